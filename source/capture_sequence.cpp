@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "capture_sequence.hpp"
+#include "pixel_kernels.hpp"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// Delta stream layout (all values little-endian):
+//   Header: "RSEQ", uint32 version, uint32 width, uint32 height
+//   Frame:  uint32 frame index, uint8 type (key or delta), uint32 payload size, payload
+// The payload is a sequence of (varint zero count, varint literal count, literal bytes) tokens covering all RGBA8 bytes of the frame.
+// Key frames encode the pixels directly, delta frames encode them XOR'ed with the previous frame, which leaves mostly zeros for static content.
+static constexpr uint32_t s_delta_stream_version = 1;
+static constexpr uint8_t s_key_frame = 0;
+static constexpr uint8_t s_delta_frame = 1;
+static constexpr uint32_t s_key_frame_interval = 60;
+static constexpr size_t s_min_zero_run = 8; // Shorter runs of zeros are cheaper to store as literals
+static constexpr uint32_t s_max_frame_dimension = 16384; // Largest texture size supported by any of the graphics APIs, which limits how much memory a corrupt file can make the reader allocate
+
+static inline uint64_t load_uint64(const uint8_t *data)
+{
+	uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+static inline bool has_zero_byte(uint64_t value)
+{
+	return ((value - 0x0101010101010101ull) & ~value & 0x8080808080808080ull) != 0;
+}
+
+static void write_uint32_le(std::vector<uint8_t> &data, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i)
+		data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+static uint32_t read_uint32_le(const uint8_t *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (uint32_t(data[3]) << 24);
+}
+
+static void write_varint(std::vector<uint8_t> &data, size_t value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	data.push_back(static_cast<uint8_t>(value));
+}
+static bool read_varint(const uint8_t *&data, const uint8_t *end, size_t &value)
+{
+	value = 0;
+	for (unsigned int shift = 0; data < end && shift < 64; shift += 7)
+	{
+		const uint8_t byte = *data++;
+		value |= size_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void encode_zero_runs(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+{
+	size_t i = 0;
+	while (i < size)
+	{
+		// Skip run of zeros
+		const size_t zeros_begin = i;
+		while (i + 8 <= size && load_uint64(data + i) == 0)
+			i += 8;
+		while (i < size && data[i] == 0)
+			i++;
+
+		const size_t zero_count = i - zeros_begin;
+
+		// Collect literals until the next run of zeros that is long enough to be worth encoding
+		const size_t literals_begin = i;
+		while (i < size)
+		{
+			while (i + 8 <= size && !has_zero_byte(load_uint64(data + i)))
+				i += 8;
+			if (i >= size)
+				break;
+			if (data[i] != 0)
+			{
+				i++;
+				continue;
+			}
+
+			size_t run_end = i;
+			while (run_end < size && run_end - i < s_min_zero_run && data[run_end] == 0)
+				run_end++;
+			if (run_end - i >= s_min_zero_run || run_end == size)
+				break;
+
+			i = run_end;
+		}
+
+		write_varint(out, zero_count);
+		write_varint(out, i - literals_begin);
+		out.insert(out.end(), data + literals_begin, data + i);
+	}
+}
+static bool decode_zero_runs(const uint8_t *data, size_t size, uint8_t *out, size_t out_size)
+{
+	const uint8_t *const end = data + size;
+
+	size_t offset = 0;
+	while (data < end)
+	{
+		size_t zero_count = 0, literal_count = 0;
+		if (!read_varint(data, end, zero_count) || !read_varint(data, end, literal_count))
+			return false;
+		if (zero_count > out_size - offset || literal_count > out_size - offset - zero_count || literal_count > size_t(end - data))
+			return false;
+
+		std::memset(out + offset, 0, zero_count);
+		offset += zero_count;
+		std::memcpy(out + offset, data, literal_count);
+		offset += literal_count;
+		data += literal_count;
+	}
+
+	return offset == out_size;
+}
+
+reshade::capture_sequence::~capture_sequence()
+{
+	finish();
+}
+
+bool reshade::capture_sequence::start(const std::filesystem::path &path, uint32_t width, uint32_t height, const settings &settings)
+{
+	finish();
+
+	if (width == 0 || height == 0 || settings.frame_count == 0)
+		return false;
+
+	_path = path;
+	_settings = settings;
+	_settings.frame_interval = std::max(_settings.frame_interval, 1u);
+	_settings.max_buffered_frames = std::max(_settings.max_buffered_frames, size_t(1));
+	_width = width;
+	_height = height;
+	_frame_counter = 0;
+	_stats = statistics();
+
+	std::error_code ec;
+	if (_settings.delta_encoding)
+	{
+		_path += L".rsq";
+
+		if (path.has_parent_path())
+			std::filesystem::create_directories(path.parent_path(), ec);
+
+		_delta_file.open(_path, std::ios::binary | std::ios::trunc);
+		if (!_delta_file)
+			return false;
+
+		std::vector<uint8_t> header = { 'R', 'S', 'E', 'Q' };
+		write_uint32_le(header, s_delta_stream_version);
+		write_uint32_le(header, width);
+		write_uint32_le(header, height);
+		_delta_file.write(reinterpret_cast<const char *>(header.data()), header.size());
+
+		_previous_frame.clear();
+		_frames_since_key_frame = 0;
+	}
+	else
+	{
+		std::filesystem::create_directories(_path, ec);
+		if (ec)
+			return false;
+
+		// Encoding images is expensive, so encode as many at the same time as the pool has threads
+		_image_writer = std::make_unique<screenshot_writer>(_pool, _pool.num_threads(), _settings.max_buffered_frames);
+	}
+
+	_frames_left = _settings.frame_count;
+	return true;
+}
+void reshade::capture_sequence::stop()
+{
+	_frames_left = 0;
+}
+void reshade::capture_sequence::finish()
+{
+	stop();
+
+	if (_image_writer != nullptr)
+	{
+		_image_writer->wait_idle();
+		get_statistics(); // Collect results of the last frames
+		_image_writer.reset();
+	}
+
+	if (_delta_file.is_open())
+	{
+		{ std::unique_lock<std::mutex> lock(_mutex);
+			_frame_written.wait(lock, [this]() { return !_delta_writer_busy; });
+
+			_free_buffers.clear();
+		}
+
+		_previous_frame.clear();
+		_delta_file.close();
+	}
+}
+
+bool reshade::capture_sequence::is_writing() const
+{
+	if (_image_writer != nullptr)
+		return _image_writer->num_pending_jobs() != 0;
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+	return !_pending_frames.empty() || _delta_writer_busy;
+}
+
+bool reshade::capture_sequence::next_frame()
+{
+	if (_frames_left == 0)
+		return false;
+
+	const bool capture = (_frame_counter % _settings.frame_interval) == 0;
+	_sequence_index = _frame_counter++;
+
+	if (capture)
+		_frames_left--;
+
+	return capture;
+}
+
+std::vector<uint8_t> reshade::capture_sequence::acquire_frame_buffer()
+{
+	const size_t size = size_t(_width) * _height * 4;
+
+	if (_image_writer != nullptr)
+		return _image_writer->acquire_buffer(size);
+
+	std::vector<uint8_t> buffer;
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		if (!_free_buffers.empty())
+		{
+			buffer = std::move(_free_buffers.back());
+			_free_buffers.pop_back();
+		}
+	}
+
+	buffer.resize(size);
+	return buffer;
+}
+
+void reshade::capture_sequence::submit_frame(uint32_t frame_index, std::vector<uint8_t> &&pixels)
+{
+	if (_image_writer != nullptr)
+	{
+		char filename[32];
+		std::snprintf(filename, sizeof(filename), "%.5u.%s", frame_index, _settings.image_format == 0 ? "bmp" : _settings.image_format == 2 ? "jpg" : "png");
+
+		screenshot_writer::job job;
+		job.path = _path / filename;
+		job.pixels = std::move(pixels);
+		job.width = _width;
+		job.height = _height;
+		job.format = _settings.image_format;
+		job.jpeg_quality = _settings.jpeg_quality;
+		job.clear_alpha = _settings.clear_alpha;
+
+		const bool queued = _image_writer->submit(std::move(job));
+
+		const std::lock_guard<std::mutex> lock(_mutex);
+		if (queued)
+			_stats.frames_captured++;
+		else
+			_stats.frames_dropped++;
+		return;
+	}
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		if (!_delta_file.is_open() || _pending_frames.size() >= _settings.max_buffered_frames)
+		{
+			// Keep the memory around for the next frame
+			_free_buffers.push_back(std::move(pixels));
+			_stats.frames_dropped++;
+			return;
+		}
+
+		_pending_frames.emplace_back(frame_index, std::move(pixels));
+		_stats.frames_captured++;
+
+		// Frames have to be written in order, so only ever have a single task writing them
+		if (_delta_writer_busy)
+			return;
+
+		_delta_writer_busy = true;
+	}
+
+	_pool.submit([this]() { write_delta_frames(); });
+}
+void reshade::capture_sequence::drop_frame()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+	_stats.frames_dropped++;
+}
+
+reshade::capture_sequence::statistics reshade::capture_sequence::get_statistics()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_image_writer != nullptr)
+	{
+		screenshot_writer::job job;
+		while (_image_writer->poll_finished(job))
+		{
+			if (job.success)
+				_stats.frames_written++;
+			else
+				_stats.frames_failed++;
+		}
+	}
+
+	return _stats;
+}
+
+void reshade::capture_sequence::write_delta_frames()
+{
+	std::vector<uint8_t> delta, data;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_pending_frames.empty())
+	{
+		auto [frame_index, pixels] = std::move(_pending_frames.front());
+		_pending_frames.pop_front();
+
+		lock.unlock();
+
+		const size_t size = pixels.size();
+		if (_settings.clear_alpha)
+			pixel_kernels::fill_alpha(pixels.data(), size / 4);
+
+		uint8_t type = s_key_frame;
+		const uint8_t *payload = pixels.data();
+		if (_previous_frame.size() == size && _frames_since_key_frame < s_key_frame_interval)
+		{
+			type = s_delta_frame;
+			delta.resize(size);
+			for (size_t i = 0; i < size; ++i)
+				delta[i] = pixels[i] ^ _previous_frame[i];
+			payload = delta.data();
+		}
+
+		data.clear();
+		write_uint32_le(data, frame_index);
+		data.push_back(type);
+		write_uint32_le(data, 0); // Placeholder for payload size
+		encode_zero_runs(payload, size, data);
+
+		const uint32_t payload_size = static_cast<uint32_t>(data.size() - 9);
+		for (int i = 0; i < 4; ++i)
+			data[5 + i] = static_cast<uint8_t>(payload_size >> (i * 8));
+
+		const bool success = !!_delta_file.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+		_frames_since_key_frame = (type == s_key_frame) ? 1 : _frames_since_key_frame + 1;
+
+		// Keep the current frame as reference for the next one and recycle the old reference buffer
+		_previous_frame.swap(pixels);
+
+		lock.lock();
+
+		if (success)
+			_stats.frames_written++;
+		else
+			_stats.frames_failed++;
+
+		if (!pixels.empty() && _free_buffers.size() < _settings.max_buffered_frames + 1)
+			_free_buffers.push_back(std::move(pixels));
+	}
+
+	_delta_writer_busy = false;
+
+	// Notify while still holding the lock, since the sequence may be destroyed as soon as a waiting thread sees that the writer is done
+	_frame_written.notify_all();
+}
+
+bool reshade::capture_sequence::read_delta_stream(const std::filesystem::path &path, const std::function<bool(uint32_t width, uint32_t height, uint32_t frame_index, const uint8_t *pixels)> &callback)
+{
+	std::error_code ec;
+	const uintmax_t file_size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	uint8_t header[16];
+	if (!file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+		std::memcmp(header, "RSEQ", 4) != 0 || read_uint32_le(header + 4) != s_delta_stream_version)
+		return false;
+
+	const uint32_t width = read_uint32_le(header + 8);
+	const uint32_t height = read_uint32_le(header + 12);
+	if (width == 0 || width > s_max_frame_dimension || height == 0 || height > s_max_frame_dimension)
+		return false;
+
+	std::vector<uint8_t> pixels, decoded, payload;
+	bool has_previous_frame = false;
+
+	while (true)
+	{
+		uint8_t frame_header[9];
+		if (!file.read(reinterpret_cast<char *>(frame_header), sizeof(frame_header)))
+			return file.gcount() == 0; // Reaching the end of the file between frames is fine
+
+		const uint32_t frame_index = read_uint32_le(frame_header);
+		const uint8_t type = frame_header[4];
+
+		// Check the payload size against what is left in the file before allocating anything for it
+		const uint32_t payload_size = read_uint32_le(frame_header + 5);
+		if (payload_size > file_size - static_cast<uintmax_t>(file.tellg()))
+			return false;
+
+		payload.resize(payload_size);
+		if (!file.read(reinterpret_cast<char *>(payload.data()), payload.size()))
+			return false;
+
+		decoded.resize(size_t(width) * height * 4);
+		if (!decode_zero_runs(payload.data(), payload.size(), decoded.data(), decoded.size()))
+			return false;
+
+		if (type == s_key_frame)
+		{
+			pixels.swap(decoded);
+		}
+		else if (type == s_delta_frame && has_previous_frame)
+		{
+			for (size_t i = 0; i < pixels.size(); ++i)
+				pixels[i] ^= decoded[i];
+		}
+		else
+		{
+			return false;
+		}
+
+		has_previous_frame = true;
+
+		if (!callback(width, height, frame_index, pixels.data()))
+			return true;
+	}
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "screenshot_writer.hpp"
+#include <memory>
+#include <fstream>
+#include <functional>
+
+namespace reshade
+{
+	/// <summary>
+	/// Records a sequence of consecutive frames to disk, either as individual images or as a single lossless delta-encoded stream.
+	/// Frames are buffered in a bounded queue and written on the threads of a pool. If writing cannot keep up, new frames are dropped rather than stalling the caller.
+	/// </summary>
+	class capture_sequence
+	{
+	public:
+		struct settings
+		{
+			uint32_t frame_count = 60; // Number of frames to capture
+			uint32_t frame_interval = 1; // Capture every Nth frame
+			bool delta_encoding = false; // Write a single delta-encoded stream instead of individual images
+			unsigned int image_format = 1; // Image format when not using delta encoding (see 'screenshot_writer::job::format')
+			unsigned int jpeg_quality = 90;
+			bool clear_alpha = true;
+			size_t max_buffered_frames = 8; // Number of frames that may wait for writing before new ones are dropped
+		};
+
+		struct statistics
+		{
+			uint32_t frames_captured = 0;
+			uint32_t frames_written = 0;
+			uint32_t frames_dropped = 0;
+			uint32_t frames_failed = 0;
+		};
+
+		/// <summary>
+		/// Create a capture sequence that writes frames on the specified thread pool.
+		/// </summary>
+		explicit capture_sequence(thread_pool &pool) : _pool(pool) {}
+		~capture_sequence();
+
+		capture_sequence(const capture_sequence &) = delete;
+		capture_sequence &operator=(const capture_sequence &) = delete;
+
+		/// <summary>
+		/// Start recording a new sequence. Any previous sequence is finished first.
+		/// </summary>
+		/// <param name="path">Base path of the output. Images are written to a directory of that name, a delta stream to a file of that name with a ".rsq" extension.</param>
+		/// <param name="width">The width of the frames.</param>
+		/// <param name="height">The height of the frames.</param>
+		/// <param name="settings">The capture settings.</param>
+		bool start(const std::filesystem::path &path, uint32_t width, uint32_t height, const settings &settings);
+		/// <summary>
+		/// Stop capturing new frames. Frames that were already captured are still written in the background.
+		/// </summary>
+		void stop();
+		/// <summary>
+		/// Block until all captured frames were written and the output is closed.
+		/// </summary>
+		void finish();
+
+		/// <summary>
+		/// Returns whether frames are still being captured.
+		/// </summary>
+		bool is_capturing() const { return _frames_left != 0; }
+		/// <summary>
+		/// Returns whether there are captured frames still being written.
+		/// </summary>
+		bool is_writing() const;
+		/// <summary>
+		/// Returns the base path of the current (or last) sequence.
+		/// </summary>
+		const std::filesystem::path &path() const { return _path; }
+
+		/// <summary>
+		/// Advance to the next frame and return whether it should be captured.
+		/// Call this once per presented frame.
+		/// </summary>
+		bool next_frame();
+		/// <summary>
+		/// Returns the index of the current frame in the sequence.
+		/// </summary>
+		uint32_t frame_index() const { return _sequence_index; }
+		/// <summary>
+		/// Get a buffer to capture the current frame into, reusing the memory of already written frames if possible.
+		/// </summary>
+		std::vector<uint8_t> acquire_frame_buffer();
+		/// <summary>
+		/// Queue a captured frame for writing. The frame is dropped (and counted as such) if too many frames are waiting already.
+		/// Frames have to be submitted in order, but may be submitted after later frames were advanced to (e.g. when their pixel data is read back asynchronously).
+		/// </summary>
+		/// <param name="frame_index">The index of the frame, as returned by <see cref="frame_index"/> when it was advanced to.</param>
+		/// <param name="pixels">The RGBA8 pixel data of the frame.</param>
+		void submit_frame(uint32_t frame_index, std::vector<uint8_t> &&pixels);
+		/// <summary>
+		/// Count a frame as dropped, e.g. because it could not be captured.
+		/// </summary>
+		void drop_frame();
+
+		/// <summary>
+		/// Get the statistics of the current (or last) sequence.
+		/// </summary>
+		statistics get_statistics();
+
+		/// <summary>
+		/// Read back all frames of a delta-encoded stream written by this class.
+		/// </summary>
+		/// <param name="path">The path to the ".rsq" file.</param>
+		/// <param name="callback">Function that is called with the index and RGBA8 pixel data of each frame in order. Return <c>false</c> to stop reading.</param>
+		/// <returns><c>true</c> if the file was read successfully, <c>false</c> if it is invalid.</returns>
+		static bool read_delta_stream(const std::filesystem::path &path, const std::function<bool(uint32_t width, uint32_t height, uint32_t frame_index, const uint8_t *pixels)> &callback);
+
+	private:
+		void write_delta_frames();
+
+		std::filesystem::path _path;
+		settings _settings;
+		uint32_t _width = 0, _height = 0;
+		uint32_t _frames_left = 0;
+		uint32_t _frame_counter = 0;
+		uint32_t _sequence_index = 0;
+		statistics _stats;
+		thread_pool &_pool;
+
+		// Writer for individual images
+		std::unique_ptr<screenshot_writer> _image_writer;
+
+		// Writer for the delta stream
+		mutable std::mutex _mutex;
+		std::condition_variable _frame_written;
+		std::deque<std::pair<uint32_t, std::vector<uint8_t>>> _pending_frames;
+		std::vector<std::vector<uint8_t>> _free_buffers;
+		std::vector<uint8_t> _previous_frame;
+		uint32_t _frames_since_key_frame = 0;
+		std::ofstream _delta_file;
+		bool _delta_writer_busy = false;
+	};
+}
@@ -9,6 +9,7 @@
 #include "runtime_d3d10.hpp"
 #include "runtime_objects.hpp"
 #include "dxgi/format_utils.hpp"
+#include "pixel_kernels.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
@@ -223,6 +224,9 @@ void reshade::d3d10::runtime_d3d10::on_reset()
 {
 	runtime::on_reset();
 
+	for (com_ptr<ID3D10Texture2D> &texture : _readback_textures)
+		texture.reset();
+
 	_backbuffer.reset();
 	_backbuffer_resolved.reset();
 	_backbuffer_rtv[0].reset();
@@ -325,6 +329,53 @@ bool reshade::d3d10::runtime_d3d10::capture_screenshot(uint8_t *buffer) const
 	}
 
 	// Create a texture in system memory, copy back buffer data into it and map it for reading
+	com_ptr<ID3D10Texture2D> intermediate;
+	if (!create_screenshot_texture(intermediate))
+		return false;
+
+	_device->CopyResource(intermediate.get(), _backbuffer_resolved.get());
+
+	D3D10_MAPPED_TEXTURE2D mapped;
+	if (FAILED(intermediate->Map(0, D3D10_MAP_READ, 0, &mapped)))
+		return false;
+	copy_screenshot_rows(buffer, static_cast<const uint8_t *>(mapped.pData), mapped.RowPitch);
+	intermediate->Unmap(0);
+
+	return true;
+}
+
+bool reshade::d3d10::runtime_d3d10::begin_frame_readback(uint32_t slot)
+{
+	// Unsupported formats are reported by 'capture_screenshot'
+	if (_color_bit_depth != 8 && _color_bit_depth != 10)
+		return false;
+
+	com_ptr<ID3D10Texture2D> &intermediate = _readback_textures[slot];
+	if (intermediate == nullptr && !create_screenshot_texture(intermediate))
+		return false;
+
+	_device->CopyResource(intermediate.get(), _backbuffer_resolved.get());
+
+	return true;
+}
+reshade::runtime::readback_status reshade::d3d10::runtime_d3d10::finish_frame_readback(uint32_t slot, uint8_t *buffer)
+{
+	const com_ptr<ID3D10Texture2D> &intermediate = _readback_textures[slot];
+
+	// Do not block if the copy has not finished yet, just try again next frame
+	D3D10_MAPPED_TEXTURE2D mapped;
+	if (const HRESULT hr = intermediate->Map(0, D3D10_MAP_READ, D3D10_MAP_FLAG_DO_NOT_WAIT, &mapped); hr == DXGI_ERROR_WAS_STILL_DRAWING)
+		return readback_status::pending;
+	else if (FAILED(hr))
+		return readback_status::failed;
+	copy_screenshot_rows(buffer, static_cast<const uint8_t *>(mapped.pData), mapped.RowPitch);
+	intermediate->Unmap(0);
+
+	return readback_status::available;
+}
+
+bool reshade::d3d10::runtime_d3d10::create_screenshot_texture(com_ptr<ID3D10Texture2D> &texture) const
+{
 	D3D10_TEXTURE2D_DESC desc = {};
 	desc.Width = _width;
 	desc.Height = _height;
@@ -335,52 +386,34 @@ bool reshade::d3d10::runtime_d3d10::capture_screenshot(uint8_t *buffer) const
 	desc.Usage = D3D10_USAGE_STAGING;
 	desc.CPUAccessFlags = D3D10_CPU_ACCESS_READ;
 
-	com_ptr<ID3D10Texture2D> intermediate;
-	if (HRESULT hr = _device->CreateTexture2D(&desc, nullptr, &intermediate); FAILED(hr))
+	if (HRESULT hr = _device->CreateTexture2D(&desc, nullptr, &texture); FAILED(hr))
 	{
 		LOG(ERROR) << "Failed to create system memory texture for screenshot capture! HRESULT is " << hr << '.';
 		LOG(DEBUG) << "> Details: Width = " << desc.Width << ", Height = " << desc.Height << ", Format = " << desc.Format;
 		return false;
 	}
 
-	_device->CopyResource(intermediate.get(), _backbuffer_resolved.get());
-
-	D3D10_MAPPED_TEXTURE2D mapped;
-	if (FAILED(intermediate->Map(0, D3D10_MAP_READ, 0, &mapped)))
-		return false;
-	auto mapped_data = static_cast<const uint8_t *>(mapped.pData);
-
-	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += mapped.RowPitch)
+	return true;
+}
+void reshade::d3d10::runtime_d3d10::copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data, UINT row_pitch) const
+{
+	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += row_pitch)
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-			}
+			pixel_kernels::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width);
+		}
+		else if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+			_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel_kernels::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, pitch);
-
-			if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-				_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
-
-	intermediate->Unmap(0);
-
-	return true;
 }
 
 bool reshade::d3d10::runtime_d3d10::init_effect(size_t index)
@@ -962,7 +995,7 @@ void reshade::d3d10::runtime_d3d10::render_technique(technique &technique)
 			impl->timestamp_query_end->GetData(&timestamp1, sizeof(timestamp1), D3D10_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
 		{
 			if (!disjoint.Disjoint)
-				technique.average_gpu_duration.append((timestamp1 - timestamp0) * 1'000'000'000 / disjoint.Frequency);
+				technique.record_gpu_duration((timestamp1 - timestamp0) * 1'000'000'000 / disjoint.Frequency);
 			impl->query_in_flight = false;
 		}
 	}
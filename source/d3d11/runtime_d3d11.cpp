@@ -8,13 +8,18 @@
 #include "dll_resources.hpp"
 #include "runtime_d3d11.hpp"
 #include "runtime_objects.hpp"
+#include "timestamp_query_ring.hpp"
 #include "dxgi/format_utils.hpp"
+#include "pixel_kernels.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
 
 namespace reshade::d3d11
 {
+	// Number of frames the timestamp queries of a technique can be in flight before measurements are skipped
+	static constexpr uint32_t NUM_QUERY_FRAMES = 4;
+
 	struct tex_data
 	{
 		com_ptr<ID3D11Texture2D> texture;
@@ -42,10 +47,9 @@ namespace reshade::d3d11
 
 	struct technique_data
 	{
-		bool query_in_flight = false;
-		com_ptr<ID3D11Query> timestamp_disjoint;
-		com_ptr<ID3D11Query> timestamp_query_beg;
-		com_ptr<ID3D11Query> timestamp_query_end;
+		timestamp_query_ring query_ring;
+		std::vector<com_ptr<ID3D11Query>> timestamp_disjoint; // One per slot in the query ring
+		std::vector<com_ptr<ID3D11Query>> timestamp_queries;
 		std::vector<com_ptr<ID3D11SamplerState>> sampler_states;
 		std::vector<pass_data> passes;
 	};
@@ -248,6 +252,9 @@ void reshade::d3d11::runtime_d3d11::on_reset()
 
 	runtime::on_reset();
 
+	for (com_ptr<ID3D11Texture2D> &texture : _readback_textures)
+		texture.reset();
+
 	_backbuffer.reset();
 	_backbuffer_resolved.reset();
 	_backbuffer_rtv[0].reset();
@@ -352,6 +359,53 @@ bool reshade::d3d11::runtime_d3d11::capture_screenshot(uint8_t *buffer) const
 	}
 
 	// Create a texture in system memory, copy back buffer data into it and map it for reading
+	com_ptr<ID3D11Texture2D> intermediate;
+	if (!create_screenshot_texture(intermediate))
+		return false;
+
+	_immediate_context->CopyResource(intermediate.get(), _backbuffer_resolved.get());
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(_immediate_context->Map(intermediate.get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		return false;
+	copy_screenshot_rows(buffer, static_cast<const uint8_t *>(mapped.pData), mapped.RowPitch);
+	_immediate_context->Unmap(intermediate.get(), 0);
+
+	return true;
+}
+
+bool reshade::d3d11::runtime_d3d11::begin_frame_readback(uint32_t slot)
+{
+	// Unsupported formats are reported by 'capture_screenshot'
+	if (_color_bit_depth != 8 && _color_bit_depth != 10)
+		return false;
+
+	com_ptr<ID3D11Texture2D> &intermediate = _readback_textures[slot];
+	if (intermediate == nullptr && !create_screenshot_texture(intermediate))
+		return false;
+
+	_immediate_context->CopyResource(intermediate.get(), _backbuffer_resolved.get());
+
+	return true;
+}
+reshade::runtime::readback_status reshade::d3d11::runtime_d3d11::finish_frame_readback(uint32_t slot, uint8_t *buffer)
+{
+	const com_ptr<ID3D11Texture2D> &intermediate = _readback_textures[slot];
+
+	// Do not block if the copy has not finished yet, just try again next frame
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (const HRESULT hr = _immediate_context->Map(intermediate.get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped); hr == DXGI_ERROR_WAS_STILL_DRAWING)
+		return readback_status::pending;
+	else if (FAILED(hr))
+		return readback_status::failed;
+	copy_screenshot_rows(buffer, static_cast<const uint8_t *>(mapped.pData), mapped.RowPitch);
+	_immediate_context->Unmap(intermediate.get(), 0);
+
+	return readback_status::available;
+}
+
+bool reshade::d3d11::runtime_d3d11::create_screenshot_texture(com_ptr<ID3D11Texture2D> &texture) const
+{
 	D3D11_TEXTURE2D_DESC desc = {};
 	desc.Width = _width;
 	desc.Height = _height;
@@ -362,53 +416,35 @@ bool reshade::d3d11::runtime_d3d11::capture_screenshot(uint8_t *buffer) const
 	desc.Usage = D3D11_USAGE_STAGING;
 	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
 
-	com_ptr<ID3D11Texture2D> intermediate;
-	if (HRESULT hr = _device->CreateTexture2D(&desc, nullptr, &intermediate); FAILED(hr))
+	if (HRESULT hr = _device->CreateTexture2D(&desc, nullptr, &texture); FAILED(hr))
 	{
 		LOG(ERROR) << "Failed to create system memory texture for screenshot capture! HRESULT is " << hr << '.';
 		LOG(DEBUG) << "> Details: Width = " << desc.Width << ", Height = " << desc.Height << ", Format = " << desc.Format;
 		return false;
 	}
-	set_debug_name(intermediate.get(), L"ReShade screenshot texture");
-
-	_immediate_context->CopyResource(intermediate.get(), _backbuffer_resolved.get());
+	set_debug_name(texture.get(), L"ReShade screenshot texture");
 
-	D3D11_MAPPED_SUBRESOURCE mapped;
-	if (FAILED(_immediate_context->Map(intermediate.get(), 0, D3D11_MAP_READ, 0, &mapped)))
-		return false;
-	auto mapped_data = static_cast<const uint8_t *>(mapped.pData);
-
-	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += mapped.RowPitch)
+	return true;
+}
+void reshade::d3d11::runtime_d3d11::copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data, UINT row_pitch) const
+{
+	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += row_pitch)
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-			}
+			pixel_kernels::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width);
+		}
+		else if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+			_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel_kernels::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, pitch);
-
-			if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-				_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
-
-	_immediate_context->Unmap(intermediate.get(), 0);
-
-	return true;
 }
 
 bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
@@ -621,12 +657,19 @@ bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
 		auto impl = new technique_data(technique_init);
 		technique.impl = impl;
 
+		// Write a timestamp before the first and after each pass, unless there are too many passes, in which case only the entire technique is measured
+		const uint32_t num_timestamps = technique.passes.size() < timestamp_query_ring::MAX_TIMESTAMPS ? static_cast<uint32_t>(technique.passes.size() + 1) : 2;
+		impl->query_ring = timestamp_query_ring(NUM_QUERY_FRAMES, num_timestamps);
+		impl->timestamp_disjoint.resize(NUM_QUERY_FRAMES);
+		impl->timestamp_queries.resize(NUM_QUERY_FRAMES * num_timestamps);
+
 		D3D11_QUERY_DESC query_desc = {};
 		query_desc.Query = D3D11_QUERY_TIMESTAMP;
-		_device->CreateQuery(&query_desc, &impl->timestamp_query_beg);
-		_device->CreateQuery(&query_desc, &impl->timestamp_query_end);
+		for (com_ptr<ID3D11Query> &query : impl->timestamp_queries)
+			_device->CreateQuery(&query_desc, &query);
 		query_desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
-		_device->CreateQuery(&query_desc, &impl->timestamp_disjoint);
+		for (com_ptr<ID3D11Query> &query : impl->timestamp_disjoint)
+			_device->CreateQuery(&query_desc, &query);
 
 		impl->passes.resize(technique.passes.size());
 		for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
@@ -1038,26 +1081,34 @@ void reshade::d3d11::runtime_d3d11::render_technique(technique &technique)
 	const auto impl = static_cast<technique_data *>(technique.impl);
 	effect_data &effect_data = _effect_data[technique.effect_index];
 
-	// Evaluate queries
-	if (impl->query_in_flight)
-	{
-		UINT64 timestamp0, timestamp1;
-		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	// Evaluate queries of previous frames that finished
+	impl->query_ring.collect(
+		[this, impl](uint32_t slot, uint64_t *timestamps) {
+			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+			if (_immediate_context->GetData(impl->timestamp_disjoint[slot].get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				return timestamp_query_ring::status::pending;
 
-		if (_immediate_context->GetData(impl->timestamp_disjoint.get(),  &disjoint,   sizeof(disjoint),   D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
-			_immediate_context->GetData(impl->timestamp_query_beg.get(), &timestamp0, sizeof(timestamp0), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
-			_immediate_context->GetData(impl->timestamp_query_end.get(), &timestamp1, sizeof(timestamp1), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
-		{
-			if (!disjoint.Disjoint)
-				technique.average_gpu_duration.append((timestamp1 - timestamp0) * 1'000'000'000 / disjoint.Frequency);
-			impl->query_in_flight = false;
-		}
-	}
+			for (uint32_t i = 0; i < impl->query_ring.num_timestamps(); ++i)
+			{
+				if (_immediate_context->GetData(impl->timestamp_queries[impl->query_ring.query_index(slot, i)].get(), &timestamps[i], sizeof(*timestamps), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+					return timestamp_query_ring::status::pending;
+			}
+
+			if (disjoint.Disjoint || disjoint.Frequency == 0)
+				return timestamp_query_ring::status::invalid;
 
-	if (!impl->query_in_flight)
+			return timestamp_query_ring::convert_ticks_to_nanoseconds(timestamps, impl->query_ring.num_timestamps(), 1'000'000'000.0 / disjoint.Frequency);
+		},
+		[&technique](const uint64_t *timestamps, uint32_t num_timestamps) {
+			technique.record_gpu_timestamps(timestamps, num_timestamps);
+		});
+
+	// Skip measuring this frame if the queries of all previous frames in the ring are still in flight
+	const uint32_t query_slot = impl->query_ring.acquire();
+	if (query_slot != timestamp_query_ring::no_slot)
 	{
-		_immediate_context->Begin(impl->timestamp_disjoint.get());
-		_immediate_context->End(impl->timestamp_query_beg.get());
+		_immediate_context->Begin(impl->timestamp_disjoint[query_slot].get());
+		_immediate_context->End(impl->timestamp_queries[impl->query_ring.query_index(query_slot, 0)].get());
 	}
 
 	// Setup vertex input (no explicit vertices are provided, so bind to null)
@@ -1215,15 +1266,19 @@ void reshade::d3d11::runtime_d3d11::render_technique(technique &technique)
 			if (resource_desc.Texture2D.MipLevels > 1)
 				_immediate_context->GenerateMips(resource.get());
 		}
+
+		// The timestamp after the last pass is written below
+		if (query_slot != timestamp_query_ring::no_slot && pass_index + 2 < impl->query_ring.num_timestamps())
+			_immediate_context->End(impl->timestamp_queries[impl->query_ring.query_index(query_slot, static_cast<uint32_t>(pass_index + 1))].get());
 	}
 
-	if (!impl->query_in_flight)
+	if (query_slot != timestamp_query_ring::no_slot)
 	{
-		_immediate_context->End(impl->timestamp_query_end.get());
-		_immediate_context->End(impl->timestamp_disjoint.get());
-	}
+		_immediate_context->End(impl->timestamp_queries[impl->query_ring.query_index(query_slot, impl->query_ring.num_timestamps() - 1)].get());
+		_immediate_context->End(impl->timestamp_disjoint[query_slot].get());
 
-	impl->query_in_flight = true;
+		impl->query_ring.submit(query_slot);
+	}
 }
 
 void reshade::d3d11::runtime_d3d11::set_debug_name(ID3D11DeviceChild *object, LPCWSTR name) const
@@ -24,6 +24,12 @@ namespace reshade::d3d11
 		bool capture_screenshot(uint8_t *buffer) const override;
 
 	private:
+		bool begin_frame_readback(uint32_t slot) override;
+		readback_status finish_frame_readback(uint32_t slot, uint8_t *buffer) override;
+
+		bool create_screenshot_texture(com_ptr<ID3D11Texture2D> &texture) const;
+		void copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data, UINT row_pitch) const;
+
 		bool init_effect(size_t index) override;
 		void unload_effect(size_t index) override;
 		void unload_effects() override;
@@ -48,6 +54,7 @@ namespace reshade::d3d11
 		com_ptr<ID3D11RenderTargetView> _backbuffer_rtv[3];
 		com_ptr<ID3D11Texture2D> _backbuffer_texture;
 		com_ptr<ID3D11ShaderResourceView> _backbuffer_texture_srv[2];
+		com_ptr<ID3D11Texture2D> _readback_textures[NUM_READBACK_SLOTS];
 
 		com_ptr<ID3D11PixelShader> _copy_pixel_shader;
 		com_ptr<ID3D11VertexShader> _copy_vertex_shader;
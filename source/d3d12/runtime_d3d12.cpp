@@ -10,6 +10,7 @@
 #include "runtime_d3d12.hpp"
 #include "runtime_objects.hpp"
 #include "dxgi/format_utils.hpp"
+#include "pixel_kernels.hpp"
 #include <CoreWindow.h>
 #include <imgui.h>
 #include <imgui_internal.h>
@@ -18,6 +19,12 @@
 #define D3D12_RESOURCE_STATE_SHADER_RESOURCE \
 	(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
 
+static inline uint32_t get_screenshot_row_pitch(uint32_t width)
+{
+	// Rows in buffers that are copied to from textures have to be aligned
+	return (width * 4 + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
+}
+
 namespace reshade::d3d12
 {
 	struct tex_data
@@ -339,6 +346,9 @@ void reshade::d3d12::runtime_d3d12::on_reset()
 	_cmd_list.reset();
 	_cmd_alloc.clear();
 
+	for (com_ptr<ID3D12Resource> &buffer : _readback_buffers)
+		buffer.reset();
+
 	if (_fence_event != nullptr)
 	{
 		CloseHandle(_fence_event);
@@ -484,11 +494,71 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 		return false;
 	}
 
-	const uint32_t data_pitch = _width * 4;
-	const uint32_t download_pitch = (data_pitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
+	com_ptr<ID3D12Resource> intermediate;
+	if (!create_screenshot_buffer(intermediate))
+		return false;
+
+	if (!begin_command_list())
+		return false;
+
+	record_screenshot_copy(intermediate.get());
+
+	// Execute and wait for completion
+	if (!wait_for_command_queue())
+		return false;
+
+	// Copy data from system memory texture into output buffer
+	uint8_t *mapped_data;
+	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
+		return false;
+	copy_screenshot_rows(buffer, mapped_data);
+	intermediate->Unmap(0, nullptr);
+
+	return true;
+}
+
+bool reshade::d3d12::runtime_d3d12::begin_frame_readback(uint32_t slot)
+{
+	// Unsupported formats are reported by 'capture_screenshot'
+	if (_color_bit_depth != 8 && _color_bit_depth != 10)
+		return false;
+
+	com_ptr<ID3D12Resource> &intermediate = _readback_buffers[slot];
+	if (intermediate == nullptr && !create_screenshot_buffer(intermediate))
+		return false;
+
+	if (!begin_command_list())
+		return false;
+
+	record_screenshot_copy(intermediate.get());
+
+	// The copy is executed with the rest of this frame, after which the fence for the current back buffer is signaled with the next value (see 'on_present')
+	_readback_swap_index[slot] = _swap_index;
+	_readback_fence_value[slot] = _fence_value[_swap_index] + 1;
+
+	return true;
+}
+reshade::runtime::readback_status reshade::d3d12::runtime_d3d12::finish_frame_readback(uint32_t slot, uint8_t *buffer)
+{
+	// Do not block if the copy has not finished yet, just try again next frame
+	if (_fence[_readback_swap_index[slot]]->GetCompletedValue() < _readback_fence_value[slot])
+		return readback_status::pending;
 
+	const com_ptr<ID3D12Resource> &intermediate = _readback_buffers[slot];
+
+	uint8_t *mapped_data;
+	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
+		return readback_status::failed;
+	copy_screenshot_rows(buffer, mapped_data);
+	intermediate->Unmap(0, nullptr);
+
+	return readback_status::available;
+}
+
+bool reshade::d3d12::runtime_d3d12::create_screenshot_buffer(com_ptr<ID3D12Resource> &buffer) const
+{
 	D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
-	desc.Width = _height * download_pitch;
+	desc.Width = _height * get_screenshot_row_pitch(_width);
 	desc.Height = 1;
 	desc.DepthOrArraySize = 1;
 	desc.MipLevels = 1;
@@ -496,18 +566,18 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 	D3D12_HEAP_PROPERTIES props = { D3D12_HEAP_TYPE_READBACK };
 
-	com_ptr<ID3D12Resource> intermediate;
-	if (HRESULT hr = _device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&intermediate)); FAILED(hr))
+	if (HRESULT hr = _device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&buffer)); FAILED(hr))
 	{
 		LOG(ERROR) << "Failed to create system memory texture for screenshot capture! HRESULT is " << hr << '.';
 		LOG(DEBUG) << "> Details: Width = " << desc.Width;
 		return false;
 	}
-	intermediate->SetName(L"ReShade screenshot texture");
-
-	if (!begin_command_list())
-		return false;
+	buffer->SetName(L"ReShade screenshot texture");
 
+	return true;
+}
+void reshade::d3d12::runtime_d3d12::record_screenshot_copy(ID3D12Resource *buffer) const
+{
 	// Was transitioned to D3D12_RESOURCE_STATE_RENDER_TARGET in 'on_present' already
 	transition_state(_cmd_list, _backbuffers[_swap_index], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE, 0);
 	{
@@ -515,58 +585,40 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 		src_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 		src_location.SubresourceIndex = 0;
 
-		D3D12_TEXTURE_COPY_LOCATION dst_location = { intermediate.get() };
+		D3D12_TEXTURE_COPY_LOCATION dst_location = { buffer };
 		dst_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
 		dst_location.PlacedFootprint.Footprint.Width = _width;
 		dst_location.PlacedFootprint.Footprint.Height = _height;
 		dst_location.PlacedFootprint.Footprint.Depth = 1;
 		dst_location.PlacedFootprint.Footprint.Format = make_dxgi_format_normal(_backbuffer_format);
-		dst_location.PlacedFootprint.Footprint.RowPitch = download_pitch;
+		dst_location.PlacedFootprint.Footprint.RowPitch = get_screenshot_row_pitch(_width);
 
 		_cmd_list->CopyTextureRegion(&dst_location, 0, 0, 0, &src_location, nullptr);
 	}
 	transition_state(_cmd_list, _backbuffers[_swap_index], D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET, 0);
-
-	// Execute and wait for completion
-	if (!wait_for_command_queue())
-		return false;
-
-	// Copy data from system memory texture into output buffer
-	uint8_t *mapped_data;
-	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
-		return false;
+}
+void reshade::d3d12::runtime_d3d12::copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data) const
+{
+	const uint32_t data_pitch = _width * 4;
+	const uint32_t download_pitch = get_screenshot_row_pitch(_width);
 
 	for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += download_pitch)
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < data_pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-			}
+			pixel_kernels::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width);
+		}
+		else if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+			_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel_kernels::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, data_pitch);
-
-			if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-				_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < data_pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
-
-	intermediate->Unmap(0, nullptr);
-
-	return true;
 }
 
 bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
@@ -28,6 +28,13 @@ namespace reshade::d3d12
 		bool capture_screenshot(uint8_t *buffer) const override;
 
 	private:
+		bool begin_frame_readback(uint32_t slot) override;
+		readback_status finish_frame_readback(uint32_t slot, uint8_t *buffer) override;
+
+		bool create_screenshot_buffer(com_ptr<ID3D12Resource> &buffer) const;
+		void record_screenshot_copy(ID3D12Resource *buffer) const;
+		void copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data) const;
+
 		bool init_effect(size_t index) override;
 		void unload_effect(size_t index) override;
 		void unload_effects() override;
@@ -65,6 +72,9 @@ namespace reshade::d3d12
 		DXGI_FORMAT _backbuffer_format = DXGI_FORMAT_UNKNOWN;
 		std::vector<com_ptr<ID3D12Resource>> _backbuffers;
 		com_ptr<ID3D12Resource> _backbuffer_texture;
+		com_ptr<ID3D12Resource> _readback_buffers[NUM_READBACK_SLOTS];
+		UINT _readback_swap_index[NUM_READBACK_SLOTS] = {};
+		UINT64 _readback_fence_value[NUM_READBACK_SLOTS] = {};
 		com_ptr<ID3D12DescriptorHeap> _backbuffer_rtvs;
 		com_ptr<ID3D12DescriptorHeap> _depthstencil_dsvs;
 
@@ -7,6 +7,7 @@
 #include "dll_config.hpp"
 #include "runtime_d3d9.hpp"
 #include "runtime_objects.hpp"
+#include "pixel_kernels.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
@@ -309,29 +310,17 @@ bool reshade::d3d9::runtime_d3d9::capture_screenshot(uint8_t *buffer) const
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-				if (_backbuffer_format == D3DFMT_A2R10G10B10)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
+			pixel_kernels::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width, _backbuffer_format == D3DFMT_A2R10G10B10);
+		}
+		else if (_backbuffer_format == D3DFMT_A8R8G8B8 ||
+			_backbuffer_format == D3DFMT_X8R8G8B8)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel_kernels::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, pitch);
-
-			if (_backbuffer_format == D3DFMT_A8R8G8B8 ||
-				_backbuffer_format == D3DFMT_X8R8G8B8)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
 
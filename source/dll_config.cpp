@@ -4,16 +4,374 @@
  */
 
 #include "dll_config.hpp"
+#include <limits>
 #include <cassert>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <unordered_set>
+#include <condition_variable>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define INI_FILE_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanForward
+#endif
+#else
+#define INI_FILE_SSE2 0
+#endif
+
+/// <summary>
+/// Writes modified INI files on a background thread, so that saving them does not block the caller.
+/// The thread is only running while there are files to write and exits on its own afterwards.
+/// On Windows it keeps a reference to the module instead of being joined (see 'start_ini_writer_thread'), elsewhere it is joined before the next one is started and when background writes are stopped.
+/// </summary>
+static struct ini_writer
+{
+	struct job
+	{
+		std::filesystem::path path;
+		std::string data;
+		std::filesystem::file_time_type modified_at;
+	};
+
+	std::mutex mutex;
+	std::condition_variable idle;
+	bool enabled = true; // Whether files may be written by a background writer thread
+	bool running = false; // Whether a background writer thread currently exists
+	bool write_without_lock = false; // Set when all other threads were terminated (which may have happened while the writer thread held the lock)
+	bool failed = false;
+	std::wstring current_path; // Path of the file currently being written
+	job current; // Kept until the write finished, so that it can be repeated if the writer thread was terminated in the middle of it
+	std::unordered_map<std::wstring, job> pending; // Only the latest data is kept for every file, so multiple saves of the same file in quick succession are coalesced into a single write
+	std::unordered_map<std::wstring, std::filesystem::file_time_type> written_times; // Last write time of every file after it was written from here
+#ifndef _WIN32
+	std::thread thread;
+
+	~ini_writer()
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+#endif
+} g_ini_writer;
+
+/// <summary>
+/// Notifies about changes to the cached files in a directory, so that they do not have to be checked individually on every access.
+/// </summary>
+struct directory_watcher
+{
+	directory_watcher() = default;
+	~directory_watcher()
+	{
+		close();
+	}
+
+	directory_watcher(const directory_watcher &) = delete;
+	directory_watcher &operator=(const directory_watcher &) = delete;
+
+	void close()
+	{
+#ifdef _WIN32
+		if (handle != nullptr)
+		{
+			// Wait for the pending read to be canceled, since the system would otherwise still write to the buffer afterwards
+			DWORD size = 0;
+			CancelIoEx(handle, &overlapped);
+			GetOverlappedResult(handle, &overlapped, &size, TRUE);
+			CloseHandle(handle);
+			handle = nullptr;
+		}
+		if (overlapped.hEvent != nullptr)
+		{
+			CloseHandle(overlapped.hEvent);
+			overlapped.hEvent = nullptr;
+		}
+#endif
+	}
+
+#ifdef _WIN32
+	bool read_changes()
+	{
+		return ReadDirectoryChangesW(handle, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr) != FALSE;
+	}
 
+	OVERLAPPED overlapped = {};
+	alignas(DWORD) uint8_t buffer[4096];
+#endif
+
+	void *handle = nullptr;
+	size_t generation = 1;
+	std::unordered_set<std::wstring> file_names; // Lower case names of the cached files in the directory, since changes to other files (like the log) do not matter
+};
+
+static std::unordered_map<std::wstring, directory_watcher> g_directory_watchers;
+// Declare cache after the writer, so that cached files are destroyed (and saved) while the writer state is still valid
 static std::unordered_map<std::wstring, reshade::ini_file> g_ini_cache;
 
+static constexpr size_t storage_block_size = 4096;
+
+static inline bool is_space(char c)
+{
+	return c == ' ' || c == '\t';
+}
+static inline char to_upper(char c)
+{
+	return c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c;
+}
+
+static std::string_view trim(std::string_view str, const char chars[] = " \t")
+{
+	const size_t first = str.find_first_not_of(chars);
+	if (first == std::string_view::npos)
+		return std::string_view(str.data(), 0);
+	return str.substr(first, str.find_last_not_of(chars) + 1 - first);
+}
+
+template <typename T>
+static T *find_char(T *first, T *const last, const char c)
+{
+#if INI_FILE_SSE2
+	// Compare 16 characters at a time, which is where most of the time is spent when scanning for line endings and separators
+	const __m128i pattern = _mm_set1_epi8(c);
+	for (; last - first >= 16; first += 16)
+	{
+		const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first)), pattern));
+		if (mask != 0)
+		{
+#ifdef _MSC_VER
+			unsigned long offset;
+			_BitScanForward(&offset, static_cast<unsigned long>(mask));
+			return first + offset;
+#else
+			return first + __builtin_ctz(static_cast<unsigned int>(mask));
+#endif
+		}
+	}
+#endif
+	return std::find(first, last, c);
+}
+
+static size_t hash(const std::string_view &section, const std::string_view &key)
+{
+	// FNV-1a hash of the section and key names, with a separator that cannot be part of a section name
+	size_t hash = static_cast<size_t>(14695981039346656037ull);
+	for (const char c : section)
+		hash = (hash ^ static_cast<uint8_t>(c)) * static_cast<size_t>(1099511628211ull);
+	hash = (hash ^ ']') * static_cast<size_t>(1099511628211ull);
+	for (const char c : key)
+		hash = (hash ^ static_cast<uint8_t>(c)) * static_cast<size_t>(1099511628211ull);
+	return hash;
+}
+
+static size_t check_directory_changes(const std::filesystem::path &path)
+{
+#ifdef _WIN32
+	const std::filesystem::path directory = path.parent_path();
+
+	const auto it = g_directory_watchers.try_emplace(directory.native());
+	directory_watcher &watcher = it.first->second;
+	if (it.second)
+	{
+		// Get notified when files are added, removed, renamed or written to (which includes the files written by the background writer)
+		// The system keeps track of changes that happen between reads for as long as the directory handle is open, so none are missed while the results are processed
+		watcher.handle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (watcher.handle == INVALID_HANDLE_VALUE)
+			watcher.handle = nullptr;
+		else if (watcher.overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			watcher.overlapped.hEvent == nullptr || !watcher.read_changes())
+			watcher.close();
+	}
+
+	if (watcher.handle == nullptr)
+		return 0; // Notifications are not available, so files have to be checked every time
+
+	std::wstring file_name = path.filename().native();
+	CharLowerBuffW(file_name.data(), static_cast<DWORD>(file_name.size()));
+	watcher.file_names.insert(std::move(file_name));
+
+	if (DWORD size = 0; GetOverlappedResult(watcher.handle, &watcher.overlapped, &size, FALSE))
+	{
+		// An empty result means that there were more changes than fit into the buffer, so cannot tell which files changed
+		bool changed = size == 0;
+		for (DWORD offset = 0; !changed && offset < size;)
+		{
+			const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(watcher.buffer + offset);
+
+			std::wstring changed_file_name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+			CharLowerBuffW(changed_file_name.data(), static_cast<DWORD>(changed_file_name.size()));
+			changed = watcher.file_names.find(changed_file_name) != watcher.file_names.end();
+
+			if (info->NextEntryOffset == 0)
+				break;
+			offset += info->NextEntryOffset;
+		}
+
+		if (changed)
+			watcher.generation++;
+
+		if (!watcher.read_changes())
+			return watcher.close(), 0;
+	}
+	else if (GetLastError() != ERROR_IO_INCOMPLETE)
+	{
+		return watcher.close(), 0;
+	}
+
+	return watcher.generation;
+#else
+	(void)path;
+	return 0; // Notifications are not available, so files have to be checked every time
+#endif
+}
+
+/// <summary>
+/// Locks the writer state, unless all other threads were terminated, in which case the lock may never be released again.
+/// </summary>
+static std::unique_lock<std::mutex> lock_ini_writer()
+{
+	if (g_ini_writer.write_without_lock)
+		return std::unique_lock<std::mutex>(g_ini_writer.mutex, std::defer_lock);
+	return std::unique_lock<std::mutex>(g_ini_writer.mutex);
+}
+
+static bool write_ini_file(const std::filesystem::path &path, const std::string &data, std::filesystem::file_time_type modified_at)
+{
+	std::error_code ec;
+	if (const std::filesystem::file_time_type disk_modified_at = std::filesystem::last_write_time(path, ec);
+		!ec && disk_modified_at >= modified_at)
+	{
+		const std::unique_lock<std::mutex> lock = lock_ini_writer();
+		if (const auto it = g_ini_writer.written_times.find(path.wstring());
+			it == g_ini_writer.written_times.end() || it->second != disk_modified_at)
+			return true; // File exists and was modified on disk and therefore may have different data, so cannot save
+	}
+
+	// Write to a temporary file first and then replace the actual file with it, so that the file is not left half-written if the application crashes during the write
+	std::filesystem::path temp_path = path;
+	temp_path += L".tmp";
+
+	std::ofstream file(temp_path);
+	if (!file)
+		return false;
+
+	file.write(data.data(), data.size());
+
+	// Flush stream to disk before replacing the file
+	file.close();
+	if (file.fail() || (std::filesystem::rename(temp_path, path, ec), ec))
+	{
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	const std::filesystem::file_time_type written_at = std::filesystem::last_write_time(path, ec);
+
+	const std::unique_lock<std::mutex> lock = lock_ini_writer();
+	g_ini_writer.written_times[path.wstring()] = written_at;
+
+	return true;
+}
+
+static void ini_writer_thread_loop()
+{
+	std::unique_lock<std::mutex> lock(g_ini_writer.mutex);
+
+	while (!g_ini_writer.pending.empty())
+	{
+		auto node = g_ini_writer.pending.extract(g_ini_writer.pending.begin());
+		g_ini_writer.current_path = std::move(node.key());
+		g_ini_writer.current = std::move(node.mapped());
+
+		lock.unlock();
+		const bool success = write_ini_file(g_ini_writer.current.path, g_ini_writer.current.data, g_ini_writer.current.modified_at);
+		lock.lock();
+
+		if (!success)
+			g_ini_writer.failed = true;
+
+		g_ini_writer.current_path.clear();
+		g_ini_writer.current = {};
+		g_ini_writer.idle.notify_all();
+	}
+
+	// Starting a new thread happens under the same lock, so no file can be queued between the check above and this thread being marked as finished
+	g_ini_writer.running = false;
+	g_ini_writer.idle.notify_all();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI ini_writer_thread_main(LPVOID module)
+{
+	ini_writer_thread_loop();
+
+	// Release the reference to the module that was added when this thread was started
+	// This may unload the module, which is why this has to happen in the same call that exits the thread, so that no code of the module is executed afterwards
+	FreeLibraryAndExitThread(static_cast<HMODULE>(module), 0);
+}
+#endif
+
+/// <summary>
+/// Starts a background writer thread. Has to be called with the writer lock held.
+/// </summary>
+static bool start_ini_writer_thread()
+{
+	g_ini_writer.running = true;
+
+#ifdef _WIN32
+	// The thread holds a reference to this module while it is running, so that the module cannot be unloaded from under it (and 'DllMain' never has to wait for it to exit)
+	HMODULE module = nullptr;
+	if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&ini_writer_thread_main), &module))
+	{
+		if (const HANDLE thread = CreateThread(nullptr, 0, &ini_writer_thread_main, module, 0, nullptr); thread != nullptr)
+		{
+			CloseHandle(thread);
+			return true;
+		}
+
+		FreeLibrary(module);
+	}
+
+	g_ini_writer.running = false;
+	return false;
+#else
+	// The previous thread released the lock after marking itself as finished, so it is about to exit and joining it here cannot block for long
+	if (g_ini_writer.thread.joinable())
+		g_ini_writer.thread.join();
+
+	g_ini_writer.thread = std::thread(&ini_writer_thread_loop);
+	return true;
+#endif
+}
+
+static void cancel_pending_write(const std::filesystem::path &path)
+{
+	const std::wstring key = path.wstring();
+
+	std::unique_lock<std::mutex> lock = lock_ini_writer();
+	g_ini_writer.pending.erase(key);
+
+	// Wait for the file to be written if it is in progress, so that the caller can access it afterwards (unless the writer thread was terminated, in which case it never finishes)
+	if (!g_ini_writer.write_without_lock)
+		g_ini_writer.idle.wait(lock, [&key]() { return g_ini_writer.current_path != key; });
+}
+
 reshade::ini_file::ini_file(const std::filesystem::path &path) : _path(path)
 {
 	load();
 }
+reshade::ini_file::ini_file(const ini_file &other) : _modified(other._modified), _revision(other._revision), _path(other._path), _modified_at(other._modified_at)
+{
+	copy_entries(other._entries, other._elements);
+}
 reshade::ini_file::~ini_file()
 {
 	save();
@@ -23,76 +381,127 @@ void reshade::ini_file::load()
 {
 	std::error_code ec;
 	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_path, ec);
-	if (ec || _modified_at >= modified_at)
-		return; // Skip loading if there was an error (e.g. file does not exist) or there was no modification to the file since it was last loaded
+	if (ec)
+		return; // Skip loading if there was an error (e.g. file does not exist)
+
+	if (_modified_at >= modified_at)
+		return; // Skip loading if there was no modification to the file since it was last loaded
+
+	std::ifstream file(_path, std::ios::binary);
+	if (!file)
+		return;
+
+	// Read the entire file into a single buffer, which the parsed entries then point into
+	file.seekg(0, std::ios::end);
+	const size_t size = static_cast<size_t>(file.tellg());
+	file.seekg(0, std::ios::beg);
 
-	std::ifstream file;
-	if (file.open(_path); !file)
+	std::vector<char> data(size + 1); // Reserve space for a null-terminator after the last element
+	if (!file.read(data.data(), size))
 		return;
 
-	_sections.clear();
+	clear();
+	_data = std::move(data);
 	_modified = false;
 	_modified_at = modified_at;
+	_revision++;
+
+	char *it = _data.data();
+	char *const end = it + size;
 
-	file.imbue(std::locale("en-us.UTF-8"));
 	// Remove BOM (0xefbbbf means 0xfeff)
-	if (file.get() != 0xef || file.get() != 0xbb || file.get() != 0xbf)
-		file.seekg(0, std::ios::beg);
+	if (size >= 3 && static_cast<uint8_t>(it[0]) == 0xef && static_cast<uint8_t>(it[1]) == 0xbb && static_cast<uint8_t>(it[2]) == 0xbf)
+		it += 3;
 
-	std::string line, section;
-	while (std::getline(file, line))
+	std::string_view section;
+	for (char *line_end; it < end; it = line_end + 1)
 	{
-		trim(line);
-
-		if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
+		line_end = find_char(it, end, '\n');
+
+		// Remove carriage return of a CRLF line ending, since the file is read in binary mode, then trim the line
+		char *first = it, *last = line_end;
+		if (last > first && *(last - 1) == '\r')
+			--last;
+		while (first < last && is_space(*first))
+			++first;
+		while (last > first && is_space(*(last - 1)))
+			--last;
+
+		if (first == last || *first == ';' || *first == '/' || *first == '#')
 			continue;
 
 		// Read section name
-		if (line[0] == '[')
+		if (*first == '[')
 		{
+			const std::string_view line(first, last - first);
 			section = trim(line.substr(0, line.find(']')), " \t[]");
 			continue;
 		}
 
 		// Read section content
-		const auto assign_index = line.find('=');
-		if (assign_index != std::string::npos)
+		char *const assign = find_char(first, last, '=');
+		if (assign == last)
 		{
-			const std::string key = trim(line.substr(0, assign_index));
-			const std::string value = trim(line.substr(assign_index + 1));
+			bool added = false;
+			const size_t index = find_or_add(section, std::string_view(first, last - first), added);
+			if (added)
+				_entries[index].first_element = static_cast<uint32_t>(_elements.size());
+			continue;
+		}
 
-			// Append to key if it already exists
-			reshade::ini_file::value &elements = _sections[section][key];
-			for (size_t offset = 0, base = 0, len = value.size(); offset <= len;)
-			{
-				// Treat ",," as an escaped comma and only split on single ","
-				const size_t found = std::min(value.find_first_of(',', offset), len);
-				if (found + 1 < len && value[found + 1] == ',')
-				{
-					offset = found + 2;
-				}
-				else
-				{
-					std::string &element = elements.emplace_back();
-					element.reserve(found - base);
-
-					while (base < found)
-					{
-						const char c = value[base++];
-						element += c;
-
-						if (c == ',' && base < found && value[base] == ',')
-							base++; // Skip second comma in a ",," escape sequence
-					}
-
-					base = offset = found + 1;
-				}
-			}
+		const std::string_view key = trim(std::string_view(first, assign - first));
+
+		char *value_first = assign + 1;
+		while (value_first < last && is_space(*value_first))
+			++value_first;
+
+		bool added = false;
+		const size_t index = find_or_add(section, key, added);
+
+		// Append to key if it already exists, which requires its elements to be at the end of the list
+		if (entry &entry = _entries[index]; added || entry.num_elements == 0)
+		{
+			entry.first_element = static_cast<uint32_t>(_elements.size());
 		}
-		else
+		else if (entry.first_element + entry.num_elements != _elements.size())
 		{
-			_sections[section].insert({ line, {} });
+			_elements.reserve(_elements.size() + entry.num_elements);
+			for (uint32_t i = 0; i < entry.num_elements; ++i)
+				_elements.push_back(_elements[entry.first_element + i]);
+			_unused_size += entry.num_elements * sizeof(std::string_view);
+			entry.first_element = static_cast<uint32_t>(_elements.size() - entry.num_elements);
+		}
+
+		// Split the value into elements in place, writing unescaped characters and null-terminators back into the buffer
+		// Treat ",," as an escaped comma and only split on single ","
+		char *read = value_first, *write = value_first, *element = value_first;
+		for (char *comma; true; read = comma + 1)
+		{
+			comma = find_char(read, last, ',');
+
+			if (write != read)
+				std::memmove(write, read, comma - read);
+			write += comma - read;
+
+			if (comma == last)
+				break;
+
+			if (comma + 1 < last && *(comma + 1) == ',')
+			{
+				*write++ = ',';
+				comma++; // Skip second comma in a ",," escape sequence
+				continue;
+			}
+
+			*write = '\0';
+			_elements.emplace_back(element, write - element);
+			_entries[index].num_elements++;
+			element = ++write;
 		}
+
+		*write = '\0';
+		_elements.emplace_back(element, write - element);
+		_entries[index].num_elements++;
 	}
 }
 bool reshade::ini_file::save()
@@ -103,117 +512,462 @@ bool reshade::ini_file::save()
 	// Reset state even on failure to avoid 'flush_cache' repeatedly trying and failing to save
 	_modified = false;
 
-	std::error_code ec;
-	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_path, ec);
-	if (!ec && modified_at >= _modified_at)
-		return true; // File exists and was modified on disk and therefore may have different data, so cannot save
-
-	std::stringstream data;
-	std::vector<std::string> section_names, key_names;
-
-	section_names.reserve(_sections.size());
-	for (const auto &section : _sections)
-		section_names.push_back(section.first);
-
-	// Sort sections to generate consistent files
-	std::sort(section_names.begin(), section_names.end(),
-		[](std::string a, std::string b) {
-			std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-			std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-			return a < b;
+	std::string data;
+	serialize(data);
+
+	// Make sure an older version of this file that is still queued for writing does not overwrite this one afterwards
+	cancel_pending_write(_path);
+
+	return write_ini_file(_path, data, _modified_at);
+}
+void reshade::ini_file::queue_save()
+{
+	_modified = false;
+
+	ini_writer::job job;
+	job.path = _path;
+	job.modified_at = _modified_at;
+	serialize(job.data);
+
+	std::unique_lock<std::mutex> lock = lock_ini_writer();
+
+	if (g_ini_writer.enabled)
+	{
+		const auto it = g_ini_writer.pending.try_emplace(_path.wstring());
+		if (it.second)
+			it.first->second = std::move(job);
+		else
+			it.first->second.data = std::move(job.data); // Keep the time of the first modification when coalescing, so that changes made to the file on disk in the meantime are still detected
+
+		if (g_ini_writer.running || start_ini_writer_thread())
+			return;
+
+		// Fall back to writing the file on the calling thread if the thread could not be started
+		job = std::move(it.first->second);
+		g_ini_writer.pending.erase(it.first);
+	}
+
+	if (lock.owns_lock())
+		lock.unlock();
+	const bool success = write_ini_file(job.path, job.data, job.modified_at);
+	lock = lock_ini_writer();
+
+	if (!success)
+		g_ini_writer.failed = true;
+}
+void reshade::ini_file::serialize(std::string &data) const
+{
+	struct sort_key
+	{
+		uint32_t index;
+		uint32_t section_offset;
+		uint32_t key_offset;
+	};
+
+	// Build upper case versions of all section and key names once, instead of converting them on every comparison while sorting
+	std::string folded;
+	std::vector<sort_key> order;
+	order.reserve(_entries.size());
+
+	size_t data_size = 0;
+
+	for (size_t i = 0; i < _entries.size(); ++i)
+	{
+		const entry &entry = _entries[i];
+		if (entry.removed)
+			continue;
+
+		sort_key &sort_key = order.emplace_back();
+		sort_key.index = static_cast<uint32_t>(i);
+
+		// Consecutive entries of the same section usually share the same name, so only need to convert it once
+		if (order.size() > 1 && _entries[order[order.size() - 2].index].section.data() == entry.section.data())
+		{
+			sort_key.section_offset = order[order.size() - 2].section_offset;
+		}
+		else
+		{
+			sort_key.section_offset = static_cast<uint32_t>(folded.size());
+			std::transform(entry.section.begin(), entry.section.end(), std::back_inserter(folded), to_upper);
+			data_size += entry.section.size() + 4;
+		}
+
+		sort_key.key_offset = static_cast<uint32_t>(folded.size());
+		std::transform(entry.key.begin(), entry.key.end(), std::back_inserter(folded), to_upper);
+
+		data_size += entry.key.size() + 2;
+		for (uint32_t k = 0; k < entry.num_elements; ++k)
+			data_size += _elements[entry.first_element + k].size() + 1;
+	}
+
+	// Sort sections and keys to generate consistent files
+	// Entries with names that only differ in case are ordered by their actual name, so that all keys of a section end up next to each other
+	std::sort(order.begin(), order.end(),
+		[this, &folded](const sort_key &lhs, const sort_key &rhs) {
+			const entry &lhs_entry = _entries[lhs.index];
+			const entry &rhs_entry = _entries[rhs.index];
+			if (const int c = std::string_view(folded.data() + lhs.section_offset, lhs_entry.section.size()).compare(
+					std::string_view(folded.data() + rhs.section_offset, rhs_entry.section.size())); c != 0)
+				return c < 0;
+			if (const int c = lhs_entry.section.compare(rhs_entry.section); c != 0)
+				return c < 0;
+			if (const int c = std::string_view(folded.data() + lhs.key_offset, lhs_entry.key.size()).compare(
+					std::string_view(folded.data() + rhs.key_offset, rhs_entry.key.size())); c != 0)
+				return c < 0;
+			return lhs_entry.key < rhs_entry.key;
 		});
 
-	for (const std::string &section_name : section_names)
+	data.reserve(data.size() + data_size + data_size / 16);
+
+	for (size_t i = 0; i < order.size(); ++i)
 	{
-		const auto &keys = _sections.at(section_name);
+		const entry &entry = _entries[order[i].index];
 
-		key_names.clear();
-		key_names.reserve(keys.size());
-		for (const auto &key : keys)
-			key_names.push_back(key.first);
+		if (i == 0 || entry.section != _entries[order[i - 1].index].section)
+		{
+			if (i != 0)
+				data += '\n';
 
-		std::sort(key_names.begin(), key_names.end(),
-			[](std::string a, std::string b) {
-				std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-				std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-				return a < b;
-			});
+			// Empty section should have been sorted to the top, so do not need to append it before keys
+			if (!entry.section.empty())
+				data += '[', data += entry.section, data += ']', data += '\n';
+		}
 
-		// Empty section should have been sorted to the top, so do not need to append it before keys
-		if (!section_name.empty())
-			data << '[' << section_name << ']' << '\n';
+		data += entry.key;
+		data += '=';
 
-		for (const std::string &key_name : key_names)
+		for (uint32_t k = 0; k < entry.num_elements; ++k)
 		{
-			data << key_name << '=';
+			if (k != 0)
+				data += ','; // Separate multiple values with a comma
 
-			if (const reshade::ini_file::value &elements = keys.at(key_name); !elements.empty())
+			const std::string_view element = _elements[entry.first_element + k];
+			for (const char *it = element.data(), *const end = it + element.size(), *comma; it < end; it = comma + 1)
 			{
-				std::string value;
-				for (const std::string &element : elements)
-				{
-					value.reserve(value.size() + element.size() + 1);
-					for (const char c : element)
-						value.append(c == ',' ? 2 : 1, c);
-					value += ','; // Separate multiple values with a comma
-				}
-
-				// Remove the last comma
-				value.pop_back();
-
-				data << value;
+				comma = find_char(it, end, ',');
+				data.append(it, comma);
+
+				if (comma == end)
+					break;
+				data += ",,";
 			}
+		}
+
+		data += '\n';
+	}
+
+	if (!order.empty())
+		data += '\n';
+}
+
+void reshade::ini_file::clear()
+{
+	_data.clear();
+	_storage.clear();
+	_storage_used = 0;
+	_storage_size = 0;
+	_storage_total = 0;
+	_unused_size = 0;
+	_entries.clear();
+	_elements.clear();
+	_lookup.clear();
+}
+void reshade::ini_file::copy_entries(const std::vector<entry> &entries, const std::vector<std::string_view> &elements)
+{
+	size_t total_size = 0;
+	size_t num_entries = 0;
+	size_t num_elements = 0;
+	for (const entry &entry : entries)
+	{
+		if (entry.removed)
+			continue;
+
+		total_size += entry.section.size() + entry.key.size() + 2;
+		for (uint32_t k = 0; k < entry.num_elements; ++k)
+			total_size += elements[entry.first_element + k].size() + 1;
+
+		num_entries++;
+		num_elements += entry.num_elements;
+	}
+
+	// Allocate a single block large enough to hold all the strings
+	if (total_size != 0)
+	{
+		_storage.push_back(std::make_unique<char[]>(total_size));
+		_storage_used = 0;
+		_storage_size = total_size;
+		_storage_total = total_size;
+	}
+
+	_entries.reserve(num_entries);
+	_elements.reserve(num_elements);
+
+	for (const entry &source : entries)
+	{
+		if (source.removed)
+			continue;
+
+		const std::string_view section = !_entries.empty() && _entries.back().section == source.section ? _entries.back().section : store(source.section);
+
+		bool added = false;
+		entry &entry = _entries[find_or_add(section, store(source.key), added)];
+		assert(added);
+
+		entry.first_element = static_cast<uint32_t>(_elements.size());
+		entry.num_elements = source.num_elements;
+		for (uint32_t k = 0; k < source.num_elements; ++k)
+			_elements.push_back(store(elements[source.first_element + k]));
+	}
+}
+void reshade::ini_file::compact()
+{
+	// Keep the old data alive until all entries were copied out of it
+	const std::vector<char> data = std::move(_data);
+	const std::vector<std::unique_ptr<char[]>> storage = std::move(_storage);
+	const std::vector<entry> entries = std::move(_entries);
+	const std::vector<std::string_view> elements = std::move(_elements);
+
+	clear();
+	copy_entries(entries, elements);
+}
+
+const reshade::ini_file::entry *reshade::ini_file::find(const std::string_view &section, const std::string_view &key) const
+{
+	if (_lookup.empty())
+		return nullptr;
+
+	const size_t mask = _lookup.size() - 1;
+	for (size_t slot = hash(section, key) & mask; _lookup[slot] != std::numeric_limits<uint32_t>::max(); slot = (slot + 1) & mask)
+	{
+		const entry &entry = _entries[_lookup[slot]];
+		if (entry.section == section && entry.key == key)
+			return entry.removed ? nullptr : &entry;
+	}
+
+	return nullptr;
+}
+size_t reshade::ini_file::find_or_add(const std::string_view &section, const std::string_view &key, bool &added)
+{
+	// Keep the hash table at most half full, so that probe sequences stay short
+	if ((_entries.size() + 1) * 2 > _lookup.size())
+	{
+		_lookup.assign(std::max<size_t>(_lookup.size() * 2, 64), std::numeric_limits<uint32_t>::max());
 
-			data << '\n';
+		const size_t mask = _lookup.size() - 1;
+		for (size_t i = 0; i < _entries.size(); ++i)
+		{
+			size_t slot = hash(_entries[i].section, _entries[i].key) & mask;
+			while (_lookup[slot] != std::numeric_limits<uint32_t>::max())
+				slot = (slot + 1) & mask;
+			_lookup[slot] = static_cast<uint32_t>(i);
 		}
+	}
 
-		data << '\n';
+	const size_t mask = _lookup.size() - 1;
+	size_t slot = hash(section, key) & mask;
+	for (; _lookup[slot] != std::numeric_limits<uint32_t>::max(); slot = (slot + 1) & mask)
+	{
+		const entry &entry = _entries[_lookup[slot]];
+		if (entry.section == section && entry.key == key)
+			return added = false, _lookup[slot];
 	}
 
-	std::ofstream file(_path);
-	if (!file)
-		return false;
+	_lookup[slot] = static_cast<uint32_t>(_entries.size());
+	_entries.push_back({ section, key, 0, 0, false });
 
-	const std::string str = data.str();
-	file.imbue(std::locale("en-us.UTF-8"));
-	file.write(str.data(), str.size());
+	return added = true, _entries.size() - 1;
+}
 
-	// Flush stream to disk before updating last write time
-	file.close();
-	_modified_at = std::filesystem::last_write_time(_path, ec);
+size_t reshade::ini_file::reset_value(const std::string &section, const std::string &key)
+{
+	// Copy the remaining entries into new storage once there is a lot of unused data from values that were replaced
+	if (_unused_size > 65536 && _unused_size * 2 > _data.size() + _storage_total)
+		compact();
 
-	assert(std::filesystem::file_size(_path, ec) > 0);
+	bool added = false;
+	const size_t index = find_or_add(section, key, added);
 
-	return true;
+	entry &entry = _entries[index];
+	if (added)
+	{
+		// Copy the names into storage owned by this object (sharing the section name with the previous entry if it matches)
+		entry.section = index != 0 && _entries[index - 1].section == section ? _entries[index - 1].section : store(section);
+		entry.key = store(key);
+	}
+	else
+	{
+		if (!entry.removed)
+		{
+			_unused_size += entry.num_elements * sizeof(std::string_view);
+			for (uint32_t k = 0; k < entry.num_elements; ++k)
+				_unused_size += _elements[entry.first_element + k].size() + 1;
+		}
+
+		entry.removed = false;
+	}
+
+	// New elements are always appended to the end of the list
+	entry.first_element = static_cast<uint32_t>(_elements.size());
+	entry.num_elements = 0;
+
+	_modified = true;
+	_modified_at = std::filesystem::file_time_type::clock::now();
+	_revision++;
+
+	return index;
+}
+void reshade::ini_file::append_element(size_t index, const std::string_view &element)
+{
+	entry &entry = _entries[index];
+	assert(entry.first_element + entry.num_elements == _elements.size());
+
+	_elements.push_back(store(element));
+	entry.num_elements++;
+}
+std::string_view reshade::ini_file::store(const std::string_view &str)
+{
+	if (_storage_size - _storage_used < str.size() + 1)
+	{
+		_storage_size = std::max(str.size() + 1, storage_block_size);
+		_storage_used = 0;
+		_storage_total += _storage_size;
+		_storage.push_back(std::make_unique<char[]>(_storage_size));
+	}
+
+	char *const data = _storage.back().get() + _storage_used;
+	if (!str.empty())
+		std::memcpy(data, str.data(), str.size());
+	data[str.size()] = '\0';
+	_storage_used += str.size() + 1;
+
+	return std::string_view(data, str.size());
+}
+
+void reshade::ini_file::remove_key(const std::string &section, const std::string &key)
+{
+	if (entry *const entry = const_cast<ini_file::entry *>(find(section, key)))
+	{
+		_unused_size += entry->num_elements * sizeof(std::string_view);
+		for (uint32_t k = 0; k < entry->num_elements; ++k)
+			_unused_size += _elements[entry->first_element + k].size() + 1;
+
+		entry->removed = true;
+		entry->num_elements = 0;
+
+		_modified = true;
+		_modified_at = std::filesystem::file_time_type::clock::now();
+		_revision++;
+	}
 }
 
 reshade::ini_file &reshade::ini_file::load_cache(const std::filesystem::path &path)
 {
+	// Check for changes before loading the file, so that changes made while it is loaded are not missed
+	const size_t generation = check_directory_changes(path);
+
 	const auto it = g_ini_cache.try_emplace(path, path);
-	if (it.second || (std::filesystem::file_time_type::clock::now() - it.first->second._modified_at) < std::chrono::seconds(1))
-		return it.first->second; // Don't need to reload file when it was just loaded or there are still modifications pending
+	ini_file &file = it.first->second;
+	if (it.second)
+		return file._directory_generation = generation, file;
+
+	if ((std::filesystem::file_time_type::clock::now() - file._modified_at) < std::chrono::seconds(1))
+		return file; // Don't need to reload file when there are still modifications pending
+	if (generation != 0 && generation == file._directory_generation)
+		return file; // Don't need to reload file when none of the cached files in its directory changed since it was last checked
+
+	file._directory_generation = generation;
+
+	{
+		const std::unique_lock<std::mutex> lock = lock_ini_writer();
+		if (const auto written_it = g_ini_writer.written_times.find(path.wstring());
+			written_it != g_ini_writer.written_times.end() && written_it->second > file._modified_at)
+			file._modified_at = written_it->second; // Do not load the file again after it was just written with the data in memory
+	}
+
+	return file.load(), file;
+}
+
+void reshade::ini_file::stop_background_writes(bool other_threads_terminated)
+{
+	std::unique_lock<std::mutex> lock = lock_ini_writer();
+	g_ini_writer.enabled = false;
+
+	// The writer thread may have been terminated while it was holding the lock or in the middle of writing a file, so have to take over its work
+	if (other_threads_terminated)
+	{
+		g_ini_writer.write_without_lock = true;
+		g_ini_writer.running = false;
+
+		if (!g_ini_writer.current_path.empty())
+		{
+			g_ini_writer.pending.try_emplace(std::move(g_ini_writer.current_path), std::move(g_ini_writer.current));
+			g_ini_writer.current_path.clear();
+		}
+	}
 	else
-		return it.first->second.load(), it.first->second;
+	{
+#ifndef _WIN32
+		// Let a running writer thread finish all queued files and join it, so that it does not outlive the data it uses
+		if (std::thread thread = std::move(g_ini_writer.thread); thread.joinable())
+		{
+			lock.unlock();
+			thread.join();
+			lock.lock();
+		}
+#else
+		// Let a running writer thread finish the file it is currently writing, but write the remaining ones here
+		g_ini_writer.idle.wait(lock, []() { return g_ini_writer.current_path.empty(); });
+#endif
+	}
+
+	while (!g_ini_writer.pending.empty())
+	{
+		auto node = g_ini_writer.pending.extract(g_ini_writer.pending.begin());
+
+		if (lock.owns_lock())
+			lock.unlock();
+		const bool success = write_ini_file(node.mapped().path, node.mapped().data, node.mapped().modified_at);
+		lock = lock_ini_writer();
+
+		if (!success)
+			g_ini_writer.failed = true;
+	}
 }
 
 bool reshade::ini_file::flush_cache()
 {
-	bool success = true;
-
-	// Save all files that were modified in one second intervals
+	// Queue all files that were modified in one second intervals for writing in the background
 	for (std::pair<const std::wstring, ini_file> &file : g_ini_cache)
 	{
-		// Check modified status before requesting file time, since the latter is costly and therefore should be avoided when not necessary
+		// Check modified status first, since serializing the file is only necessary when there are changes
 		if (file.second._modified && (std::filesystem::file_time_type::clock::now() - file.second._modified_at) > std::chrono::seconds(1))
-			success &= file.second.save();
+			file.second.queue_save();
 	}
 
-	return success;
+	// Report any failures of previous writes
+	const std::unique_lock<std::mutex> lock = lock_ini_writer();
+	return !std::exchange(g_ini_writer.failed, false);
 }
 bool reshade::ini_file::flush_cache(const std::filesystem::path &path)
 {
 	const auto it = g_ini_cache.find(path);
-	return it != g_ini_cache.end() && it->second.save();
+	if (it == g_ini_cache.end())
+		return false;
+
+	// Wait for a queued write of this file to finish, so that the file on disk is up to date after this call
+	if (!it->second._modified)
+	{
+		std::unique_lock<std::mutex> lock = lock_ini_writer();
+		// Without the lock all other threads were terminated, so there is no writer thread to wait for (and queued files are written directly)
+		if (lock.owns_lock())
+		{
+			const std::wstring key = path.wstring();
+			g_ini_writer.idle.wait(lock, [&key]() { return g_ini_writer.pending.find(key) == g_ini_writer.pending.end() && g_ini_writer.current_path != key; });
+		}
+		return true;
+	}
+
+	return it->second.save();
 }
 
 reshade::ini_file &reshade::global_config()
@@ -5,7 +5,10 @@
 
 #pragma once
 
+#include <memory>
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
 #include <unordered_map>
@@ -28,6 +31,10 @@ inline std::string trim(const std::string &str, const char chars[] = " \t")
 
 namespace reshade
 {
+	/// <summary>
+	/// An INI file that is parsed in place from a single contiguous buffer.
+	/// Sections, keys and value elements are views into that buffer (or into additional storage for modified values), so loading a file does not allocate per entry.
+	/// </summary>
 	class ini_file
 	{
 	public:
@@ -36,25 +43,27 @@ namespace reshade
 		/// </summary>
 		/// <param name="path">The path to the INI file to access.</param>
 		explicit ini_file(const std::filesystem::path &path);
+		ini_file(const ini_file &other);
 		~ini_file();
 
+		ini_file &operator=(const ini_file &) = delete;
+
 		/// <summary>
 		/// Gets the path to this INI file.
 		/// </summary>
 		const std::filesystem::path &path() const { return _path; }
 
+		/// <summary>
+		/// Gets a number that changes whenever the data in this INI changes, either through modification or by reloading it from disk.
+		/// </summary>
+		size_t revision() const { return _revision; }
+
 		/// <summary>
 		/// Checks whether the specified <paramref name="section"/> and <paramref name="key"/> currently exist in the INI.
 		/// </summary>
 		bool has(const std::string &section, const std::string &key) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
-				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
-				return false;
-			return true;
+			return find(section, key) != nullptr;
 		}
 
 		/// <summary>
@@ -65,40 +74,31 @@ namespace reshade
 		template <typename T>
 		bool get(const std::string &section, const std::string &key, T &value) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
+			const entry *const it = find(section, key);
+			if (it == nullptr)
 				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
-				return false;
-			value = convert<T>(it2->second, 0);
+			value = convert<T>(_elements.data() + it->first_element, it->num_elements, 0);
 			return true;
 		}
 		template <typename T, size_t SIZE>
 		bool get(const std::string &section, const std::string &key, T(&values)[SIZE]) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
-				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
+			const entry *const it = find(section, key);
+			if (it == nullptr)
 				return false;
 			for (size_t i = 0; i < SIZE; ++i)
-				values[i] = convert<T>(it2->second, i);
+				values[i] = convert<T>(_elements.data() + it->first_element, it->num_elements, i);
 			return true;
 		}
 		template <typename T>
 		bool get(const std::string &section, const std::string &key, std::vector<T> &values) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
+			const entry *const it = find(section, key);
+			if (it == nullptr)
 				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
-				return false;
-			values.resize(it2->second.size());
-			for (size_t i = 0; i < it2->second.size(); ++i)
-				values[i] = convert<T>(it2->second, i);
+			values.resize(it->num_elements);
+			for (size_t i = 0; i < it->num_elements; ++i)
+				values[i] = convert<T>(_elements.data() + it->first_element, it->num_elements, i);
 			return true;
 		}
 
@@ -114,6 +114,7 @@ namespace reshade
 
 		/// <summary>
 		/// Sets the value of the specified <paramref name="section"/> and <paramref name="key"/> to a new <paramref name="value"/>.
+		/// This does nothing if the key already has that value, so the file is neither marked as modified nor does its revision change.
 		/// </summary>
 		/// <param name="value">The data to set this INI entry to.</param>
 		template <typename T>
@@ -129,18 +130,7 @@ namespace reshade
 		template <>
 		void set(const std::string &section, const std::string &key, const std::string &value)
 		{
-			auto &v = _sections[section][key];
-			v.assign(1, value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		void set(const std::string &section, const std::string &key, std::string &&value)
-		{
-			auto &v = _sections[section][key];
-			v.resize(1);
-			v[0] = std::forward<std::string>(value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_elements(section, key, &value, &value + 1);
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::filesystem::path &value)
@@ -150,37 +140,24 @@ namespace reshade
 		template <typename T, size_t SIZE>
 		void set(const std::string &section, const std::string &key, const T(&values)[SIZE], const size_t size = SIZE)
 		{
-			auto &v = _sections[section][key];
-			v.resize(size);
+			std::string elements[SIZE];
 			for (size_t i = 0; i < size; ++i)
-				v[i] = std::to_string(values[i]);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+				elements[i] = std::to_string(values[i]);
+			set_elements(section, key, elements, elements + size);
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::string> &values)
 		{
-			auto &v = _sections[section][key];
-			v = values;
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		void set(const std::string &section, const std::string &key, std::vector<std::string> &&values)
-		{
-			auto &v = _sections[section][key];
-			v = std::forward<std::vector<std::string>>(values);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			set_elements(section, key, values.begin(), values.end());
 		}
 		template <>
 		void set(const std::string &section, const std::string &key, const std::vector<std::filesystem::path> &values)
 		{
-			auto &v = _sections[section][key];
-			v.resize(values.size());
-			for (size_t i = 0; i < values.size(); ++i)
-				v[i] = values[i].u8string();
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+			std::vector<std::string> elements;
+			elements.reserve(values.size());
+			for (const std::filesystem::path &element : values)
+				elements.push_back(element.u8string());
+			set_elements(section, key, elements.begin(), elements.end());
 		}
 
 		/// <summary>
@@ -188,12 +165,7 @@ namespace reshade
 		/// </summary>
 		/// <param name="section"></param>
 		/// <param name="key"></param>
-		void remove_key(const std::string &section, const std::string &key)
-		{
-			const auto it = _sections.find(section);
-			if (it != _sections.end())
-				it->second.erase(key);
-		}
+		void remove_key(const std::string &section, const std::string &key);
 
 		/// <summary>
 		/// Gets the specified INI file from cache or opens it when it was not cached yet.
@@ -203,84 +175,139 @@ namespace reshade
 		/// <returns>A reference to the cached data. This reference is valid until the next call to <see cref="load_cache"/>.</returns>
 		static reshade::ini_file &load_cache(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Queues all cached INI files that were modified for writing on a background thread.
+		/// </summary>
+		/// <returns><c>false</c> if any previously queued write failed, <c>true</c> otherwise.</returns>
 		static bool flush_cache();
+		/// <summary>
+		/// Writes the specified cached INI file to disk immediately (or waits for a queued write of it to finish).
+		/// </summary>
 		static bool flush_cache(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Writes all files still queued for the background thread on the calling thread and writes any further ones there directly too.
+		/// This is safe to call from 'DllMain' during process detach, since the background thread is not running anymore at that point (unless the process is exiting, in which case it was terminated).
+		/// </summary>
+		/// <param name="other_threads_terminated">Set to <c>true</c> when all other threads were terminated already (e.g. during process exit), in which case the background thread may have been holding the lock or been in the middle of a write.</param>
+		static void stop_background_writes(bool other_threads_terminated = false);
+
 	private:
+		/// <summary>
+		/// Describes a single key/value pair in an INI file.
+		/// The elements of the value are stored consecutively in '_elements' and are all null-terminated.
+		/// </summary>
+		struct entry
+		{
+			std::string_view section;
+			std::string_view key;
+			uint32_t first_element;
+			uint32_t num_elements;
+			bool removed;
+		};
+
 		void load();
 		bool save();
+		void queue_save();
+		void serialize(std::string &data) const;
+
+		void clear();
+		void copy_entries(const std::vector<entry> &entries, const std::vector<std::string_view> &elements);
+		void compact();
+
+		const entry *find(const std::string_view &section, const std::string_view &key) const;
+		size_t find_or_add(const std::string_view &section, const std::string_view &key, bool &added);
+		size_t reset_value(const std::string &section, const std::string &key);
+		void append_element(size_t index, const std::string_view &element);
+
+		template <typename It>
+		void set_elements(const std::string &section, const std::string &key, It first, It last)
+		{
+			// Leave the entry alone if it already has these elements, so that writing back unchanged values does not count as a modification
+			if (const entry *const existing = find(section, key);
+				existing != nullptr && !existing->removed && existing->num_elements == static_cast<size_t>(std::distance(first, last)) &&
+				std::equal(first, last, _elements.begin() + existing->first_element))
+				return;
+
+			const size_t index = reset_value(section, key);
+			for (; first != last; ++first)
+				append_element(index, *first);
+		}
+		std::string_view store(const std::string_view &str);
 
 		template <typename T>
-		static const T convert(const std::vector<std::string> &values, size_t i) = delete;
+		static const T convert(const std::string_view *values, size_t num_values, size_t i) = delete;
 		template <>
-		static const bool convert(const std::vector<std::string> &values, size_t i)
+		static const bool convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return convert<int>(values, i) != 0 || i < values.size() && (values[i] == "true" || values[i] == "True" || values[i] == "TRUE");
+			return convert<int>(values, num_values, i) != 0 || i < num_values && (values[i] == "true" || values[i] == "True" || values[i] == "TRUE");
 		}
 		template <>
-		static const int convert(const std::vector<std::string> &values, size_t i)
+		static const int convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return static_cast<int>(convert<long>(values, i));
+			return static_cast<int>(convert<long>(values, num_values, i));
 		}
 		template <>
-		static const unsigned int convert(const std::vector<std::string> &values, size_t i)
+		static const unsigned int convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return static_cast<unsigned int>(convert<unsigned long>(values, i));
+			return static_cast<unsigned int>(convert<unsigned long>(values, num_values, i));
 		}
 		template <>
-		static const long convert(const std::vector<std::string> &values, size_t i)
+		static const long convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? std::strtol(values[i].c_str(), nullptr, 10) : 0l;
+			return i < num_values ? std::strtol(values[i].data(), nullptr, 10) : 0l;
 		}
 		template <>
-		static const unsigned long convert(const std::vector<std::string> &values, size_t i)
+		static const unsigned long convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? std::strtoul(values[i].c_str(), nullptr, 10) : 0ul;
+			return i < num_values ? std::strtoul(values[i].data(), nullptr, 10) : 0ul;
 		}
 		template <>
-		static const long long convert(const std::vector<std::string> &values, size_t i)
+		static const long long convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? std::strtoll(values[i].c_str(), nullptr, 10) : 0ll;
+			return i < num_values ? std::strtoll(values[i].data(), nullptr, 10) : 0ll;
 		}
 		template <>
-		static const unsigned long long convert(const std::vector<std::string> &values, size_t i)
+		static const unsigned long long convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? std::strtoull(values[i].c_str(), nullptr, 10) : 0ull;
+			return i < num_values ? std::strtoull(values[i].data(), nullptr, 10) : 0ull;
 		}
 		template <>
-		static const float convert(const std::vector<std::string> &values, size_t i)
+		static const float convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return static_cast<float>(convert<double>(values, i));
+			return static_cast<float>(convert<double>(values, num_values, i));
 		}
 		template <>
-		static const double convert(const std::vector<std::string> &values, size_t i)
+		static const double convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? std::strtod(values[i].c_str(), nullptr) : 0.0;
+			return i < num_values ? std::strtod(values[i].data(), nullptr) : 0.0;
 		}
 		template <>
-		static const std::string convert(const std::vector<std::string> &values, size_t i)
+		static const std::string convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? values[i] : std::string();
+			return i < num_values ? std::string(values[i]) : std::string();
 		}
 		template <>
-		static const std::filesystem::path convert(const std::vector<std::string> &values, size_t i)
+		static const std::filesystem::path convert(const std::string_view *values, size_t num_values, size_t i)
 		{
-			return i < values.size() ? std::filesystem::u8path(values[i]) : std::filesystem::path();
+			return i < num_values ? std::filesystem::u8path(values[i].begin(), values[i].end()) : std::filesystem::path();
 		}
 
-		/// <summary>
-		/// Describes a single value in an INI file.
-		/// </summary>
-		using value = std::vector<std::string>;
-		/// <summary>
-		/// Describes a section of multiple key/value pairs in an INI file.
-		/// </summary>
-		using section = std::unordered_map<std::string, value>;
-
 		bool _modified = false;
+		size_t _revision = 0;
+		size_t _directory_generation = 0;
 		std::filesystem::path _path;
 		std::filesystem::file_time_type _modified_at;
-		std::unordered_map<std::string, section> _sections;
+
+		std::vector<char> _data; // Contents of the file, with the value elements unescaped and null-terminated in place
+		std::vector<std::unique_ptr<char[]>> _storage; // Blocks holding strings that were added after loading
+		size_t _storage_used = 0; // Number of bytes used in the last storage block
+		size_t _storage_size = 0; // Size of the last storage block
+		size_t _storage_total = 0; // Size of all storage blocks combined
+		size_t _unused_size = 0; // Number of bytes in storage and element slots that are no longer referenced
+		std::vector<entry> _entries;
+		std::vector<std::string_view> _elements;
+		std::vector<uint32_t> _lookup; // Open addressing hash table of indices into '_entries'
 	};
 
 	/// <summary>
@@ -5,42 +5,299 @@
 
 #include "dll_log.hpp"
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <cstdio>
+#include <condition_variable>
+#ifdef _WIN32
+#include <share.h>
 #include <Windows.h>
+#else
+#include <ctime>
+#endif
 
 struct scoped_file_handle
 {
 	~scoped_file_handle()
 	{
-		if (handle != INVALID_HANDLE_VALUE)
-			CloseHandle(handle);
+		if (handle != nullptr)
+			std::fclose(handle);
 	}
 
-	inline operator HANDLE() const { return handle; }
-	inline void operator=(HANDLE new_handle) { handle = new_handle; }
+	inline operator FILE *() const { return handle; }
+	inline void operator=(FILE *new_handle) { handle = new_handle; }
 
 private:
-	HANDLE handle = INVALID_HANDLE_VALUE;
+	FILE *handle = nullptr;
+};
+
+struct queued_line
+{
+	std::string text;
+	reshade::log::level level;
+	uint32_t thread_id;
+	size_t message_offset;
+	std::chrono::system_clock::time_point time;
 };
 
-static std::mutex s_message_mutex;
+/// <summary>
+/// Bounded multi-producer single-consumer queue of finished log lines.
+/// Each slot carries a sequence number that tells producers and the consumer whose turn it is, so that no lock is needed to add a line.
+/// </summary>
+struct log_ring
+{
+	static constexpr size_t CAPACITY = 1024; // Has to be a power of two
+
+	struct slot
+	{
+		std::atomic<size_t> sequence;
+		queued_line line;
+	};
+
+	log_ring()
+	{
+		for (size_t i = 0; i < CAPACITY; ++i)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	bool try_push(queued_line &line)
+	{
+		for (size_t pos = enqueue_pos.load(std::memory_order_relaxed);;)
+		{
+			slot &s = slots[pos & (CAPACITY - 1)];
+			const ptrdiff_t diff = static_cast<ptrdiff_t>(s.sequence.load(std::memory_order_acquire)) - static_cast<ptrdiff_t>(pos);
+
+			if (diff == 0)
+			{
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					s.line = std::move(line);
+					s.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false; // The ring is full
+			}
+			else
+			{
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Must only be called by one thread at a time
+	bool try_pop(queued_line &line)
+	{
+		const size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		slot &s = slots[pos & (CAPACITY - 1)];
+		if (s.sequence.load(std::memory_order_acquire) != pos + 1)
+			return false; // The ring is empty (or the next line is still being written)
+
+		line = std::move(s.line);
+
+		s.sequence.store(pos + CAPACITY, std::memory_order_release);
+		dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	size_t size() const
+	{
+		return enqueue_pos.load(std::memory_order_relaxed) - dequeue_pos.load(std::memory_order_relaxed);
+	}
+
+	slot slots[CAPACITY];
+	std::atomic<size_t> enqueue_pos = 0;
+	std::atomic<size_t> dequeue_pos = 0;
+};
+
+static log_ring s_ring;
+static std::mutex s_write_mutex; // Serializes the consumer side of the ring and access to the file
 static scoped_file_handle s_file_handle;
-std::ostringstream reshade::log::line_stream;
+static std::mutex s_writer_wake_mutex;
+static std::condition_variable s_writer_wake;
+static std::atomic<bool> s_writer_enabled = false; // Whether lines may be written by a background writer thread
+static std::atomic<bool> s_writer_running = false; // Whether a background writer thread currently exists
+static std::atomic<bool> s_write_without_lock = false; // Set when all other threads were terminated (which may have happened while one of them held the lock)
+static std::mutex s_history_mutex;
+static std::deque<reshade::log::entry> s_history;
+static uint64_t s_history_next_index = 0;
+static const size_t s_history_capacity = 4096;
+// Time after which the writer thread exits when nothing was logged
+static const auto s_writer_idle_timeout = std::chrono::seconds(1);
+#ifndef _WIN32
+static std::mutex s_writer_thread_mutex;
+static std::thread s_writer_thread;
 
-reshade::log::message::message(level level)
+static void join_writer_thread()
 {
-	SYSTEMTIME time;
-	GetLocalTime(&time);
+	const std::lock_guard<std::mutex> lock(s_writer_thread_mutex);
+	if (s_writer_thread.joinable())
+		s_writer_thread.join();
+}
+#endif
+static struct scoped_flush
+{
+	~scoped_flush()
+	{
+#ifndef _WIN32
+		// The writer thread has to exit before the state it works on is destroyed
+		s_writer_enabled = false;
+		s_writer_wake.notify_one();
+		join_writer_thread();
+#endif
+		// Write out anything still queued in case the process exits without 'stop_log_writer' being called
+		reshade::log::flush();
+	}
+} s_flush_on_exit;
 
-	const char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
-	assert((static_cast<size_t>(level) - 1) < ARRAYSIZE(level_names));
+thread_local std::ostringstream reshade::log::line_stream = []() {
+	// Set default line stream settings
+	std::ostringstream stream;
+	stream.setf(std::ios::left);
+	stream.setf(std::ios::showbase);
+	return stream;
+}();
+
+static void write_queued_lines()
+{
+	// Collect everything that is queued into a single batch, so it can be written with one call
+	std::string batch;
+	std::vector<reshade::log::entry> entries;
+
+	for (queued_line line; s_ring.try_pop(line);)
+	{
+		// Split multi-line messages into separate lines and terminate each with CRLF
+		for (size_t begin = 0, end; begin <= line.text.size(); begin = end + 1)
+		{
+			end = line.text.find('\n', begin);
+			if (end == std::string::npos)
+				end = line.text.size();
+
+			batch.append(line.text, begin, end - begin);
+			batch += "\r\n";
+
+			entries.push_back({ 0, line.level, line.thread_id, line.time, line.text.substr(begin, end - begin), begin == 0 ? line.message_offset : 0 });
+		}
+	}
+
+	if (batch.empty())
+		return;
+
+	{ const std::lock_guard<std::mutex> lock(s_history_mutex);
+		for (reshade::log::entry &entry : entries)
+		{
+			entry.index = s_history_next_index++;
+			s_history.push_back(std::move(entry));
+		}
+		while (s_history.size() > s_history_capacity)
+			s_history.pop_front();
+	}
+
+	if (s_file_handle != nullptr)
+	{
+		std::fwrite(batch.data(), 1, batch.size(), s_file_handle);
+		// Hand the data to the operating system right away, so that it is not lost if the process crashes
+		std::fflush(s_file_handle);
+	}
+
+#if defined(_WIN32) && !defined(NDEBUG)
+	// Write lines to the debug output
+	OutputDebugStringA(batch.c_str());
+#endif
+}
+
+static void writer_thread_loop()
+{
+	auto last_write_time = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		{ std::unique_lock<std::mutex> lock(s_writer_wake_mutex);
+			// Wake up periodically even without notification, since producers only notify once the ring starts to fill up
+			s_writer_wake.wait_for(lock, std::chrono::milliseconds(50), []() { return !s_writer_enabled || s_ring.size() >= log_ring::CAPACITY / 4; });
+		}
+
+		if (s_ring.size() != 0)
+		{
+			const std::lock_guard<std::mutex> lock(s_write_mutex);
+			write_queued_lines();
+
+			last_write_time = std::chrono::steady_clock::now();
+		}
+		else if (!s_writer_enabled || std::chrono::steady_clock::now() - last_write_time > s_writer_idle_timeout)
+		{
+			s_writer_running = false;
+
+			// A producer may have queued a line after the ring was checked above, but did not start a new thread since this one was still running, so have to take care of that line
+			if (s_ring.size() == 0 || !s_writer_enabled || s_writer_running.exchange(true))
+				break;
+		}
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI writer_thread_main(LPVOID module)
+{
+	writer_thread_loop();
+
+	// Release the reference to the module that was added when this thread was started
+	// This may unload the module, which is why this has to happen in the same call that exits the thread, so that no code of the module is executed afterwards
+	FreeLibraryAndExitThread(static_cast<HMODULE>(module), 0);
+}
+#endif
+
+static void start_writer_thread()
+{
+	if (s_writer_running.exchange(true))
+		return;
+
+#ifdef _WIN32
+	// The thread holds a reference to this module while it is running, so that the module cannot be unloaded from under it
+	// That also means 'DllMain' never has to wait for it to exit (which it could not do, since exiting requires the loader lock), since the module is only unloaded once no writer thread is left
+	HMODULE module = nullptr;
+	if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&writer_thread_main), &module))
+	{
+		if (const HANDLE thread = CreateThread(nullptr, 0, &writer_thread_main, module, 0, nullptr); thread != nullptr)
+		{
+			CloseHandle(thread);
+			return;
+		}
 
-	// Lock the stream until the message is complete
-	s_message_mutex.lock();
+		FreeLibrary(module);
+	}
+
+	// Fall back to writing lines on the threads that log them
+	s_writer_enabled = false;
+	s_writer_running = false;
+#else
+	const std::lock_guard<std::mutex> lock(s_writer_thread_mutex);
+
+	// A previous thread already left its loop (otherwise 's_writer_running' would still be set), so this does not wait for long
+	if (s_writer_thread.joinable())
+		s_writer_thread.join();
+
+	s_writer_thread = std::thread(&writer_thread_loop);
+#endif
+}
 
-	// Start a new line
+reshade::log::message::message(level level) : _level(level), _time(std::chrono::system_clock::now())
+{
+	const char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
+	assert((static_cast<size_t>(level) - 1) < std::size(level_names));
+
+	// Start a new line (the stream is thread-local, so no need to lock anything while the message is built)
 	line_stream.str(std::string());
 	line_stream.clear();
 
+#ifdef _WIN32
+	SYSTEMTIME time;
+	GetLocalTime(&time);
+	_thread_id = GetCurrentThreadId();
+
 	line_stream << std::right << std::setfill('0')
 #if RESHADE_VERBOSE_LOG
 		<< std::setw(4) << time.wYear << '-'
@@ -51,45 +308,134 @@ reshade::log::message::message(level level)
 		<< std::setw(2) << time.wMinute << ':'
 		<< std::setw(2) << time.wSecond << ':'
 		<< std::setw(3) << time.wMilliseconds << ' '
-		<< '[' << std::setw(5) << GetCurrentThreadId() << ']' << std::setfill(' ') << " | "
+		<< '[' << std::setw(5) << _thread_id << ']' << std::setfill(' ') << " | "
+#else
+	const std::time_t now_time = std::chrono::system_clock::to_time_t(_time);
+	std::tm time = {};
+	localtime_r(&now_time, &time);
+	_thread_id = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000);
+
+	line_stream << std::right << std::setfill('0')
+#if RESHADE_VERBOSE_LOG
+		<< std::setw(4) << (time.tm_year + 1900) << '-'
+		<< std::setw(2) << (time.tm_mon + 1) << '-'
+		<< std::setw(2) << time.tm_mday << 'T'
+#endif
+		<< std::setw(2) << time.tm_hour << ':'
+		<< std::setw(2) << time.tm_min << ':'
+		<< std::setw(2) << time.tm_sec << ':'
+		<< std::setw(3) << (std::chrono::duration_cast<std::chrono::milliseconds>(_time.time_since_epoch()).count() % 1000) << ' '
+		<< '[' << std::setw(5) << _thread_id << ']' << std::setfill(' ') << " | "
+#endif
 		<< level_names[static_cast<unsigned int>(level) - 1] << " | " << std::left;
+
+	_message_offset = static_cast<size_t>(line_stream.tellp());
 }
 reshade::log::message::~message()
 {
-	std::string line_string = line_stream.str();
-	line_string += '\n'; // Terminate line with line feed
+	// Line endings are converted by the writer, so that this thread only has to hand off the text
+	queued_line line = { line_stream.str(), _level, _thread_id, _message_offset, _time };
 
-	// Replace all LF with CRLF
-	for (size_t offset = 0; (offset = line_string.find('\n', offset)) != std::string::npos; offset += 2)
-		line_string.replace(offset, 1, "\r\n", 2);
+	// If the ring is full, help the writer by writing out queued lines on this thread, which also throttles threads that log excessively
+	while (!s_ring.try_push(line))
+		flush();
 
-	// Write line to the log file
-	if (s_file_handle != INVALID_HANDLE_VALUE)
+	if (!s_writer_enabled || _level == level::error)
+	{
+		// Write out immediately while background writing is not enabled and for errors, which often precede a crash
+		flush();
+	}
+	else if (!s_writer_running)
 	{
-		DWORD written = 0;
-		WriteFile(s_file_handle, line_string.data(), static_cast<DWORD>(line_string.size()), &written, nullptr);
-		assert(written == line_string.size());
+		// The writer thread exits when idle, so start a new one
+		start_writer_thread();
 	}
+	else if (s_ring.size() >= log_ring::CAPACITY / 4)
+	{
+		s_writer_wake.notify_one();
+	}
+}
 
-#ifndef NDEBUG
-	// Write line to the debug output
-	OutputDebugStringA(line_string.c_str());
+void reshade::log::open_log_file(const std::filesystem::path &path)
+{
+	const std::lock_guard<std::mutex> lock(s_write_mutex);
+
+	// Write out anything still queued for the previous file and close it
+	write_queued_lines();
+
+	if (s_file_handle != nullptr)
+		std::fclose(s_file_handle);
+
+	// Open the log file for writing and clear previous contents (but allow others to read it while it is open)
+#ifdef _WIN32
+	s_file_handle = _wfsopen(path.c_str(), L"wb", _SH_DENYWR);
+#else
+	s_file_handle = std::fopen(path.c_str(), "wb");
 #endif
+}
+void reshade::log::close_log_file()
+{
+	const std::lock_guard<std::mutex> lock(s_write_mutex);
+
+	write_queued_lines();
 
-	// The message is finished, we can unlock the stream
-	s_message_mutex.unlock();
+	if (s_file_handle != nullptr)
+		std::fclose(s_file_handle);
+
+	s_file_handle = nullptr;
 }
 
-void reshade::log::open_log_file(const std::filesystem::path &path)
+void reshade::log::start_log_writer()
+{
+	s_writer_enabled = true;
+}
+void reshade::log::stop_log_writer(bool other_threads_terminated)
 {
-	// Close the previous file first
-	if (s_file_handle != INVALID_HANDLE_VALUE)
-		CloseHandle(s_file_handle);
+	s_writer_enabled = false;
+	s_writer_wake.notify_one();
 
-	// Set default line stream settings
-	line_stream.setf(std::ios::left);
-	line_stream.setf(std::ios::showbase);
+	// Another thread may have been terminated while it was holding the lock, in which case it would never be released again
+	if (other_threads_terminated)
+		s_write_without_lock = true;
+
+#ifndef _WIN32
+	// Outside of Windows there is no loader lock, so can simply wait for the thread to exit
+	join_writer_thread();
+#endif
+
+	flush();
+}
+
+void reshade::log::flush()
+{
+	if (s_write_without_lock)
+	{
+		// All other threads were terminated, so there is no one left to synchronize with
+		write_queued_lines();
+		return;
+	}
+
+	const std::lock_guard<std::mutex> lock(s_write_mutex);
+	write_queued_lines();
+}
+
+uint64_t reshade::log::read_history(uint64_t first_index, std::vector<entry> &entries)
+{
+	const std::lock_guard<std::mutex> lock(s_history_mutex);
+
+	if (s_history.empty())
+		return s_history_next_index;
+
+	const uint64_t first_index_in_history = s_history.front().index;
+	for (size_t i = first_index > first_index_in_history ? static_cast<size_t>(first_index - first_index_in_history) : 0; i < s_history.size(); ++i)
+		entries.push_back(s_history[i]);
+
+	return s_history_next_index;
+}
+void reshade::log::clear_history()
+{
+	const std::lock_guard<std::mutex> lock(s_history_mutex);
 
-	// Open the log file for writing (and flush on each write) and clear previous contents
-	s_file_handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+	// Keep counting indices from where they left off, so that readers notice the new lines
+	s_history.clear();
 }
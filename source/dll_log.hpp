@@ -5,12 +5,17 @@
 
 #pragma once
 
+#include <chrono>
+#include <vector>
 #include <cassert>
+#include <cstdint>
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
 #include <utf8/unchecked.h>
+#ifdef _WIN32
 #include <combaseapi.h> // REFIID, HRESULT
+#endif
 
 #undef INFO
 #undef ERROR // This is defined in the Windows SDK headers
@@ -33,19 +38,68 @@ namespace reshade::log
 		debug = 4,
 	};
 
+	/// <summary>
+	/// A single line of the in-memory log history.
+	/// </summary>
+	struct entry
+	{
+		uint64_t index;
+		log::level level;
+		uint32_t thread_id;
+		std::chrono::system_clock::time_point time;
+		std::string line;
+		size_t message_offset; // Offset of the message text in the line, after time, thread and level (zero for continuation lines of multi-line messages)
+	};
+
 	/// <summary>
 	/// Open a log file for writing.
 	/// </summary>
 	/// <param name="path">The path to the log file.</param>
 	void open_log_file(const std::filesystem::path &path);
+	/// <summary>
+	/// Write all queued messages and close the log file again.
+	/// </summary>
+	void close_log_file();
 
 	/// <summary>
-	/// The current log line stream.
+	/// Allow queued messages to be written to the log file by a background thread.
+	/// Until this is called, messages are written out immediately on the thread that logged them.
+	/// The thread is started when the first message is queued and exits again after a while without any messages. It holds a reference to the module while it is running, so the module is only unloaded after it exited.
 	/// </summary>
-	extern std::ostringstream line_stream;
+	void start_log_writer();
+	/// <summary>
+	/// Write all remaining messages and write any further messages immediately on the thread that logged them again.
+	/// This is safe to call from 'DllMain' during process detach, since it does not wait for the background thread on Windows (which is not running anymore at that point anyway, unless the process is exiting). Elsewhere it waits for the thread to exit.
+	/// </summary>
+	/// <param name="other_threads_terminated">Set to <c>true</c> when all other threads were terminated already (e.g. during process exit), in which case one of them may have been holding the lock on the log file.</param>
+	void stop_log_writer(bool other_threads_terminated = false);
+
+	/// <summary>
+	/// Write all queued messages to the log file right away on the calling thread.
+	/// This waits for the background writer thread if it is currently writing.
+	/// </summary>
+	void flush();
 
 	/// <summary>
-	/// Constructs a single log message including current time and level and writes it to the open log file.
+	/// Append all lines of the in-memory log history starting at the specified index to a list.
+	/// Only the most recent lines are kept in memory, so the first returned line may have a larger index than requested.
+	/// </summary>
+	/// <param name="first_index">The index of the first line to retrieve.</param>
+	/// <param name="entries">The list to append the lines to.</param>
+	/// <returns>The index following the last line in the history.</returns>
+	uint64_t read_history(uint64_t first_index, std::vector<entry> &entries);
+	/// <summary>
+	/// Remove all lines from the in-memory log history.
+	/// </summary>
+	void clear_history();
+
+	/// <summary>
+	/// The current log line stream of the calling thread.
+	/// </summary>
+	extern thread_local std::ostringstream line_stream;
+
+	/// <summary>
+	/// Constructs a single log message including current time and level and queues it for writing to the open log file.
 	/// </summary>
 	struct message
 	{
@@ -59,16 +113,15 @@ namespace reshade::log
 			return *this;
 		}
 
-		template <>
-		message &operator<<(REFIID riid)
+#ifdef _WIN32
+		inline message &operator<<(REFIID riid)
 		{
 			OLECHAR riid_string[40];
 			StringFromGUID2(riid, riid_string, ARRAYSIZE(riid_string));
 			return *this << riid_string;
 		}
 
-		template <>
-		message &operator<<(const HRESULT &hresult) // Note: HRESULT is just an alias for long, so this falsely catches all long values too
+		inline message &operator<<(const HRESULT &hresult) // Note: HRESULT is just an alias for long, so this falsely catches all long values too
 		{
 			switch (hresult)
 			{
@@ -106,19 +159,22 @@ namespace reshade::log
 				return *this << std::hex << static_cast<unsigned long>(hresult) << std::dec;
 			}
 		}
+#endif
 
-		template <>
-		message &operator<<(const std::wstring &message)
+		inline message &operator<<(const std::wstring &message)
 		{
-			static_assert(sizeof(std::wstring::value_type) == sizeof(uint16_t), "expected 'std::wstring' to use UTF-16 encoding");
 			std::string utf8_message;
 			utf8_message.reserve(message.size());
+#ifdef _WIN32
+			static_assert(sizeof(std::wstring::value_type) == sizeof(uint16_t), "expected 'std::wstring' to use UTF-16 encoding");
 			utf8::unchecked::utf16to8(message.begin(), message.end(), std::back_inserter(utf8_message));
+#else
+			utf8::unchecked::utf32to8(message.begin(), message.end(), std::back_inserter(utf8_message));
+#endif
 			return operator<<(utf8_message);
 		}
 
-		template <>
-		message &operator<<(const std::filesystem::path &path)
+		inline message &operator<<(const std::filesystem::path &path)
 		{
 			return operator<<('"' + path.u8string() + '"');
 		}
@@ -131,10 +187,20 @@ namespace reshade::log
 
 		inline message &operator<<(const wchar_t *message)
 		{
-			static_assert(sizeof(wchar_t) == sizeof(uint16_t), "expected 'wchar_t' to use UTF-16 encoding");
 			std::string utf8_message;
+#ifdef _WIN32
+			static_assert(sizeof(wchar_t) == sizeof(uint16_t), "expected 'wchar_t' to use UTF-16 encoding");
 			utf8::unchecked::utf16to8(message, message + wcslen(message), std::back_inserter(utf8_message));
+#else
+			utf8::unchecked::utf32to8(message, message + wcslen(message), std::back_inserter(utf8_message));
+#endif
 			return operator<<(utf8_message);
 		}
+
+	private:
+		level _level;
+		uint32_t _thread_id;
+		size_t _message_offset;
+		std::chrono::system_clock::time_point _time;
 	};
 }
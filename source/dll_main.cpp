@@ -134,6 +134,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	g_reshade_base_path = get_base_path();
 
 	reshade::log::open_log_file(g_reshade_base_path / g_reshade_dll_path.filename().replace_extension(L".log"));
+	reshade::log::start_log_writer();
 
 	reshade::hooks::register_module(L"user32.dll");
 
@@ -801,7 +802,7 @@ static PVOID g_exception_handler_handle = nullptr;
 // Export special symbol to identify modules as ReShade instances
 extern "C" __declspec(dllexport) const char *ReShadeVersion = VERSION_STRING_PRODUCT;
 
-BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
+BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID lpReserved)
 {
 	switch (fdwReason)
 	{
@@ -906,8 +907,17 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		// Do not register Vulkan hooks, since Vulkan layering mechanism is used instead
 
 		LOG(INFO) << "Initialized.";
+
+		// Start writing log messages in the background only now that initialization succeeded and the module stays loaded
+		reshade::log::start_log_writer();
 		break;
 	case DLL_PROCESS_DETACH:
+		// Write all remaining and further messages right away, so they make it into the log file before the module is unloaded
+		// There is no background writer thread left at this point when the module is unloaded via 'FreeLibrary', since it holds a reference to the module while running, but all other threads were terminated already during process exit (in which case the reserved parameter is not null)
+		reshade::log::stop_log_writer(lpReserved != nullptr);
+		// Same for INI files that are still queued for writing, since the background writer thread may have been terminated during process exit
+		reshade::ini_file::stop_background_writes(lpReserved != nullptr);
+
 		LOG(INFO) << "Exiting ...";
 
 		reshade::hooks::uninstall();
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+namespace reshade
+{
+	/// <summary>
+	/// A histogram of durations in nanoseconds with a fixed memory footprint, which uses logarithmically sized buckets that are each split into linear sub-buckets (similar to an HDR histogram).
+	/// Durations between one microsecond and about 34 seconds are recorded with a relative error of at most 1/16, which is enough to compute percentiles and find stutter.
+	/// </summary>
+	class duration_histogram
+	{
+	public:
+		void clear()
+		{
+			_count = 0;
+			_sum = 0;
+			_max = 0;
+			std::fill_n(_buckets, NUM_BUCKETS, 0u);
+		}
+
+		void record(uint64_t value)
+		{
+			_count++;
+			_sum += value;
+			_max = std::max(_max, value);
+			_buckets[index_of(value)]++;
+		}
+
+		uint64_t count() const { return _count; }
+		uint64_t max() const { return _max; }
+		uint64_t mean() const { return _count != 0 ? _sum / _count : 0; }
+
+		/// <summary>
+		/// Gets the duration that the specified fraction of all recorded durations is less than or equal to (e.g. 0.99 for the 99th percentile).
+		/// </summary>
+		/// <param name="fraction">The percentile as a fraction between zero and one.</param>
+		/// <returns>The upper bound of the bucket the percentile falls into, which is never larger than the maximum recorded duration.</returns>
+		uint64_t percentile(double fraction) const
+		{
+			if (_count == 0)
+				return 0;
+
+			const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * _count + 0.5));
+
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < NUM_BUCKETS; ++i)
+				if ((cumulative += _buckets[i]) >= target)
+					return std::min(_max, upper_bound_of(i));
+
+			return _max;
+		}
+
+		// Durations are recorded in units of 16 nanoseconds, so that one microsecond (62 units) already falls into the logarithmic buckets
+		static constexpr unsigned int UNIT_SHIFT = 4;
+		static constexpr unsigned int SUB_BUCKET_BITS = 4;
+		static constexpr unsigned int MAX_MAGNITUDE = 30; // Largest power of two (in units) with its own bucket, anything above is put into the last bucket
+		static constexpr size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		static constexpr size_t NUM_BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+		/// <summary>
+		/// Gets the index of the bucket the specified duration is recorded in.
+		/// </summary>
+		static size_t index_of(uint64_t value)
+		{
+			const uint64_t units = value >> UNIT_SHIFT;
+			// The first two buckets are linear with a sub-bucket width of one unit
+			if (units < 2 * SUB_BUCKETS)
+				return static_cast<size_t>(units);
+
+			unsigned int magnitude = SUB_BUCKET_BITS + 1;
+			while (magnitude < MAX_MAGNITUDE && (units >> (magnitude + 1)) != 0)
+				magnitude++;
+
+			// Each following bucket covers twice the range of the previous one with sub-buckets that are twice as wide
+			const unsigned int shift = magnitude - SUB_BUCKET_BITS;
+			return std::min<size_t>((shift + 1) * SUB_BUCKETS + static_cast<size_t>((units >> shift) - SUB_BUCKETS), NUM_BUCKETS - 1);
+		}
+
+		/// <summary>
+		/// Gets the largest duration that is recorded in the bucket with the specified index.
+		/// </summary>
+		static uint64_t upper_bound_of(size_t index)
+		{
+			if (index + 1 >= NUM_BUCKETS)
+				return UINT64_MAX;
+
+			// Lower bound of the next sub-bucket minus one
+			const size_t next = index + 1;
+			if (next < 2 * SUB_BUCKETS)
+				return (static_cast<uint64_t>(next) << UNIT_SHIFT) - 1;
+
+			const unsigned int shift = static_cast<unsigned int>(next / SUB_BUCKETS - 1);
+			return (static_cast<uint64_t>(next % SUB_BUCKETS + SUB_BUCKETS) << (shift + UNIT_SHIFT)) - 1;
+		}
+
+	private:
+		uint64_t _count = 0, _sum = 0, _max = 0;
+		uint32_t _buckets[NUM_BUCKETS] = {};
+	};
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace reshade
+{
+	/// <summary>
+	/// Keeps the total duration of all enabled techniques within a budget, by suspending the technique with the lowest priority while the budget is exceeded and resuming it once there is enough headroom again.
+	/// Changes are only made after the budget was exceeded (or there was headroom) for a number of consecutive updates, so that short spikes or small fluctuations do not make techniques flicker on and off.
+	/// Decisions only depend on the durations passed to <see cref="update"/>, so the controller can be driven by recorded timing traces.
+	/// </summary>
+	class effect_budget_controller
+	{
+	public:
+		// Number of consecutive updates the budget has to be exceeded before a technique is suspended
+		static constexpr unsigned int SUSPEND_DELAY = 30;
+		// Number of consecutive updates there has to be enough headroom before a technique is resumed
+		static constexpr unsigned int RESUME_DELAY = 120;
+		// Percentage of the budget that has to be left after resuming a technique, so that it is not suspended again right away
+		static constexpr unsigned int RESUME_HEADROOM_PERCENT = 10;
+
+		struct candidate
+		{
+			uint64_t duration; // Average GPU duration in nanoseconds (for suspended techniques the last one measured before they were suspended)
+			int priority; // Techniques with a lower priority are suspended first and resumed last
+			bool suspended;
+		};
+
+		enum class action
+		{
+			none,
+			suspend,
+			resume,
+		};
+
+		struct decision
+		{
+			action type = action::none;
+			size_t index = 0; // Index of the candidate to suspend or resume
+			uint64_t total_duration = 0; // Total duration of all candidates that are not suspended
+		};
+
+		/// <summary>
+		/// Decides whether a technique should be suspended or resumed this frame. At most one technique is changed per update.
+		/// </summary>
+		/// <param name="budget">The budget in nanoseconds.</param>
+		/// <param name="candidates">The enabled techniques in render order. Among candidates with the same priority, later ones are suspended first.</param>
+		/// <param name="num_candidates">The number of elements in <paramref name="candidates"/>.</param>
+		decision update(uint64_t budget, const candidate *candidates, size_t num_candidates)
+		{
+			decision result;
+
+			size_t suspend_index = num_candidates;
+			size_t resume_index = num_candidates;
+
+			for (size_t i = 0; i < num_candidates; ++i)
+			{
+				const candidate &c = candidates[i];
+
+				if (c.suspended)
+				{
+					if (resume_index == num_candidates || c.priority > candidates[resume_index].priority)
+						resume_index = i;
+				}
+				else
+				{
+					result.total_duration += c.duration;
+
+					if (suspend_index == num_candidates || c.priority <= candidates[suspend_index].priority)
+						suspend_index = i;
+				}
+			}
+
+			if (result.total_duration > budget && suspend_index != num_candidates)
+			{
+				_updates_with_headroom = 0;
+
+				if (++_updates_over_budget >= SUSPEND_DELAY)
+				{
+					_updates_over_budget = 0;
+
+					result.type = action::suspend;
+					result.index = suspend_index;
+				}
+			}
+			else if (resume_index != num_candidates &&
+				(result.total_duration + candidates[resume_index].duration) * 100 <= budget * (100 - RESUME_HEADROOM_PERCENT))
+			{
+				_updates_over_budget = 0;
+
+				if (++_updates_with_headroom >= RESUME_DELAY)
+				{
+					_updates_with_headroom = 0;
+
+					result.type = action::resume;
+					result.index = resume_index;
+				}
+			}
+			else
+			{
+				reset();
+			}
+
+			return result;
+		}
+
+		/// <summary>
+		/// Restarts the delays, e.g. after the budget or the list of techniques changed.
+		/// </summary>
+		void reset()
+		{
+			_updates_over_budget = 0;
+			_updates_with_headroom = 0;
+		}
+
+	private:
+		unsigned int _updates_over_budget = 0;
+		unsigned int _updates_with_headroom = 0;
+	};
+}
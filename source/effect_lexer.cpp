@@ -6,6 +6,26 @@
 #include "effect_lexer.hpp"
 #include <cassert>
 #include <unordered_map> // Used for static lookup tables
+#include <string_view>
+
+// These can be defined to 0 before compiling this file, to get the scalar scanning and plain keyword map the optimized lexer is tested against
+#ifndef LEXER_SSE2
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define LEXER_SSE2 1
+#else
+#define LEXER_SSE2 0
+#endif
+#endif
+#ifndef LEXER_KEYWORD_TABLE
+#define LEXER_KEYWORD_TABLE 1
+#endif
+
+#if LEXER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanForward
+#endif
+#endif
 
 using namespace reshadefx;
 
@@ -198,7 +218,7 @@ static const std::unordered_map<tokenid, std::string> token_lookup = {
 	{ tokenid::sampler, "sampler" },
 	{ tokenid::storage, "storage" },
 };
-static const std::unordered_map<std::string, tokenid> keyword_lookup = {
+static const std::pair<std::string_view, tokenid> keyword_list[] = {
 	{ "asm", tokenid::reserved },
 	{ "asm_fragment", tokenid::reserved },
 	{ "auto", tokenid::reserved },
@@ -432,6 +452,51 @@ static const std::unordered_map<std::string, tokenid> keyword_lookup = {
 	{ "volatile", tokenid::volatile_ },
 	{ "while", tokenid::while_ }
 };
+
+#if LEXER_KEYWORD_TABLE
+// Seed of the keyword hash, which was chosen so that every keyword in the list above maps to a different slot in the lookup table
+// If a keyword is added and the assertion in 'keyword_table' fails, a new seed has to be found
+static constexpr uint32_t keyword_hash_seed = 2166321505u;
+static constexpr uint32_t keyword_table_bits = 11;
+
+static inline uint32_t hash_keyword(const char *begin, const char *end)
+{
+	uint32_t hash = keyword_hash_seed;
+	for (; begin != end; ++begin)
+		hash = (hash ^ static_cast<uint8_t>(*begin)) * 16777619u;
+	return hash >> (32 - keyword_table_bits);
+}
+
+// Perfect hash table which translates an identifier to a keyword token with a single lookup and without constructing a string
+static const struct keyword_table
+{
+	keyword_table()
+	{
+		static_assert(std::size(keyword_list) < 255);
+
+		for (size_t i = 0; i < std::size(keyword_list); ++i)
+		{
+			const std::string_view name = keyword_list[i].first;
+			uint8_t &slot = slots[hash_keyword(name.data(), name.data() + name.size())];
+			assert(slot == 0);
+			slot = static_cast<uint8_t>(i + 1);
+		}
+	}
+
+	bool find(const char *begin, const char *end, tokenid &id) const
+	{
+		const uint8_t slot = slots[hash_keyword(begin, end)];
+		if (slot == 0 || keyword_list[slot - 1].first != std::string_view(begin, end - begin))
+			return false;
+		id = keyword_list[slot - 1].second;
+		return true;
+	}
+
+	uint8_t slots[1 << keyword_table_bits] = {};
+} keyword_lookup;
+#else
+static const std::unordered_map<std::string, tokenid> keyword_lookup(std::begin(keyword_list), std::end(keyword_list));
+#endif
 static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
 	{ "define", tokenid::hash_def },
 	{ "undef", tokenid::hash_undef },
@@ -447,6 +512,86 @@ static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
 	{ "include", tokenid::hash_include },
 };
 
+#if LEXER_SSE2
+static inline unsigned int first_set_bit(int mask)
+{
+#ifdef _MSC_VER
+	unsigned long offset;
+	_BitScanForward(&offset, static_cast<unsigned long>(mask));
+	return offset;
+#else
+	return __builtin_ctz(static_cast<unsigned int>(mask));
+#endif
+}
+static inline __m128i in_range(__m128i chars, char first, char last)
+{
+	// Characters are compared as signed values, so anything above 0x7F is never in range (which matches the type lookup table)
+	return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8(last + 1)));
+}
+
+// Skip characters as long as the 'mask' function returns a set bit for them, processing 16 characters at a time
+// Only full blocks are processed, so the caller has to handle any remaining characters at the end of the input
+template <typename F>
+static inline const char *skip_while(const char *first, const char *const last, F mask)
+{
+	for (; last - first >= 16; first += 16)
+		if (const int mismatch = ~mask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first))) & 0xFFFF; mismatch != 0)
+			return first + first_set_bit(mismatch);
+	return first;
+}
+#endif
+
+static inline const char *skip_space_chars(const char *first, const char *const last)
+{
+#if LEXER_SSE2
+	first = skip_while(first, last, [](__m128i chars) {
+		// Any of ' ', '\t', '\v', '\f' or '\r', but not '\n'
+		const __m128i control = _mm_andnot_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')), in_range(chars, '\t', '\r'));
+		return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')), control));
+	});
+#endif
+	while (first < last && type_lookup[uint8_t(*first)] == SPACE)
+		first++;
+	return first;
+}
+static inline const char *skip_identifier_chars(const char *first, const char *const last)
+{
+#if LEXER_SSE2
+	first = skip_while(first, last, [](__m128i chars) {
+		const __m128i letter = in_range(_mm_or_si128(chars, _mm_set1_epi8(0x20)), 'a', 'z');
+		return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, in_range(chars, '0', '9')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'))));
+	});
+#endif
+	while (first < last && (type_lookup[uint8_t(*first)] == IDENT || type_lookup[uint8_t(*first)] == DIGIT))
+		first++;
+	return first;
+}
+static inline const char *find_any_of(const char *first, const char *const last, char c1, char c2)
+{
+#if LEXER_SSE2
+	first = skip_while(first, last, [c1, c2](__m128i chars) {
+		return ~_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(c1)), _mm_cmpeq_epi8(chars, _mm_set1_epi8(c2))));
+	});
+#endif
+	while (first < last && *first != c1 && *first != c2)
+		first++;
+	return first;
+}
+static inline const char *skip_string_chars(const char *first, const char *const last)
+{
+	// Skip all characters that do not need special handling in a string literal
+#if LEXER_SSE2
+	first = skip_while(first, last, [](__m128i chars) {
+		return ~_mm_movemask_epi8(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('\\'))),
+			_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')))));
+	});
+#endif
+	while (first < last && *first != '"' && *first != '\\' && *first != '\n' && *first != '\r')
+		first++;
+	return first;
+}
+
 static inline bool is_octal_digit(char c)
 {
 	return static_cast<unsigned>(c - '0') < 8;
@@ -648,6 +793,13 @@ next_token:
 		{
 			while (_cur < _end)
 			{
+				if (*_cur != '\n' && *_cur != '*')
+				{
+					// Skip over the comment text in one go, since only line feeds and the end of the comment need to be handled
+					skip(find_any_of(_cur, _end, '\n', '*') - _cur);
+					continue;
+				}
+
 				if (*_cur == '\n')
 				{
 					_cur_location.line++;
@@ -775,29 +927,27 @@ void reshadefx::lexer::skip(size_t length)
 }
 void reshadefx::lexer::skip_space()
 {
-	// Skip each character until a space is found
-	while (type_lookup[uint8_t(*_cur)] == SPACE && _cur < _end)
-		skip(1);
+	// Skip each character until a non-space character is found
+	skip(skip_space_chars(_cur, _end) - _cur);
 }
 void reshadefx::lexer::skip_to_next_line()
 {
 	// Skip each character until a new line feed is found
-	while (*_cur != '\n' && _cur < _end)
-		skip(1);
+	skip(find_any_of(_cur, _end, '\n', '\n') - _cur);
 }
 
 void reshadefx::lexer::reset_to_offset(size_t offset)
 {
-	assert(offset < _input.size());
-	_cur = _input.data() + offset;
+	assert(offset < static_cast<size_t>(_end - _begin));
+	_cur = _begin + offset;
 }
 
 void reshadefx::lexer::parse_identifier(token &tok) const
 {
-	auto *const begin = _cur, *end = begin;
+	auto *const begin = _cur;
 
 	// Skip to the end of the identifier sequence
-	do end++; while (type_lookup[uint8_t(*end)] == IDENT || type_lookup[uint8_t(*end)] == DIGIT);
+	auto *const end = skip_identifier_chars(begin + 1, _end);
 
 	tok.id = tokenid::identifier;
 	tok.offset = input_offset();
@@ -807,14 +957,27 @@ void reshadefx::lexer::parse_identifier(token &tok) const
 	if (_ignore_keywords)
 		return;
 
+#if LEXER_KEYWORD_TABLE
+	keyword_lookup.find(begin, end, tok.id);
+#else
 	if (const auto it = keyword_lookup.find(tok.literal_as_string);
 		it != keyword_lookup.end())
 		tok.id = it->second;
+#endif
 }
 bool reshadefx::lexer::parse_pp_directive(token &tok)
 {
 	skip(1); // Skip the '#'
 	skip_space(); // Skip any space between the '#' and directive
+
+	if (_cur >= _end)
+	{
+		// There is no directive name after the '#' at the end of the input, so do not read any further
+		tok.id = tokenid::hash_unknown;
+		tok.length = 0;
+		return true;
+	}
+
 	parse_identifier(tok);
 
 	if (const auto it = pp_directive_lookup.find(tok.literal_as_string);
@@ -861,6 +1024,14 @@ void reshadefx::lexer::parse_string_literal(token &tok, bool escape)
 
 	for (auto c = *end; c != '"'; c = *++end)
 	{
+		if (const char *const run_end = skip_string_chars(end, _end); run_end != end)
+		{
+			// Append all characters up to the next one that needs special handling at once
+			tok.literal_as_string.append(end, run_end);
+			end = run_end - 1;
+			continue;
+		}
+
 		if (c == '\n' || end >= _end)
 		{
 			// Line feed reached, the string literal is done (technically this should be an error, but the lexer does not report errors, so ignore it)
@@ -884,8 +1055,8 @@ void reshadefx::lexer::parse_string_literal(token &tok, bool escape)
 			continue;
 		}
 
-		// Handle escape sequences
-		if (c == '\\' && escape)
+		// Handle escape sequences (except for an escape character at the very end of the input, which has nothing to escape)
+		if (c == '\\' && escape && end + 1 < _end)
 		{
 			unsigned int n = 0;
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <cassert>
 
 namespace reshadefx
 {
@@ -33,17 +34,46 @@ namespace reshadefx
 			_ignore_keywords(ignore_keywords),
 			_escape_string_literals(escape_string_literals)
 		{
-			_cur = _input.data();
+			_begin = _cur = _input.data();
 			_end = _cur + _input.size();
 		}
+		/// <summary>
+		/// Create a lexical analyzer that works on text it does not own, so that it does not have to be copied first.
+		/// The text has to be followed by a null terminator and stay alive for as long as the lexical analyzer is used.
+		/// </summary>
+		lexer(
+			const char *begin,
+			const char *end,
+			bool ignore_comments = true,
+			bool ignore_whitespace = true,
+			bool ignore_pp_directives = true,
+			bool ignore_line_directives = false,
+			bool ignore_keywords = false,
+			bool escape_string_literals = true,
+			const location &start_location = location()) :
+			_cur_location(start_location),
+			_begin(begin),
+			_cur(begin),
+			_end(end),
+			_ignore_comments(ignore_comments),
+			_ignore_whitespace(ignore_whitespace),
+			_ignore_pp_directives(ignore_pp_directives),
+			_ignore_line_directives(ignore_line_directives),
+			_ignore_keywords(ignore_keywords),
+			_escape_string_literals(escape_string_literals)
+		{
+			assert(*end == '\0');
+		}
 
 		lexer(const lexer &lexer) { operator=(lexer); }
 		lexer &operator=(const lexer &lexer)
 		{
 			_input = lexer._input;
 			_cur_location = lexer._cur_location;
-			reset_to_offset(lexer._cur - lexer._input.data());
-			_end = _input.data() + _input.size();
+			// Text that is not owned is shared with the other lexical analyzer, owned text is copied
+			_begin = lexer._begin == lexer._input.data() ? _input.data() : lexer._begin;
+			_cur = _begin + (lexer._cur - lexer._begin);
+			_end = _begin + (lexer._end - lexer._begin);
 			_ignore_comments = lexer._ignore_comments;
 			_ignore_whitespace = lexer._ignore_whitespace;
 			_ignore_pp_directives = lexer._ignore_pp_directives;
@@ -57,10 +87,11 @@ namespace reshadefx
 		/// <summary>
 		/// Get the current position in the input string.
 		/// </summary>
-		size_t input_offset() const { return _cur - _input.data(); }
+		size_t input_offset() const { return _cur - _begin; }
 
 		/// <summary>
 		/// Get the input string this lexical analyzer works on.
+		/// This is empty if the lexical analyzer was created on text it does not own.
 		/// </summary>
 		/// <returns>A constant reference to the input string.</returns>
 		const std::string &input_string() const { return _input; }
@@ -100,7 +131,7 @@ namespace reshadefx
 
 		std::string _input;
 		location _cur_location;
-		const std::string::value_type *_cur, *_end;
+		const std::string::value_type *_begin, *_cur, *_end;
 		bool _ignore_comments;
 		bool _ignore_whitespace;
 		bool _ignore_pp_directives;
@@ -28,6 +28,15 @@ namespace reshadefx
 		/// <returns>A boolean value indicating whether parsing was successful or not.</returns>
 		bool parse(std::string source, class codegen *backend);
 
+		/// <summary>
+		/// Get the number of tokens that were consumed while parsing (tokens consumed again after backtracking are only counted once).
+		/// </summary>
+		size_t num_tokens() const { return _num_tokens; }
+		/// <summary>
+		/// Get the number of symbols that were declared while parsing.
+		/// </summary>
+		using symbol_table::num_symbols;
+
 		/// <summary>
 		/// Get the list of error messages.
 		/// </summary>
@@ -79,6 +88,8 @@ namespace reshadefx
 		std::string _errors;
 		token _token, _token_next, _token_backup;
 		std::unique_ptr<class lexer> _lexer;
+		size_t _num_tokens = 0;
+		size_t _num_tokens_backup = 0;
 		size_t _lexer_backup_offset = 0;
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
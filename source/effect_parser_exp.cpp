@@ -36,17 +36,20 @@ void reshadefx::parser::backup()
 {
 	_token_backup = _token_next;
 	_lexer_backup_offset = _lexer->input_offset();
+	_num_tokens_backup = _num_tokens;
 }
 void reshadefx::parser::restore()
 {
 	_lexer->reset_to_offset(_lexer_backup_offset);
 	_token_next = _token_backup; // Copy instead of move here, since restore may be called twice (from 'accept_type_class' and then again from 'parse_expression_unary')
+	_num_tokens = _num_tokens_backup; // Tokens consumed since the backup are consumed again, so do not count them twice
 }
 
 void reshadefx::parser::consume()
 {
 	_token = std::move(_token_next);
 	_token_next = _lexer->lex();
+	_num_tokens++;
 }
 void reshadefx::parser::consume_until(tokenid tokid)
 {
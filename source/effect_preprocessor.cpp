@@ -105,6 +105,42 @@ static std::string escape_string(std::string s)
 	return '\"' + s + '\"';
 }
 
+bool reshadefx::file_cache::read(const std::filesystem::path &path, std::string &data)
+{
+	const std::string key = path.u8string();
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		if (const auto it = _files.find(key); it != _files.end())
+			return data = it->second.data, true;
+	}
+
+	// Get modification time before reading, so that a change while reading is detected by 'remove_modified' later
+	std::error_code ec;
+	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(path, ec);
+
+	// Read outside the lock, so that threads reading different files do not wait on each other
+	if (!read_file(path, data))
+		return false;
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+	_files.emplace(key, file { data, modified_at });
+	return true;
+}
+
+void reshadefx::file_cache::remove_modified()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	std::error_code ec;
+	for (auto it = _files.begin(); it != _files.end();)
+	{
+		if (std::filesystem::last_write_time(std::filesystem::u8path(it->first), ec) != it->second.modified_at || ec)
+			it = _files.erase(it);
+		else
+			++it;
+	}
+}
+
 reshadefx::preprocessor::preprocessor()
 {
 }
@@ -675,7 +711,7 @@ void reshadefx::preprocessor::parse_include()
 	}
 	else
 	{
-		if (!read_file(file_path, data))
+		if (_include_cache != nullptr ? !_include_cache->read(file_path, data) : !read_file(file_path, data))
 		{
 			error(keyword_location, "could not open included file '" + file_path_string + '\'');
 			consume_until(tokenid::end_of_line);
@@ -689,6 +725,8 @@ void reshadefx::preprocessor::parse_include()
 	while (_input_stack.size() > (_next_input_index + 1))
 		_input_stack.pop_back();
 	push(std::move(data), file_path_string);
+
+	_num_includes++;
 }
 
 bool reshadefx::preprocessor::evaluate_expression()
@@ -1124,6 +1162,7 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 
 	std::string input;
 	expand_macro(it->first, it->second, arguments, input);
+	_num_macro_expansions++;
 
 	if (!input.empty())
 	{
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <mutex>
 #include <memory> // std::unique_ptr
 #include <filesystem>
 #include <unordered_set>
@@ -13,6 +14,36 @@
 
 namespace reshadefx
 {
+	/// <summary>
+	/// A cache of file contents that can be shared between multiple preprocessor instances (even on different threads), so that include files common to many effects are only read from disk once.
+	/// </summary>
+	class file_cache
+	{
+	public:
+		/// <summary>
+		/// Get the contents of the file at the specified <paramref name="path"/>, reading it from disk if it was not cached yet.
+		/// </summary>
+		/// <param name="path">The path to the file to read.</param>
+		/// <param name="data">The contents of the file.</param>
+		/// <returns><c>true</c> if the file exists and could be read, <c>false</c> otherwise.</returns>
+		bool read(const std::filesystem::path &path, std::string &data);
+
+		/// <summary>
+		/// Remove all files that were modified or deleted since they were read from the cache, so that they are read from disk again on the next access.
+		/// </summary>
+		void remove_modified();
+
+	private:
+		struct file
+		{
+			std::string data;
+			std::filesystem::file_time_type modified_at;
+		};
+
+		std::mutex _mutex;
+		std::unordered_map<std::string, file> _files;
+	};
+
 	/// <summary>
 	/// A C-style preprocessor implementation.
 	/// </summary>
@@ -36,6 +67,11 @@ namespace reshadefx
 		/// </summary>
 		/// <param name="path">The path to the directory to add.</param>
 		void add_include_path(const std::filesystem::path &path);
+		/// <summary>
+		/// Read included files through the specified cache instead of directly from disk.
+		/// </summary>
+		/// <param name="cache">The cache to use. It has to stay alive for the lifetime of this preprocessor instance.</param>
+		void set_include_cache(file_cache *cache) { _include_cache = cache; }
 
 		/// <summary>
 		/// Add a new macro definition. This is equal to appending '#define name macro' to this preprocessor instance.
@@ -90,6 +126,15 @@ namespace reshadefx
 		/// <returns></returns>
 		std::vector<std::pair<std::string, std::string>> used_macro_definitions() const;
 
+		/// <summary>
+		/// Get the number of macros that were expanded.
+		/// </summary>
+		size_t num_macro_expansions() const { return _num_macro_expansions; }
+		/// <summary>
+		/// Get the number of #include directives that were processed (including those of files that were already included before).
+		/// </summary>
+		size_t num_includes() const { return _num_includes; }
+
 	private:
 		struct if_level
 		{
@@ -146,10 +191,13 @@ namespace reshadefx
 		size_t _next_input_index = 0;
 		size_t _current_input_index = 0;
 		unsigned short _recursion_count = 0;
+		size_t _num_macro_expansions = 0;
+		size_t _num_includes = 0;
 		location _output_location;
 		std::unordered_set<std::string> _used_macros;
 		std::unordered_map<std::string, macro> _macros;
 		std::vector<std::filesystem::path> _include_paths;
 		std::unordered_map<std::string, std::string> _file_cache;
+		file_cache *_include_cache = nullptr;
 	};
 }
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <algorithm>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// Statistics about the compilation of a single effect, used to find out where the time to load it is spent.
+	/// </summary>
+	struct compile_statistics
+	{
+		// Wall time of each compilation step in microseconds
+		// Code generation happens while parsing, so it is included in the parse time, with only the final 'codegen::write_result' measured separately
+		uint64_t preprocess_time = 0;
+		uint64_t parse_time = 0;
+		uint64_t write_result_time = 0;
+
+		size_t num_tokens = 0;
+		size_t num_macro_expansions = 0;
+		size_t num_includes = 0;
+		size_t num_symbols = 0;
+		size_t num_instructions = 0;
+
+		// Only available when the host application tracks allocations (see ReShadeFXC), zero otherwise
+		size_t num_allocations = 0;
+		size_t allocated_bytes = 0;
+
+		uint64_t total_time() const { return preprocess_time + parse_time + write_result_time; }
+	};
+
+	/// <summary>
+	/// Count the instructions in the code generated for the specified <paramref name="module"/>.
+	/// This is the number of SPIR-V instructions for SPIR-V modules and the number of lines of code for HLSL and GLSL.
+	/// </summary>
+	inline size_t count_instructions(const module &module)
+	{
+		if (module.spirv.empty())
+			return std::count(module.hlsl.begin(), module.hlsl.end(), '\n');
+
+		size_t num_instructions = 0;
+		// Skip the module header (magic number, version, generator, bound and schema)
+		for (size_t i = 5; i < module.spirv.size(); ++num_instructions)
+		{
+			// Word count of an instruction is stored in the upper 16 bits of its first word
+			const uint32_t word_count = module.spirv[i] >> 16;
+			if (word_count == 0)
+				break;
+			i += word_count;
+		}
+
+		return num_instructions;
+	}
+}
@@ -245,6 +245,8 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 		insert_sorted(_symbol_stack[name], scoped_symbol { symbol, _current_scope });
 	}
 
+	_num_symbols++;
+
 	return true;
 }
 
@@ -95,7 +95,13 @@ namespace reshadefx
 		/// </summary>
 		bool resolve_function_call(const std::string &name, const std::vector<expression> &args, const scope &scope, symbol &data, bool &ambiguous) const;
 
+		/// <summary>
+		/// Get the number of symbols that were inserted into the symbol table.
+		/// </summary>
+		size_t num_symbols() const { return _num_symbols; }
+
 	private:
+		size_t _num_symbols = 0;
 		scope _current_scope;
 		std::unordered_map<std::string, // Lookup table from name to matching symbols
 			std::vector<scoped_symbol>> _symbol_stack;
@@ -24,7 +24,8 @@
  */
 
 #include "imgui_editor.hpp"
-#include "effect_lexer.hpp"
+#include "syntax_colorizer.hpp"
+#include "text_search.hpp"
 #include <algorithm>
 #include <imgui.h>
 #include <imgui_internal.h> // GetCurrentWindowRead
@@ -81,6 +82,7 @@ const char *reshade::gui::code_editor::get_palette_color_name(unsigned int col)
 reshade::gui::code_editor::code_editor()
 {
 	_lines.emplace_back();
+	_line_states.push_back(line_state::normal);
 }
 
 void reshade::gui::code_editor::render(const char *title, const uint32_t palette[color_palette_max], bool border, ImFont *font)
@@ -326,6 +328,22 @@ void reshade::gui::code_editor::render(const char *title, const uint32_t palette
 			draw_list->AddRectFilled(beg, end, palette[color_selection]);
 		}
 
+		// Draw all matches of the current search text
+		if (_search_window_open && _search_text[0] != '\0')
+		{
+			const std::vector<std::pair<text_pos, text_pos>> &matches = find_all_text(_search_text);
+
+			for (auto match = std::lower_bound(matches.begin(), matches.end(), line_beg_pos,
+					[](const std::pair<text_pos, text_pos> &match, const text_pos &pos) { return match.second <= pos; });
+				match != matches.end() && match->first <= line_end_pos; ++match)
+			{
+				const ImVec2 beg = ImVec2(text_screen_pos.x + (match->first > line_beg_pos ? calc_text_distance_to_line_begin(match->first) : 0.0f), text_screen_pos.y);
+				const ImVec2 end = ImVec2(text_screen_pos.x + calc_text_distance_to_line_begin(match->second < line_end_pos ? match->second : line_end_pos), text_screen_pos.y + char_advance.y);
+
+				draw_list->AddRect(beg, end, palette[color_selection], 1.0f);
+			}
+		}
+
 		// Find any highlighted words and draw a selection rectangle below them
 		if (!_highlighted.empty())
 		{
@@ -491,7 +509,7 @@ void reshade::gui::code_editor::render(const char *title, const uint32_t palette
 		ImGui::Dummy(ImVec2(0, ImGui::GetStyle().ItemSpacing.y));
 		ImGui::BeginChild("##search", ImVec2(0, 0));
 
-		const float input_width = ImGui::GetContentRegionAvail().x - (4 * button_spacing) - (4 * button_size) - 5;
+		const float input_width = ImGui::GetContentRegionAvail().x - (5 * button_spacing) - (5 * button_size) - 10;
 		ImGui::PushItemWidth(input_width);
 		if (ImGui::InputText("##search", _search_text, sizeof(_search_text), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AllowTabInput))
 		{
@@ -514,6 +532,14 @@ void reshade::gui::code_editor::render(const char *title, const uint32_t palette
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Match case (Alt + C)");
 
+		ImGui::SameLine(0.0f, button_spacing);
+		ImGui::PushStyleColor(ImGuiCol_Button, ImGui::GetStyle().Colors[_search_whole_word ? ImGuiCol_ButtonActive : ImGuiCol_Button]);
+		if (ImGui::Button("W", ImVec2(button_size + 5, 0)) || (!ctrl && !shift && alt && ImGui::IsKeyPressed('W')))
+			_search_whole_word = !_search_whole_word;
+		ImGui::PopStyleColor();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Match whole word (Alt + W)");
+
 		ImGui::SameLine(0.0f, button_spacing);
 		if (ImGui::Button("<", ImVec2(button_size, 0)) || (shift && ImGui::IsKeyPressed(0x72))) // VK_F3
 			find_and_scroll_to_text(_search_text, true);
@@ -553,7 +579,7 @@ void reshade::gui::code_editor::render(const char *title, const uint32_t palette
 				ImGui::SetKeyboardFocusHere(-1);
 			}
 
-			ImGui::SameLine(0.0f, button_spacing * 2 + button_size + 5);
+			ImGui::SameLine(0.0f, button_spacing * 3 + button_size * 2 + 10);
 			if (ImGui::Button("Repl", ImVec2(2 * button_size + button_spacing, 0)) || (!ctrl && !shift && alt && ImGui::IsKeyPressed('R')))
 				if (find_and_scroll_to_text(_search_text, false, true))
 					insert_text(_replace_text);
@@ -646,6 +672,19 @@ void reshade::gui::code_editor::select_all()
 
 	select(_interactive_beg, _interactive_end);
 }
+void reshade::gui::code_editor::scroll_to(text_pos pos, size_t select_length)
+{
+	// Restrict position to text bounds
+	pos.line = std::min(pos.line, _lines.size() - 1);
+	pos.column = std::min(pos.column, _lines[pos.line].size());
+
+	_cursor_pos = pos;
+	_interactive_beg = pos;
+	_interactive_end = text_pos(pos.line, std::min(pos.column + select_length, _lines[pos.line].size()));
+
+	select(_interactive_beg, _interactive_end);
+	_scroll_to_cursor = true;
+}
 
 void reshade::gui::code_editor::set_text(const std::string &text)
 {
@@ -672,6 +711,10 @@ void reshade::gui::code_editor::set_text(const std::string &text)
 	_interactive_beg = _interactive_end = text_pos();
 	_cursor_pos = std::min(_cursor_pos, text_pos(_lines.size() - 1, _lines.back().size()));
 
+	_line_states.assign(_lines.size(), line_state::normal);
+
+	_text_version++;
+
 	_colorize_line_beg = 0;
 	_colorize_line_end = _lines.size();
 }
@@ -702,8 +745,8 @@ void reshade::gui::code_editor::insert_character(char c, bool auto_indent)
 			auto &beg = _select_beg;
 			auto &end = _select_end;
 
-			_colorize_line_beg = std::min(_colorize_line_beg, beg.line - std::min<size_t>(beg.line, 10));
-			_colorize_line_end = std::max(_colorize_line_end, end.line + 10 + 1);
+			_colorize_line_beg = std::min(_colorize_line_beg, beg.line);
+			_colorize_line_end = std::max(_colorize_line_end, end.line + 1);
 
 			beg.column = 0;
 			if (end.column == 0 && end.line > 0)
@@ -798,8 +841,7 @@ void reshade::gui::code_editor::insert_character(char c, bool auto_indent)
 	u.added = c;
 	u.added_beg = _cursor_pos;
 
-	// Colorize additional 10 lines above and below to better catch multi-line constructs
-	_colorize_line_beg = std::min(_colorize_line_beg, _cursor_pos.line - std::min<size_t>(_cursor_pos.line, 10));
+	_colorize_line_beg = std::min(_colorize_line_beg, _cursor_pos.line);
 
 	// New line feed requires insertion of a new line
 	if (c == '\n')
@@ -812,6 +854,7 @@ void reshade::gui::code_editor::insert_character(char c, bool auto_indent)
 		_errors = std::move(errors);
 
 		auto &new_line = *_lines.emplace(_lines.begin() + _cursor_pos.line + 1);
+		_line_states.insert(_line_states.begin() + _cursor_pos.line + 1, line_state::normal);
 		auto &line = _lines[_cursor_pos.line];
 
 		// Auto indentation
@@ -846,7 +889,7 @@ void reshade::gui::code_editor::insert_character(char c, bool auto_indent)
 
 	_scroll_to_cursor = true;
 
-	_colorize_line_end = std::max(_colorize_line_end, _cursor_pos.line + 10 + 1);
+	_colorize_line_end = std::max(_colorize_line_end, _cursor_pos.line + 1);
 }
 
 std::string reshade::gui::code_editor::get_text() const
@@ -958,6 +1001,9 @@ void reshade::gui::code_editor::redo(unsigned int steps)
 
 void reshade::gui::code_editor::record_undo(undo_record &&record)
 {
+	// Every modification of the text goes through here, so use it to invalidate cached search results
+	_text_version++;
+
 	if (_in_undo_operation)
 		return;
 
@@ -1014,8 +1060,8 @@ void reshade::gui::code_editor::delete_next()
 
 	record_undo(std::move(u));
 
-	_colorize_line_beg = std::min(_colorize_line_beg, _cursor_pos.line - std::min<size_t>(_cursor_pos.line, 10));
-	_colorize_line_end = std::max(_colorize_line_end, _cursor_pos.line + 10 + 1);
+	_colorize_line_beg = std::min(_colorize_line_beg, _cursor_pos.line);
+	_colorize_line_end = std::max(_colorize_line_end, _cursor_pos.line + 1);
 }
 void reshade::gui::code_editor::delete_previous()
 {
@@ -1068,8 +1114,8 @@ void reshade::gui::code_editor::delete_previous()
 
 	_scroll_to_cursor = true;
 
-	_colorize_line_beg = std::min(_colorize_line_beg, _cursor_pos.line - std::min<size_t>(_cursor_pos.line, 10));
-	_colorize_line_end = std::max(_colorize_line_end, _cursor_pos.line + 10 + 1);
+	_colorize_line_beg = std::min(_colorize_line_beg, _cursor_pos.line);
+	_colorize_line_end = std::max(_colorize_line_end, _cursor_pos.line + 1);
 }
 void reshade::gui::code_editor::delete_selection()
 {
@@ -1114,8 +1160,8 @@ void reshade::gui::code_editor::delete_selection()
 		assert(!_lines.empty());
 	}
 
-	_colorize_line_beg = std::min(_colorize_line_beg, _select_beg.line - std::min<size_t>(_cursor_pos.line, 10));
-	_colorize_line_end = std::max(_colorize_line_end, _select_end.line + 10 + 1);
+	_colorize_line_beg = std::min(_colorize_line_beg, _select_beg.line);
+	_colorize_line_end = std::max(_colorize_line_end, _select_beg.line + 1);
 
 	// Reset selection
 	_cursor_pos = _select_beg;
@@ -1135,6 +1181,7 @@ void reshade::gui::code_editor::delete_lines(size_t first_line, size_t last_line
 	_errors = std::move(errors);
 
 	_lines.erase(_lines.begin() + first_line, _lines.begin() + last_line + 1);
+	_line_states.erase(_line_states.begin() + first_line, _line_states.begin() + last_line + 1);
 }
 
 void reshade::gui::code_editor::clipboard_copy()
@@ -1507,6 +1554,11 @@ void reshade::gui::code_editor::move_lines_up()
 	for (size_t line = _select_beg.line; line <= _select_end.line; ++line)
 		std::swap(_lines[line], _lines[line - 1]);
 
+	_colorize_line_beg = std::min(_colorize_line_beg, _select_beg.line - 1);
+	_colorize_line_end = std::max(_colorize_line_end, _select_end.line + 1);
+
+	_text_version++;
+
 	_select_beg.line--;
 	_select_end.line--;
 	_cursor_pos.line--;
@@ -1519,6 +1571,11 @@ void reshade::gui::code_editor::move_lines_down()
 	for (size_t line = _select_end.line; line >= _select_beg.line && line < _lines.size(); --line)
 		std::swap(_lines[line], _lines[line + 1]);
 
+	_colorize_line_beg = std::min(_colorize_line_beg, _select_beg.line);
+	_colorize_line_end = std::max(_colorize_line_end, _select_end.line + 2);
+
+	_text_version++;
+
 	_select_beg.line++;
 	_select_end.line++;
 	_cursor_pos.line++;
@@ -1526,127 +1583,90 @@ void reshade::gui::code_editor::move_lines_down()
 
 bool reshade::gui::code_editor::find_and_scroll_to_text(const std::string &text, bool backwards, bool with_selection)
 {
-	if (text.empty())
-		return false; // Cannot search for empty text
-
-	const auto compare_c = [this](char clhs, char crhs) {
-		return _search_case_sensitive ? clhs == crhs : tolower(clhs) == tolower(crhs);
-	};
+	const std::vector<std::pair<text_pos, text_pos>> &matches = find_all_text(text);
+	if (matches.empty())
+		return false;
 
 	// Start search at the cursor position
-	text_pos match_pos_beg, search_pos = backwards != with_selection ? _select_beg : _select_end;
+	const text_pos search_pos = backwards != with_selection ? _select_beg : _select_end;
 
+	std::vector<std::pair<text_pos, text_pos>>::const_iterator match;
 	if (backwards)
 	{
-		// Start searching at the character before the current cursor position
-		if (search_pos.column != 0)
-		{
-			search_pos.column -= 1;
-		}
-		else if (search_pos.line != 0)
-		{
-			search_pos.line -= 1;
-			search_pos.column = _lines[search_pos.line].size();
-		}
-
-		const size_t match_last = text.size() - 1;
-		size_t match_offset = match_last;
-
-		while (true)
-		{
-			if (!_lines[search_pos.line].empty())
-			{
-				// Trim column index to the last character in the line (rather than the actual end)
-				search_pos.column = std::min(search_pos.column, _lines[search_pos.line].size() - 1);
-
-				while (true)
-				{
-					if (compare_c(_lines[search_pos.line][search_pos.column].c, text[match_offset]))
-					{
-						if (match_offset == match_last) // Keep track of end of the match
-							match_pos_beg = search_pos;
-
-						// All characters matching means the text was found, so select it and return
-						if (match_offset == 0)
-						{
-							_select_beg = search_pos;
-							_select_end = text_pos(match_pos_beg.line, match_pos_beg.column + 1);
-							_cursor_pos = _select_beg;
-							_scroll_to_cursor = true;
-							return true;
-						}
-						else
-						{
-							match_offset--;
-						}
-					}
-					else
-					{
-						// A character mismatched, so start from the end again
-						match_offset = match_last;
-					}
+		// Find the last match that ends before the search position
+		match = std::upper_bound(matches.begin(), matches.end(), search_pos,
+			[](const text_pos &pos, const std::pair<text_pos, text_pos> &match) { return pos < match.second; });
+		if (match == matches.begin())
+			return false;
+		--match;
+	}
+	else
+	{
+		// Find the first match that begins at or after the search position
+		match = std::lower_bound(matches.begin(), matches.end(), search_pos,
+			[](const std::pair<text_pos, text_pos> &match, const text_pos &pos) { return match.first < pos; });
+		if (match == matches.end())
+			return false;
+	}
 
-					if (search_pos.column == 0)
-						break; // Reached the first column and cannot go further back, so break and go up the next line
-					else
-						search_pos.column -= 1;
-				}
-			}
+	_select_beg = match->first;
+	_select_end = match->second;
+	_cursor_pos = backwards ? _select_beg : _select_end;
+	_scroll_to_cursor = true;
 
-			if (search_pos.line == 0)
-				break; // Reached the first line and cannot go further back, so abort
-			else
-				search_pos.line -= 1;
+	return true;
+}
+const std::vector<std::pair<reshade::gui::code_editor::text_pos, reshade::gui::code_editor::text_pos>> &reshade::gui::code_editor::find_all_text(const std::string &text)
+{
+	// Results are cached until either the text or the search options change
+	if (_search_results_version == _text_version &&
+		_search_results_text == text &&
+		_search_results_case_sensitive == _search_case_sensitive &&
+		_search_results_whole_word == _search_whole_word)
+		return _search_results;
+
+	_search_results.clear();
+	_search_results_text = text;
+	_search_results_version = _text_version;
+	_search_results_case_sensitive = _search_case_sensitive;
+	_search_results_whole_word = _search_whole_word;
 
-			if (match_offset != match_last && text[match_offset--] != '\n')
-				match_offset  = match_last; // Check for line feed in search text between lines
+	if (text.empty())
+		return _search_results; // Cannot search for empty text
 
-			search_pos.column = _lines[search_pos.line].size(); // Continue at end of previous line
-		}
-	}
-	else
+	// Copy text into a contiguous buffer, so that it can be scanned much faster than the individual glyphs
+	if (_search_buffer_version != _text_version)
 	{
-		size_t match_offset = 0;
+		_search_buffer.clear();
+		_search_line_offsets.clear();
 
-		while (search_pos.line < _lines.size())
+		for (size_t line_no = 0; line_no < _lines.size(); ++line_no)
 		{
-			if (match_offset != 0 && text[match_offset++] != '\n')
-				match_offset  = 0; // Check for line feed in search text between lines
+			if (line_no != 0)
+				_search_buffer.push_back('\n');
 
-			while (search_pos.column < _lines[search_pos.line].size())
-			{
-				if (compare_c(_lines[search_pos.line][search_pos.column].c, text[match_offset]))
-				{
-					if (match_offset == 0) // Keep track of beginning of the match
-						match_pos_beg = search_pos;
+			_search_line_offsets.push_back(_search_buffer.size());
 
-					match_offset++;
+			for (const glyph &glyph : _lines[line_no])
+				_search_buffer.push_back(glyph.c);
+		}
 
-					// All characters matching means the text was found, so select it and return
-					if (match_offset == text.size())
-					{
-						_select_beg = match_pos_beg;
-						_select_end = text_pos(search_pos.line, search_pos.column + 1);
-						_cursor_pos = _select_end;
-						_scroll_to_cursor = true;
-						return true;
-					}
-				}
-				else
-				{
-					// A character mismatched, so start from the beginning again
-					match_offset = 0;
-				}
+		_search_buffer_version = _text_version;
+	}
 
-				search_pos.column += 1;
-			}
+	std::vector<size_t> match_offsets;
+	reshade::find_all_occurrences(_search_buffer, text, _search_case_sensitive, _search_whole_word, match_offsets);
 
-			search_pos.line += 1;
-			search_pos.column = 0;
-		}
-	}
+	const auto offset_to_text_pos = [this](size_t offset) {
+		const size_t line = std::distance(_search_line_offsets.begin(), std::upper_bound(_search_line_offsets.begin(), _search_line_offsets.end(), offset)) - 1;
+		return text_pos(line, offset - _search_line_offsets[line]);
+	};
+
+	_search_results.reserve(match_offsets.size());
+	for (const size_t offset : match_offsets)
+		_search_results.emplace_back(offset_to_text_pos(offset), offset_to_text_pos(offset + text.size()));
 
-	return false; // No match found
+	return _search_results;
 }
 
 void reshade::gui::code_editor::colorize()
@@ -1654,246 +1674,46 @@ void reshade::gui::code_editor::colorize()
 	if (_colorize_line_beg >= _colorize_line_end)
 		return;
 
-	// Step through code incrementally rather than coloring everything at once
-	const size_t from = _colorize_line_beg, to = std::min(from + 1000, _colorize_line_end);
-	_colorize_line_beg = to;
+	assert(_line_states.size() == _lines.size());
 
-	// Reset coloring range if we have finished coloring it after this iteration
-	if (_colorize_line_end > _lines.size())
-		_colorize_line_end = _lines.size();
-	if (_colorize_line_beg == _colorize_line_end)
-	{
-		_colorize_line_beg = std::numeric_limits<size_t>::max();
-		_colorize_line_end = 0;
-	}
+	size_t line_no = _colorize_line_beg;
+	size_t line_end = std::min(_colorize_line_end, _lines.size());
 
-	// Copy lines into string for consumption by the lexer
-	std::string input_string;
-	for (size_t l = from; l < to && l < _lines.size(); ++l, input_string.push_back('\n'))
-		for (size_t k = 0; k < _lines[l].size(); ++k)
-			input_string.push_back(_lines[l][k].c);
-
-	reshadefx::lexer lexer(
-		input_string,
-		false /* ignore_comments */,
-		true  /* ignore_whitespace */,
-		false /* ignore_pp_directives */,
-		true  /* ignore_line_directives */,
-		false /* ignore_keywords */,
-		false /* escape_string_literals */);
-
-	for (reshadefx::token tok; (tok = lexer.lex()).id != reshadefx::tokenid::end_of_file;)
+	// Step through code incrementally rather than coloring everything at once
+	for (size_t budget = 1000; line_no < line_end && budget != 0; --budget)
 	{
-		color col = color_default;
+		auto &line = _lines[line_no];
 
-		switch (tok.id)
-		{
-		case reshadefx::tokenid::exclaim:
-		case reshadefx::tokenid::percent:
-		case reshadefx::tokenid::ampersand:
-		case reshadefx::tokenid::parenthesis_open:
-		case reshadefx::tokenid::parenthesis_close:
-		case reshadefx::tokenid::star:
-		case reshadefx::tokenid::plus:
-		case reshadefx::tokenid::comma:
-		case reshadefx::tokenid::minus:
-		case reshadefx::tokenid::dot:
-		case reshadefx::tokenid::slash:
-		case reshadefx::tokenid::colon:
-		case reshadefx::tokenid::semicolon:
-		case reshadefx::tokenid::less:
-		case reshadefx::tokenid::equal:
-		case reshadefx::tokenid::greater:
-		case reshadefx::tokenid::question:
-		case reshadefx::tokenid::bracket_open:
-		case reshadefx::tokenid::backslash:
-		case reshadefx::tokenid::bracket_close:
-		case reshadefx::tokenid::caret:
-		case reshadefx::tokenid::brace_open:
-		case reshadefx::tokenid::pipe:
-		case reshadefx::tokenid::brace_close:
-		case reshadefx::tokenid::tilde:
-		case reshadefx::tokenid::exclaim_equal:
-		case reshadefx::tokenid::percent_equal:
-		case reshadefx::tokenid::ampersand_ampersand:
-		case reshadefx::tokenid::ampersand_equal:
-		case reshadefx::tokenid::star_equal:
-		case reshadefx::tokenid::plus_plus:
-		case reshadefx::tokenid::plus_equal:
-		case reshadefx::tokenid::minus_minus:
-		case reshadefx::tokenid::minus_equal:
-		case reshadefx::tokenid::arrow:
-		case reshadefx::tokenid::ellipsis:
-		case reshadefx::tokenid::slash_equal:
-		case reshadefx::tokenid::colon_colon:
-		case reshadefx::tokenid::less_less_equal:
-		case reshadefx::tokenid::less_less:
-		case reshadefx::tokenid::less_equal:
-		case reshadefx::tokenid::equal_equal:
-		case reshadefx::tokenid::greater_greater_equal:
-		case reshadefx::tokenid::greater_greater:
-		case reshadefx::tokenid::greater_equal:
-		case reshadefx::tokenid::caret_equal:
-		case reshadefx::tokenid::pipe_equal:
-		case reshadefx::tokenid::pipe_pipe:
-			col = color_punctuation;
-			break;
-		case reshadefx::tokenid::identifier:
-			col = color_identifier;
-			break;
-		case reshadefx::tokenid::int_literal:
-		case reshadefx::tokenid::uint_literal:
-		case reshadefx::tokenid::float_literal:
-		case reshadefx::tokenid::double_literal:
-			col = color_number_literal;
-			break;
-		case reshadefx::tokenid::string_literal:
-			col = color_string_literal;
-			break;
-		case reshadefx::tokenid::true_literal:
-		case reshadefx::tokenid::false_literal:
-		case reshadefx::tokenid::namespace_:
-		case reshadefx::tokenid::struct_:
-		case reshadefx::tokenid::technique:
-		case reshadefx::tokenid::pass:
-		case reshadefx::tokenid::for_:
-		case reshadefx::tokenid::while_:
-		case reshadefx::tokenid::do_:
-		case reshadefx::tokenid::if_:
-		case reshadefx::tokenid::else_:
-		case reshadefx::tokenid::switch_:
-		case reshadefx::tokenid::case_:
-		case reshadefx::tokenid::default_:
-		case reshadefx::tokenid::break_:
-		case reshadefx::tokenid::continue_:
-		case reshadefx::tokenid::return_:
-		case reshadefx::tokenid::discard_:
-		case reshadefx::tokenid::extern_:
-		case reshadefx::tokenid::static_:
-		case reshadefx::tokenid::uniform_:
-		case reshadefx::tokenid::volatile_:
-		case reshadefx::tokenid::precise:
-		case reshadefx::tokenid::groupshared:
-		case reshadefx::tokenid::in:
-		case reshadefx::tokenid::out:
-		case reshadefx::tokenid::inout:
-		case reshadefx::tokenid::const_:
-		case reshadefx::tokenid::linear:
-		case reshadefx::tokenid::noperspective:
-		case reshadefx::tokenid::centroid:
-		case reshadefx::tokenid::nointerpolation:
-		case reshadefx::tokenid::void_:
-		case reshadefx::tokenid::bool_:
-		case reshadefx::tokenid::bool2:
-		case reshadefx::tokenid::bool3:
-		case reshadefx::tokenid::bool4:
-		case reshadefx::tokenid::bool2x2:
-		case reshadefx::tokenid::bool2x3:
-		case reshadefx::tokenid::bool2x4:
-		case reshadefx::tokenid::bool3x2:
-		case reshadefx::tokenid::bool3x3:
-		case reshadefx::tokenid::bool3x4:
-		case reshadefx::tokenid::bool4x2:
-		case reshadefx::tokenid::bool4x3:
-		case reshadefx::tokenid::bool4x4:
-		case reshadefx::tokenid::int_:
-		case reshadefx::tokenid::int2:
-		case reshadefx::tokenid::int3:
-		case reshadefx::tokenid::int4:
-		case reshadefx::tokenid::int2x2:
-		case reshadefx::tokenid::int2x3:
-		case reshadefx::tokenid::int2x4:
-		case reshadefx::tokenid::int3x2:
-		case reshadefx::tokenid::int3x3:
-		case reshadefx::tokenid::int3x4:
-		case reshadefx::tokenid::int4x2:
-		case reshadefx::tokenid::int4x3:
-		case reshadefx::tokenid::int4x4:
-		case reshadefx::tokenid::min16int:
-		case reshadefx::tokenid::min16int2:
-		case reshadefx::tokenid::min16int3:
-		case reshadefx::tokenid::min16int4:
-		case reshadefx::tokenid::uint_:
-		case reshadefx::tokenid::uint2:
-		case reshadefx::tokenid::uint3:
-		case reshadefx::tokenid::uint4:
-		case reshadefx::tokenid::uint2x2:
-		case reshadefx::tokenid::uint2x3:
-		case reshadefx::tokenid::uint2x4:
-		case reshadefx::tokenid::uint3x2:
-		case reshadefx::tokenid::uint3x3:
-		case reshadefx::tokenid::uint3x4:
-		case reshadefx::tokenid::uint4x2:
-		case reshadefx::tokenid::uint4x3:
-		case reshadefx::tokenid::uint4x4:
-		case reshadefx::tokenid::min16uint:
-		case reshadefx::tokenid::min16uint2:
-		case reshadefx::tokenid::min16uint3:
-		case reshadefx::tokenid::min16uint4:
-		case reshadefx::tokenid::float_:
-		case reshadefx::tokenid::float2:
-		case reshadefx::tokenid::float3:
-		case reshadefx::tokenid::float4:
-		case reshadefx::tokenid::float2x2:
-		case reshadefx::tokenid::float2x3:
-		case reshadefx::tokenid::float2x4:
-		case reshadefx::tokenid::float3x2:
-		case reshadefx::tokenid::float3x3:
-		case reshadefx::tokenid::float3x4:
-		case reshadefx::tokenid::float4x2:
-		case reshadefx::tokenid::float4x3:
-		case reshadefx::tokenid::float4x4:
-		case reshadefx::tokenid::min16float:
-		case reshadefx::tokenid::min16float2:
-		case reshadefx::tokenid::min16float3:
-		case reshadefx::tokenid::min16float4:
-		case reshadefx::tokenid::vector:
-		case reshadefx::tokenid::matrix:
-		case reshadefx::tokenid::string_:
-		case reshadefx::tokenid::texture:
-		case reshadefx::tokenid::sampler:
-		case reshadefx::tokenid::storage:
-			col = color_keyword;
-			break;
-		case reshadefx::tokenid::hash_def:
-		case reshadefx::tokenid::hash_undef:
-		case reshadefx::tokenid::hash_if:
-		case reshadefx::tokenid::hash_ifdef:
-		case reshadefx::tokenid::hash_ifndef:
-		case reshadefx::tokenid::hash_else:
-		case reshadefx::tokenid::hash_elif:
-		case reshadefx::tokenid::hash_endif:
-		case reshadefx::tokenid::hash_error:
-		case reshadefx::tokenid::hash_warning:
-		case reshadefx::tokenid::hash_pragma:
-		case reshadefx::tokenid::hash_include:
-		case reshadefx::tokenid::hash_unknown:
-			col = color_preprocessor;
-			tok.offset--; // Add # to token
-			tok.length++;
-			break;
-		case reshadefx::tokenid::single_line_comment:
-			col = color_comment;
-			break;
-		case reshadefx::tokenid::multi_line_comment:
-			col = color_multiline_comment;
-			break;
-		}
+		// Glyphs store each character next to its color, so gather the characters in a buffer the lexer can work on
+		_colorize_text.resize(line.size());
+		_colorize_colors.resize(line.size());
+		for (size_t k = 0; k < line.size(); ++k)
+			_colorize_text[k] = line[k].c;
 
-		// Update character range matching the current the token
-		size_t line = from + tok.location.line - 1;
-		size_t column = tok.location.column - 1;
+		const line_state next_line_state = colorize_line(_colorize_text.data(), _colorize_text.size(), _line_states[line_no], _colorize_colors.data());
 
-		for (size_t k = 0; k < tok.length; ++k)
-		{
-			if (column >= _lines[line].size())
-			{
-				line++;
-				column = 0;
-				continue;
-			}
+		for (size_t k = 0; k < line.size(); ++k)
+			line[k].col = _colorize_colors[k];
+
+		line_no++;
 
-			_lines[line][column++].col = col;
+		// Keep going past the requested range until the state at the beginning of the next line matches what was recorded for it previously
+		if (line_no < _lines.size() && _line_states[line_no] != next_line_state)
+		{
+			_line_states[line_no] = next_line_state;
+			line_end = std::max(line_end, line_no + 1);
 		}
 	}
+
+	// Reset coloring range if we have finished coloring it after this iteration
+	if (line_no >= line_end)
+	{
+		_colorize_line_beg = std::numeric_limits<size_t>::max();
+		_colorize_line_end = 0;
+	}
+	else
+	{
+		_colorize_line_beg = line_no;
+		_colorize_line_end = line_end;
+	}
 }
@@ -63,6 +63,18 @@ namespace reshade::gui
 			color_palette_max
 		};
 
+		/// <summary>
+		/// State at the beginning of a line, which depends on constructs continued from previous lines.
+		/// </summary>
+		enum class line_state : unsigned char
+		{
+			normal,
+			// The line starts inside a multi-line comment that was not terminated on a previous line
+			multi_line_comment,
+			// The line continues a preprocessor directive from the previous line, which ended with a backslash
+			continued_directive
+		};
+
 		enum class selection_mode
 		{
 			normal,
@@ -99,6 +111,13 @@ namespace reshade::gui
 		/// </summary>
 		bool has_selection() const { return _select_end > _select_beg; }
 
+		/// <summary>
+		/// Moves the cursor to the specified position and scrolls it into view.
+		/// </summary>
+		/// <param name="pos">Position to move the cursor to (is clamped to the text bounds).</param>
+		/// <param name="select_length">Number of characters after the cursor position to select.</param>
+		void scroll_to(text_pos pos, size_t select_length = 0);
+
 		/// <summary>
 		/// Searches the text of this text editor for the specific search <paramref name="text"/>, starting at the cursor and scrolls to its position when found.
 		/// </summary>
@@ -107,6 +126,12 @@ namespace reshade::gui
 		/// <param name="with_selection">Set to <c>true</c> to start search at selection boundaries, rather than the cursor position.</param>
 		/// <returns><c>true</c> when the search <paramref name="text"/> was found, <c>false</c> otherwise.</returns>
 		bool find_and_scroll_to_text(const std::string &text, bool backwards = false, bool with_selection = false);
+		/// <summary>
+		/// Searches the entire text of this text editor for all occurrences of the specific search <paramref name="text"/>, using the current search options.
+		/// </summary>
+		/// <param name="text">The text to find.</param>
+		/// <returns>The beginning and end positions of all matches, sorted by position.</returns>
+		const std::vector<std::pair<text_pos, text_pos>> &find_all_text(const std::string &text);
 
 		/// <summary>
 		/// Replaces the text of this text editor with the specified string.
@@ -238,6 +263,8 @@ namespace reshade::gui
 
 		// Holds the entire text split up into individual character glyphs
 		std::vector<std::vector<glyph>> _lines;
+		// Holds the state at the beginning of each line, so that coloring can resume at any line
+		std::vector<line_state> _line_states;
 
 		bool _readonly = false;
 		bool _overwrite = false;
@@ -268,10 +295,25 @@ namespace reshade::gui
 		char _replace_text[256] = "";
 		bool _show_search_popup = false;
 		bool _search_case_sensitive = false;
+		bool _search_whole_word = false;
 		unsigned int _search_window_open = 0;
 		unsigned int _search_window_focus = 0;
 
 		size_t _colorize_line_beg = 0;
 		size_t _colorize_line_end = 0;
+		// Characters and colors of the line currently being colored, which are kept around to avoid allocating them for every line
+		std::string _colorize_text;
+		std::vector<color> _colorize_colors;
+
+		// Incremented on every modification of the text, so that search results can be cached until the text changes
+		size_t _text_version = 1;
+		size_t _search_buffer_version = 0;
+		std::string _search_buffer;
+		std::vector<size_t> _search_line_offsets;
+		size_t _search_results_version = 0;
+		std::string _search_results_text;
+		bool _search_results_case_sensitive = false;
+		bool _search_results_whole_word = false;
+		std::vector<std::pair<text_pos, text_pos>> _search_results;
 	};
 }
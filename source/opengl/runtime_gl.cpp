@@ -7,6 +7,7 @@
 #include "dll_config.hpp"
 #include "runtime_gl.hpp"
 #include "runtime_objects.hpp"
+#include "pixel_kernels.hpp"
 #include <imgui.h>
 
 namespace reshade::opengl
@@ -256,6 +257,10 @@ void reshade::opengl::runtime_gl::on_reset()
 	_state_tracking.release();
 
 	glDeleteBuffers(NUM_BUF, _buf);
+	glDeleteBuffers(NUM_READBACK_SLOTS, _readback_buffers);
+	for (GLsync &fence : _readback_fences)
+		glDeleteSync(fence),
+		fence = nullptr;
 	glDeleteTextures(NUM_TEX, _tex);
 	glDeleteTextures(static_cast<GLsizei>(_reserved_texture_names.size()), _reserved_texture_names.data());
 	glDeleteVertexArrays(NUM_VAO, _vao);
@@ -267,6 +272,7 @@ void reshade::opengl::runtime_gl::on_reset()
 	std::memset(_vao, 0, sizeof(_vao));
 	std::memset(_fbo, 0, sizeof(_fbo));
 	std::memset(_rbo, 0, sizeof(_rbo));
+	std::memset(_readback_buffers, 0, sizeof(_readback_buffers));
 
 	glDeleteProgram(_mipmap_program);
 	_mipmap_program = 0;
@@ -353,24 +359,70 @@ bool reshade::opengl::runtime_gl::capture_screenshot(uint8_t *buffer) const
 
 	// Flip image vertically (unless it came from the RBO, which is already upside down)
 	if (_current_fbo == 0)
-	{
-		for (unsigned int y = 0, pitch = _width * 4; y * 2 < _height; ++y)
-		{
-			const auto i1 = y * pitch;
-			const auto i2 = (_height - 1 - y) * pitch;
+		pixel_kernels::flip_vertically(buffer, _width * 4, _height);
 
-			for (unsigned int x = 0; x < pitch; x += 4)
-			{
-				std::swap(buffer[i1 + x + 0], buffer[i2 + x + 0]);
-				std::swap(buffer[i1 + x + 1], buffer[i2 + x + 1]);
-				std::swap(buffer[i1 + x + 2], buffer[i2 + x + 2]);
-				std::swap(buffer[i1 + x + 3], buffer[i2 + x + 3]);
-			}
-		}
+	return true;
+}
+
+bool reshade::opengl::runtime_gl::begin_frame_readback(uint32_t slot)
+{
+	assert(_app_state.has_state);
+
+	// The pixel pack buffer binding is not part of the state block, so restore it manually
+	GLint prev_pack_buffer = 0;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &prev_pack_buffer);
+
+	if (_readback_buffers[slot] == 0)
+	{
+		glGenBuffers(1, &_readback_buffers[slot]);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _readback_buffers[slot]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(_width) * _height * 4, nullptr, GL_STREAM_READ);
+	}
+	else
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _readback_buffers[slot]);
 	}
 
+	// Reading into a pixel buffer object returns immediately, with the copy happening asynchronously
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _current_fbo);
+	glReadBuffer(_current_fbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, GLsizei(_width), GLsizei(_height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, prev_pack_buffer);
+
+	_readback_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_readback_flip[slot] = _current_fbo == 0;
+
 	return true;
 }
+reshade::runtime::readback_status reshade::opengl::runtime_gl::finish_frame_readback(uint32_t slot, uint8_t *buffer)
+{
+	assert(_app_state.has_state);
+
+	// Do not block if the copy has not finished yet, just try again next frame (commands were flushed by presenting in the meantime)
+	const GLenum status = glClientWaitSync(_readback_fences[slot], 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return readback_status::pending;
+
+	glDeleteSync(_readback_fences[slot]);
+	_readback_fences[slot] = nullptr;
+
+	if (status == GL_WAIT_FAILED)
+		return readback_status::failed;
+
+	GLint prev_pack_buffer = 0;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &prev_pack_buffer);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _readback_buffers[slot]);
+	glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(_width) * _height * 4, buffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, prev_pack_buffer);
+
+	// Flip image vertically (unless it came from the RBO, which is already upside down)
+	if (_readback_flip[slot])
+		pixel_kernels::flip_vertically(buffer, _width * 4, _height);
+
+	return readback_status::available;
+}
 
 bool reshade::opengl::runtime_gl::init_effect(size_t index)
 {
@@ -1046,7 +1098,7 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 		if (GLuint64 elapsed_time = 0; available != GL_FALSE)
 		{
 			glGetQueryObjectui64v(impl->query, GL_QUERY_RESULT, &elapsed_time);
-			technique.average_gpu_duration.append(elapsed_time);
+			technique.record_gpu_duration(elapsed_time);
 			impl->query_in_flight = false; // Reset query status
 		}
 	}
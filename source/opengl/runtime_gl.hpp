@@ -29,6 +29,9 @@ namespace reshade::opengl
 		std::unordered_set<HDC> _hdcs;
 
 	private:
+		bool begin_frame_readback(uint32_t slot) override;
+		readback_status finish_frame_readback(uint32_t slot, uint8_t *buffer) override;
+
 		bool init_effect(size_t index) override;
 		void unload_effect(size_t index) override;
 		void unload_effects() override;
@@ -89,6 +92,9 @@ namespace reshade::opengl
 		GLuint _fbo[NUM_FBO] = {}, _current_fbo = 0;
 		GLuint _rbo[NUM_RBO] = {};
 		GLuint _mipmap_program = 0;
+		GLuint _readback_buffers[NUM_READBACK_SLOTS] = {};
+		GLsync _readback_fences[NUM_READBACK_SLOTS] = {};
+		bool _readback_flip[NUM_READBACK_SLOTS] = {};
 		GLenum _default_depth_format = GL_NONE;
 		std::vector<GLuint> _effect_ubos;
 		std::vector<GLuint> _reserved_texture_names;
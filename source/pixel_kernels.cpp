@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "pixel_kernels.hpp"
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define PIXEL_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> // __cpuid, _xgetbv
+// Intrinsics can be used in any function with MSVC, regardless of the target architecture
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#else
+#define PIXEL_KERNELS_X86 0
+#endif
+
+#if PIXEL_KERNELS_X86
+static bool check_avx2_support()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// Check that the operating system saves the AVX registers on context switches too
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool s_has_avx2 = check_avx2_support();
+
+static size_t fill_alpha_sse2(uint8_t *data, size_t count, uint8_t alpha)
+{
+	const __m128i color_mask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i alpha_value = _mm_set1_epi32(alpha << 24);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i * 4), _mm_or_si128(_mm_and_si128(pixels, color_mask), alpha_value));
+	}
+	return i;
+}
+AVX2_FUNCTION static size_t fill_alpha_avx2(uint8_t *data, size_t count, uint8_t alpha)
+{
+	const __m256i color_mask = _mm256_set1_epi32(0x00FFFFFF);
+	const __m256i alpha_value = _mm256_set1_epi32(alpha << 24);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * 4));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i * 4), _mm256_or_si256(_mm256_and_si256(pixels, color_mask), alpha_value));
+	}
+	return i;
+}
+
+static size_t swap_red_blue_sse2(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	const __m128i green_alpha_mask = _mm_set1_epi32(0xFF00FF00);
+	const __m128i channel_mask = _mm_set1_epi32(0x000000FF);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+		const __m128i red = _mm_slli_epi32(_mm_and_si128(pixels, channel_mask), 16);
+		const __m128i blue = _mm_and_si128(_mm_srli_epi32(pixels, 16), channel_mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_or_si128(_mm_and_si128(pixels, green_alpha_mask), _mm_or_si128(red, blue)));
+	}
+	return i;
+}
+AVX2_FUNCTION static size_t swap_red_blue_avx2(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	// Each 16-byte lane is shuffled separately, which is fine since pixels do not cross lanes
+	const __m256i shuffle = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_shuffle_epi8(pixels, shuffle));
+	}
+	return i;
+}
+
+static size_t convert_rgb10a2_to_rgba8_sse2(uint8_t *dst, const uint8_t *src, size_t count, bool swap_red_blue)
+{
+	const __m128i channel_mask = _mm_set1_epi32(0x000000FF);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+
+		// Drop the lowest two bits of each 10-bit channel to get into 8-bit range
+		const __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 2), channel_mask);
+		const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 12), channel_mask);
+		const __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 22), channel_mask);
+		// Expand 2-bit alpha to 8-bit by repeating it (which is the same as multiplying by 85)
+		__m128i a = _mm_srli_epi32(pixels, 30);
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 2));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 4));
+
+		const __m128i result = _mm_or_si128(
+			_mm_or_si128(swap_red_blue ? b : r, _mm_slli_epi32(g, 8)),
+			_mm_or_si128(_mm_slli_epi32(swap_red_blue ? r : b, 16), _mm_slli_epi32(a, 24)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), result);
+	}
+	return i;
+}
+AVX2_FUNCTION static size_t convert_rgb10a2_to_rgba8_avx2(uint8_t *dst, const uint8_t *src, size_t count, bool swap_red_blue)
+{
+	const __m256i channel_mask = _mm256_set1_epi32(0x000000FF);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+
+		const __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 2), channel_mask);
+		const __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 12), channel_mask);
+		const __m256i b = _mm256_and_si256(_mm256_srli_epi32(pixels, 22), channel_mask);
+		__m256i a = _mm256_srli_epi32(pixels, 30);
+		a = _mm256_or_si256(a, _mm256_slli_epi32(a, 2));
+		a = _mm256_or_si256(a, _mm256_slli_epi32(a, 4));
+
+		const __m256i result = _mm256_or_si256(
+			_mm256_or_si256(swap_red_blue ? b : r, _mm256_slli_epi32(g, 8)),
+			_mm256_or_si256(_mm256_slli_epi32(swap_red_blue ? r : b, 16), _mm256_slli_epi32(a, 24)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), result);
+	}
+	return i;
+}
+
+static inline __m128 half_to_float_sse2(__m128i h)
+{
+	// Move the exponent and mantissa into place and rebias the exponent with a multiplication, which handles denormals too
+	const __m128i exp_mant_mask = _mm_set1_epi32(0x7FFF);
+	const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+	const __m128i max_finite = _mm_set1_epi32(0x7BFF);
+	const __m128 inf_nan_exp = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+	const __m128i exp_mant = _mm_and_si128(h, exp_mant_mask);
+	const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, exp_mant), 16);
+	const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exp_mant, 13)), magic);
+	const __m128 inf_nan = _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(exp_mant, max_finite)), inf_nan_exp);
+
+	return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), inf_nan));
+}
+static inline __m128i half_to_unorm8_sse2(__m128i h)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	// Note: Maximum with zero as the second operand also maps NaN to zero
+	const __m128 value = _mm_min_ps(_mm_max_ps(half_to_float_sse2(h), zero), one);
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+static size_t convert_rgba16f_to_rgba8_sse2(uint8_t *dst, const uint16_t *src, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i pixels01 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+		const __m128i pixels23 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 8));
+
+		const __m128i pixel0 = half_to_unorm8_sse2(_mm_unpacklo_epi16(pixels01, zero));
+		const __m128i pixel1 = half_to_unorm8_sse2(_mm_unpackhi_epi16(pixels01, zero));
+		const __m128i pixel2 = half_to_unorm8_sse2(_mm_unpacklo_epi16(pixels23, zero));
+		const __m128i pixel3 = half_to_unorm8_sse2(_mm_unpackhi_epi16(pixels23, zero));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(_mm_packs_epi32(pixel0, pixel1), _mm_packs_epi32(pixel2, pixel3)));
+	}
+	return i;
+}
+
+static inline __m128i premultiply_alpha_sse2(__m128i pixels)
+{
+	// Pixels are expanded to 16-bit per channel here
+	const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+	// Broadcast alpha to all channels of each pixel, but leave the alpha channel itself unchanged by multiplying it with 255
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm_or_si128(_mm_andnot_si128(alpha_lanes, alpha), _mm_and_si128(alpha_lanes, _mm_set1_epi16(255)));
+
+	// Divide by 255 with rounding, which is exact for all products of two 8-bit values
+	__m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+	product = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+	return product;
+}
+static size_t premultiply_alpha_sse2(uint8_t *data, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 4));
+		const __m128i lo = premultiply_alpha_sse2(_mm_unpacklo_epi8(pixels, zero));
+		const __m128i hi = premultiply_alpha_sse2(_mm_unpackhi_epi8(pixels, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i * 4), _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+AVX2_FUNCTION static inline __m256i premultiply_alpha_avx2(__m256i pixels)
+{
+	const __m256i alpha_lanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm256_blendv_epi8(alpha, _mm256_set1_epi16(255), alpha_lanes);
+
+	__m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(128));
+	product = _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+	return product;
+}
+AVX2_FUNCTION static size_t premultiply_alpha_avx2(uint8_t *data, size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		// Unpacking and packing again both work per 16-byte lane, so the pixel order is preserved
+		const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * 4));
+		const __m256i lo = premultiply_alpha_avx2(_mm256_unpacklo_epi8(pixels, zero));
+		const __m256i hi = premultiply_alpha_avx2(_mm256_unpackhi_epi8(pixels, zero));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i * 4), _mm256_packus_epi16(lo, hi));
+	}
+	return i;
+}
+#endif
+
+static inline float half_to_float(uint16_t h)
+{
+	// Same approach as the SIMD version above
+	const uint32_t magic_bits = (254 - 15) << 23;
+	float magic; std::memcpy(&magic, &magic_bits, 4);
+
+	const uint32_t exp_mant = h & 0x7FFF;
+	const uint32_t shifted = exp_mant << 13;
+	float scaled; std::memcpy(&scaled, &shifted, 4);
+	scaled *= magic;
+
+	uint32_t bits; std::memcpy(&bits, &scaled, 4);
+	if (exp_mant > 0x7BFF)
+		bits |= 255 << 23;
+	bits |= (h & 0x8000) << 16;
+
+	float value; std::memcpy(&value, &bits, 4);
+	return value;
+}
+
+void reshade::pixel_kernels::fill_alpha(uint8_t *data, size_t count, uint8_t alpha)
+{
+	size_t i = 0;
+#if PIXEL_KERNELS_X86
+	i = s_has_avx2 ? fill_alpha_avx2(data, count, alpha) : fill_alpha_sse2(data, count, alpha);
+#endif
+	for (; i < count; ++i)
+		data[i * 4 + 3] = alpha;
+}
+
+void reshade::pixel_kernels::swap_red_blue(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+#if PIXEL_KERNELS_X86
+	i = s_has_avx2 ? swap_red_blue_avx2(dst, src, count) : swap_red_blue_sse2(dst, src, count);
+#endif
+	for (; i < count; ++i)
+	{
+		const uint8_t r = src[i * 4 + 0], g = src[i * 4 + 1], b = src[i * 4 + 2], a = src[i * 4 + 3];
+		dst[i * 4 + 0] = b;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = r;
+		dst[i * 4 + 3] = a;
+	}
+}
+
+void reshade::pixel_kernels::convert_rgb10a2_to_rgba8(uint8_t *dst, const uint8_t *src, size_t count, bool swap_red_blue)
+{
+	size_t i = 0;
+#if PIXEL_KERNELS_X86
+	i = s_has_avx2 ? convert_rgb10a2_to_rgba8_avx2(dst, src, count, swap_red_blue) : convert_rgb10a2_to_rgba8_sse2(dst, src, count, swap_red_blue);
+#endif
+	for (; i < count; ++i)
+	{
+		uint32_t rgba; std::memcpy(&rgba, src + i * 4, 4);
+		// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
+		const uint8_t r = static_cast<uint8_t>( (rgba & 0x000003FF)        /  4);
+		const uint8_t g = static_cast<uint8_t>(((rgba & 0x000FFC00) >> 10) /  4);
+		const uint8_t b = static_cast<uint8_t>(((rgba & 0x3FF00000) >> 20) /  4);
+		const uint8_t a = static_cast<uint8_t>(((rgba & 0xC0000000) >> 30) * 85);
+		dst[i * 4 + 0] = swap_red_blue ? b : r;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = swap_red_blue ? r : b;
+		dst[i * 4 + 3] = a;
+	}
+}
+
+void reshade::pixel_kernels::convert_rgba16f_to_rgba8(uint8_t *dst, const uint16_t *src, size_t count)
+{
+	size_t i = 0;
+#if PIXEL_KERNELS_X86
+	i = convert_rgba16f_to_rgba8_sse2(dst, src, count);
+#endif
+	for (i *= 4, count *= 4; i < count; ++i)
+	{
+		const float value = half_to_float(src[i]);
+		// Comparisons are written so that NaN ends up as zero
+		dst[i] = static_cast<uint8_t>((value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f) * 255.0f + 0.5f);
+	}
+}
+
+void reshade::pixel_kernels::premultiply_alpha(uint8_t *data, size_t count)
+{
+	size_t i = 0;
+#if PIXEL_KERNELS_X86
+	i = s_has_avx2 ? premultiply_alpha_avx2(data, count) : premultiply_alpha_sse2(data, count);
+#endif
+	for (; i < count; ++i)
+	{
+		const uint32_t a = data[i * 4 + 3];
+		for (size_t c = 0; c < 3; ++c)
+		{
+			const uint32_t product = data[i * 4 + c] * a + 128;
+			data[i * 4 + c] = static_cast<uint8_t>((product + (product >> 8)) >> 8);
+		}
+	}
+}
+
+void reshade::pixel_kernels::flip_vertically(uint8_t *data, size_t row_size, size_t rows)
+{
+	for (size_t y = 0; y < rows / 2; ++y)
+	{
+		uint8_t *const row1 = data + y * row_size;
+		uint8_t *const row2 = data + (rows - 1 - y) * row_size;
+		std::swap_ranges(row1, row1 + row_size, row2);
+	}
+}
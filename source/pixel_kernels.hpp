@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reshade::pixel_kernels
+{
+	/// <summary>
+	/// Set the alpha channel of all pixels in RGBA8 data to the specified value.
+	/// </summary>
+	/// <param name="data">The pixel data to modify.</param>
+	/// <param name="count">The number of pixels.</param>
+	void fill_alpha(uint8_t *data, size_t count, uint8_t alpha = 0xFF);
+
+	/// <summary>
+	/// Convert BGRA8 pixel data to RGBA8 (or the other way around) by swapping the red and blue channels.
+	/// </summary>
+	/// <param name="dst">The buffer to write the converted pixels to. This may be the same as <paramref name="src"/>.</param>
+	/// <param name="src">The pixel data to convert.</param>
+	/// <param name="count">The number of pixels.</param>
+	void swap_red_blue(uint8_t *dst, const uint8_t *src, size_t count);
+
+	/// <summary>
+	/// Convert 10:10:10:2 pixel data (red in the least significant bits) to RGBA8.
+	/// </summary>
+	/// <param name="dst">The buffer to write the converted pixels to. This may be the same as <paramref name="src"/>.</param>
+	/// <param name="src">The pixel data to convert.</param>
+	/// <param name="count">The number of pixels.</param>
+	/// <param name="swap_red_blue">Set to <c>true</c> to swap the red and blue channels during conversion (e.g. for data with blue in the least significant bits).</param>
+	void convert_rgb10a2_to_rgba8(uint8_t *dst, const uint8_t *src, size_t count, bool swap_red_blue = false);
+
+	/// <summary>
+	/// Convert RGBA16F pixel data to RGBA8, clamping all values to the zero to one range.
+	/// </summary>
+	/// <param name="dst">The buffer to write the converted pixels to.</param>
+	/// <param name="src">The pixel data to convert.</param>
+	/// <param name="count">The number of pixels.</param>
+	void convert_rgba16f_to_rgba8(uint8_t *dst, const uint16_t *src, size_t count);
+
+	/// <summary>
+	/// Multiply the color channels of all pixels in RGBA8 data with their alpha channel.
+	/// </summary>
+	/// <param name="data">The pixel data to modify.</param>
+	/// <param name="count">The number of pixels.</param>
+	void premultiply_alpha(uint8_t *data, size_t count);
+
+	/// <summary>
+	/// Flip an image upside down by swapping rows.
+	/// </summary>
+	/// <param name="data">The image data to modify.</param>
+	/// <param name="row_size">The size of a single row in bytes.</param>
+	/// <param name="rows">The number of rows.</param>
+	void flip_vertically(uint8_t *data, size_t row_size, size_t rows);
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "preset_index.hpp"
+#include "dll_config.hpp"
+#include <cwctype>
+#include <algorithm>
+#include <unordered_map>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+static std::wstring to_lower(std::wstring str)
+{
+	std::transform(str.begin(), str.end(), str.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+	return str;
+}
+
+static bool is_preset_file(const std::filesystem::path &path)
+{
+	// Go through the INI cache, so that the file is only read again when it changed and is already loaded when switching to it
+	return reshade::ini_file::load_cache(path).has({}, "Techniques");
+}
+
+reshade::preset_index::~preset_index()
+{
+#ifdef _WIN32
+	if (_change_notification != nullptr)
+		FindCloseChangeNotification(_change_notification);
+#endif
+}
+
+void reshade::preset_index::update(const std::filesystem::path &directory)
+{
+	std::error_code ec;
+
+	if (directory != _directory)
+	{
+		_directory = directory;
+
+#ifdef _WIN32
+		if (_change_notification != nullptr)
+			FindCloseChangeNotification(_change_notification);
+
+		// Get notified when files are added, removed, renamed or written to, so that the directory does not have to be checked on every call
+		_change_notification = FindFirstChangeNotificationW(_directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+		if (_change_notification == INVALID_HANDLE_VALUE)
+			_change_notification = nullptr;
+#endif
+
+		_directory_modified_at = std::filesystem::last_write_time(_directory, ec);
+		_entries.clear();
+		scan();
+		return;
+	}
+
+#ifdef _WIN32
+	if (_change_notification != nullptr)
+	{
+		if (WaitForSingleObject(_change_notification, 0) == WAIT_OBJECT_0)
+		{
+			// Re-arm the notification before scanning, so that changes during the scan are not missed
+			FindNextChangeNotification(_change_notification);
+			scan();
+		}
+		return;
+	}
+#endif
+
+	// Fall back to checking the modification time of the directory, which changes when files are added, removed or renamed
+	if (const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_directory, ec);
+		modified_at != _directory_modified_at)
+	{
+		_directory_modified_at = modified_at;
+		scan();
+	}
+}
+
+void reshade::preset_index::scan()
+{
+	std::error_code ec;
+
+	// Keep entries of files that did not change, so they do not have to be checked again
+	std::unordered_map<std::wstring, entry> previous_entries;
+	previous_entries.reserve(_entries.size());
+	for (entry &entry : _entries)
+		previous_entries.emplace(entry.path.wstring(), std::move(entry));
+
+	_entries.clear();
+	_num_presets = 0;
+
+	for (const std::filesystem::directory_entry &dir_entry : std::filesystem::directory_iterator(_directory, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (dir_entry.is_directory(ec))
+			continue;
+
+		// First make sure the extension matches, before diving into the file system
+		const std::filesystem::path &path = dir_entry.path();
+		if (const std::filesystem::path ext = path.extension();
+			ext != L".ini" && ext != L".txt")
+			continue;
+
+		entry &entry = _entries.emplace_back();
+		entry.modified_at = dir_entry.last_write_time(ec);
+
+		if (const auto it = previous_entries.find(path.wstring());
+			it != previous_entries.end() && it->second.modified_at == entry.modified_at)
+		{
+			entry = std::move(it->second);
+		}
+		else
+		{
+			entry.path = path;
+			entry.name = to_lower(path.stem().wstring());
+			entry.is_preset = is_preset_file(path);
+		}
+
+		if (entry.is_preset)
+			_num_presets++;
+	}
+
+	std::sort(_entries.begin(), _entries.end(), [](const entry &lhs, const entry &rhs) {
+		return lhs.name < rhs.name || (lhs.name == rhs.name && lhs.path < rhs.path); });
+}
+
+bool reshade::preset_index::find_next(const std::filesystem::path &current_path, const std::wstring &filter, bool reversed, std::filesystem::path &result) const
+{
+	if (_num_presets == 0)
+		return false; // No valid preset files were found, so nothing more to do
+
+	const std::wstring filter_lower = to_lower(filter);
+	const auto matches_filter = [&filter_lower](const entry &entry) {
+		return entry.is_preset && (filter_lower.empty() || entry.name.find(filter_lower) != std::wstring::npos);
+	};
+
+	// Binary search for the current preset by name and only compare the actual files of the few entries with that name
+	const std::wstring current_name = to_lower(current_path.stem().wstring());
+
+	size_t current_index = _entries.size();
+	std::error_code ec;
+	for (auto it = std::lower_bound(_entries.begin(), _entries.end(), current_name, [](const entry &entry, const std::wstring &name) { return entry.name < name; });
+		it != _entries.end() && it->name == current_name; ++it)
+	{
+		if (it->is_preset && std::filesystem::equivalent(it->path, current_path, ec))
+		{
+			current_index = std::distance(_entries.begin(), it);
+			break;
+		}
+	}
+
+	const size_t num_entries = _entries.size();
+
+	if (current_index == num_entries)
+	{
+		// Current preset was not in the directory, so just use the first or last matching file
+		for (size_t i = 0; i < num_entries; ++i)
+		{
+			const entry &entry = _entries[reversed ? num_entries - 1 - i : i];
+			if (matches_filter(entry))
+				return result = entry.path, true;
+		}
+
+		return false;
+	}
+
+	// Current preset was found in the directory, so use the matching file before or after it
+	for (size_t i = 1; i < num_entries; ++i)
+	{
+		const entry &entry = _entries[reversed ? (current_index + num_entries - i) % num_entries : (current_index + i) % num_entries];
+		if (matches_filter(entry))
+			return result = entry.path, true;
+	}
+
+	// There is no other matching preset, so stay with the current one
+	result = _entries[current_index].path;
+	return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// A sorted list of the preset files in a directory, which is only scanned again when the directory contents change.
+	/// </summary>
+	class preset_index
+	{
+	public:
+		preset_index() = default;
+		~preset_index();
+
+		preset_index(const preset_index &) = delete;
+		preset_index &operator=(const preset_index &) = delete;
+
+		/// <summary>
+		/// Switch the index to the specified directory, or refresh it if files in the current directory were changed since the last call.
+		/// </summary>
+		/// <param name="directory">The absolute path to the directory containing the preset files.</param>
+		void update(const std::filesystem::path &directory);
+
+		/// <summary>
+		/// Find the preset that follows (or precedes) the specified one in the index, wrapping around at the end.
+		/// </summary>
+		/// <param name="current_path">The path to the current preset. If it is not part of the index, the first (or last) preset is returned.</param>
+		/// <param name="filter">Optional text that the preset file names must contain (case-insensitive).</param>
+		/// <param name="reversed">Set to <c>true</c> to search for the previous instead of the next preset.</param>
+		/// <param name="result">The path to the found preset.</param>
+		/// <returns><c>true</c> if a preset was found, <c>false</c> if there are no matching presets in the directory.</returns>
+		bool find_next(const std::filesystem::path &current_path, const std::wstring &filter, bool reversed, std::filesystem::path &result) const;
+
+		/// <summary>
+		/// Returns the number of valid preset files in the index.
+		/// </summary>
+		size_t size() const { return _num_presets; }
+
+	private:
+		struct entry
+		{
+			std::filesystem::path path;
+			std::wstring name; // Lower case file name without extension, used for sorting and filtering
+			std::filesystem::file_time_type modified_at;
+			bool is_preset = false;
+		};
+
+		void scan();
+
+		std::filesystem::path _directory;
+		std::filesystem::file_time_type _directory_modified_at;
+		void *_change_notification = nullptr;
+		std::vector<entry> _entries;
+		size_t _num_presets = 0;
+	};
+}
@@ -13,12 +13,14 @@
 #include "effect_preprocessor.hpp"
 #include "input.hpp"
 #include "input_freepie.hpp"
+#include "texture_alias_planner.hpp"
+#include "windows/ws2_32.hpp"
 #include <set>
 #include <thread>
+#include <fstream>
 #include <algorithm>
 #include <stb_image.h>
 #include <stb_image_dds.h>
-#include <stb_image_write.h>
 #include <stb_image_resize.h>
 
 bool resolve_path(std::filesystem::path &path)
@@ -68,6 +70,31 @@ static std::vector<std::filesystem::path> find_files(const std::vector<std::file
 	return files;
 }
 
+static void replace_texture_references(reshadefx::pass_info &pass_info, const std::string &old_name, const std::string &new_name)
+{
+	std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names), old_name, new_name);
+
+	for (reshadefx::sampler_info &sampler_info : pass_info.samplers)
+		if (sampler_info.texture_name == old_name)
+			sampler_info.texture_name  = new_name;
+	for (reshadefx::storage_info &storage_info : pass_info.storages)
+		if (storage_info.texture_name == old_name)
+			storage_info.texture_name  = new_name;
+}
+static void replace_texture_references(reshadefx::module &module, const std::string &old_name, const std::string &new_name)
+{
+	for (reshadefx::sampler_info &sampler_info : module.samplers)
+		if (sampler_info.texture_name == old_name)
+			sampler_info.texture_name  = new_name;
+	for (reshadefx::storage_info &storage_info : module.storages)
+		if (storage_info.texture_name == old_name)
+			storage_info.texture_name  = new_name;
+
+	for (reshadefx::technique_info &technique_info : module.techniques)
+		for (reshadefx::pass_info &pass_info : technique_info.passes)
+			replace_texture_references(pass_info, old_name, new_name);
+}
+
 reshade::runtime::runtime() :
 	_start_time(std::chrono::high_resolution_clock::now()),
 	_last_present_time(std::chrono::high_resolution_clock::now()),
@@ -78,10 +105,15 @@ reshade::runtime::runtime() :
 	_performance_mode_key_data(),
 	_effects_key_data(),
 	_screenshot_key_data(),
+	_screenshot_sequence_key_data(),
 	_prev_preset_key_data(),
 	_next_preset_key_data(),
 	_config_path(g_reshade_base_path / L"ReShade.ini"),
-	_screenshot_path(g_reshade_base_path)
+	_screenshot_path(g_reshade_base_path),
+	// Encoding screenshots is expensive, but leave some room for the application itself
+	_screenshot_thread_pool(std::max(std::thread::hardware_concurrency() / 2, 1u)),
+	_screenshot_writer(_screenshot_thread_pool),
+	_screenshot_sequence(_screenshot_thread_pool)
 {
 	_needs_update = check_for_update(_latest_version);
 
@@ -138,6 +170,15 @@ void reshade::runtime::on_reset()
 
 	unload_effects();
 
+	// Frame size is about to change, so cannot continue recording into the current sequence
+	_screenshot_sequence.stop();
+
+	// The staging resources of copies still in flight are destroyed along with the other resources, so those frames are lost
+	for (size_t i = 0; i < _screenshot_sequence_readbacks.size(); ++i)
+		_screenshot_sequence.drop_frame();
+	_screenshot_sequence_readbacks.clear();
+	_next_readback_slot = 0;
+
 	_width = _height = 0;
 #if RESHADE_GUI
 	if (_imgui_font_atlas != nullptr)
@@ -153,12 +194,18 @@ void reshade::runtime::on_present()
 	const auto current_time = std::chrono::high_resolution_clock::now();
 	_last_frame_duration = current_time - _last_present_time;
 	_last_present_time = current_time;
+	_frame_time_histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(_last_frame_duration).count());
+
+	update_screenshot_status();
 
 #ifdef NDEBUG
 	// Lock input so it cannot be modified by other threads while we are reading it here
 	const auto input_lock = _input->lock();
 #endif
 
+	// Capture sequence frames before the overlay is drawn, so that it does not show up in them
+	update_screenshot_sequence();
+
 #if RESHADE_GUI
 	// Draw overlay
 	draw_gui();
@@ -179,6 +226,9 @@ void reshade::runtime::on_present()
 		if (_input->is_key_pressed(_screenshot_key_data, _force_shortcut_modifiers))
 			_should_save_screenshot = true; // Notify 'update_and_render_effects' that we want to save a screenshot next frame
 
+		if (_input->is_key_pressed(_screenshot_sequence_key_data, _force_shortcut_modifiers))
+			toggle_screenshot_sequence();
+
 		// Do not allow the next shortcuts while effects are being loaded or compiled (since they affect that state)
 		if (!is_loading() && _reload_compile_queue.empty())
 		{
@@ -221,7 +271,7 @@ void reshade::runtime::on_present()
 	static int cooldown = 0, traffic = 0;
 	if (cooldown-- > 0)
 	{
-		traffic += g_network_traffic > 0;
+		traffic += g_network_traffic.total() > 0;
 	}
 	else
 	{
@@ -231,7 +281,7 @@ void reshade::runtime::on_present()
 	}
 
 	// Reset frame statistics
-	g_network_traffic = 0;
+	g_network_traffic.reset();
 }
 
 bool reshade::runtime::load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t effect_index, bool preprocess_required)
@@ -351,7 +401,11 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			"#define tex2Dgather3 tex2DgatherA\n");
 
 		// Load and preprocess the source file
+		const auto time_preprocess_started = std::chrono::high_resolution_clock::now();
 		effect.preprocessed = pp.append_file(source_file);
+		effect.statistics.preprocess_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - time_preprocess_started).count();
+		effect.statistics.num_macro_expansions = pp.num_macro_expansions();
+		effect.statistics.num_includes = pp.num_includes();
 
 		// Append preprocessor errors to the error list
 		effect.errors      += pp.errors();
@@ -404,7 +458,9 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		reshadefx::parser parser;
 
 		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
+		const auto time_parse_started = std::chrono::high_resolution_clock::now();
 		effect.compiled = parser.parse(std::move(source), codegen.get());
+		const auto time_parse_finished = std::chrono::high_resolution_clock::now();
 
 		// Append parser errors to the error list
 		effect.errors  += parser.errors();
@@ -412,9 +468,17 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		// Write result to effect module
 		codegen->write_result(effect.module);
 
+		effect.statistics.parse_time = std::chrono::duration_cast<std::chrono::microseconds>(time_parse_finished - time_parse_started).count();
+		effect.statistics.write_result_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - time_parse_finished).count();
+		effect.statistics.num_tokens = parser.num_tokens();
+		effect.statistics.num_symbols = parser.num_symbols();
+		effect.statistics.num_instructions = reshadefx::count_instructions(effect.module);
+
 		if (effect.compiled)
 		{
 			effect.uniforms.clear();
+			effect.special_uniforms.clear();
+			effect.toggle_key_uniforms.clear();
 
 			// Create space for all variables (aligned to 16 bytes)
 			effect.uniform_data_storage.resize((effect.module.total_uniform_size + 15) & ~15);
@@ -426,7 +490,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				// Copy initial data into uniform storage area
 				reset_uniform_value(variable);
 
-				const std::string_view special = variable.annotation_as_string("source");
+				const std::string_view special = variable.annotation_as_string(annotation_key::source);
 				if (special.empty()) /* Ignore if annotation is missing */;
 				else if (special == "frametime")
 					variable.special = special_uniform::frame_time;
@@ -461,9 +525,32 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				else if (special == "bufready_depth")
 					variable.special = special_uniform::bufready_depth;
 
+				if (variable.special == special_uniform::key || variable.special == special_uniform::mouse_button)
+				{
+					if (const std::string_view mode = variable.annotation_as_string(annotation_key::mode);
+						mode == "toggle" || variable.annotation_as_int(annotation_key::toggle))
+						variable.input_mode = special_input_mode::toggle;
+					else if (mode == "press")
+						variable.input_mode = special_input_mode::press;
+				}
+
 				effect.uniforms.push_back(std::move(variable));
 			}
 
+			// Build lists of the uniforms that need to be updated every frame, so that the other uniforms do not have to be visited
+			for (uint32_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+			{
+				const uniform &variable = effect.uniforms[uniform_index];
+				if (variable.special != special_uniform::none)
+					effect.special_uniforms.push_back(uniform_index);
+				if (variable.supports_toggle_key())
+					effect.toggle_key_uniforms.push_back(uniform_index);
+			}
+
+			// Group uniforms by their source, so that updating them runs the same code for consecutive uniforms
+			std::stable_sort(effect.special_uniforms.begin(), effect.special_uniforms.end(),
+				[&effect](uint32_t lhs, uint32_t rhs) { return effect.uniforms[lhs].special < effect.uniforms[rhs].special; });
+
 			// Fill all specialization constants with values from the current preset
 			if (_performance_mode)
 			{
@@ -548,7 +635,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
 					effect.errors += ") already created a texture with the same name but different dimensions\n";
 				}
-				if (texture.semantic.empty() && (existing_texture->annotation_as_string("source") != texture.annotation_as_string("source")))
+				if (texture.semantic.empty() && (existing_texture->annotation_as_string(annotation_key::source) != texture.annotation_as_string(annotation_key::source)))
 				{
 					effect.errors += "warning: " + texture.unique_name + ": another effect (";
 					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
@@ -575,37 +662,15 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				continue;
 			}
 
-			if (texture.annotation_as_int("pooled") && texture.semantic.empty())
+			if (texture.annotation_as_int(annotation_key::pooled) && texture.semantic.empty())
 			{
 				// Try to find another pooled texture to share with (and do not share within the same effect)
 				if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
-					[&texture](const auto &item) { return item.annotation_as_int("pooled") && item.effect_index != texture.effect_index && item.matches_description(texture); });
+					[&texture](const auto &item) { return item.annotation_as_int(annotation_key::pooled) && item.effect_index != texture.effect_index && item.matches_description(texture); });
 					existing_texture != _textures.end())
 				{
-					// Overwrite referenced texture in samplers with the pooled one
-					for (auto &sampler_info : effect.module.samplers)
-						if (sampler_info.texture_name == texture.unique_name)
-							sampler_info.texture_name  = existing_texture->unique_name;
-					// Overwrite referenced texture in storages with the pooled one
-					for (auto &storage_info : effect.module.storages)
-						if (storage_info.texture_name == texture.unique_name)
-							storage_info.texture_name  = existing_texture->unique_name;
-					// Overwrite referenced texture in render targets with the pooled one
-					for (auto &technique_info : effect.module.techniques)
-					{
-						for (auto &pass_info : technique_info.passes)
-						{
-							std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names),
-								texture.unique_name, existing_texture->unique_name);
-
-							for (auto &sampler_info : pass_info.samplers)
-								if (sampler_info.texture_name == texture.unique_name)
-									sampler_info.texture_name  = existing_texture->unique_name;
-							for (auto &storage_info : pass_info.storages)
-								if (storage_info.texture_name == texture.unique_name)
-									storage_info.texture_name  = existing_texture->unique_name;
-						}
-					}
+					// Overwrite referenced texture with the pooled one
+					replace_texture_references(effect.module, texture.unique_name, existing_texture->unique_name);
 
 					if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
 						existing_texture->shared.push_back(effect_index);
@@ -625,13 +690,16 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			_textures.push_back(std::move(texture));
 		}
 
-		for (technique technique : effect.module.techniques)
+		for (size_t technique_index = 0; technique_index < effect.module.techniques.size(); ++technique_index)
 		{
+			technique technique = effect.module.techniques[technique_index];
 			technique.effect_index = effect_index;
+			technique.unique_name = technique.name + '@' + effect.source_file.filename().u8string();
+			technique.index_in_effect = technique_index;
 
-			technique.hidden = technique.annotation_as_int("hidden") != 0;
+			technique.hidden = technique.annotation_as_int(annotation_key::hidden) != 0;
 
-			if (technique.annotation_as_int("enabled"))
+			if (technique.annotation_as_int(annotation_key::enabled))
 				enable_technique(technique);
 
 			_techniques.push_back(std::move(technique));
@@ -649,6 +717,11 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			LOG(INFO) << "Successfully loaded " << source_file << '.';
 		else
 			LOG(WARN) << "Successfully loaded " << source_file << " with warnings:\n" << effect.errors;
+
+		const reshadefx::compile_statistics &stats = effect.statistics;
+		LOG(DEBUG) << "> Compilation took " << (stats.total_time() / 1000.0) << " ms"
+			" (preprocess " << (stats.preprocess_time / 1000.0) << " ms, parse " << (stats.parse_time / 1000.0) << " ms, write_result " << (stats.write_result_time / 1000.0) << " ms)"
+			" for " << stats.num_tokens << " tokens, " << stats.num_macro_expansions << " macro expansions, " << stats.num_includes << " includes, " << stats.num_symbols << " symbols and " << stats.num_instructions << " instructions.";
 		return true;
 	}
 	else
@@ -664,6 +737,9 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 }
 void reshade::runtime::load_effects()
 {
+	// Any cached preset plans refer to the effects that are about to be replaced
+	_preset_plans.clear();
+
 	// Reload preprocessor definitions from current preset before compiling
 	_preset_preprocessor_definitions.clear();
 	ini_file &preset = ini_file::load_cache(_current_preset_path);
@@ -707,7 +783,7 @@ void reshade::runtime::load_textures()
 			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
 
 		std::filesystem::path source_path = std::filesystem::u8path(
-			texture.annotation_as_string("source"));
+			texture.annotation_as_string(annotation_key::source));
 		// Ignore textures that have no image file attached to them (e.g. plain render targets)
 		if (source_path.empty())
 			continue;
@@ -765,6 +841,127 @@ void reshade::runtime::load_textures()
 	_textures_loaded = true;
 }
 
+void reshade::runtime::alias_transient_textures()
+{
+	struct texture_usage
+	{
+		size_t technique_index = std::numeric_limits<size_t>::max();
+		uint32_t first_use = std::numeric_limits<uint32_t>::max();
+		uint32_t last_use = 0;
+		bool transient = true;
+	};
+
+	std::unordered_map<std::string, texture_usage> usages;
+	for (const texture &tex : _textures)
+	{
+		// Only consider render targets that are not created yet and not shared or pooled deliberately (those are expected to keep their contents)
+		if (tex.impl != nullptr || !tex.render_target || tex.storage_access || tex.shared.size() != 1 || !tex.semantic.empty() ||
+			tex.annotation_as_int(annotation_key::pooled) || !tex.annotation_as_string(annotation_key::source).empty())
+			continue;
+
+		usages.emplace(tex.unique_name, texture_usage());
+	}
+
+	// Walk through all passes in the order they are rendered and track the lifetime of each texture
+	uint32_t position = 0;
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		for (const reshadefx::pass_info &pass_info : _techniques[technique_index].passes)
+		{
+			const auto access = [&usages, technique_index, position](const std::string &texture_name, bool is_full_write) {
+				const auto it = usages.find(texture_name);
+				if (it == usages.end())
+					return;
+
+				texture_usage &usage = it->second;
+				// Textures used in multiple techniques may be expected to keep their contents from one technique to the next, with other techniques rendering in between
+				if (usage.technique_index != std::numeric_limits<size_t>::max() && usage.technique_index != technique_index)
+					usage.transient = false;
+				// Textures that are read or only partially written before they are fully written keep contents from the previous frame
+				if (usage.technique_index == std::numeric_limits<size_t>::max() && !is_full_write)
+					usage.transient = false;
+
+				usage.technique_index = technique_index;
+				usage.first_use = std::min(usage.first_use, position);
+				usage.last_use = position;
+			};
+
+			// Reads happen while the pass is rendering, so count them as happening before the render targets are written
+			for (const reshadefx::sampler_info &sampler_info : pass_info.samplers)
+				access(sampler_info.texture_name, false);
+			for (const reshadefx::storage_info &storage_info : pass_info.storages)
+				access(storage_info.texture_name, false);
+
+			// Only a pass that clears its render targets is known to overwrite them entirely (even a full screen triangle may not touch every pixel, e.g. when the shader discards some of them)
+			const bool is_full_write = pass_info.clear_render_targets;
+
+			for (const std::string &render_target_name : pass_info.render_target_names)
+				if (!render_target_name.empty())
+					access(render_target_name, is_full_write);
+
+			position++;
+		}
+	}
+
+	std::vector<texture *> transient_textures;
+	std::vector<texture_alias_planner::resource> resources;
+	for (texture &tex : _textures)
+	{
+		if (const auto it = usages.find(tex.unique_name);
+			it != usages.end() && it->second.transient && it->second.technique_index != std::numeric_limits<size_t>::max())
+		{
+			transient_textures.push_back(&tex);
+			resources.push_back({ tex.width, tex.height, tex.levels, tex.format, it->second.first_use, it->second.last_use });
+		}
+	}
+
+	const std::vector<size_t> assignment = texture_alias_planner::plan(resources);
+
+	const auto replace_references = [this](size_t effect_index, const std::string &old_name, const std::string &new_name) {
+		replace_texture_references(_effects[effect_index].module, old_name, new_name);
+		for (technique &tech : _techniques)
+			if (tech.effect_index == effect_index)
+				for (reshadefx::pass_info &pass_info : tech.passes)
+					replace_texture_references(pass_info, old_name, new_name);
+	};
+
+	std::unordered_set<std::string> aliased_texture_names;
+	for (size_t i = 0; i < transient_textures.size(); ++i)
+	{
+		if (assignment[i] == i)
+			continue;
+
+		texture &tex = *transient_textures[i];
+		texture &existing_texture = *transient_textures[assignment[i]];
+
+		// Once the texture is shared with another effect it outlives a reload of the effect it belongs to, so rename it to something no effect can declare
+		// Otherwise that effect would pick it up again by name when it is reloaded on its own, even though the other effect still uses it for a different texture
+		if (existing_texture.effect_index != tex.effect_index && existing_texture.shared.size() == 1)
+		{
+			const std::string alias_name = existing_texture.unique_name + "@alias" + std::to_string(_num_texture_aliases++);
+			replace_references(existing_texture.effect_index, existing_texture.unique_name, alias_name);
+			existing_texture.unique_name = alias_name;
+		}
+
+		LOG(DEBUG) << "> Texture " << tex.unique_name << " shares memory with " << existing_texture.unique_name << '.';
+
+		// Overwrite referenced texture with the one it shares memory with, same as for pooled textures
+		replace_references(tex.effect_index, tex.unique_name, existing_texture.unique_name);
+
+		if (std::find(existing_texture.shared.begin(), existing_texture.shared.end(), tex.effect_index) == existing_texture.shared.end())
+			existing_texture.shared.push_back(tex.effect_index);
+
+		aliased_texture_names.insert(tex.unique_name);
+	}
+
+	if (aliased_texture_names.empty())
+		return;
+
+	LOG(INFO) << "Sharing memory of " << transient_textures.size() << " transient render targets between " << (transient_textures.size() - aliased_texture_names.size()) << " textures.";
+
+	_textures.erase(std::remove_if(_textures.begin(), _textures.end(),
+		[&aliased_texture_names](const texture &tex) { return aliased_texture_names.find(tex.unique_name) != aliased_texture_names.end(); }), _textures.end());
+}
 void reshade::runtime::unload_effect(size_t effect_index)
 {
 	assert(effect_index < _effects.size());
@@ -784,6 +981,9 @@ void reshade::runtime::unload_effect(size_t effect_index)
 				destroy_texture(tex);
 				return true;
 			}
+			// Hand the texture over to another effect that still uses it, so that it is not destroyed should this effect fail to compile after a reload
+			if (tex.effect_index == effect_index)
+				tex.effect_index = tex.shared.front();
 			return false;
 		}), _textures.end());
 	// Clean up techniques belonging to this effect
@@ -818,6 +1018,7 @@ void reshade::runtime::unload_effects()
 
 	// Reset the effect list after all resources have been destroyed
 	_effects.clear();
+	_preset_plans.clear();
 }
 
 bool reshade::runtime::reload_effect(size_t effect_index, bool preprocess_required)
@@ -828,6 +1029,7 @@ bool reshade::runtime::reload_effect(size_t effect_index, bool preprocess_requir
 
 	const std::filesystem::path source_file = _effects[effect_index].source_file;
 	unload_effect(effect_index);
+	_preset_plans.clear();
 	return load_effect(source_file, ini_file::load_cache(_current_preset_path), effect_index, preprocess_required);
 }
 void reshade::runtime::reload_effects()
@@ -844,6 +1046,25 @@ void reshade::runtime::reload_effects()
 	load_effects();
 }
 
+#if RESHADE_GUI
+void reshade::runtime::update_effect_search_index()
+{
+	_editor_search_index_outdated = false;
+
+	std::vector<std::filesystem::path> included_files;
+	for (const effect &effect : _effects)
+		included_files.insert(included_files.end(), effect.included_files.begin(), effect.included_files.end());
+
+	// Index all effect files and headers in the search paths, as well as any files that were included from elsewhere
+	// Searching the file system is done on the background thread of the index too, so that this does not stall rendering
+	_editor_search_index.update([search_paths = _effect_search_paths, included_files = std::move(included_files)]() {
+		std::vector<std::filesystem::path> files = find_files(search_paths, { L".fx", L".fxh" });
+		files.insert(files.end(), included_files.begin(), included_files.end());
+		return files;
+	});
+}
+#endif
+
 bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const
 {
 	if (_no_effect_cache)
@@ -976,7 +1197,11 @@ void reshade::runtime::update_and_render_effects()
 				thread.join(); // Threads have exited, but still need to join them prior to destruction
 		_worker_threads.clear();
 
-		// Finished loading effects, so apply preset to figure out which ones need compiling
+		// Finished loading effects, so figure out which textures can share memory before any of them are created
+		if (_alias_transient_textures)
+			alias_transient_textures();
+
+		// Apply preset to figure out which ones need compiling
 		load_current_preset();
 
 		_last_reload_time = std::chrono::high_resolution_clock::now();
@@ -986,6 +1211,9 @@ void reshade::runtime::update_and_render_effects()
 		_load_option_disable_skipping = false;
 
 #if RESHADE_GUI
+		// Files may have changed, so update search index the next time the code editor is used
+		_editor_search_index_outdated = true;
+
 		// Update all editors after a reload
 		for (editor_instance &instance : _editors)
 		{
@@ -1116,17 +1344,25 @@ void reshade::runtime::update_and_render_effects()
 	if (!_effects_enabled)
 		return;
 
+	// Compute values that are shared by all uniforms of the same source once per frame
+	const float frame_time = _last_frame_duration.count() * 1e-6f;
+	const unsigned int timer_ms = static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count());
+	int date[4] = {}; // Only filled in when there is a uniform using it
+
 	// Update special uniform variables
 	for (effect &effect : _effects)
 	{
 		if (!effect.rendering)
 			continue;
 
-		for (uniform &variable : effect.uniforms)
+		// Only uniforms that support toggle keys need to be checked for key presses
+		if (!_ignore_shortcuts)
 		{
-			if (!_ignore_shortcuts && _input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
+			for (const uint32_t uniform_index : effect.toggle_key_uniforms)
 			{
-				assert(variable.supports_toggle_key());
+				uniform &variable = effect.uniforms[uniform_index];
+				if (variable.toggle_key_data[0] == 0 || !_input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
+					continue;
 
 				// Change to next value if the associated shortcut key was pressed
 				switch (variable.type.base)
@@ -1143,7 +1379,7 @@ void reshade::runtime::update_and_render_effects()
 					{
 						int data[4];
 						get_uniform_value(variable, data, 4);
-						const std::string_view ui_items = variable.annotation_as_string("ui_items");
+						const std::string_view ui_items = variable.annotation_as_string(annotation_key::ui_items);
 						int num_items = 0;
 						for (size_t offset = 0, next; (next = ui_items.find('\0', offset)) != std::string::npos; offset = next + 1)
 							num_items++;
@@ -1154,12 +1390,18 @@ void reshade::runtime::update_and_render_effects()
 				}
 				save_current_preset();
 			}
+		}
+
+		// Only visit uniforms with a special source, which were grouped by source when the effect was loaded
+		for (const uint32_t uniform_index : effect.special_uniforms)
+		{
+			uniform &variable = effect.uniforms[uniform_index];
 
 			switch (variable.special)
 			{
 				case special_uniform::frame_time:
 				{
-					set_uniform_value(variable, _last_frame_duration.count() * 1e-6f);
+					set_uniform_value(variable, frame_time);
 					break;
 				}
 				case special_uniform::frame_count:
@@ -1172,19 +1414,19 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::random:
 				{
-					const int min = variable.annotation_as_int("min", 0, 0);
-					const int max = variable.annotation_as_int("max", 0, RAND_MAX);
+					const int min = variable.annotation_as_int(annotation_key::min, 0, 0);
+					const int max = variable.annotation_as_int(annotation_key::max, 0, RAND_MAX);
 					set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
 					break;
 				}
 				case special_uniform::ping_pong:
 				{
-					const float min = variable.annotation_as_float("min", 0, 0.0f);
-					const float max = variable.annotation_as_float("max", 0, 1.0f);
-					const float step_min = variable.annotation_as_float("step", 0);
-					const float step_max = variable.annotation_as_float("step", 1);
+					const float min = variable.annotation_as_float(annotation_key::min, 0, 0.0f);
+					const float max = variable.annotation_as_float(annotation_key::max, 0, 1.0f);
+					const float step_min = variable.annotation_as_float(annotation_key::step, 0);
+					const float step_max = variable.annotation_as_float(annotation_key::step, 1);
 					float increment = step_max == 0 ? step_min : (step_min + std::fmodf(static_cast<float>(std::rand()), step_max - step_min + 1));
-					const float smoothing = variable.annotation_as_float("smoothing");
+					const float smoothing = variable.annotation_as_float(annotation_key::smoothing);
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
@@ -1209,38 +1451,37 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::date:
 				{
-					const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-					tm tm; localtime_s(&tm, &t);
-
-					const int value[4] = {
-						tm.tm_year + 1900,
-						tm.tm_mon + 1,
-						tm.tm_mday,
-						tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec
-					};
-					set_uniform_value(variable, value, 4);
+					if (date[0] == 0)
+					{
+						const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+						tm tm; localtime_s(&tm, &t);
+
+						date[0] = tm.tm_year + 1900;
+						date[1] = tm.tm_mon + 1;
+						date[2] = tm.tm_mday;
+						date[3] = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+					}
+					set_uniform_value(variable, date, 4);
 					break;
 				}
 				case special_uniform::timer:
 				{
-					const unsigned long long timer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count();
-					set_uniform_value(variable, static_cast<unsigned int>(timer_ms));
+					set_uniform_value(variable, timer_ms);
 					break;
 				}
 				case special_uniform::key:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
+					if (const int keycode = variable.annotation_as_int(annotation_key::keycode);
 						keycode > 7 && keycode < 256)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+						if (variable.input_mode == special_input_mode::toggle)
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value, 1);
 							if (_input->is_key_pressed(keycode))
 								set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
+						else if (variable.input_mode == special_input_mode::press)
 							set_uniform_value(variable, _input->is_key_pressed(keycode));
 						else
 							set_uniform_value(variable, _input->is_key_down(keycode));
@@ -1259,18 +1500,17 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::mouse_button:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
+					if (const int keycode = variable.annotation_as_int(annotation_key::keycode);
 						keycode >= 0 && keycode < 5)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+						if (variable.input_mode == special_input_mode::toggle)
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value, 1);
 							if (_input->is_mouse_button_pressed(keycode))
 								set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
+						else if (variable.input_mode == special_input_mode::press)
 							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
 						else
 							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
@@ -1279,9 +1519,9 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::mouse_wheel:
 				{
-					const float min = variable.annotation_as_float("min");
-					const float max = variable.annotation_as_float("max");
-					float step = variable.annotation_as_float("step");
+					const float min = variable.annotation_as_float(annotation_key::min);
+					const float max = variable.annotation_as_float(annotation_key::max);
+					float step = variable.annotation_as_float(annotation_key::step);
 					if (step == 0.0f)
 						step  = 1.0f;
 
@@ -1300,7 +1540,7 @@ void reshade::runtime::update_and_render_effects()
 				case special_uniform::freepie:
 				{
 					if (freepie_io_data data;
-						freepie_io_read(variable.annotation_as_int("index"), &data))
+						freepie_io_read(variable.annotation_as_int(annotation_key::index), &data))
 						set_uniform_value(variable, &data.yaw, 3 * 2);
 					break;
 				}
@@ -1328,6 +1568,9 @@ void reshade::runtime::update_and_render_effects()
 		}
 	}
 
+	if (_effect_budget > 0)
+		update_effect_budget();
+
 	// Render all enabled techniques
 	for (technique &technique : _techniques)
 	{
@@ -1339,14 +1582,14 @@ void reshade::runtime::update_and_render_effects()
 				disable_technique(technique);
 		}
 
-		if (technique.impl == nullptr || !technique.enabled)
-			continue; // Ignore techniques that are not fully loaded or currently disabled
+		if (technique.impl == nullptr || !technique.enabled || technique.suspended)
+			continue; // Ignore techniques that are not fully loaded, currently disabled or suspended to stay within the effect budget
 
 		const auto time_technique_started = std::chrono::high_resolution_clock::now();
 		render_technique(technique);
 		const auto time_technique_finished = std::chrono::high_resolution_clock::now();
 
-		technique.average_cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
+		technique.record_cpu_duration(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
 
 		if (technique.time_left > 0)
 		{
@@ -1369,7 +1612,7 @@ void reshade::runtime::enable_technique(technique &technique)
 
 	const bool status_changed = !technique.enabled;
 	technique.enabled = true;
-	technique.time_left = technique.annotation_as_int("timeout");
+	technique.time_left = technique.annotation_as_int(annotation_key::timeout);
 
 	// Queue effect file for compilation if it was not fully loaded yet
 	if (technique.impl == nullptr && // Avoid adding the same effect multiple times to the queue if it contains multiple techniques that were enabled simultaneously
@@ -1385,13 +1628,64 @@ void reshade::runtime::disable_technique(technique &technique)
 
 	const bool status_changed =  technique.enabled;
 	technique.enabled = false;
+	technique.suspended = false;
 	technique.time_left = 0;
 	technique.average_cpu_duration.clear();
 	technique.average_gpu_duration.clear();
+	for (auto &pass_timing : technique.pass_timings)
+		pass_timing.average_gpu_duration.clear();
 
 	if (status_changed) // Decrease rendering reference count
 		_effects[technique.effect_index].rendering--;
 }
+void reshade::runtime::update_effect_budget()
+{
+	std::vector<technique *> candidate_techniques;
+	std::vector<effect_budget_controller::candidate> candidates;
+
+	for (technique &technique : _techniques)
+	{
+		if (technique.impl == nullptr || !technique.enabled)
+			continue;
+
+		// The CPU duration only measures how long it took to record the commands and not how long the GPU is busy with them, so do not make any decisions without a GPU duration for every technique
+		// This is the case for APIs that do not measure GPU durations, but also right after a technique was enabled and before its first result came in
+		// Suspended techniques are not rendered, so their averages still contain the duration from before they were suspended
+		const uint64_t duration = technique.average_gpu_duration;
+		if (duration == 0)
+		{
+			_effect_budget_controller.reset();
+			return;
+		}
+
+		candidate_techniques.push_back(&technique);
+		candidates.push_back({ duration, technique.annotation_as_int(annotation_key::budget_priority), technique.suspended });
+	}
+
+	const effect_budget_controller::decision decision = _effect_budget_controller.update(static_cast<uint64_t>(_effect_budget * 1'000'000.0), candidates.data(), candidates.size());
+	if (decision.type == effect_budget_controller::action::none)
+		return;
+
+	technique &technique = *candidate_techniques[decision.index];
+	technique.suspended = decision.type == effect_budget_controller::action::suspend;
+
+	LOG(INFO) << (technique.suspended ? "Suspending" : "Resuming") << " technique " << technique.unique_name << " (" << candidates[decision.index].duration * 1e-6 << " ms)"
+		<< " to keep post-processing within the effect budget (" << decision.total_duration * 1e-6 << " ms of " << _effect_budget << " ms).";
+}
+void reshade::runtime::resume_suspended_techniques()
+{
+	_effect_budget_controller.reset();
+
+	for (technique &technique : _techniques)
+	{
+		if (!technique.suspended)
+			continue;
+
+		technique.suspended = false;
+
+		LOG(INFO) << "Resuming technique " << technique.unique_name << " since the effect budget was disabled.";
+	}
+}
 
 void reshade::runtime::subscribe_to_load_config(std::function<void(const ini_file &)> function)
 {
@@ -1417,11 +1711,14 @@ void reshade::runtime::load_config()
 	config.get("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
 	config.get("INPUT", "KeyReload", _reload_key_data);
 	config.get("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.get("INPUT", "KeyScreenshotSequence", _screenshot_sequence_key_data);
 
 	config.get("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.get("GENERAL", "NoEffectCache", _no_effect_cache);
 	config.get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
 
+	config.get("GENERAL", "AliasTransientTextures", _alias_transient_textures);
+	config.get("GENERAL", "EffectBudget", _effect_budget);
 	config.get("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.get("GENERAL", "PerformanceMode", _performance_mode);
 	config.get("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
@@ -1452,6 +1749,9 @@ void reshade::runtime::load_config()
 	config.get("SCREENSHOT", "SaveOverlayShot", _screenshot_save_ui);
 	config.get("SCREENSHOT", "SavePath", _screenshot_path);
 	config.get("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
+	config.get("SCREENSHOT", "SequenceDeltaEncoding", _screenshot_sequence_delta);
+	config.get("SCREENSHOT", "SequenceInterval", _screenshot_sequence_interval);
+	config.get("SCREENSHOT", "SequenceLength", _screenshot_sequence_length);
 
 	for (const auto &callback : _load_config_callables)
 		callback(config);
@@ -1467,11 +1767,14 @@ void reshade::runtime::save_config() const
 	config.set("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
 	config.set("INPUT", "KeyReload", _reload_key_data);
 	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.set("INPUT", "KeyScreenshotSequence", _screenshot_sequence_key_data);
 
 	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
 	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
 
+	config.set("GENERAL", "AliasTransientTextures", _alias_transient_textures);
+	config.set("GENERAL", "EffectBudget", _effect_budget);
 	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.set("GENERAL", "PerformanceMode", _performance_mode);
 	config.set("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
@@ -1496,6 +1799,9 @@ void reshade::runtime::save_config() const
 	config.set("SCREENSHOT", "SaveOverlayShot", _screenshot_save_ui);
 	config.set("SCREENSHOT", "SavePath", _screenshot_path);
 	config.set("SCREENSHOT", "SavePresetFile", _screenshot_include_preset);
+	config.set("SCREENSHOT", "SequenceDeltaEncoding", _screenshot_sequence_delta);
+	config.set("SCREENSHOT", "SequenceInterval", _screenshot_sequence_interval);
+	config.set("SCREENSHOT", "SequenceLength", _screenshot_sequence_length);
 
 	for (const auto &callback : _save_config_callables)
 		callback(config);
@@ -1505,56 +1811,82 @@ void reshade::runtime::load_current_preset()
 {
 	_preset_save_success = true;
 
-	ini_file config = ini_file::load_cache(_config_path); // Copy config, because reference becomes invalid in the next line
-	const ini_file &preset = ini_file::load_cache(_current_preset_path);
+	// Only compare the value the plan depends on, since the config is saved (and therefore changes revision) right before switching presets
+	std::vector<std::string> config_technique_sorting;
+	ini_file::load_cache(_config_path).get("GENERAL", "TechniqueSorting", config_technique_sorting);
+	const size_t preset_revision = ini_file::load_cache(_current_preset_path).revision();
 
-	std::vector<std::string> technique_list;
-	preset.get({}, "Techniques", technique_list);
-	std::vector<std::string> sorted_technique_list;
-	preset.get({}, "TechniqueSorting", sorted_technique_list);
-	std::vector<std::string> preset_preprocessor_definitions;
-	preset.get({}, "PreprocessorDefinitions", preset_preprocessor_definitions);
+	// Translating a preset is expensive, so only do it again if the preset or the loaded effects changed since it was last applied
+	auto plan_it = std::find_if(_preset_plans.begin(), _preset_plans.end(),
+		[this](const preset_plan &plan) { return plan.path == _current_preset_path; });
+	if (plan_it == _preset_plans.end())
+	{
+		if (_preset_plans.size() >= 32)
+			_preset_plans.erase(_preset_plans.begin()); // Limit amount of cached plans by throwing away the oldest one
+
+		plan_it = _preset_plans.emplace(_preset_plans.end());
+		plan_it->path = _current_preset_path;
+		build_preset_plan(*plan_it);
+	}
+	else if (!plan_it->is_up_to_date(preset_revision, config_technique_sorting))
+	{
+		build_preset_plan(*plan_it);
+	}
+
+	const preset_plan &plan = *plan_it;
 
 	// Recompile effects if preprocessor definitions have changed or running in performance mode (in which case all preset values are compile-time constants)
 	if (_reload_remaining_effects != 0) // ... unless this is the 'load_current_preset' call in 'update_and_render_effects'
 	{
-		if (_performance_mode || preset_preprocessor_definitions != _preset_preprocessor_definitions)
+		if (_performance_mode || plan.preprocessor_definitions != _preset_preprocessor_definitions)
 		{
-			_preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
+			_preset_preprocessor_definitions = plan.preprocessor_definitions;
 			reload_effects();
 			return; // Preset values are loaded in 'update_and_render_effects' during effect loading
 		}
 
-		if (std::find_if(technique_list.begin(), technique_list.end(), [this](const std::string &technique) {
-				if (const size_t at_pos = technique.find('@'); at_pos == std::string::npos)
-					return true;
-				else if (const auto it = std::find_if(_effects.begin(), _effects.end(),
-					[effect_name = static_cast<std::string_view>(technique).substr(at_pos + 1)](const effect &effect) { return effect_name == effect.source_file.filename().u8string(); }); it == _effects.end())
-					return true;
-				else
-					return it->skipped; }) != technique_list.end())
+		if (plan.references_skipped_effects)
 		{
 			reload_effects();
 			return;
 		}
 	}
 
-	if (sorted_technique_list.empty())
-		config.get("GENERAL", "TechniqueSorting", sorted_technique_list);
-	if (sorted_technique_list.empty())
-		sorted_technique_list = technique_list;
+	// Reorder techniques with a stable counting sort on the positions looked up when building the plan
+	{
+		const auto technique_state_index = [&plan](const technique &technique) {
+			return plan.technique_offsets[technique.effect_index] + technique.index_in_effect;
+		};
+
+		std::vector<size_t> position_offsets(plan.num_technique_positions + 1);
+		for (const technique &technique : _techniques)
+			position_offsets[plan.technique_states[technique_state_index(technique)].position + 1]++;
+		for (size_t i = 1; i < position_offsets.size(); ++i)
+			position_offsets[i] += position_offsets[i - 1];
+
+		std::vector<size_t> sorted_indices(_techniques.size());
+		for (size_t i = 0; i < _techniques.size(); ++i)
+			sorted_indices[position_offsets[plan.technique_states[technique_state_index(_techniques[i])].position]++] = i;
+
+		std::vector<technique> sorted_techniques;
+		sorted_techniques.reserve(_techniques.size());
+		for (const size_t index : sorted_indices)
+			sorted_techniques.push_back(std::move(_techniques[index]));
+
+		_techniques = std::move(sorted_techniques);
 
-	// Reorder techniques
-	std::sort(_techniques.begin(), _techniques.end(), [this, &sorted_technique_list](const technique &lhs, const technique &rhs) {
-		const std::string lhs_unique = lhs.name + '@' + _effects[lhs.effect_index].source_file.filename().u8string();
-		const std::string rhs_unique = rhs.name + '@' + _effects[rhs.effect_index].source_file.filename().u8string();
-		auto lhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), lhs_unique);
-		auto rhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs_unique);
-		if (lhs_it == sorted_technique_list.end())
-			lhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), lhs.name);
-		if (rhs_it == sorted_technique_list.end())
-			rhs_it = std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs.name);
-		return lhs_it < rhs_it; });
+		for (technique &technique : _techniques)
+		{
+			const preset_plan::technique_state &state = plan.technique_states[technique_state_index(technique)];
+
+			if (state.enabled)
+				enable_technique(technique);
+			else
+				disable_technique(technique);
+
+			std::memcpy(technique.toggle_key_data, state.toggle_key_data, sizeof(technique.toggle_key_data));
+		}
+	}
 
 	// Compute times since the transition has started and how much is left till it should end
 	auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
@@ -1564,78 +1896,200 @@ void reshade::runtime::load_current_preset()
 	if (_is_in_between_presets_transition && transition_ms_left <= 0)
 		_is_in_between_presets_transition = false;
 
-	for (effect &effect : _effects)
+	if (_is_in_between_presets_transition)
+	{
+		// Uniforms that are not set in the preset keep their current value during a transition, instead of being reset to their defaults
+		for (const preset_plan::uniform_transition &transition : plan.uniform_transitions)
+		{
+			uniform &variable = _effects[transition.effect_index].uniforms[transition.uniform_index];
+
+			reshadefx::constant values;
+			switch (variable.type.base)
+			{
+			case reshadefx::type::t_int:
+				set_uniform_value(variable, transition.value.as_int, variable.type.components());
+				break;
+			case reshadefx::type::t_bool:
+			case reshadefx::type::t_uint:
+				set_uniform_value(variable, transition.value.as_uint, variable.type.components());
+				break;
+			case reshadefx::type::t_float:
+				get_uniform_value(variable, values.as_float, variable.type.components());
+				// Perform smooth transition on floating point values
+				for (unsigned int i = 0; i < variable.type.components(); i++)
+				{
+					const auto transition_ratio = (transition.value.as_float[i] - values.as_float[i]) / transition_ms_left_from_last_frame;
+					values.as_float[i] = transition.value.as_float[i] - transition_ratio * transition_ms_left;
+				}
+				set_uniform_value(variable, values.as_float, variable.type.components());
+				break;
+			}
+		}
+	}
+	else
+	{
+		for (const preset_plan::uniform_value &value : plan.uniform_values)
+			std::memcpy(_effects[value.effect_index].uniform_data_storage.data() + value.offset, plan.uniform_data.data() + value.data_offset, value.size);
+	}
+
+	for (const preset_plan::uniform_toggle_key &key : plan.uniform_toggle_keys)
+		std::memcpy(_effects[key.effect_index].uniforms[key.uniform_index].toggle_key_data, key.key_data, sizeof(key.key_data));
+}
+void reshade::runtime::build_preset_plan(preset_plan &plan)
+{
+	// Read everything needed from the config first, since loading the preset below may invalidate the reference to it
+	plan.config_technique_sorting.clear();
+	ini_file::load_cache(_config_path).get("GENERAL", "TechniqueSorting", plan.config_technique_sorting);
+
+	const ini_file &preset = ini_file::load_cache(plan.path);
+	plan.preset_revision = preset.revision();
+
+	std::vector<std::string> technique_list;
+	preset.get({}, "Techniques", technique_list);
+	std::vector<std::string> sorted_technique_list;
+	preset.get({}, "TechniqueSorting", sorted_technique_list);
+	plan.preprocessor_definitions.clear();
+	preset.get({}, "PreprocessorDefinitions", plan.preprocessor_definitions);
+
+	// Check whether the preset enables techniques of effects that were skipped during loading (and therefore need to be loaded again)
+	{
+		std::unordered_map<std::string, bool> effect_skipped;
+		effect_skipped.reserve(_effects.size());
+		for (const effect &effect : _effects)
+			effect_skipped.emplace(effect.source_file.filename().u8string(), effect.skipped);
+
+		plan.references_skipped_effects = std::find_if(technique_list.begin(), technique_list.end(), [&effect_skipped](const std::string &technique) {
+				if (const size_t at_pos = technique.find('@'); at_pos == std::string::npos)
+					return true;
+				else if (const auto it = effect_skipped.find(technique.substr(at_pos + 1)); it == effect_skipped.end())
+					return true;
+				else
+					return it->second; }) != technique_list.end();
+	}
+
+	if (sorted_technique_list.empty())
+		sorted_technique_list = plan.config_technique_sorting;
+	if (sorted_technique_list.empty())
+		sorted_technique_list = technique_list;
+
+	// Look up the position and state of each technique (by unique name first, falling back to the plain name for older presets)
+	{
+		std::unordered_map<std::string_view, size_t> sorted_technique_positions;
+		sorted_technique_positions.reserve(sorted_technique_list.size());
+		for (size_t i = 0; i < sorted_technique_list.size(); ++i)
+			sorted_technique_positions.emplace(sorted_technique_list[i], i); // Keeps the first occurrence in case of duplicates
+
+		const std::unordered_set<std::string_view> enabled_techniques(technique_list.begin(), technique_list.end());
+
+		size_t num_techniques = 0;
+		plan.technique_offsets.resize(_effects.size());
+		for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		{
+			plan.technique_offsets[effect_index] = num_techniques;
+			num_techniques += _effects[effect_index].module.techniques.size();
+		}
+
+		plan.technique_states.assign(num_techniques, {});
+
+		// Techniques not in the list are moved to the end
+		plan.num_technique_positions = sorted_technique_list.size() + 1;
+
+		for (const technique &technique : _techniques)
+		{
+			preset_plan::technique_state &state = plan.technique_states[plan.technique_offsets[technique.effect_index] + technique.index_in_effect];
+
+			auto it = sorted_technique_positions.find(technique.unique_name);
+			if (it == sorted_technique_positions.end())
+				it = sorted_technique_positions.find(technique.name);
+			state.position = it != sorted_technique_positions.end() ? it->second : plan.num_technique_positions - 1;
+
+			// Ignore preset if "enabled" annotation is set
+			state.enabled = technique.annotation_as_int(annotation_key::enabled) ||
+				enabled_techniques.find(technique.unique_name) != enabled_techniques.end() ||
+				enabled_techniques.find(technique.name) != enabled_techniques.end();
+
+			if (!preset.get({}, "Key" + technique.unique_name, state.toggle_key_data) &&
+				!preset.get({}, "Key" + technique.name, state.toggle_key_data))
+			{
+				state.toggle_key_data[0] = technique.annotation_as_int(annotation_key::toggle);
+				state.toggle_key_data[1] = technique.annotation_as_int(annotation_key::togglectrl);
+				state.toggle_key_data[2] = technique.annotation_as_int(annotation_key::toggleshift);
+				state.toggle_key_data[3] = technique.annotation_as_int(annotation_key::togglealt);
+			}
+		}
+	}
+
+	plan.uniform_data.clear();
+	plan.uniform_values.clear();
+	plan.uniform_transitions.clear();
+	plan.uniform_toggle_keys.clear();
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
 	{
-		for (uniform &variable : effect.uniforms)
+		effect &effect = _effects[effect_index];
+		const std::string section = effect.source_file.filename().u8string();
+
+		// Evaluate the preset values in the uniform storage of the effect and restore the current values afterwards, so that this does not have any visible effect yet
+		const std::vector<unsigned char> current_data = effect.uniform_data_storage;
+
+		for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
 		{
+			uniform &variable = effect.uniforms[uniform_index];
 			if (variable.special != special_uniform::none)
 				continue;
-			const std::string section = effect.source_file.filename().u8string();
 
 			if (variable.supports_toggle_key())
 			{
-				if (!preset.get(section, "Key" + variable.name, variable.toggle_key_data))
-					std::memset(variable.toggle_key_data, 0, sizeof(variable.toggle_key_data));
+				preset_plan::uniform_toggle_key &key = plan.uniform_toggle_keys.emplace_back();
+				key.effect_index = effect_index;
+				key.uniform_index = uniform_index;
+				if (!preset.get(section, "Key" + variable.name, key.key_data))
+					std::memset(key.key_data, 0, sizeof(key.key_data));
 			}
 
 			// Reset values to defaults before loading from a new preset
-			if (!_is_in_between_presets_transition)
-				reset_uniform_value(variable);
+			reset_uniform_value(variable);
 
-			reshadefx::constant values, values_old;
+			reshadefx::constant values;
+			bool is_set_in_preset = false;
 			switch (variable.type.base)
 			{
 			case reshadefx::type::t_int:
 				get_uniform_value(variable, values.as_int, variable.type.components());
-				preset.get(section, variable.name, values.as_int);
+				is_set_in_preset = preset.get(section, variable.name, values.as_int);
 				set_uniform_value(variable, values.as_int, variable.type.components());
 				break;
 			case reshadefx::type::t_bool:
 			case reshadefx::type::t_uint:
 				get_uniform_value(variable, values.as_uint, variable.type.components());
-				preset.get(section, variable.name, values.as_uint);
+				is_set_in_preset = preset.get(section, variable.name, values.as_uint);
 				set_uniform_value(variable, values.as_uint, variable.type.components());
 				break;
 			case reshadefx::type::t_float:
 				get_uniform_value(variable, values.as_float, variable.type.components());
-				values_old = values;
-				preset.get(section, variable.name, values.as_float);
-				if (_is_in_between_presets_transition)
-				{
-					// Perform smooth transition on floating point values
-					for (unsigned int i = 0; i < variable.type.components(); i++)
-					{
-						const auto transition_ratio = (values.as_float[i] - values_old.as_float[i]) / transition_ms_left_from_last_frame;
-						values.as_float[i] = values.as_float[i] - transition_ratio * transition_ms_left;
-					}
-				}
+				is_set_in_preset = preset.get(section, variable.name, values.as_float);
 				set_uniform_value(variable, values.as_float, variable.type.components());
 				break;
 			}
-		}
-	}
 
-	for (technique &technique : _techniques)
-	{
-		const std::string unique_name =
-			technique.name + '@' + _effects[technique.effect_index].source_file.filename().u8string();
+			// Values are not reset during a transition between presets, so only those set in the preset change
+			if (is_set_in_preset)
+				plan.uniform_transitions.push_back({ effect_index, uniform_index, values });
 
-		// Ignore preset if "enabled" annotation is set
-		if (technique.annotation_as_int("enabled") ||
-			std::find(technique_list.begin(), technique_list.end(), unique_name) != technique_list.end() ||
-			std::find(technique_list.begin(), technique_list.end(), technique.name) != technique_list.end())
-			enable_technique(technique);
-		else
-			disable_technique(technique);
+			// Merge with the previous value if they are adjacent in memory, to reduce the number of copies when applying the plan
+			if (!plan.uniform_values.empty() &&
+				plan.uniform_values.back().effect_index == effect_index &&
+				plan.uniform_values.back().offset + plan.uniform_values.back().size == variable.offset)
+				plan.uniform_values.back().size += variable.size;
+			else
+				plan.uniform_values.push_back({ effect_index, variable.offset, variable.size, plan.uniform_data.size() });
 
-		if (!preset.get({}, "Key" + unique_name, technique.toggle_key_data) &&
-			!preset.get({}, "Key" + technique.name, technique.toggle_key_data))
-		{
-			technique.toggle_key_data[0] = technique.annotation_as_int("toggle");
-			technique.toggle_key_data[1] = technique.annotation_as_int("togglectrl");
-			technique.toggle_key_data[2] = technique.annotation_as_int("toggleshift");
-			technique.toggle_key_data[3] = technique.annotation_as_int("togglealt");
+			plan.uniform_data.insert(plan.uniform_data.end(),
+				effect.uniform_data_storage.begin() + variable.offset,
+				effect.uniform_data_storage.begin() + variable.offset + variable.size);
 		}
+
+		effect.uniform_data_storage = current_data;
 	}
 }
 void reshade::runtime::save_current_preset() const
@@ -1651,8 +2105,7 @@ void reshade::runtime::save_current_preset() const
 
 	for (const technique &technique : _techniques)
 	{
-		const std::string unique_name =
-			technique.name + '@' + _effects[technique.effect_index].source_file.filename().u8string();
+		const std::string &unique_name = technique.unique_name;
 
 		if (technique.enabled)
 			technique_list.push_back(unique_name);
@@ -1664,7 +2117,7 @@ void reshade::runtime::save_current_preset() const
 
 		if (technique.toggle_key_data[0] != 0)
 			preset.set({}, "Key" + unique_name, technique.toggle_key_data);
-		else if (technique.annotation_as_int("toggle") != 0)
+		else if (technique.annotation_as_int(annotation_key::toggle) != 0)
 			preset.set({}, "Key" + unique_name, 0); // Overwrite default toggle key to none
 		else
 			preset.remove_key({}, "Key" + unique_name);
@@ -1729,115 +2182,271 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 		if (filter_text = filter_path.filename(); !filter_text.empty())
 			filter_path = filter_path.parent_path();
 
-	size_t current_preset_index = std::numeric_limits<size_t>::max();
-	std::vector<std::filesystem::path> preset_paths;
+	// Only enumerate the directory again if files in it changed since the last switch
+	_preset_index.update(filter_path);
+
+	std::filesystem::path next_preset_path;
+	if (!_preset_index.find_next(_current_preset_path, filter_text.native(), reversed, next_preset_path))
+		return false; // No valid preset files were found, so nothing more to do
+
+	_current_preset_path = std::move(next_preset_path);
+
+	return true;
+}
+
+void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
+{
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	tm tm; localtime_s(&tm, &t);
+	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
+	if (_screenshot_naming == 1)
+		filename += L' ' + _current_preset_path.stem().wstring();
+
+	filename += postfix;
+	filename += _screenshot_format == 0 ? L".bmp" : _screenshot_format == 1 ? L".png" : L".jpg";
+
+	std::filesystem::path screenshot_path = g_reshade_base_path / _screenshot_path / filename;
+
+	LOG(INFO) << "Saving screenshot to " << screenshot_path << " ...";
+
+	screenshot_writer::job job;
+	job.path = screenshot_path;
+	job.width = _width;
+	job.height = _height;
+	job.format = _screenshot_format;
+	job.jpeg_quality = _screenshot_jpeg_quality;
+	job.clear_alpha = _screenshot_clear_alpha;
+	if (_screenshot_include_preset && should_save_preset)
+		job.preset_path = _current_preset_path;
+
+	// Only capture the pixel data here, encoding and writing the file happens on a background thread (see 'update_screenshot_status')
+	job.pixels = _screenshot_writer.acquire_buffer(_width * _height * 4);
+	if (capture_screenshot(job.pixels.data()) && _screenshot_writer.submit(std::move(job)))
+		return;
+
+	_screenshot_save_success = false;
+	_last_screenshot_file = screenshot_path;
+	_last_screenshot_time = std::chrono::high_resolution_clock::now();
 
-	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
+}
+void reshade::runtime::update_screenshot_status()
+{
+	for (screenshot_writer::job job; _screenshot_writer.poll_finished(job);)
 	{
-		// Skip anything that is not a valid preset file
-		if (!resolve_preset_path(preset_path))
-			continue;
+		_screenshot_save_success = job.success;
+		_last_screenshot_file = job.path;
+		_last_screenshot_time = std::chrono::high_resolution_clock::now();
 
-		// Keep track of the index of the current preset in the list of found preset files that is being build
-		if (std::filesystem::equivalent(preset_path, _current_preset_path, ec)) {
-			current_preset_index = preset_paths.size();
-			preset_paths.push_back(std::move(preset_path));
-			continue;
+		if (!_screenshot_save_success)
+		{
+			LOG(ERROR) << "Failed to write screenshot to " << job.path << '!';
+		}
+		else if (!job.preset_path.empty() && ini_file::flush_cache(job.preset_path))
+		{
+			// Preset was flushed to disk, so can just copy it over to the new location
+			std::error_code ec; std::filesystem::copy_file(job.preset_path, job.path.replace_extension(L".ini"), std::filesystem::copy_options::overwrite_existing, ec);
 		}
+	}
 
-		const std::wstring preset_name = preset_path.stem();
-		// Only add those files that are matching the filter text
-		if (filter_text.empty() || std::search(preset_name.begin(), preset_name.end(), filter_text.native().begin(), filter_text.native().end(),
-			[](wchar_t c1, wchar_t c2) { return towlower(c1) == towlower(c2); }) != preset_name.end())
-			preset_paths.push_back(std::move(preset_path));
+	if (_screenshot_sequence_active && !_screenshot_sequence.is_capturing() && _screenshot_sequence_readbacks.empty() && !_screenshot_sequence.is_writing())
+	{
+		_screenshot_sequence_active = false;
+		_screenshot_sequence.finish();
+
+		const capture_sequence::statistics stats = _screenshot_sequence.get_statistics();
+		if (stats.frames_failed != 0)
+			LOG(ERROR) << "Failed to write " << stats.frames_failed << " frames of screenshot sequence to " << _screenshot_sequence.path() << '!';
+		LOG(INFO) << "Finished writing screenshot sequence to " << _screenshot_sequence.path() << " (" << stats.frames_written << " frames written, " << stats.frames_dropped << " frames dropped).";
+	}
+}
+void reshade::runtime::toggle_screenshot_sequence()
+{
+	if (_screenshot_sequence.is_capturing())
+	{
+		_screenshot_sequence.stop();
+		return; // Remaining frames are finished in 'update_screenshot_status'
 	}
 
-	if (preset_paths.begin() == preset_paths.end())
-		return false; // No valid preset files were found, so nothing more to do
+	// Frames of the previous sequence that are still being copied have to be written to that one, so cannot start a new sequence yet
+	if (!_screenshot_sequence_readbacks.empty())
+		return;
+
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	tm tm; localtime_s(&tm, &t);
+	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path sequence_path = g_reshade_base_path / _screenshot_path / g_target_executable_path.stem().concat(timestamp);
 
-	if (current_preset_index == std::numeric_limits<size_t>::max())
+	capture_sequence::settings settings;
+	settings.frame_count = _screenshot_sequence_length;
+	settings.frame_interval = _screenshot_sequence_interval;
+	settings.delta_encoding = _screenshot_sequence_delta;
+	settings.image_format = _screenshot_format;
+	settings.jpeg_quality = _screenshot_jpeg_quality;
+	settings.clear_alpha = _screenshot_clear_alpha;
+
+	if (!_screenshot_sequence.start(sequence_path, _width, _height, settings))
 	{
-		// Current preset was not in the container path, so just use the first or last file
-		if (reversed)
-			_current_preset_path = preset_paths.back();
-		else
-			_current_preset_path = preset_paths.front();
+		_screenshot_save_success = false;
+		_last_screenshot_file = sequence_path;
+		_last_screenshot_time = std::chrono::high_resolution_clock::now();
+
+		LOG(ERROR) << "Failed to start screenshot sequence at " << sequence_path << '!';
+		return;
 	}
-	else
+
+	_screenshot_sequence_active = true;
+
+	LOG(INFO) << "Recording screenshot sequence of " << _screenshot_sequence_length << " frames to " << _screenshot_sequence.path() << " ...";
+}
+void reshade::runtime::update_screenshot_sequence()
+{
+	// Queue frames whose copy has finished on the GPU for writing, oldest first and without waiting for the others
+	while (!_screenshot_sequence_readbacks.empty())
 	{
-		// Current preset was found in the container path, so use the file before or after it
-		if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
-			_current_preset_path = it == preset_paths.begin() ? preset_paths.back() : *--it;
+		sequence_readback &readback = _screenshot_sequence_readbacks.front();
+
+		const readback_status status = finish_frame_readback(readback.slot, readback.pixels.data());
+		if (status == readback_status::pending)
+			break;
+
+		if (status == readback_status::available)
+			_screenshot_sequence.submit_frame(readback.frame_index, std::move(readback.pixels));
 		else
-			_current_preset_path = it == std::prev(preset_paths.end()) ? preset_paths.front() : *++it;
+			_screenshot_sequence.drop_frame();
+
+		_screenshot_sequence_readbacks.pop_front();
 	}
 
-	return true;
+	if (!_screenshot_sequence.next_frame())
+		return;
+
+	// Drop the frame rather than stalling the application if the GPU is too far behind
+	if (_screenshot_sequence_readbacks.size() >= NUM_READBACK_SLOTS)
+	{
+		_screenshot_sequence.drop_frame();
+		return;
+	}
+
+	std::vector<uint8_t> pixels = _screenshot_sequence.acquire_frame_buffer();
+
+	// Copies finish in order, so the slot after the last one that is in flight is always free
+	if (begin_frame_readback(_next_readback_slot))
+	{
+		_screenshot_sequence_readbacks.push_back({ _next_readback_slot, _screenshot_sequence.frame_index(), std::move(pixels) });
+		_next_readback_slot = (_next_readback_slot + 1) % NUM_READBACK_SLOTS;
+		return;
+	}
+
+	// Fall back to a synchronous copy if the runtime does not support asynchronous ones
+	if (capture_screenshot(pixels.data()))
+		_screenshot_sequence.submit_frame(_screenshot_sequence.frame_index(), std::move(pixels));
+	else
+		_screenshot_sequence.drop_frame();
 }
 
-void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
+bool reshade::runtime::export_timing_statistics() const
 {
 	char timestamp[21];
 	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 	tm tm; localtime_s(&tm, &t);
 	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
 
-	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
-	if (_screenshot_naming == 1)
-		filename += L' ' + _current_preset_path.stem().wstring();
+	// Put the files next to the log file, which has the same name as the ReShade DLL
+	const std::filesystem::path base_path = g_reshade_base_path / g_reshade_dll_path.stem().concat(L" timings").concat(timestamp);
 
-	filename += postfix;
-	filename += _screenshot_format == 0 ? L".bmp" : _screenshot_format == 1 ? L".png" : L".jpg";
+	std::ofstream csv(std::filesystem::path(base_path).concat(L".csv"), std::ios::trunc);
+	std::ofstream json(std::filesystem::path(base_path).concat(L".json"), std::ios::trunc);
+	if (!csv || !json)
+	{
+		LOG(ERROR) << "Failed to open " << base_path << " for writing timing statistics!";
+		return false;
+	}
 
-	std::filesystem::path screenshot_path = g_reshade_base_path / _screenshot_path / filename;
+	csv << "name,kind,samples,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+	json << "{\n\t\"frames\": " << _framecount << ",\n";
 
-	LOG(INFO) << "Saving screenshot to " << screenshot_path << " ...";
+	const auto write_histogram = [&csv, &json](const std::string &name, const char *kind, const duration_histogram &histogram, const char *json_indent) {
+		char values[256];
+		sprintf_s(values, "%llu,%.3f,%.3f,%.3f,%.3f,%.3f",
+			histogram.count(), histogram.mean() * 1e-6, histogram.percentile(0.50) * 1e-6, histogram.percentile(0.95) * 1e-6, histogram.percentile(0.99) * 1e-6, histogram.max() * 1e-6);
+
+		// Quote the name in case it contains a comma, which requires doubling any quotes in it
+		std::string quoted_name = name;
+		for (size_t i = 0; (i = quoted_name.find('"', i)) != std::string::npos; i += 2)
+			quoted_name.insert(i, 1, '"');
+		csv << '"' << quoted_name << "\"," << kind << ',' << values << '\n';
+
+		sprintf_s(values, "{ \"samples\": %llu, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f }",
+			histogram.count(), histogram.mean() * 1e-6, histogram.percentile(0.50) * 1e-6, histogram.percentile(0.95) * 1e-6, histogram.percentile(0.99) * 1e-6, histogram.max() * 1e-6);
+		json << json_indent << '"' << kind << "\": " << values;
+	};
 
-	_screenshot_save_success = false; // Default to a save failure unless it is reported to succeed below
+	write_histogram("Frame", "frame_time", _frame_time_histogram, "\t");
+	json << ",\n\t\"techniques\": [";
 
-	if (std::vector<uint8_t> data(_width * _height * 4); capture_screenshot(data.data()))
+	bool first_technique = true;
+	for (const technique &technique : _techniques)
 	{
-		// Clear alpha channel
-		// The alpha channel doesn't need to be cleared if we're saving a JPEG, stbi ignores it
-		if (_screenshot_clear_alpha && _screenshot_format != 2)
-			for (uint32_t h = 0; h < _height; ++h)
-				for (uint32_t w = 0; w < _width; ++w)
-					data[(h * _width + w) * 4 + 3] = 0xFF;
+		if (technique.cpu_duration_histogram.count() == 0)
+			continue; // Skip techniques that were never rendered
+
+		std::string escaped_name = technique.unique_name;
+		for (size_t i = 0; (i = escaped_name.find_first_of("\"\\", i)) != std::string::npos; i += 2)
+			escaped_name.insert(i, 1, '\\');
+
+		json << (first_technique ? "\n" : ",\n") << "\t\t{\n\t\t\t\"name\": \"" << escaped_name << "\",\n";
+		write_histogram(technique.unique_name, "cpu", technique.cpu_duration_histogram, "\t\t\t");
+		json << ",\n";
+		write_histogram(technique.unique_name, "gpu", technique.gpu_duration_histogram, "\t\t\t");
 
-		if (FILE *file; _wfopen_s(&file, screenshot_path.c_str(), L"wb") == 0)
+		if (!technique.pass_timings.empty())
 		{
-			const auto write_callback = [](void *context, void *data, int size) {
-				fwrite(data, 1, size, static_cast<FILE *>(context));
-			};
+			json << ",\n\t\t\t\"passes\": [";
 
-			switch (_screenshot_format)
+			for (size_t pass_index = 0; pass_index < technique.pass_timings.size(); ++pass_index)
 			{
-			case 0:
-				_screenshot_save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, 4, data.data()) != 0;
-				break;
-			case 1:
-				_screenshot_save_success = stbi_write_png_to_func(write_callback, file, _width, _height, 4, data.data(), 0) != 0;
-				break;
-			case 2:
-				_screenshot_save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, 4, data.data(), _screenshot_jpeg_quality) != 0;
-				break;
+				const std::string pass_name = technique.passes[pass_index].name.empty() ? "Pass " + std::to_string(pass_index) : technique.passes[pass_index].name;
+
+				json << (pass_index == 0 ? "\n" : ",\n") << "\t\t\t\t{\n\t\t\t\t\t\"name\": \"" << pass_name << "\",\n";
+				write_histogram(technique.unique_name + " / " + pass_name, "gpu", technique.pass_timings[pass_index].gpu_duration_histogram, "\t\t\t\t\t");
+				json << "\n\t\t\t\t}";
 			}
 
-			fclose(file);
+			json << "\n\t\t\t]";
 		}
+
+		json << "\n\t\t}";
+
+		first_technique = false;
 	}
 
-	_last_screenshot_file = screenshot_path;
-	_last_screenshot_time = std::chrono::high_resolution_clock::now();
+	json << (first_technique ? "]\n}\n" : "\n\t]\n}\n");
 
-	if (!_screenshot_save_success)
+	if (!csv || !json)
 	{
-		LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
+		LOG(ERROR) << "Failed to write timing statistics to " << base_path << '!';
+		return false;
 	}
-	else if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
+
+	LOG(INFO) << "Wrote timing statistics of " << _frame_time_histogram.count() << " frames to " << base_path << " (.csv and .json).";
+	return true;
+}
+void reshade::runtime::reset_timing_statistics()
+{
+	_frame_time_histogram.clear();
+
+	for (technique &technique : _techniques)
 	{
-		// Preset was flushed to disk, so can just copy it over to the new location
-		std::error_code ec; std::filesystem::copy_file(_current_preset_path, screenshot_path.replace_extension(L".ini"), std::filesystem::copy_options::overwrite_existing, ec);
+		technique.cpu_duration_histogram.clear();
+		technique.gpu_duration_histogram.clear();
+		for (auto &pass_timing : technique.pass_timings)
+			pass_timing.gpu_duration_histogram.clear();
 	}
 }
 
@@ -11,16 +11,21 @@
 #include <chrono>
 #include <functional>
 #include <filesystem>
+#include "screenshot_writer.hpp"
+#include "capture_sequence.hpp"
+#include "preset_index.hpp"
+#include "duration_histogram.hpp"
+#include "effect_budget_controller.hpp"
 
 #if RESHADE_GUI
+#include "dll_log.hpp"
 #include "imgui_editor.hpp"
+#include "search_index.hpp"
 
 struct ImDrawData;
 struct ImGuiContext;
 #endif
 
-extern volatile long g_network_traffic;
-
 namespace reshade
 {
 	class ini_file; // Forward declarations to avoid excessive #include
@@ -28,6 +33,7 @@ namespace reshade
 	struct uniform;
 	struct texture;
 	struct technique;
+	struct preset_plan;
 
 	/// <summary>
 	/// Platform independent base class for the main ReShade runtime.
@@ -226,6 +232,34 @@ namespace reshade
 		virtual void render_imgui_draw_data(ImDrawData *draw_data) = 0;
 #endif
 
+		/// <summary>
+		/// Status of a copy of the frame image to system memory that was started with <see cref="begin_frame_readback"/>.
+		/// </summary>
+		enum class readback_status
+		{
+			pending,
+			available,
+			failed
+		};
+
+		/// <summary>
+		/// Number of copies of the frame image to system memory that can be in flight at the same time.
+		/// </summary>
+		static constexpr uint32_t NUM_READBACK_SLOTS = 4;
+
+		/// <summary>
+		/// Start copying the current frame image to a staging resource in system memory, without waiting for the GPU to finish it.
+		/// Runtimes that do not support this return <c>false</c>, in which case <see cref="capture_screenshot"/> is used instead.
+		/// </summary>
+		/// <param name="slot">The index of the staging resource to copy to, less than <see cref="NUM_READBACK_SLOTS"/>. Any earlier copy to it was finished already.</param>
+		virtual bool begin_frame_readback(uint32_t /* slot */) { return false; }
+		/// <summary>
+		/// Retrieve the frame image of a copy started with <see cref="begin_frame_readback"/>, if the GPU has finished it. This never waits.
+		/// </summary>
+		/// <param name="slot">The index of the staging resource that was passed to <see cref="begin_frame_readback"/>.</param>
+		/// <param name="buffer">The 32bpp RGBA buffer to save the frame image to.</param>
+		virtual readback_status finish_frame_readback(uint32_t /* slot */, uint8_t * /* buffer */) { return readback_status::failed; }
+
 		/// <summary>
 		/// Returns the texture object corresponding to the passed <paramref name="unique_name"/>.
 		/// </summary>
@@ -274,6 +308,20 @@ namespace reshade
 		/// </summary>
 		/// <param name="technique"></param>
 		void disable_technique(technique &technique);
+		/// <summary>
+		/// Suspend or resume techniques based on their recent durations, so that the total duration of all enabled techniques stays within the effect budget.
+		/// </summary>
+		void update_effect_budget();
+		/// <summary>
+		/// Resume all techniques that were suspended to stay within the effect budget.
+		/// </summary>
+		void resume_suspended_techniques();
+
+		/// <summary>
+		/// Let render targets that are only used temporarily within a single technique share their texture with others of the same description that are not in use at the same time.
+		/// Must be called after effects were loaded, but before any of their textures were created.
+		/// </summary>
+		void alias_transient_textures();
 
 		/// <summary>
 		/// Load user configuration from disk.
@@ -285,6 +333,10 @@ namespace reshade
 		/// </summary>
 		void load_current_preset();
 		/// <summary>
+		/// Translate the preset at the path of the specified <paramref name="plan"/> into the data it applies to the currently loaded effects.
+		/// </summary>
+		void build_preset_plan(preset_plan &plan);
+		/// <summary>
 		/// Save the current value configuration to the currently selected preset.
 		/// </summary>
 		void save_current_preset() const;
@@ -298,9 +350,31 @@ namespace reshade
 		bool switch_to_next_preset(std::filesystem::path filter_path, bool reversed = false);
 
 		/// <summary>
-		/// Create a copy of the current frame and write it to an image file on disk.
+		/// Create a copy of the current frame and queue it to be written to an image file on disk.
 		/// </summary>
 		void save_screenshot(const std::wstring &postfix = std::wstring(), bool should_save_preset = false);
+		/// <summary>
+		/// Update the screenshot status with the results of screenshots that finished saving in the background.
+		/// </summary>
+		void update_screenshot_status();
+		/// <summary>
+		/// Start recording a screenshot sequence with the current settings, or stop the one that is currently being recorded.
+		/// </summary>
+		void toggle_screenshot_sequence();
+		/// <summary>
+		/// Start copying the current frame if it is part of the screenshot sequence and queue those copies that finished for writing.
+		/// </summary>
+		void update_screenshot_sequence();
+
+		/// <summary>
+		/// Write percentiles of the frame time and of the CPU and GPU duration of each technique to CSV and JSON files next to the log file.
+		/// </summary>
+		/// <returns><c>true</c> if both files were written successfully, <c>false</c> otherwise.</returns>
+		bool export_timing_statistics() const;
+		/// <summary>
+		/// Discard all durations recorded so far in the frame time and technique duration histograms.
+		/// </summary>
+		void reset_timing_statistics();
 
 		// === Status ===
 		bool _effects_enabled = true;
@@ -311,6 +385,9 @@ namespace reshade
 		std::chrono::high_resolution_clock::duration _last_frame_duration;
 		std::chrono::high_resolution_clock::time_point _start_time;
 		std::chrono::high_resolution_clock::time_point _last_present_time;
+		duration_histogram _frame_time_histogram;
+		float _effect_budget = 0.0f; // Maximum post-processing duration in milliseconds, or zero to render all enabled techniques regardless of their cost
+		effect_budget_controller _effect_budget_controller;
 
 		// == Configuration ===
 		bool _needs_update = false;
@@ -324,6 +401,8 @@ namespace reshade
 		bool _no_effect_cache = false;
 		bool _no_reload_on_init = false;
 		bool _effect_load_skipping = false;
+		bool _alias_transient_textures = false;
+		size_t _num_texture_aliases = 0; // Used to generate unique names for textures that are shared between effects because of aliasing
 		bool _load_option_disable_skipping = false;
 		std::atomic<int> _last_reload_successfull = true;
 		bool _last_texture_reload_successfull = true;
@@ -355,6 +434,17 @@ namespace reshade
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
 		unsigned int _screenshot_jpeg_quality = 90;
+		thread_pool _screenshot_thread_pool;
+		screenshot_writer _screenshot_writer;
+		unsigned int _screenshot_sequence_key_data[4];
+		unsigned int _screenshot_sequence_length = 60;
+		unsigned int _screenshot_sequence_interval = 1;
+		bool _screenshot_sequence_delta = false;
+		bool _screenshot_sequence_active = false;
+		capture_sequence _screenshot_sequence;
+		struct sequence_readback { uint32_t slot; uint32_t frame_index; std::vector<uint8_t> pixels; };
+		std::deque<sequence_readback> _screenshot_sequence_readbacks;
+		uint32_t _next_readback_slot = 0;
 
 		// === Preset Switching ===
 		bool _preset_save_success = true;
@@ -364,6 +454,8 @@ namespace reshade
 		unsigned int _preset_transition_delay = 1000;
 		std::filesystem::path _current_preset_path;
 		std::chrono::high_resolution_clock::time_point _last_preset_switching_time;
+		std::vector<preset_plan> _preset_plans;
+		preset_index _preset_index;
 
 #if RESHADE_GUI
 		struct editor_instance
@@ -397,6 +489,8 @@ namespace reshade
 		void open_code_editor(editor_instance &instance);
 		void draw_code_editor(editor_instance &instance);
 
+		void update_effect_search_index();
+
 		// === User Interface ===
 		ImGuiContext *_imgui_context = nullptr;
 		std::unique_ptr<texture> _imgui_font_atlas;
@@ -444,12 +538,21 @@ namespace reshade
 
 		// === User Interface - Log ===
 		bool _log_wordwrap = false;
-		uintmax_t _last_log_size;
-		std::vector<std::string> _log_lines;
+		bool _log_show_levels[4] = { true, true, true, true }; // Indexed by log level minus one
+		uint64_t _log_next_index = 0;
+		std::vector<log::entry> _log_entries;
+		std::vector<size_t> _log_filtered_entries; // Indices into '_log_entries' of the lines that pass the current filters
 
 		// === User Interface - Code Editor ===
 		std::vector<editor_instance> _editors;
 		uint32_t _editor_palette[gui::code_editor::color_palette_max];
+		search_index _editor_search_index;
+		bool _editor_search_index_outdated = true;
+		unsigned int _editor_search_key_data[4];
+		unsigned int _editor_definition_key_data[4];
+		char _editor_search_text[256] = "";
+		std::vector<search_index::match> _editor_search_results;
+		size_t _editor_search_goto = std::numeric_limits<size_t>::max();
 #endif
 	};
 }
@@ -13,6 +13,7 @@
 #include "runtime_objects.hpp"
 #include "input.hpp"
 #include "imgui_widgets.hpp"
+#include "windows/ws2_32.hpp"
 #include "fonts/forkawesome.inl"
 #include <fstream>
 #include <algorithm>
@@ -36,6 +37,16 @@ void reshade::runtime::init_gui()
 	_overlay_key_data[2] = false;
 	_overlay_key_data[3] = false;
 
+	// Default shortcuts: Ctrl + Shift + F and F12
+	_editor_search_key_data[0] = 'F';
+	_editor_search_key_data[1] = true;
+	_editor_search_key_data[2] = true;
+	_editor_search_key_data[3] = false;
+	_editor_definition_key_data[0] = 0x7B; // VK_F12
+	_editor_definition_key_data[1] = false;
+	_editor_definition_key_data[2] = false;
+	_editor_definition_key_data[3] = false;
+
 	_imgui_context = ImGui::CreateContext();
 	auto &imgui_io = _imgui_context->IO;
 	auto &imgui_style = _imgui_context->Style;
@@ -82,6 +93,8 @@ void reshade::runtime::init_gui()
 
 	_load_config_callables.push_back([this, &imgui_io, &imgui_style](const ini_file &config) {
 		config.get("INPUT", "KeyOverlay", _overlay_key_data);
+		config.get("INPUT", "KeyEditorSearch", _editor_search_key_data);
+		config.get("INPUT", "KeyEditorGoToDefinition", _editor_definition_key_data);
 		config.get("INPUT", "InputProcessing", _input_processing_mode);
 
 		config.get("OVERLAY", "ClockFormat", _clock_format);
@@ -125,6 +138,8 @@ void reshade::runtime::init_gui()
 	});
 	_save_config_callables.push_back([this, &imgui_io, &imgui_style](ini_file &config) {
 		config.set("INPUT", "KeyOverlay", _overlay_key_data);
+		config.set("INPUT", "KeyEditorSearch", _editor_search_key_data);
+		config.set("INPUT", "KeyEditorGoToDefinition", _editor_definition_key_data);
 		config.set("INPUT", "InputProcessing", _input_processing_mode);
 
 		config.set("OVERLAY", "ClockFormat", _clock_format);
@@ -530,7 +545,9 @@ void reshade::runtime::draw_gui()
 	// Do not show this message in the same frame the screenshot is taken (so that it won't show up on the UI screenshot)
 	const bool show_screenshot_message = (_show_screenshot_message || !_screenshot_save_success) && !_should_save_screenshot && (_last_present_time - _last_screenshot_time) < std::chrono::seconds(_screenshot_save_success ? 3 : 5);
 
-	if (show_screenshot_message || !_preset_save_success || (!_show_overlay && _tutorial_index == 0))
+	const bool show_sequence_message = _screenshot_sequence_active;
+
+	if (show_screenshot_message || show_sequence_message || !_preset_save_success || (!_show_overlay && _tutorial_index == 0))
 		show_splash = true;
 	const bool show_stats_window = _show_clock || _show_fps || _show_frametime;
 
@@ -610,6 +627,16 @@ void reshade::runtime::draw_gui()
 		{
 			ImGui::TextColored(COLOR_RED, "Unable to save current preset. Make sure you have write permissions to %s.", _current_preset_path.u8string().c_str());
 		}
+		else if (show_sequence_message)
+		{
+			const capture_sequence::statistics stats = _screenshot_sequence.get_statistics();
+			if (_screenshot_sequence.is_capturing())
+				ImGui::Text("Recording screenshot sequence to %s (%u of %u frames) ...", _screenshot_sequence.path().u8string().c_str(), stats.frames_captured + stats.frames_dropped, _screenshot_sequence_length);
+			else
+				ImGui::Text("Writing screenshot sequence to %s (%u of %u frames) ...", _screenshot_sequence.path().u8string().c_str(), stats.frames_written + stats.frames_failed, stats.frames_captured);
+			if (stats.frames_dropped != 0)
+				ImGui::TextColored(COLOR_YELLOW, "%u frames were dropped because they could not be written fast enough.", stats.frames_dropped);
+		}
 		else if (show_screenshot_message)
 		{
 			if (!_screenshot_save_success)
@@ -807,6 +834,33 @@ void reshade::runtime::draw_gui()
 			ImGui::End();
 		}
 
+		// Open the file containing the search result that was selected in the code editor
+		if (_editor_search_goto < _editor_search_results.size() && !_effects.empty())
+		{
+			const search_index::match &result = _editor_search_results[_editor_search_goto];
+
+			// Associate file with an effect that references it, so that its errors are shown
+			size_t effect_index = 0;
+			for (size_t i = 0; i < _effects.size(); ++i)
+			{
+				if (_effects[i].source_file == result.file_path ||
+					std::find(_effects[i].included_files.begin(), _effects[i].included_files.end(), result.file_path) != _effects[i].included_files.end())
+				{
+					effect_index = i;
+					break;
+				}
+			}
+
+			open_code_editor(effect_index, result.file_path);
+
+			if (const auto it = std::find_if(_editors.begin(), _editors.end(),
+				[&result](const editor_instance &instance) { return instance.file_path == result.file_path && instance.entry_point_name.empty(); });
+				it != _editors.end())
+				it->editor.scroll_to(gui::code_editor::text_pos(result.line, result.column), strlen(_editor_search_text));
+
+			_editor_search_goto = std::numeric_limits<size_t>::max();
+		}
+
 		if (!_editors.empty())
 		{
 			if (ImGui::Begin("Edit###editor", nullptr, ImGuiWindowFlags_NoFocusOnAppearing) &&
@@ -1080,7 +1134,7 @@ void reshade::runtime::draw_gui_home()
 	{
 		std::string texture_list;
 		for (const texture &tex : _textures)
-			if (tex.impl != nullptr && !tex.loaded && !tex.annotation_as_string("source").empty())
+			if (tex.impl != nullptr && !tex.loaded && !tex.annotation_as_string(annotation_key::source).empty())
 				texture_list += ' ' + tex.unique_name + ',';
 
 		if (texture_list.empty())
@@ -1104,11 +1158,11 @@ void reshade::runtime::draw_gui_home()
 
 			for (technique &technique : _techniques)
 			{
-				std::string_view label = technique.annotation_as_string("ui_label");
+				std::string_view label = technique.annotation_as_string(annotation_key::ui_label);
 				if (label.empty())
 					label = technique.name;
 
-				technique.hidden = technique.annotation_as_int("hidden") != 0 || (
+				technique.hidden = technique.annotation_as_int(annotation_key::hidden) != 0 || (
 					!filter_view.empty() && // Reset visibility state if filter is empty
 					std::search(label.begin(), label.end(), filter_view.begin(), filter_view.end(), // Search case insensitive
 						[](const char c1, const char c2) { return (('a' <= c1 && c1 <= 'z') ? static_cast<char>(c1 - ' ') : c1) == (('a' <= c2 && c2 <= 'z') ? static_cast<char>(c2 - ' ') : c2); }) == label.end());
@@ -1138,10 +1192,10 @@ void reshade::runtime::draw_gui_home()
 				[](const reshade::technique &a) { return a.enabled || a.toggle_key_data[0] != 0; }); it != _techniques.end())
 			{
 				std::stable_sort(it, _techniques.end(), [](const reshade::technique &lhs, const reshade::technique &rhs) {
-						std::string lhs_label(lhs.annotation_as_string("ui_label"));
+						std::string lhs_label(lhs.annotation_as_string(annotation_key::ui_label));
 						if (lhs_label.empty()) lhs_label = lhs.name;
 						std::transform(lhs_label.begin(), lhs_label.end(), lhs_label.begin(), [](char c) { return static_cast<char>(toupper(c)); });
-						std::string rhs_label(rhs.annotation_as_string("ui_label"));
+						std::string rhs_label(rhs.annotation_as_string(annotation_key::ui_label));
 						if (rhs_label.empty()) rhs_label = rhs.name;
 						std::transform(rhs_label.begin(), rhs_label.end(), rhs_label.begin(), [](char c) { return static_cast<char>(toupper(c)); });
 						return lhs_label < rhs_label;
@@ -1325,6 +1379,9 @@ void reshade::runtime::draw_gui_settings()
 		ImGui::SameLine(0, inner_spacing);
 		ImGui::TextUnformatted("Preset switching keys");
 
+		modified |= widgets::key_input_box("Editor search key", _editor_search_key_data, *_input);
+		modified |= widgets::key_input_box("Editor go to definition key", _editor_definition_key_data, *_input);
+
 		modified |= ImGui::SliderInt("Preset transition delay", reinterpret_cast<int *>(&_preset_transition_delay), 0, 10 * 1000);
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Makes a smooth transition, but only for floating point values.\nRecommended for multiple presets that contain the same effects, otherwise set this to zero.\nValues are in milliseconds.");
@@ -1334,6 +1391,20 @@ void reshade::runtime::draw_gui_settings()
 			"Block input when cursor is on overlay\0"
 			"Block all input when overlay is visible\0");
 
+		if (ImGui::SliderFloat("Effect budget", &_effect_budget, 0.0f, 33.0f, _effect_budget > 0 ? "%.1f ms" : "Off"))
+		{
+			modified = true;
+
+			if (_effect_budget > 0)
+				_effect_budget_controller.reset();
+			else
+				resume_suspended_techniques();
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Suspends enabled techniques while post-processing takes longer than this on average and resumes them once there is enough headroom again.\n"
+				"Techniques with a lower \"budget_priority\" annotation and those further down the list are suspended first.\nSet this to zero to always render all enabled techniques.\n\n"
+				"This only has an effect where the GPU duration of techniques is measured (Direct3D 10, Direct3D 11, OpenGL and Vulkan).");
+
 		ImGui::Spacing();
 
 		modified |= widgets::path_list("Effect search paths", _effect_search_paths, _file_selection_path, g_reshade_base_path);
@@ -1348,6 +1419,14 @@ void reshade::runtime::draw_gui_settings()
 			reload_effects();
 		}
 
+		if (ImGui::Checkbox("Share memory between temporary render targets", &_alias_transient_textures))
+		{
+			modified = true;
+			reload_effects();
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Render targets that are only used within a single technique and cleared before anything else accesses them (\"ClearRenderTargets = true\") can share their texture with others of the same size and format.\nThis reduces video memory usage, but an effect may render incorrectly if it relies on the contents of such a render target in a way that cannot be detected.");
+
 		if (ImGui::Button("Clear effect cache", ImVec2(ImGui::CalcItemWidth(), 0)))
 			clear_effect_cache();
 	}
@@ -1372,6 +1451,11 @@ void reshade::runtime::draw_gui_settings()
 		modified |= ImGui::Checkbox("Save current preset file", &_screenshot_include_preset);
 		modified |= ImGui::Checkbox("Save before and after images", &_screenshot_save_before);
 		modified |= ImGui::Checkbox("Save separate image with the overlay visible", &_screenshot_save_ui);
+
+		modified |= widgets::key_input_box("Sequence key", _screenshot_sequence_key_data, *_input);
+		modified |= ImGui::SliderInt("Sequence length", reinterpret_cast<int *>(&_screenshot_sequence_length), 1, 3600, "%d frames");
+		modified |= ImGui::SliderInt("Sequence interval", reinterpret_cast<int *>(&_screenshot_sequence_interval), 1, 60, "Every %d. frame");
+		modified |= ImGui::Checkbox("Write sequence as single lossless delta-encoded file", &_screenshot_sequence_delta);
 	}
 
 	if (ImGui::CollapsingHeader("Overlay & Styling", ImGuiTreeNodeFlags_DefaultOpen))
@@ -1558,6 +1642,9 @@ void reshade::runtime::draw_gui_statistics()
 	{
 		for (const auto &technique : _techniques)
 		{
+			if (technique.suspended)
+				continue; // Averages of suspended techniques are outdated, since they are not rendered
+
 			cpu_digits = std::max(cpu_digits, technique.average_cpu_duration >= 100'000'000 ? 3u : technique.average_cpu_duration >= 10'000'000 ? 2u : 1u);
 			post_processing_time_cpu += technique.average_cpu_duration;
 			gpu_digits = std::max(gpu_digits, technique.average_gpu_duration >= 100'000'000 ? 3u : technique.average_gpu_duration >= 10'000'000 ? 2u : 1u);
@@ -1599,7 +1686,7 @@ void reshade::runtime::draw_gui_statistics()
 			ImGui::TextUnformatted("Unknown");
 		ImGui::TextUnformatted(g_target_executable_path.filename().u8string().c_str());
 		ImGui::Text("%d-%d-%d %d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
-		ImGui::Text("%u B", g_network_traffic);
+		ImGui::Text("%zu B", g_network_traffic.total());
 		ImGui::Text("%.2f fps", _imgui_context->IO.Framerate);
 		ImGui::Text("%*.3f ms CPU", cpu_digits + 4, post_processing_time_cpu * 1e-6f);
 
@@ -1630,7 +1717,9 @@ void reshade::runtime::draw_gui_statistics()
 			if (!technique.enabled)
 				continue;
 
-			if (technique.passes.size() > 1)
+			if (technique.suspended)
+				ImGui::TextDisabled("%s (suspended)", technique.name.c_str());
+			else if (technique.passes.size() > 1)
 				ImGui::Text("%s (%zu passes)", technique.name.c_str(), technique.passes.size());
 			else
 				ImGui::TextUnformatted(technique.name.c_str());
@@ -1665,6 +1754,136 @@ void reshade::runtime::draw_gui_statistics()
 				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, technique.average_gpu_duration * 1e-6f);
 			else
 				ImGui::NewLine();
+
+			if (!technique.pass_timings.empty() && ImGui::IsItemHovered())
+			{
+				ImGui::BeginTooltip();
+				for (size_t pass_index = 0; pass_index < technique.pass_timings.size(); ++pass_index)
+					ImGui::Text("%s: %.3f ms", technique.passes[pass_index].name.empty() ? ("Pass " + std::to_string(pass_index)).c_str() : technique.passes[pass_index].name.c_str(), technique.pass_timings[pass_index].average_gpu_duration * 1e-6f);
+				ImGui::EndTooltip();
+			}
+		}
+
+		ImGui::EndGroup();
+	}
+
+	if (ImGui::CollapsingHeader("Timing Percentiles"))
+	{
+		if (ImGui::Button("Export", ImVec2(ImGui::GetWindowContentRegionWidth() * 0.5f - 5, 0)))
+			export_timing_statistics();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Write the percentiles of all frames and techniques since the last reset to CSV and JSON files next to the log file.");
+		ImGui::SameLine(0, 10);
+		if (ImGui::Button("Reset", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+			reset_timing_statistics();
+
+		// Technique list is modified while effects are loading, so only show the frame time then
+		const bool show_techniques = !is_loading() && _effects_enabled;
+
+		const auto draw_percentiles = [](const duration_histogram &histogram, const char *suffix) {
+			if (histogram.count() == 0)
+			{
+				ImGui::NewLine();
+				return;
+			}
+
+			ImGui::Text("%.2f | %.2f | %.2f ms%s", histogram.percentile(0.50) * 1e-6f, histogram.percentile(0.95) * 1e-6f, histogram.percentile(0.99) * 1e-6f, suffix);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("p50 | p95 | p99\nMax: %.3f ms\nMean: %.3f ms\nSamples: %llu", histogram.max() * 1e-6f, histogram.mean() * 1e-6f, histogram.count());
+		};
+
+		ImGui::BeginGroup();
+
+		ImGui::TextUnformatted("Frame time");
+		for (const auto &technique : _techniques)
+		{
+			if (!show_techniques || !technique.enabled)
+				continue;
+
+			ImGui::TextUnformatted(technique.name.c_str());
+
+			// Passes are only listed when the backend measured each of them separately
+			for (size_t pass_index = 0; pass_index < technique.pass_timings.size(); ++pass_index)
+				if (technique.passes[pass_index].name.empty())
+					ImGui::Text("  Pass %zu", pass_index);
+				else
+					ImGui::Text("  %s", technique.passes[pass_index].name.c_str());
+		}
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+
+		draw_percentiles(_frame_time_histogram, "");
+		for (const auto &technique : _techniques)
+		{
+			if (!show_techniques || !technique.enabled)
+				continue;
+
+			draw_percentiles(technique.cpu_duration_histogram, " CPU");
+
+			for (size_t pass_index = 0; pass_index < technique.pass_timings.size(); ++pass_index)
+				ImGui::NewLine(); // There are no CPU timings per pass
+		}
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+		ImGui::BeginGroup();
+
+		ImGui::NewLine();
+		for (const auto &technique : _techniques)
+		{
+			if (!show_techniques || !technique.enabled)
+				continue;
+
+			draw_percentiles(technique.gpu_duration_histogram, " GPU"); // GPU timings are not available for all APIs
+
+			for (const auto &pass_timing : technique.pass_timings)
+				draw_percentiles(pass_timing.gpu_duration_histogram, " GPU");
+		}
+
+		ImGui::EndGroup();
+	}
+
+	if (ImGui::CollapsingHeader("Effect Compilation") && !is_loading())
+	{
+		ImGui::BeginGroup();
+
+		for (const effect &effect : _effects)
+		{
+			if (!effect.compiled)
+				continue;
+
+			ImGui::TextUnformatted(effect.source_file.filename().u8string().c_str());
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("%zu tokens, %zu macro expansions, %zu includes", effect.statistics.num_tokens, effect.statistics.num_macro_expansions, effect.statistics.num_includes);
+		}
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+
+		for (const effect &effect : _effects)
+		{
+			if (!effect.compiled)
+				continue;
+
+			const reshadefx::compile_statistics &stats = effect.statistics;
+			ImGui::Text("%8.3f ms", stats.total_time() * 1e-3f);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Preprocess: %.3f ms\nParse: %.3f ms\nWrite result: %.3f ms", stats.preprocess_time * 1e-3f, stats.parse_time * 1e-3f, stats.write_result_time * 1e-3f);
+		}
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+		ImGui::BeginGroup();
+
+		for (const effect &effect : _effects)
+		{
+			if (!effect.compiled)
+				continue;
+
+			ImGui::Text("%zu symbols | %zu instructions", effect.statistics.num_symbols, effect.statistics.num_instructions);
 		}
 
 		ImGui::EndGroup();
@@ -1877,59 +2096,107 @@ void reshade::runtime::draw_gui_statistics()
 }
 void reshade::runtime::draw_gui_log()
 {
-	const std::filesystem::path log_path =
-		g_reshade_base_path / g_reshade_dll_path.filename().replace_extension(L".log");
-
 	if (ImGui::Button("Clear Log"))
+	{
 		// Close and open the stream again, which will clear the file too
-		log::open_log_file(log_path);
+		log::open_log_file(g_reshade_base_path / g_reshade_dll_path.filename().replace_extension(L".log"));
+		log::clear_history();
+
+		_log_entries.clear();
+		_log_filtered_entries.clear();
+	}
 
 	ImGui::SameLine();
 	ImGui::Checkbox("Word Wrap", &_log_wordwrap);
+
+	bool filter_changed = false;
+	const char *const level_names[] = { "Errors", "Warnings", "Info", "Debug" };
+	for (size_t i = 0; i < std::size(level_names); ++i)
+	{
+		ImGui::SameLine();
+		filter_changed |= ImGui::Checkbox(level_names[i], &_log_show_levels[i]);
+	}
+
 	ImGui::SameLine();
 
 	static ImGuiTextFilter filter; // TODO: Better make this a member of the runtime class, in case there are multiple instances.
-	const bool filter_changed = filter.Draw("Filter (inc, -exc)", -150);
+	filter_changed |= filter.Draw("Filter (inc, -exc)", -150);
 
-	if (ImGui::BeginChild("log", ImVec2(0, 0), true, _log_wordwrap ? 0 : ImGuiWindowFlags_AlwaysHorizontalScrollbar))
+	// Only fetch the lines that were added since the last frame, rather than reading the whole log again
+	size_t num_previous_entries = _log_entries.size();
+	_log_next_index = log::read_history(_log_next_index, _log_entries);
+
+	// Limit number of log lines kept around, to avoid the memory footprint growing over the whole session
+	const size_t line_limit = 4096;
+	if (_log_entries.size() > line_limit)
 	{
-		// Limit number of log lines to read, to avoid stalling when log gets too big
-		const size_t line_limit = 1000;
+		const size_t num_dropped_entries = _log_entries.size() - line_limit;
+		_log_entries.erase(_log_entries.begin(), _log_entries.begin() + num_dropped_entries);
+		num_previous_entries -= std::min(num_previous_entries, num_dropped_entries);
+
+		// Filtered indices are sorted, so the dropped lines are all at the front
+		_log_filtered_entries.erase(_log_filtered_entries.begin(), std::lower_bound(_log_filtered_entries.begin(), _log_filtered_entries.end(), num_dropped_entries));
+		for (size_t &index : _log_filtered_entries)
+			index -= num_dropped_entries;
+	}
 
-		std::error_code ec;
-		const auto last_log_size = std::filesystem::file_size(log_path, ec);
-		if (filter_changed || _last_log_size != last_log_size)
-		{
-			_log_lines.clear();
-			std::ifstream log_file(log_path);
-			for (std::string line; std::getline(log_file, line) && _log_lines.size() < line_limit;)
-				if (filter.PassFilter(line.c_str()))
-					_log_lines.push_back(line);
-			_last_log_size = last_log_size;
+	// Re-evaluate all lines when the filters changed, otherwise only the new ones
+	if (filter_changed)
+	{
+		num_previous_entries = 0;
+		_log_filtered_entries.clear();
+	}
 
-			if (_log_lines.size() == line_limit)
-				_log_lines.push_back("Log was truncated to reduce memory footprint!");
-		}
+	for (size_t i = num_previous_entries; i < _log_entries.size(); ++i)
+	{
+		const log::entry &entry = _log_entries[i];
+		if (_log_show_levels[static_cast<size_t>(entry.level) - 1] && filter.PassFilter(entry.line.data(), entry.line.data() + entry.line.size()))
+			_log_filtered_entries.push_back(i);
+	}
 
+	if (ImGui::BeginChild("log", ImVec2(0, 0), true, _log_wordwrap ? 0 : ImGuiWindowFlags_AlwaysHorizontalScrollbar))
+	{
 		ImGuiListClipper clipper;
-		clipper.Begin(static_cast<int>(_log_lines.size()), ImGui::GetTextLineHeightWithSpacing());
+		clipper.Begin(static_cast<int>(_log_filtered_entries.size()), ImGui::GetTextLineHeightWithSpacing());
 		while (clipper.Step())
 		{
 			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
 			{
+				const log::entry &entry = _log_entries[_log_filtered_entries[i]];
+
 				ImVec4 textcol = ImGui::GetStyleColorVec4(ImGuiCol_Text);
 
-				if (_log_lines[i].find("ERROR |") != std::string::npos || _log_lines[i].find("error") != std::string::npos)
+				switch (entry.level)
+				{
+				case log::level::error:
 					textcol = COLOR_RED;
-				else if (_log_lines[i].find("WARN  |") != std::string::npos || _log_lines[i].find("warning") != std::string::npos || i == line_limit)
+					break;
+				case log::level::warning:
 					textcol = COLOR_YELLOW;
-				else if (_log_lines[i].find("DEBUG |") != std::string::npos)
+					break;
+				case log::level::info:
+					break;
+				case log::level::debug:
 					textcol = ImColor(100, 100, 255);
+					break;
+				default:
+					assert(false);
+					break;
+				}
+
+				// Continuation lines of multi-line messages (e.g. compiler output) have no level tag of their own, so color those based on their text like before
+				if (entry.message_offset == 0)
+				{
+					if (entry.line.find("error") != std::string::npos)
+						textcol = COLOR_RED;
+					else if (entry.line.find("warning") != std::string::npos)
+						textcol = COLOR_YELLOW;
+				}
 
 				ImGui::PushStyleColor(ImGuiCol_Text, textcol);
 				if (_log_wordwrap) ImGui::PushTextWrapPos();
 
-				ImGui::TextUnformatted(_log_lines[i].c_str());
+				ImGui::TextUnformatted(entry.line.data(), entry.line.data() + entry.line.size());
 
 				if (_log_wordwrap) ImGui::PopTextWrapPos();
 				ImGui::PopStyleColor();
@@ -2267,7 +2534,7 @@ void reshade::runtime::draw_variable_editor()
 			reshade::uniform &variable = effect.uniforms[variable_index];
 
 			// Skip hidden and special variables
-			if (variable.annotation_as_int("hidden") || variable.special != special_uniform::none)
+			if (variable.annotation_as_int(annotation_key::hidden) || variable.special != special_uniform::none)
 			{
 				if (variable.special == special_uniform::overlay_active)
 					active_variable_index = variable_index;
@@ -2276,7 +2543,7 @@ void reshade::runtime::draw_variable_editor()
 				continue;
 			}
 
-			if (const std::string_view category = variable.annotation_as_string("ui_category");
+			if (const std::string_view category = variable.annotation_as_string(annotation_key::ui_category);
 				category != current_category)
 			{
 				current_category = category;
@@ -2289,7 +2556,7 @@ void reshade::runtime::draw_variable_editor()
 							category_label.insert(0, " ");
 
 					ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen;
-					if (!variable.annotation_as_int("ui_category_closed"))
+					if (!variable.annotation_as_int(annotation_key::ui_category_closed))
 						flags |= ImGuiTreeNodeFlags_DefaultOpen;
 
 					category_closed = !ImGui::TreeNodeEx(category_label.c_str(), flags);
@@ -2302,7 +2569,7 @@ void reshade::runtime::draw_variable_editor()
 						if (ImGui::Button(reset_button_label.c_str(), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
 						{
 							for (uniform &variable_it : effect.uniforms)
-								if (variable_it.annotation_as_string("ui_category") == category)
+								if (variable_it.annotation_as_string(annotation_key::ui_category) == category)
 									reset_uniform_value(variable_it);
 
 							save_current_preset();
@@ -2324,11 +2591,11 @@ void reshade::runtime::draw_variable_editor()
 				continue;
 
 			// Add spacing before variable widget
-			for (int i = 0, spacing = variable.annotation_as_int("ui_spacing"); i < spacing; ++i)
+			for (int i = 0, spacing = variable.annotation_as_int(annotation_key::ui_spacing); i < spacing; ++i)
 				ImGui::Spacing();
 
 			// Add user-configurable text before variable widget
-			if (const std::string_view text = variable.annotation_as_string("ui_text");
+			if (const std::string_view text = variable.annotation_as_string(annotation_key::ui_text);
 				!text.empty())
 			{
 				ImGui::PushTextWrapPos();
@@ -2337,10 +2604,10 @@ void reshade::runtime::draw_variable_editor()
 			}
 
 			bool modified = false;
-			std::string_view label = variable.annotation_as_string("ui_label");
+			std::string_view label = variable.annotation_as_string(annotation_key::ui_label);
 			if (label.empty())
 				label = variable.name;
-			const std::string_view ui_type = variable.annotation_as_string("ui_type");
+			const std::string_view ui_type = variable.annotation_as_string(annotation_key::ui_type);
 
 			ImGui::PushID(static_cast<int>(id++));
 
@@ -2366,22 +2633,22 @@ void reshade::runtime::draw_variable_editor()
 				int data[16];
 				get_uniform_value(variable, data, 16);
 
-				const auto ui_min_val = variable.annotation_as_int("ui_min", 0, ui_type == "slider" ? 0 : std::numeric_limits<int>::lowest());
-				const auto ui_max_val = variable.annotation_as_int("ui_max", 0, ui_type == "slider" ? 1 : std::numeric_limits<int>::max());
-				const auto ui_stp_val = std::max(1, variable.annotation_as_int("ui_step"));
+				const auto ui_min_val = variable.annotation_as_int(annotation_key::ui_min, 0, ui_type == "slider" ? 0 : std::numeric_limits<int>::lowest());
+				const auto ui_max_val = variable.annotation_as_int(annotation_key::ui_max, 0, ui_type == "slider" ? 1 : std::numeric_limits<int>::max());
+				const auto ui_stp_val = std::max(1, variable.annotation_as_int(annotation_key::ui_step));
 
 				if (ui_type == "slider")
 					modified = widgets::slider_with_buttons(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val);
 				else if (ui_type == "drag")
-					modified = variable.annotation_as_int("ui_step") == 0 ?
+					modified = variable.annotation_as_int(annotation_key::ui_step) == 0 ?
 						ImGui::DragScalarN(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, 1.0f, &ui_min_val, &ui_max_val) :
 						widgets::drag_with_buttons(label.data(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val);
 				else if (ui_type == "list")
-					modified = widgets::list_with_buttons(label.data(), variable.annotation_as_string("ui_items"), data[0]);
+					modified = widgets::list_with_buttons(label.data(), variable.annotation_as_string(annotation_key::ui_items), data[0]);
 				else if (ui_type == "combo")
-					modified = widgets::combo_with_buttons(label.data(), variable.annotation_as_string("ui_items"), data[0]);
+					modified = widgets::combo_with_buttons(label.data(), variable.annotation_as_string(annotation_key::ui_items), data[0]);
 				else if (ui_type == "radio")
-					modified = widgets::radio_list(label.data(), variable.annotation_as_string("ui_items"), data[0]);
+					modified = widgets::radio_list(label.data(), variable.annotation_as_string(annotation_key::ui_items), data[0]);
 				else if (variable.type.is_matrix())
 					for (unsigned int row = 0; row < variable.type.rows; ++row)
 						modified = ImGui::InputScalarN((std::string(label) + " [row " + std::to_string(row) + ']').c_str(), variable.type.is_signed() ? ImGuiDataType_S32 : ImGuiDataType_U32, &data[0] + row * variable.type.cols, variable.type.cols) || modified;
@@ -2397,9 +2664,9 @@ void reshade::runtime::draw_variable_editor()
 				float data[16];
 				get_uniform_value(variable, data, 16);
 
-				const auto ui_min_val = variable.annotation_as_float("ui_min", 0, ui_type == "slider" ? 0.0f : std::numeric_limits<float>::lowest());
-				const auto ui_max_val = variable.annotation_as_float("ui_max", 0, ui_type == "slider" ? 1.0f : std::numeric_limits<float>::max());
-				const auto ui_stp_val = std::max(0.001f, variable.annotation_as_float("ui_step"));
+				const auto ui_min_val = variable.annotation_as_float(annotation_key::ui_min, 0, ui_type == "slider" ? 0.0f : std::numeric_limits<float>::lowest());
+				const auto ui_max_val = variable.annotation_as_float(annotation_key::ui_max, 0, ui_type == "slider" ? 1.0f : std::numeric_limits<float>::max());
+				const auto ui_stp_val = std::max(0.001f, variable.annotation_as_float(annotation_key::ui_step));
 
 				// Calculate display precision based on step value
 				char precision_format[] = "%.0f";
@@ -2409,7 +2676,7 @@ void reshade::runtime::draw_variable_editor()
 				if (ui_type == "slider")
 					modified = widgets::slider_with_buttons(label.data(), ImGuiDataType_Float, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val, precision_format);
 				else if (ui_type == "drag")
-					modified = variable.annotation_as_float("ui_step") == 0 ?
+					modified = variable.annotation_as_float(annotation_key::ui_step) == 0 ?
 						ImGui::DragScalarN(label.data(), ImGuiDataType_Float, data, variable.type.rows, ui_stp_val, &ui_min_val, &ui_max_val, precision_format) :
 						widgets::drag_with_buttons(label.data(), ImGuiDataType_Float, data, variable.type.rows, &ui_stp_val, &ui_min_val, &ui_max_val, precision_format);
 				else if (ui_type == "color" && variable.type.rows == 1)
@@ -2436,7 +2703,7 @@ void reshade::runtime::draw_variable_editor()
 				hovered_variable = variable_index + 1;
 
 			// Display tooltip
-			if (const std::string_view tooltip = variable.annotation_as_string("ui_tooltip");
+			if (const std::string_view tooltip = variable.annotation_as_string(annotation_key::ui_tooltip);
 				!tooltip.empty() && ImGui::IsItemHovered())
 				ImGui::SetTooltip("%s", tooltip.data());
 
@@ -2631,7 +2898,7 @@ void reshade::runtime::draw_technique_editor()
 
 		// Prevent user from enabling the technique when the effect failed to compile
 		// Also prevent disabling it for when the technique is set to always be enabled via annotation
-		ImGui::PushItemFlag(ImGuiItemFlags_Disabled, !effect.compiled || technique.annotation_as_int("enabled"));
+		ImGui::PushItemFlag(ImGuiItemFlags_Disabled, !effect.compiled || technique.annotation_as_int(annotation_key::enabled));
 		// Gray out disabled techniques and mark techniques which failed to compile red
 		ImGui::PushStyleColor(ImGuiCol_Text,
 			effect.compiled ?
@@ -2640,7 +2907,7 @@ void reshade::runtime::draw_technique_editor()
 					COLOR_YELLOW :
 				COLOR_RED);
 
-		std::string label(technique.annotation_as_string("ui_label"));
+		std::string label(technique.annotation_as_string(annotation_key::ui_label));
 		if (label.empty() || !effect.compiled)
 			label = technique.name;
 		label += " [" + effect.source_file.filename().u8string() + ']' + (!effect.compiled ? " failed to compile" : "");
@@ -2666,7 +2933,7 @@ void reshade::runtime::draw_technique_editor()
 			hovered_technique_index = index;
 
 		// Display tooltip
-		if (const std::string_view tooltip = technique.annotation_as_string("ui_tooltip");
+		if (const std::string_view tooltip = technique.annotation_as_string(annotation_key::ui_tooltip);
 			ImGui::IsItemHovered() && (!tooltip.empty() || !effect.errors.empty()))
 		{
 			ImGui::BeginTooltip();
@@ -2938,6 +3205,10 @@ void reshade::runtime::open_code_editor(editor_instance &instance)
 }
 void reshade::runtime::draw_code_editor(editor_instance &instance)
 {
+	// Only build the search index once the code editor is actually used (and all effects finished loading, so that their included files are known), since it has to read all effect files
+	if (_editor_search_index_outdated && !is_loading())
+		update_effect_search_index();
+
 	if (instance.entry_point_name.empty() && (
 		ImGui::Button(ICON_FK_FLOPPY " Save", ImVec2(ImGui::GetContentRegionAvail().x, 0)) || _input->is_key_pressed('S', true, false, false)))
 	{
@@ -2951,6 +3222,7 @@ void reshade::runtime::draw_code_editor(editor_instance &instance)
 			instance.editor.clear_modified();
 
 			reload_effect(instance.effect_index);
+			update_effect_search_index();
 
 			// Reloading an effect file invalidates all textures, but the statistics window may already have drawn references to those, so need to reset it
 			ImGui::FindWindowByName("Statistics")->DrawList->CmdBuffer.clear();
@@ -2968,6 +3240,54 @@ void reshade::runtime::draw_code_editor(editor_instance &instance)
 		_imgui_context->IO.ConfigFlags &= ~ImGuiConfigFlags_NavEnableKeyboard;
 	else // Enable navigation again if focus is lost
 		_imgui_context->IO.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+
+	// Search through all effect files (Ctrl + Shift + F by default) or look up the definition of the selected identifier (F12 by default)
+	if (is_focused && _input->is_key_pressed(_editor_search_key_data))
+	{
+		if (instance.editor.has_selection())
+			_editor_search_text[instance.editor.get_selected_text().copy(_editor_search_text, sizeof(_editor_search_text) - 1)] = '\0';
+
+		_editor_search_results = _editor_search_index.find_text(_editor_search_text);
+
+		ImGui::OpenPopup("##search_files");
+	}
+	else if (is_focused && _input->is_key_pressed(_editor_definition_key_data) && instance.editor.has_selection())
+	{
+		_editor_search_text[instance.editor.get_selected_text().copy(_editor_search_text, sizeof(_editor_search_text) - 1)] = '\0';
+
+		_editor_search_results = _editor_search_index.find_definition(_editor_search_text);
+
+		if (_editor_search_results.size() == 1)
+			_editor_search_goto = 0; // Jump to definition right away if it is unambiguous
+		else
+			ImGui::OpenPopup("##search_files");
+	}
+
+	if (ImGui::BeginPopup("##search_files"))
+	{
+		ImGui::PushItemWidth(400);
+		if (ImGui::InputText("##search", _editor_search_text, sizeof(_editor_search_text), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue))
+			_editor_search_results = _editor_search_index.find_text(_editor_search_text);
+		ImGui::PopItemWidth();
+		if (ImGui::IsWindowAppearing())
+			ImGui::SetKeyboardFocusHere(-1);
+
+		if (_editor_search_index.is_updating())
+			ImGui::TextDisabled("Indexing effect files ...");
+		else if (_editor_search_results.empty())
+			ImGui::TextDisabled("No results found.");
+
+		for (size_t i = 0; i < _editor_search_results.size(); ++i)
+		{
+			const search_index::match &result = _editor_search_results[i];
+
+			const std::string label = result.file_path.filename().u8string() + '(' + std::to_string(result.line + 1) + "): " + result.line_text + "###result" + std::to_string(i);
+			if (ImGui::Selectable(label.c_str()))
+				_editor_search_goto = i;
+		}
+
+		ImGui::EndPopup();
+	}
 }
 
 #endif
@@ -6,6 +6,8 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include "effect_statistics.hpp"
+#include "duration_histogram.hpp"
 
 namespace reshade
 {
@@ -60,31 +62,158 @@ namespace reshade
 		T _average, _tick_sum, _tick_list[SAMPLES];
 	};
 
+	/// <summary>
+	/// Names of annotations that are queried by the runtime, so that they can be looked up without string comparisons.
+	/// </summary>
+	enum class annotation_key : uint8_t
+	{
+		source,
+		hidden,
+		enabled,
+		timeout,
+		budget_priority,
+		toggle,
+		togglectrl,
+		toggleshift,
+		togglealt,
+		pooled,
+		min,
+		max,
+		step,
+		smoothing,
+		keycode,
+		mode,
+		index,
+		ui_type,
+		ui_label,
+		ui_tooltip,
+		ui_category,
+		ui_category_closed,
+		ui_items,
+		ui_min,
+		ui_max,
+		ui_step,
+		ui_spacing,
+		ui_text,
+		count
+	};
+
+	/// <summary>
+	/// Input mode of the "key" and "mousebutton" special uniforms.
+	/// </summary>
+	enum class special_input_mode : uint8_t
+	{
+		down,
+		press,
+		toggle,
+	};
+
+	/// <summary>
+	/// Index over the annotations of an effect object, which is built once when the effect is loaded.
+	/// Annotations with a well-known name are found with a single array access, all others through a sorted list of name hashes.
+	/// Only indices are stored, so the index stays valid when the object it belongs to is copied.
+	/// </summary>
+	class annotation_index
+	{
+	public:
+		annotation_index()
+		{
+			std::fill_n(_well_known, static_cast<size_t>(annotation_key::count), no_annotation);
+		}
+
+		void build(const std::vector<reshadefx::annotation> &annotations)
+		{
+			static constexpr std::string_view names[static_cast<size_t>(annotation_key::count)] = {
+				"source", "hidden", "enabled", "timeout", "budget_priority", "toggle", "togglectrl", "toggleshift", "togglealt", "pooled",
+				"min", "max", "step", "smoothing", "keycode", "mode", "index",
+				"ui_type", "ui_label", "ui_tooltip", "ui_category", "ui_category_closed", "ui_items", "ui_min", "ui_max", "ui_step", "ui_spacing", "ui_text",
+			};
+
+			std::fill_n(_well_known, static_cast<size_t>(annotation_key::count), no_annotation);
+			_hashes.clear();
+			_hashes.reserve(annotations.size());
+
+			for (size_t i = 0; i < annotations.size() && i < no_annotation; ++i)
+			{
+				const std::string_view name = annotations[i].name;
+				for (size_t k = 0; k < static_cast<size_t>(annotation_key::count); ++k)
+				{
+					// Keep the first annotation if there are duplicates, same as a linear search would
+					if (name == names[k] && _well_known[k] == no_annotation)
+						_well_known[k] = static_cast<uint16_t>(i);
+				}
+
+				_hashes.emplace_back(std::hash<std::string_view>()(name), static_cast<uint16_t>(i));
+			}
+
+			std::stable_sort(_hashes.begin(), _hashes.end(),
+				[](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+		}
+
+		const reshadefx::annotation *find(const std::vector<reshadefx::annotation> &annotations, annotation_key key) const
+		{
+			const uint16_t index = _well_known[static_cast<size_t>(key)];
+			return index != no_annotation ? &annotations[index] : nullptr;
+		}
+		const reshadefx::annotation *find(const std::vector<reshadefx::annotation> &annotations, const std::string_view &name) const
+		{
+			const size_t hash = std::hash<std::string_view>()(name);
+			for (auto it = std::lower_bound(_hashes.begin(), _hashes.end(), hash,
+					[](const auto &entry, size_t hash) { return entry.first < hash; });
+				it != _hashes.end() && it->first == hash; ++it)
+				if (annotations[it->second].name == name)
+					return &annotations[it->second];
+			return nullptr;
+		}
+
+		template <typename K>
+		int as_int(const std::vector<reshadefx::annotation> &annotations, K key, size_t i, int default_value) const
+		{
+			const reshadefx::annotation *const annotation = find(annotations, key);
+			if (annotation == nullptr) return default_value;
+			return annotation->type.is_integral() ? annotation->value.as_int[i] : static_cast<int>(annotation->value.as_float[i]);
+		}
+		template <typename K>
+		float as_float(const std::vector<reshadefx::annotation> &annotations, K key, size_t i, float default_value) const
+		{
+			const reshadefx::annotation *const annotation = find(annotations, key);
+			if (annotation == nullptr) return default_value;
+			return annotation->type.is_floating_point() ? annotation->value.as_float[i] : static_cast<float>(annotation->value.as_int[i]);
+		}
+		template <typename K>
+		std::string_view as_string(const std::vector<reshadefx::annotation> &annotations, K key, const std::string_view &default_value) const
+		{
+			const reshadefx::annotation *const annotation = find(annotations, key);
+			if (annotation == nullptr) return default_value;
+			return std::string_view(annotation->value.string_data);
+		}
+
+	private:
+		static constexpr uint16_t no_annotation = std::numeric_limits<uint16_t>::max();
+
+		uint16_t _well_known[static_cast<size_t>(annotation_key::count)];
+		std::vector<std::pair<size_t, uint16_t>> _hashes;
+	};
+
 	struct texture final : reshadefx::texture_info
 	{
 		texture() {} // For standalone textures like the font atlas
-		texture(const reshadefx::texture_info &init) : texture_info(init) {}
+		texture(const reshadefx::texture_info &init) : texture_info(init) { annotation_lookup.build(annotations); }
 
-		auto annotation_as_int(const char *ann_name, size_t i = 0) const
+		template <typename K>
+		int annotation_as_int(K key, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
-			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
+			return annotation_lookup.as_int(annotations, key, i, 0);
 		}
-		auto annotation_as_float(const char *ann_name, size_t i = 0) const
+		template <typename K>
+		float annotation_as_float(K key, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
-			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
+			return annotation_lookup.as_float(annotations, key, i, 0.0f);
 		}
-		auto annotation_as_string(const char *ann_name) const
+		template <typename K>
+		std::string_view annotation_as_string(K key) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
-			return std::string_view(it->value.string_data);
+			return annotation_lookup.as_string(annotations, key, std::string_view());
 		}
 
 		bool matches_description(const reshadefx::texture_info &desc) const
@@ -93,6 +222,7 @@ namespace reshade
 		}
 
 		void *impl = nullptr;
+		annotation_index annotation_lookup;
 		size_t effect_index = std::numeric_limits<size_t>::max();
 		std::vector<size_t> shared;
 		bool loaded = false;
@@ -100,28 +230,22 @@ namespace reshade
 
 	struct uniform final : reshadefx::uniform_info
 	{
-		uniform(const reshadefx::uniform_info &init) : uniform_info(init) {}
+		uniform(const reshadefx::uniform_info &init) : uniform_info(init) { annotation_lookup.build(annotations); }
 
-		auto annotation_as_int(const char *ann_name, size_t i = 0, int default_value = 0) const
+		template <typename K>
+		int annotation_as_int(K key, size_t i = 0, int default_value = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return default_value;
-			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
+			return annotation_lookup.as_int(annotations, key, i, default_value);
 		}
-		auto annotation_as_float(const char *ann_name, size_t i = 0, float default_value = 0.0f) const
+		template <typename K>
+		float annotation_as_float(K key, size_t i = 0, float default_value = 0.0f) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return default_value;
-			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
+			return annotation_lookup.as_float(annotations, key, i, default_value);
 		}
-		auto annotation_as_string(const char *ann_name, const std::string_view &default_value = std::string_view()) const
+		template <typename K>
+		std::string_view annotation_as_string(K key, const std::string_view &default_value = std::string_view()) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return default_value;
-			return std::string_view(it->value.string_data);
+			return annotation_lookup.as_string(annotations, key, default_value);
 		}
 
 		bool supports_toggle_key() const
@@ -130,49 +254,90 @@ namespace reshade
 				return true;
 			if (type.base != reshadefx::type::t_int && type.base != reshadefx::type::t_uint)
 				return false;
-			const std::string_view ui_type = annotation_as_string("ui_type");
+			const std::string_view ui_type = annotation_as_string(annotation_key::ui_type);
 			return ui_type == "list" || ui_type == "combo" || ui_type == "radio";
 		}
 
+		annotation_index annotation_lookup;
 		size_t effect_index = std::numeric_limits<size_t>::max();
 		special_uniform special = special_uniform::none;
+		special_input_mode input_mode = special_input_mode::down;
 		uint32_t toggle_key_data[4] = {};
 	};
 
 	struct technique final : reshadefx::technique_info
 	{
-		technique(const reshadefx::technique_info &init) : technique_info(init) {}
+		technique(const reshadefx::technique_info &init) : technique_info(init) { annotation_lookup.build(annotations); }
+
+		template <typename K>
+		int annotation_as_int(K key, size_t i = 0) const
+		{
+			return annotation_lookup.as_int(annotations, key, i, 0);
+		}
+		template <typename K>
+		float annotation_as_float(K key, size_t i = 0) const
+		{
+			return annotation_lookup.as_float(annotations, key, i, 0.0f);
+		}
+		template <typename K>
+		std::string_view annotation_as_string(K key) const
+		{
+			return annotation_lookup.as_string(annotations, key, std::string_view());
+		}
 
-		auto annotation_as_int(const char *ann_name, size_t i = 0) const
+		void record_cpu_duration(uint64_t duration)
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
-			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
+			average_cpu_duration.append(duration);
+			cpu_duration_histogram.record(duration);
 		}
-		auto annotation_as_float(const char *ann_name, size_t i = 0) const
+		void record_gpu_duration(uint64_t duration)
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
-			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
+			average_gpu_duration.append(duration);
+			gpu_duration_histogram.record(duration);
 		}
-		auto annotation_as_string(const char *ann_name) const
+		/// <summary>
+		/// Record the GPU duration of the technique and, if there is a timestamp after each pass, of every pass from a list of timestamps in nanoseconds.
+		/// </summary>
+		void record_gpu_timestamps(const uint64_t *timestamps, uint32_t num_timestamps)
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
-			return std::string_view(it->value.string_data);
+			// Timestamps are not guaranteed to be monotonic (e.g. after the GPU clock changed), so avoid wrapping around
+			if (timestamps[num_timestamps - 1] < timestamps[0])
+				return;
+
+			record_gpu_duration(timestamps[num_timestamps - 1] - timestamps[0]);
+
+			if (num_timestamps != passes.size() + 1)
+				return;
+
+			pass_timings.resize(passes.size());
+			for (size_t pass_index = 0; pass_index < passes.size(); ++pass_index)
+			{
+				const uint64_t duration = timestamps[pass_index + 1] > timestamps[pass_index] ? timestamps[pass_index + 1] - timestamps[pass_index] : 0;
+				pass_timings[pass_index].average_gpu_duration.append(duration);
+				pass_timings[pass_index].gpu_duration_histogram.record(duration);
+			}
 		}
 
 		void *impl = nullptr;
+		annotation_index annotation_lookup;
 		size_t effect_index = std::numeric_limits<size_t>::max();
+		std::string unique_name; // Technique name qualified with the effect file name ("name@file.fx"), as used to identify it in presets
+		size_t index_in_effect = 0; // Index of this technique in the technique list of its effect module
 		bool hidden = false;
 		bool enabled = false;
+		bool suspended = false; // Enabled, but temporarily not rendered to keep the post-processing duration within the effect budget
 		int64_t time_left = 0;
 		uint32_t toggle_key_data[4] = {};
 		moving_average<uint64_t, 60> average_cpu_duration;
 		moving_average<uint64_t, 60> average_gpu_duration;
+		duration_histogram cpu_duration_histogram; // Unlike the averages these are kept when the technique is disabled, so that they cover the entire session
+		duration_histogram gpu_duration_histogram;
+		struct pass_timing
+		{
+			moving_average<uint64_t, 60> average_gpu_duration;
+			duration_histogram gpu_duration_histogram;
+		};
+		std::vector<pass_timing> pass_timings; // Only filled in by backends that write a timestamp after each pass
 	};
 
 	struct effect final
@@ -190,6 +355,62 @@ namespace reshade
 		std::vector<std::pair<std::string, std::string>> definitions;
 		std::unordered_map<std::string, std::string> assembly;
 		std::vector<uniform> uniforms;
+		std::vector<uint32_t> special_uniforms; // Indices of uniforms with a special source, grouped by source
+		std::vector<uint32_t> toggle_key_uniforms; // Indices of uniforms that support toggle keys
 		std::vector<unsigned char> uniform_data_storage;
+		reshadefx::compile_statistics statistics;
+	};
+
+	/// <summary>
+	/// A preset translated into the data it writes to the currently loaded effects, so that switching to it does not need to parse it again.
+	/// </summary>
+	struct preset_plan final
+	{
+		struct uniform_value
+		{
+			size_t effect_index;
+			size_t offset; // Offset into the uniform data storage of the effect
+			size_t size;
+			size_t data_offset; // Offset into 'uniform_data'
+		};
+		struct uniform_transition
+		{
+			size_t effect_index;
+			size_t uniform_index;
+			reshadefx::constant value; // Value from the preset, which floating-point values are interpolated toward
+		};
+		struct uniform_toggle_key
+		{
+			size_t effect_index;
+			size_t uniform_index;
+			uint32_t key_data[4];
+		};
+		struct technique_state
+		{
+			size_t position = 0; // Position in the technique list after sorting
+			bool enabled = false;
+			uint32_t toggle_key_data[4] = {};
+		};
+
+		/// <summary>
+		/// Checks whether this plan still matches the preset and config values it was built from.
+		/// </summary>
+		bool is_up_to_date(size_t current_preset_revision, const std::vector<std::string> &current_config_technique_sorting) const
+		{
+			return preset_revision == current_preset_revision && config_technique_sorting == current_config_technique_sorting;
+		}
+
+		std::filesystem::path path;
+		size_t preset_revision = 0;
+		std::vector<std::string> config_technique_sorting; // The only value from the config the plan depends on
+		std::vector<std::string> preprocessor_definitions;
+		bool references_skipped_effects = false;
+		std::vector<unsigned char> uniform_data;
+		std::vector<uniform_value> uniform_values;
+		std::vector<uniform_transition> uniform_transitions; // Only those uniforms that are set in the preset
+		std::vector<uniform_toggle_key> uniform_toggle_keys;
+		std::vector<size_t> technique_offsets; // Offset of the first technique of each effect into 'technique_states'
+		std::vector<technique_state> technique_states;
+		size_t num_technique_positions = 0;
 	};
 }
@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "screenshot_writer.hpp"
+#include "pixel_kernels.hpp"
+#include <array>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stb_image_write.h>
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanForward
+#endif
+
+static constexpr auto s_crc_table = []() {
+	std::array<uint32_t, 256> table = {};
+	for (uint32_t n = 0; n < 256; ++n)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		table[n] = c;
+	}
+	return table;
+}();
+
+static uint32_t compute_crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = s_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static uint32_t compute_adler32(const uint8_t *data, size_t size)
+{
+	uint32_t s1 = 1, s2 = 0;
+	while (size != 0)
+	{
+		// This is the largest number of bytes that can be summed up before the 32-bit sums may overflow
+		const size_t block_size = std::min<size_t>(size, 5552);
+		for (size_t i = 0; i < block_size; ++i)
+			s2 += s1 += data[i];
+		s1 %= 65521;
+		s2 %= 65521;
+		data += block_size;
+		size -= block_size;
+	}
+	return (s2 << 16) | s1;
+}
+static uint32_t combine_adler32(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+	// Compute the checksum of two concatenated blocks of data from the checksums of each (see 'adler32_combine' in zlib)
+	const uint32_t base = 65521;
+	const uint32_t rem = static_cast<uint32_t>(size2 % base);
+	uint32_t s1 = adler1 & 0xFFFF;
+	uint32_t s2 = (rem * s1) % base;
+	s1 += (adler2 & 0xFFFF) + base - 1;
+	s2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + base - rem;
+	if (s1 >= base) s1 -= base;
+	if (s1 >= base) s1 -= base;
+	if (s2 >= (base << 1)) s2 -= (base << 1);
+	if (s2 >= base) s2 -= base;
+	return (s2 << 16) | s1;
+}
+
+static inline void write_uint32_be(uint8_t *data, uint32_t value)
+{
+	data[0] = static_cast<uint8_t>(value >> 24);
+	data[1] = static_cast<uint8_t>(value >> 16);
+	data[2] = static_cast<uint8_t>(value >> 8);
+	data[3] = static_cast<uint8_t>(value);
+}
+
+struct bit_writer
+{
+	explicit bit_writer(std::vector<uint8_t> &out) : out(out) {}
+
+	void add(uint32_t code, uint32_t num_bits)
+	{
+		buffer |= code << count;
+		count += num_bits;
+		for (; count >= 8; count -= 8, buffer >>= 8)
+			out.push_back(static_cast<uint8_t>(buffer));
+	}
+	void add_reversed(uint32_t code, uint32_t num_bits)
+	{
+		// Huffman codes are stored with the most significant bit first
+		uint32_t reversed = 0;
+		for (uint32_t i = 0; i < num_bits; ++i, code >>= 1)
+			reversed = (reversed << 1) | (code & 1);
+		add(reversed, num_bits);
+	}
+	void add_symbol(uint32_t symbol)
+	{
+		// Fixed Huffman codes for the literal/length alphabet (see section 3.2.6 of RFC 1951)
+		if (symbol <= 143)
+			add_reversed(0x30 + symbol, 8);
+		else if (symbol <= 255)
+			add_reversed(0x190 + symbol - 144, 9);
+		else if (symbol <= 279)
+			add_reversed(symbol - 256, 7);
+		else
+			add_reversed(0xC0 + symbol - 280, 8);
+	}
+	void align()
+	{
+		if (count != 0)
+			add(0, 8 - count);
+	}
+
+	std::vector<uint8_t> &out;
+	uint32_t buffer = 0;
+	uint32_t count = 0;
+};
+
+static inline uint32_t hash_trigram(const uint8_t *data)
+{
+	uint32_t hash = data[0] | (data[1] << 8) | (data[2] << 16);
+	hash *= 0x9E3779B1;
+	return hash >> (32 - 15);
+}
+static inline size_t match_length(const uint8_t *a, const uint8_t *b, size_t limit)
+{
+	size_t length = 0;
+
+	// Compare four bytes at a time and find the first differing byte from the lowest set bit of the difference (assumes little-endian)
+	for (uint32_t a_word, b_word; length + 4 <= limit; length += 4)
+	{
+		std::memcpy(&a_word, a + length, 4);
+		std::memcpy(&b_word, b + length, 4);
+		if (const uint32_t difference = a_word ^ b_word; difference != 0)
+		{
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanForward(&bit, difference);
+#else
+			const unsigned int bit = __builtin_ctz(difference);
+#endif
+			return length + bit / 8;
+		}
+	}
+
+	while (length < limit && a[length] == b[length])
+		++length;
+	return length;
+}
+
+/// <summary>
+/// Compress data into a single DEFLATE block using the fixed Huffman codes, similar to what stb_image_write does.
+/// Blocks that are not final end with an empty stored block, so that independently compressed blocks can simply be concatenated.
+/// </summary>
+static void deflate_block(const uint8_t *data, size_t size, bool is_final, std::vector<uint8_t> &out)
+{
+	static const uint16_t length_base[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 259 };
+	static const uint8_t length_extra_bits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t dist_base[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 32768 };
+	static const uint8_t dist_extra_bits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	const size_t window_size = 32768;
+	const size_t max_match_length = 258;
+	const size_t good_match_length = 128; // Stop searching for better matches once one this long was found
+	const unsigned int max_chain_length = 16;
+
+	// Hash chains of previous positions with the same leading three bytes, indexed by position modulo window size
+	std::vector<int32_t> head(1 << 15, -1);
+	std::vector<int32_t> prev(window_size, -1);
+
+	const auto find_match = [&](size_t pos, size_t &best_length) -> size_t {
+		size_t best_distance = 0;
+		unsigned int chain_length = max_chain_length;
+		for (int32_t candidate = head[hash_trigram(data + pos)]; candidate >= 0 && pos - candidate < window_size && chain_length-- != 0; candidate = prev[candidate & (window_size - 1)])
+		{
+			if (const size_t length = match_length(data + candidate, data + pos, std::min(max_match_length, size - pos));
+				length > best_length)
+			{
+				best_length = length;
+				best_distance = pos - candidate;
+
+				if (length >= good_match_length)
+					break;
+			}
+		}
+		return best_distance;
+	};
+
+	bit_writer writer(out);
+	writer.add(is_final ? 1 : 0, 1);
+	writer.add(1, 2); // Fixed Huffman codes
+
+	size_t pos = 0;
+	while (pos + 3 < size)
+	{
+		size_t best_length = 2;
+		size_t best_distance = find_match(pos, best_length);
+
+		const uint32_t hash = hash_trigram(data + pos);
+		prev[pos & (window_size - 1)] = head[hash];
+		head[hash] = static_cast<int32_t>(pos);
+
+		// Lazy matching: Emit the current byte as a literal if there is a better match starting at the next one
+		if (best_distance != 0 && best_length < max_match_length && pos + 4 < size)
+			if (size_t next_length = best_length; find_match(pos + 1, next_length) != 0)
+				best_distance = 0;
+
+		if (best_distance != 0)
+		{
+			size_t code = 0;
+			while (best_length >= length_base[code + 1])
+				++code;
+			writer.add_symbol(static_cast<uint32_t>(257 + code));
+			if (length_extra_bits[code] != 0)
+				writer.add(static_cast<uint32_t>(best_length - length_base[code]), length_extra_bits[code]);
+
+			code = 0;
+			while (best_distance >= dist_base[code + 1])
+				++code;
+			writer.add_reversed(static_cast<uint32_t>(code), 5);
+			if (dist_extra_bits[code] != 0)
+				writer.add(static_cast<uint32_t>(best_distance - dist_base[code]), dist_extra_bits[code]);
+
+			pos += best_length;
+		}
+		else
+		{
+			writer.add_symbol(data[pos++]);
+		}
+	}
+
+	for (; pos < size; ++pos)
+		writer.add_symbol(data[pos]);
+
+	writer.add_symbol(256); // End of block
+
+	if (!is_final)
+	{
+		// Add an empty stored block, which pads the output to a byte boundary (same as a sync flush in zlib)
+		writer.add(0, 1);
+		writer.add(0, 2);
+		writer.align();
+		out.insert(out.end(), { 0x00, 0x00, 0xFF, 0xFF });
+	}
+	else
+	{
+		writer.align();
+	}
+}
+
+static inline uint8_t paeth_predictor(int a, int b, int c)
+{
+	const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return static_cast<uint8_t>(a);
+	if (pb <= pc)
+		return static_cast<uint8_t>(b);
+	return static_cast<uint8_t>(c);
+}
+
+/// <summary>
+/// Apply the PNG filter to a row of pixels that minimizes the sum of absolute differences, which is the heuristic recommended by the PNG specification.
+/// </summary>
+static void filter_row(const uint8_t *row, const uint8_t *prior, size_t row_size, size_t bpp, uint8_t *out, uint8_t *scratch)
+{
+	uint64_t best_estimate = std::numeric_limits<uint64_t>::max();
+
+	// Each filter is applied in a separate simple loop, so that the compiler can vectorize them
+	for (uint8_t filter_type = 0; filter_type < 5; ++filter_type)
+	{
+		switch (filter_type)
+		{
+		case 0: // None
+			std::memcpy(scratch, row, row_size);
+			break;
+		case 1: // Sub
+			for (size_t i = 0; i < bpp; ++i)
+				scratch[i] = row[i];
+			for (size_t i = bpp; i < row_size; ++i)
+				scratch[i] = row[i] - row[i - bpp];
+			break;
+		case 2: // Up
+			for (size_t i = 0; i < row_size; ++i)
+				scratch[i] = row[i] - prior[i];
+			break;
+		case 3: // Average
+			for (size_t i = 0; i < bpp; ++i)
+				scratch[i] = row[i] - (prior[i] >> 1);
+			for (size_t i = bpp; i < row_size; ++i)
+				scratch[i] = row[i] - static_cast<uint8_t>((row[i - bpp] + prior[i]) >> 1);
+			break;
+		case 4: // Paeth
+			for (size_t i = 0; i < bpp; ++i)
+				scratch[i] = row[i] - prior[i];
+			for (size_t i = bpp; i < row_size; ++i)
+				scratch[i] = row[i] - paeth_predictor(row[i - bpp], prior[i], prior[i - bpp]);
+			break;
+		}
+
+		uint64_t estimate = 0;
+		for (size_t i = 0; i < row_size; ++i)
+			estimate += std::abs(static_cast<int8_t>(scratch[i]));
+
+		if (estimate < best_estimate)
+		{
+			best_estimate = estimate;
+			out[0] = filter_type;
+			std::memcpy(out + 1, scratch, row_size);
+		}
+	}
+}
+
+void reshade::screenshot_writer::encode_png(const uint8_t *pixels, uint32_t width, uint32_t height, std::vector<uint8_t> &data, thread_pool *pool)
+{
+	const size_t bpp = 4;
+	const size_t row_size = width * bpp;
+
+	// Split the image into horizontal bands that are filtered and compressed in parallel
+	// Each band becomes its own IDAT chunk, with the compressed streams of all of them forming a single zlib stream when concatenated
+	// The number of bands does not depend on the number of threads, so that the output is the same on every machine
+	const uint32_t num_bands = std::max(1u, std::min(8u, height / 64));
+	const uint32_t rows_per_band = (height + num_bands - 1) / num_bands;
+
+	struct band_result
+	{
+		std::vector<uint8_t> chunk;
+		uint32_t adler = 1;
+		size_t filtered_size = 0;
+	};
+
+	std::vector<band_result> bands(num_bands);
+
+	const auto encode_band = [&](size_t band_index) {
+		band_result &band = bands[band_index];
+		const uint32_t first_row = static_cast<uint32_t>(band_index) * rows_per_band;
+		const uint32_t last_row = std::min(first_row + rows_per_band, height);
+		if (first_row >= last_row)
+			return;
+
+		std::vector<uint8_t> filtered((last_row - first_row) * (1 + row_size));
+		std::vector<uint8_t> scratch(row_size);
+		const std::vector<uint8_t> zero_row(row_size);
+
+		for (uint32_t y = first_row; y < last_row; ++y)
+			filter_row(pixels + y * row_size, y != 0 ? pixels + (y - 1) * row_size : zero_row.data(), row_size, bpp, filtered.data() + (y - first_row) * (1 + row_size), scratch.data());
+
+		band.filtered_size = filtered.size();
+		band.adler = compute_adler32(filtered.data(), filtered.size());
+
+		// Reserve space for chunk length and type, which are filled in after compression
+		band.chunk.reserve(filtered.size() / 2);
+		band.chunk.insert(band.chunk.end(), { 0, 0, 0, 0, 'I', 'D', 'A', 'T' });
+		if (band_index == 0)
+			band.chunk.insert(band.chunk.end(), { 0x78, 0x5E }); // zlib header
+		deflate_block(filtered.data(), filtered.size(), last_row == height, band.chunk);
+
+		write_uint32_be(band.chunk.data(), static_cast<uint32_t>(band.chunk.size() - 8));
+		const uint32_t crc = compute_crc32(band.chunk.data() + 4, band.chunk.size() - 4);
+		band.chunk.resize(band.chunk.size() + 4);
+		write_uint32_be(band.chunk.data() + band.chunk.size() - 4, crc);
+	};
+
+	if (pool != nullptr)
+	{
+		pool->parallel_for(num_bands, encode_band);
+	}
+	else
+	{
+		for (uint32_t band_index = 0; band_index < num_bands; ++band_index)
+			encode_band(band_index);
+	}
+
+	const auto write_chunk = [&data](const char type[4], const uint8_t *chunk_data, uint32_t size) {
+		const size_t offset = data.size();
+		data.resize(offset + 12 + size);
+		write_uint32_be(data.data() + offset, size);
+		std::memcpy(data.data() + offset + 4, type, 4);
+		if (size != 0)
+			std::memcpy(data.data() + offset + 8, chunk_data, size);
+		write_uint32_be(data.data() + offset + 8 + size, compute_crc32(data.data() + offset + 4, 4 + size));
+	};
+
+	data.clear();
+	data.insert(data.end(), { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' });
+
+	uint8_t header[13];
+	write_uint32_be(header + 0, width);
+	write_uint32_be(header + 4, height);
+	header[8] = 8; // Bit depth
+	header[9] = 6; // Color type RGBA
+	header[10] = 0; // Compression method
+	header[11] = 0; // Filter method
+	header[12] = 0; // No interlacing
+	write_chunk("IHDR", header, sizeof(header));
+
+	uint32_t adler = 1;
+	for (const band_result &band : bands)
+	{
+		if (band.chunk.empty())
+			continue;
+		data.insert(data.end(), band.chunk.begin(), band.chunk.end());
+		adler = combine_adler32(adler, band.adler, band.filtered_size);
+	}
+
+	// The zlib stream ends with the checksum of the uncompressed data, which is only known after all bands are done
+	uint8_t adler_data[4];
+	write_uint32_be(adler_data, adler);
+	write_chunk("IDAT", adler_data, sizeof(adler_data));
+
+	write_chunk("IEND", nullptr, 0);
+}
+
+reshade::screenshot_writer::screenshot_writer(thread_pool &pool, size_t max_concurrent_jobs, size_t max_pending_jobs) :
+	_pool(pool), _max_concurrent_jobs(std::max(max_concurrent_jobs, size_t(1))), _max_pending_jobs(max_pending_jobs)
+{
+}
+reshade::screenshot_writer::~screenshot_writer()
+{
+	// Finish all pending screenshots before exiting, so that none get lost
+	wait_idle();
+}
+
+std::vector<uint8_t> reshade::screenshot_writer::acquire_buffer(size_t size)
+{
+	std::vector<uint8_t> buffer;
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		if (!_free_buffers.empty())
+		{
+			buffer = std::move(_free_buffers.back());
+			_free_buffers.pop_back();
+		}
+	}
+
+	buffer.resize(size);
+	return buffer;
+}
+
+bool reshade::screenshot_writer::submit(job &&job)
+{
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		if (_pending_jobs.size() >= _max_pending_jobs)
+		{
+			// Keep the memory around for the next attempt
+			_free_buffers.push_back(std::move(job.pixels));
+			return false;
+		}
+
+		_pending_jobs.push_back(std::move(job));
+
+		// Each task keeps processing jobs until none are left, so only start another one if there are less than the maximum number of jobs running in parallel
+		if (_num_active_tasks >= _max_concurrent_jobs)
+			return true;
+
+		_num_active_tasks++;
+	}
+
+	_pool.submit([this]() { process_jobs(); });
+	return true;
+}
+bool reshade::screenshot_writer::poll_finished(job &job)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_finished_jobs.empty())
+		return false;
+
+	job = std::move(_finished_jobs.front());
+	_finished_jobs.pop_front();
+	return true;
+}
+
+size_t reshade::screenshot_writer::num_pending_jobs() const
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+	return _pending_jobs.size() + _num_active_jobs;
+}
+void reshade::screenshot_writer::wait_idle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_job_finished.wait(lock, [this]() { return _num_active_tasks == 0; });
+}
+
+void reshade::screenshot_writer::process_jobs()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_pending_jobs.empty())
+	{
+		job job = std::move(_pending_jobs.front());
+		_pending_jobs.pop_front();
+		_num_active_jobs++;
+
+		lock.unlock();
+		job.success = write_job(job);
+		lock.lock();
+
+		// Return the pixel buffer to the pool (but do not keep more around than can be in use at the same time)
+		if (_free_buffers.size() < _max_pending_jobs + _max_concurrent_jobs)
+			_free_buffers.push_back(std::move(job.pixels));
+		job.pixels = std::vector<uint8_t>();
+
+		_finished_jobs.push_back(std::move(job));
+		_num_active_jobs--;
+	}
+
+	_num_active_tasks--;
+
+	// Notify while still holding the lock, since the writer may be destroyed as soon as a waiting thread sees that no task is active anymore
+	_job_finished.notify_all();
+}
+
+bool reshade::screenshot_writer::write_job(job &job)
+{
+	if (job.pixels.size() < size_t(job.width) * job.height * 4)
+		return false;
+
+	// Clear alpha channel
+	// The alpha channel doesn't need to be cleared if we're saving a JPEG, stbi ignores it
+	if (job.clear_alpha && job.format != 2)
+		pixel_kernels::fill_alpha(job.pixels.data(), size_t(job.width) * job.height);
+
+	std::vector<uint8_t> data;
+	bool success = false;
+
+	const auto write_callback = [](void *context, void *data, int size) {
+		const auto buffer = static_cast<std::vector<uint8_t> *>(context);
+		buffer->insert(buffer->end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+	};
+
+	switch (job.format)
+	{
+	case 0:
+		success = stbi_write_bmp_to_func(write_callback, &data, job.width, job.height, 4, job.pixels.data()) != 0;
+		break;
+	case 1:
+		encode_png(job.pixels.data(), job.width, job.height, data, &_pool);
+		success = true;
+		break;
+	case 2:
+		success = stbi_write_jpg_to_func(write_callback, &data, job.width, job.height, 4, job.pixels.data(), job.jpeg_quality) != 0;
+		break;
+	}
+
+	if (!success)
+		return false;
+
+	std::ofstream file(job.path, std::ios::binary | std::ios::trunc);
+	if (!file || !file.write(reinterpret_cast<const char *>(data.data()), data.size()))
+		return false;
+
+	return true;
+}
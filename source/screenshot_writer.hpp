@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Encodes and writes screenshots on the threads of a pool, so that the render thread only has to capture the pixel data and hand it off.
+	/// </summary>
+	class screenshot_writer
+	{
+	public:
+		/// <summary>
+		/// A single screenshot to save.
+		/// </summary>
+		struct job
+		{
+			std::filesystem::path path;
+			std::vector<uint8_t> pixels; // RGBA8 pixel data, should be allocated via 'acquire_buffer'
+			uint32_t width = 0, height = 0;
+			unsigned int format = 1; // 0 = BMP, 1 = PNG, 2 = JPEG
+			unsigned int jpeg_quality = 90;
+			bool clear_alpha = true;
+			std::filesystem::path preset_path; // Optional preset file that belongs to this screenshot
+			bool success = false; // Set once the job has finished
+		};
+
+		/// <summary>
+		/// Create a writer that runs on the specified thread pool.
+		/// </summary>
+		/// <param name="pool">The pool to encode and write screenshots on.</param>
+		/// <param name="max_concurrent_jobs">Number of screenshots that can be encoded at the same time.</param>
+		/// <param name="max_pending_jobs">Maximum number of screenshots that may wait for encoding before new ones are rejected.</param>
+		explicit screenshot_writer(thread_pool &pool, size_t max_concurrent_jobs = 1, size_t max_pending_jobs = 4);
+		~screenshot_writer();
+
+		screenshot_writer(const screenshot_writer &) = delete;
+		screenshot_writer &operator=(const screenshot_writer &) = delete;
+
+		/// <summary>
+		/// Get a pixel buffer of the specified size, reusing the memory of a previously finished job if possible.
+		/// </summary>
+		std::vector<uint8_t> acquire_buffer(size_t size);
+
+		/// <summary>
+		/// Queue a screenshot for saving on the thread pool.
+		/// </summary>
+		/// <returns><c>true</c> if the job was queued, or <c>false</c> if too many jobs are pending already (in which case it is dropped).</returns>
+		bool submit(job &&job);
+		/// <summary>
+		/// Retrieve the next job that finished saving, if any. The pixel data of returned jobs is empty.
+		/// </summary>
+		bool poll_finished(job &job);
+
+		/// <summary>
+		/// Returns the number of jobs that were submitted but did not finish yet.
+		/// </summary>
+		size_t num_pending_jobs() const;
+		/// <summary>
+		/// Block until all submitted jobs have finished.
+		/// </summary>
+		void wait_idle();
+
+		/// <summary>
+		/// Encode RGBA8 pixel data to a PNG image in memory, filtering and compressing horizontal bands of the image in parallel.
+		/// </summary>
+		/// <param name="pixels">The pixel data to encode, with <paramref name="width"/> times <paramref name="height"/> elements.</param>
+		/// <param name="width">The width of the image.</param>
+		/// <param name="height">The height of the image.</param>
+		/// <param name="data">The vector to write the encoded PNG file to.</param>
+		/// <param name="pool">Optional thread pool to encode the bands on. They are all encoded on the calling thread if this is <c>nullptr</c>.</param>
+		static void encode_png(const uint8_t *pixels, uint32_t width, uint32_t height, std::vector<uint8_t> &data, thread_pool *pool = nullptr);
+
+	private:
+		void process_jobs();
+		bool write_job(job &job);
+
+		thread_pool &_pool;
+		mutable std::mutex _mutex;
+		std::condition_variable _job_finished;
+		std::deque<job> _pending_jobs;
+		std::deque<job> _finished_jobs;
+		std::vector<std::vector<uint8_t>> _free_buffers;
+		size_t _max_concurrent_jobs;
+		size_t _max_pending_jobs;
+		size_t _num_active_jobs = 0;
+		size_t _num_active_tasks = 0;
+	};
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "search_index.hpp"
+#include "effect_lexer.hpp"
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+
+static inline char to_lower(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static std::vector<uint32_t> compute_trigrams(const std::string &text)
+{
+	std::vector<uint32_t> trigrams;
+	if (text.size() < 3)
+		return trigrams;
+
+	trigrams.reserve(text.size() - 2);
+	// Trigrams are built from lower case characters, so that they can be used for both case-sensitive and case-insensitive queries
+	for (size_t i = 0; i + 2 < text.size(); ++i)
+		trigrams.push_back(
+			(static_cast<uint32_t>(static_cast<uint8_t>(to_lower(text[i + 0]))) << 16) |
+			(static_cast<uint32_t>(static_cast<uint8_t>(to_lower(text[i + 1]))) <<  8) |
+			(static_cast<uint32_t>(static_cast<uint8_t>(to_lower(text[i + 2])))));
+
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	return trigrams;
+}
+
+static bool is_declaration_prefix(reshadefx::tokenid id)
+{
+	// An identifier following a type, another identifier (which is a user-defined type then) or one of these keywords is being declared
+	return id == reshadefx::tokenid::identifier ||
+		id == reshadefx::tokenid::namespace_ ||
+		id == reshadefx::tokenid::struct_ ||
+		id == reshadefx::tokenid::technique ||
+		id == reshadefx::tokenid::hash_def ||
+		(id >= reshadefx::tokenid::void_ && id <= reshadefx::tokenid::storage);
+}
+
+reshade::search_index::~search_index()
+{
+	// Make sure the background thread no longer accesses this object
+	_abort_update = true;
+	if (_update_thread.joinable())
+		_update_thread.join();
+}
+
+void reshade::search_index::update(std::vector<std::filesystem::path> files)
+{
+	update([files = std::move(files)]() { return files; });
+}
+void reshade::search_index::update(std::function<std::vector<std::filesystem::path>()> list_files)
+{
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		_pending_list_files = std::move(list_files);
+
+		// A running update thread picks up the new file list once it is done with the current one
+		if (_updating)
+			return;
+		_updating = true;
+	}
+
+	// The previous thread has finished at this point (since it reset the updating flag), but still need to join it prior to destruction
+	if (_update_thread.joinable())
+		_update_thread.join();
+
+	_update_thread = std::thread(&search_index::update_thread, this);
+}
+void reshade::search_index::wait_for_update()
+{
+	if (_update_thread.joinable())
+		_update_thread.join();
+}
+
+void reshade::search_index::update_thread()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (_pending_list_files && !_abort_update)
+	{
+		const std::function<std::vector<std::filesystem::path>()> list_files = std::move(_pending_list_files);
+		_pending_list_files = nullptr;
+
+		// Take a snapshot of the modification times of the indexed files, so the file system can be queried without holding the lock
+		std::unordered_map<std::filesystem::path::string_type, std::filesystem::file_time_type> indexed_files;
+		for (const auto &[key, index] : _file_lookup)
+			indexed_files.emplace(key, _files[index].modified_at);
+
+		lock.unlock();
+
+		const std::vector<std::filesystem::path> files = list_files();
+
+		std::vector<file_entry> modified_files;
+		std::unordered_set<std::filesystem::path::string_type> existing_files;
+
+		for (const std::filesystem::path &path : files)
+		{
+			if (_abort_update)
+				break;
+
+			std::error_code ec;
+			const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(path, ec);
+			if (ec || !existing_files.insert(path.native()).second)
+				continue; // Skip files that do not exist and duplicates
+
+			// Only need to read files that are new or were modified since the last update
+			if (const auto it = indexed_files.find(path.native());
+				it != indexed_files.end() && it->second == modified_at)
+				continue;
+
+			file_entry &entry = modified_files.emplace_back();
+			entry.path = path;
+			entry.modified_at = modified_at;
+
+			if (!read_file(entry))
+			{
+				existing_files.erase(path.native());
+				modified_files.pop_back();
+			}
+		}
+
+		lock.lock();
+
+		if (_abort_update)
+			break;
+
+		// Remove all files that no longer exist or are no longer in the list
+		std::vector<size_t> removed_files;
+		for (const auto &[key, index] : _file_lookup)
+			if (existing_files.find(key) == existing_files.end())
+				removed_files.push_back(index);
+		for (const size_t index : removed_files)
+			remove_file(index);
+
+		for (file_entry &entry : modified_files)
+			add_file(std::move(entry));
+	}
+
+	_updating = false;
+}
+
+bool reshade::search_index::read_file(file_entry &entry)
+{
+	std::ifstream file(entry.path, std::ios::binary);
+	if (!file)
+		return false;
+
+	entry.content.assign(std::istreambuf_iterator<char>(file.rdbuf()), std::istreambuf_iterator<char>());
+
+	entry.line_offsets.clear();
+	entry.line_offsets.push_back(0);
+	for (size_t offset = 0; (offset = entry.content.find('\n', offset)) != std::string::npos;)
+		entry.line_offsets.push_back(++offset);
+
+	entry.trigrams = compute_trigrams(entry.content);
+
+	return true;
+}
+
+void reshade::search_index::add_file(file_entry &&entry)
+{
+	// Replace any previous version of this file
+	if (const auto it = _file_lookup.find(entry.path.native());
+		it != _file_lookup.end())
+		remove_file(it->second);
+
+	size_t index = _files.size();
+	if (_free_file_indices.empty())
+	{
+		_files.emplace_back();
+	}
+	else
+	{
+		index = _free_file_indices.back();
+		_free_file_indices.pop_back();
+	}
+
+	for (const uint32_t trigram : entry.trigrams)
+	{
+		std::vector<size_t> &list = _trigram_lookup[trigram];
+		list.insert(std::upper_bound(list.begin(), list.end(), index), index);
+	}
+
+	_file_lookup[entry.path.native()] = index;
+	_files[index] = std::move(entry);
+}
+void reshade::search_index::remove_file(size_t index)
+{
+	file_entry &entry = _files[index];
+
+	for (const uint32_t trigram : entry.trigrams)
+	{
+		const auto it = _trigram_lookup.find(trigram);
+		if (it == _trigram_lookup.end())
+			continue;
+
+		std::vector<size_t> &list = it->second;
+		if (const auto list_it = std::lower_bound(list.begin(), list.end(), index);
+			list_it != list.end() && *list_it == index)
+			list.erase(list_it);
+
+		if (list.empty())
+			_trigram_lookup.erase(it);
+	}
+
+	_file_lookup.erase(entry.path.native());
+	entry = file_entry();
+
+	_free_file_indices.push_back(index);
+}
+
+std::vector<size_t> reshade::search_index::find_candidates(const std::string &text) const
+{
+	std::vector<size_t> candidates;
+
+	// Text too short to contain a trigram can appear in any file
+	if (text.size() < 3)
+	{
+		for (const auto &[key, index] : _file_lookup)
+			candidates.push_back(index);
+		std::sort(candidates.begin(), candidates.end());
+		return candidates;
+	}
+
+	std::vector<const std::vector<size_t> *> lists;
+	for (const uint32_t trigram : compute_trigrams(text))
+	{
+		const auto it = _trigram_lookup.find(trigram);
+		if (it == _trigram_lookup.end())
+			return candidates; // No file contains this trigram, so none can contain the text
+		lists.push_back(&it->second);
+	}
+
+	// Intersect the shortest lists first to keep the candidate set small
+	std::sort(lists.begin(), lists.end(),
+		[](const std::vector<size_t> *lhs, const std::vector<size_t> *rhs) { return lhs->size() < rhs->size(); });
+
+	candidates = *lists[0];
+	for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+	{
+		std::vector<size_t> intersection;
+		std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(intersection));
+		candidates = std::move(intersection);
+	}
+
+	return candidates;
+}
+
+reshade::search_index::match reshade::search_index::make_match(const file_entry &entry, size_t offset) const
+{
+	const size_t line = std::distance(entry.line_offsets.begin(), std::upper_bound(entry.line_offsets.begin(), entry.line_offsets.end(), offset)) - 1;
+	const size_t line_offset = entry.line_offsets[line];
+
+	size_t line_length = entry.content.find('\n', line_offset);
+	line_length = (line_length != std::string::npos ? line_length : entry.content.size()) - line_offset;
+	if (line_length != 0 && entry.content[line_offset + line_length - 1] == '\r')
+		line_length--;
+
+	return { entry.path, line, offset - line_offset, entry.content.substr(line_offset, line_length) };
+}
+
+std::vector<reshade::search_index::match> reshade::search_index::find_text(const std::string &text, bool case_sensitive, size_t max_results) const
+{
+	std::vector<match> results;
+	if (text.empty())
+		return results;
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	for (const size_t index : find_candidates(text))
+	{
+		const file_entry &entry = _files[index];
+
+		// Candidates contain all trigrams of the text, but not necessarily in the right order, so need to verify each of them
+		for (auto it = entry.content.begin(); results.size() < max_results; it += text.size())
+		{
+			if (case_sensitive)
+				it = std::search(it, entry.content.end(), text.begin(), text.end());
+			else
+				it = std::search(it, entry.content.end(), text.begin(), text.end(),
+					[](char lhs, char rhs) { return to_lower(lhs) == to_lower(rhs); });
+
+			if (it == entry.content.end())
+				break;
+
+			results.push_back(make_match(entry, std::distance(entry.content.begin(), it)));
+		}
+
+		if (results.size() >= max_results)
+			break;
+	}
+
+	return results;
+}
+std::vector<reshade::search_index::match> reshade::search_index::find_definition(const std::string &identifier, size_t max_results) const
+{
+	std::vector<match> results;
+	if (identifier.empty())
+		return results;
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	for (const size_t index : find_candidates(identifier))
+	{
+		const file_entry &entry = _files[index];
+
+		// Only need to lex the few files that actually contain the identifier
+		reshadefx::lexer lexer(
+			entry.content,
+			true  /* ignore_comments */,
+			true  /* ignore_whitespace */,
+			false /* ignore_pp_directives */,
+			true  /* ignore_line_directives */,
+			false /* ignore_keywords */,
+			false /* escape_string_literals */);
+
+		reshadefx::tokenid prev_token = reshadefx::tokenid::unknown;
+
+		for (reshadefx::token tok; (tok = lexer.lex()).id != reshadefx::tokenid::end_of_file && results.size() < max_results; prev_token = tok.id)
+			if (tok.id == reshadefx::tokenid::identifier && tok.literal_as_string == identifier && is_declaration_prefix(prev_token))
+				results.push_back(make_match(entry, tok.offset));
+
+		if (results.size() >= max_results)
+			break;
+	}
+
+	return results;
+}
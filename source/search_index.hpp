@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// A trigram index over the contents of a set of text files, which is built on a background thread and allows searching all of them at once.
+	/// </summary>
+	class search_index
+	{
+	public:
+		/// <summary>
+		/// Location of a search result.
+		/// </summary>
+		struct match
+		{
+			std::filesystem::path file_path;
+			size_t line, column; // Zero-based, so they can be passed to the code editor directly
+			std::string line_text;
+		};
+
+		search_index() = default;
+		~search_index();
+
+		search_index(const search_index &) = delete;
+		search_index &operator=(const search_index &) = delete;
+
+		/// <summary>
+		/// Synchronize the index with the specified list of files.
+		/// Files that are new or were modified since the last update are (re-)indexed on a background thread, files no longer in the list are removed.
+		/// </summary>
+		/// <param name="files">The full list of files that should be searchable.</param>
+		void update(std::vector<std::filesystem::path> files);
+		/// <summary>
+		/// Synchronize the index with the list of files returned by <paramref name="list_files"/>, which is called on the background thread, so that the calling thread does not have to access the file system at all.
+		/// </summary>
+		/// <param name="list_files">Function with the signature <c>std::vector&lt;std::filesystem::path&gt;()</c> that returns the full list of files that should be searchable.</param>
+		void update(std::function<std::vector<std::filesystem::path>()> list_files);
+		/// <summary>
+		/// Block until any pending update has finished.
+		/// </summary>
+		void wait_for_update();
+		/// <summary>
+		/// Returns whether an update is currently in progress on the background thread.
+		/// </summary>
+		bool is_updating() const { return _updating; }
+
+		/// <summary>
+		/// Find all occurrences of the specified <paramref name="text"/> in the indexed files.
+		/// </summary>
+		/// <param name="text">The text to search for (may not span multiple lines).</param>
+		/// <param name="case_sensitive">Set to <c>true</c> to only return matches with the exact same casing.</param>
+		/// <param name="max_results">The maximum number of matches to return.</param>
+		std::vector<match> find_text(const std::string &text, bool case_sensitive = false, size_t max_results = 1000) const;
+		/// <summary>
+		/// Find all places where the specified <paramref name="identifier"/> is declared in the indexed files (macros, types, functions and variables).
+		/// </summary>
+		/// <param name="identifier">The name of the symbol to look up.</param>
+		/// <param name="max_results">The maximum number of matches to return.</param>
+		std::vector<match> find_definition(const std::string &identifier, size_t max_results = 100) const;
+
+	private:
+		struct file_entry
+		{
+			std::filesystem::path path;
+			std::filesystem::file_time_type modified_at;
+			std::string content;
+			std::vector<size_t> line_offsets;
+			std::vector<uint32_t> trigrams;
+		};
+
+		static bool read_file(file_entry &entry);
+
+		void update_thread();
+
+		void add_file(file_entry &&entry);
+		void remove_file(size_t index);
+
+		std::vector<size_t> find_candidates(const std::string &text) const;
+		match make_match(const file_entry &entry, size_t offset) const;
+
+		mutable std::mutex _mutex;
+		std::thread _update_thread;
+		std::atomic<bool> _updating = false;
+		std::atomic<bool> _abort_update = false;
+		std::function<std::vector<std::filesystem::path>()> _pending_list_files;
+
+		std::vector<file_entry> _files;
+		std::vector<size_t> _free_file_indices;
+		std::unordered_map<std::filesystem::path::string_type, size_t> _file_lookup;
+		// Maps each trigram to a sorted list of indices of the files containing it
+		std::unordered_map<uint32_t, std::vector<size_t>> _trigram_lookup;
+	};
+}
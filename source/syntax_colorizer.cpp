@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "syntax_colorizer.hpp"
+#include "effect_lexer.hpp"
+#include <algorithm>
+
+reshade::gui::code_editor::line_state reshade::gui::colorize_line(const char *text, size_t length, code_editor::line_state state, code_editor::color *colors)
+{
+	size_t column_offset = 0;
+
+	// Continue a multi-line comment from a previous line up to its terminator
+	if (state == code_editor::line_state::multi_line_comment)
+	{
+		for (; column_offset < length; ++column_offset)
+		{
+			colors[column_offset] = code_editor::color_multiline_comment;
+
+			if (column_offset != 0 && text[column_offset - 1] == '*' && text[column_offset] == '/')
+			{
+				state = code_editor::line_state::normal;
+				column_offset++;
+				break;
+			}
+		}
+
+		if (state == code_editor::line_state::multi_line_comment)
+			return state;
+	}
+
+	// Reset color of whitespace, which the lexer does not generate tokens for
+	std::fill(colors + column_offset, colors + length, code_editor::color_default);
+
+	// The lexer treats a '#' at the beginning of a line as the start of a directive, which is wrong on lines that continue a directive (e.g. the '#' stringize operator in a macro), so pretend the line does not begin there
+	const reshadefx::location start_location(1, state == code_editor::line_state::continued_directive ? 2 : 1);
+
+	reshadefx::lexer lexer(
+		text + column_offset,
+		text + length,
+		false /* ignore_comments */,
+		true  /* ignore_whitespace */,
+		false /* ignore_pp_directives */,
+		true  /* ignore_line_directives */,
+		false /* ignore_keywords */,
+		false /* escape_string_literals */,
+		start_location);
+
+	bool in_directive = state == code_editor::line_state::continued_directive;
+	bool ends_with_backslash = false;
+	state = code_editor::line_state::normal;
+
+	for (reshadefx::token tok; (tok = lexer.lex()).id != reshadefx::tokenid::end_of_file;)
+	{
+		code_editor::color col = code_editor::color_default;
+
+		switch (tok.id)
+		{
+		case reshadefx::tokenid::exclaim:
+		case reshadefx::tokenid::percent:
+		case reshadefx::tokenid::ampersand:
+		case reshadefx::tokenid::parenthesis_open:
+		case reshadefx::tokenid::parenthesis_close:
+		case reshadefx::tokenid::star:
+		case reshadefx::tokenid::plus:
+		case reshadefx::tokenid::comma:
+		case reshadefx::tokenid::minus:
+		case reshadefx::tokenid::dot:
+		case reshadefx::tokenid::slash:
+		case reshadefx::tokenid::colon:
+		case reshadefx::tokenid::semicolon:
+		case reshadefx::tokenid::less:
+		case reshadefx::tokenid::equal:
+		case reshadefx::tokenid::greater:
+		case reshadefx::tokenid::question:
+		case reshadefx::tokenid::bracket_open:
+		case reshadefx::tokenid::backslash:
+		case reshadefx::tokenid::bracket_close:
+		case reshadefx::tokenid::caret:
+		case reshadefx::tokenid::brace_open:
+		case reshadefx::tokenid::pipe:
+		case reshadefx::tokenid::brace_close:
+		case reshadefx::tokenid::tilde:
+		case reshadefx::tokenid::exclaim_equal:
+		case reshadefx::tokenid::percent_equal:
+		case reshadefx::tokenid::ampersand_ampersand:
+		case reshadefx::tokenid::ampersand_equal:
+		case reshadefx::tokenid::star_equal:
+		case reshadefx::tokenid::plus_plus:
+		case reshadefx::tokenid::plus_equal:
+		case reshadefx::tokenid::minus_minus:
+		case reshadefx::tokenid::minus_equal:
+		case reshadefx::tokenid::arrow:
+		case reshadefx::tokenid::ellipsis:
+		case reshadefx::tokenid::slash_equal:
+		case reshadefx::tokenid::colon_colon:
+		case reshadefx::tokenid::less_less_equal:
+		case reshadefx::tokenid::less_less:
+		case reshadefx::tokenid::less_equal:
+		case reshadefx::tokenid::equal_equal:
+		case reshadefx::tokenid::greater_greater_equal:
+		case reshadefx::tokenid::greater_greater:
+		case reshadefx::tokenid::greater_equal:
+		case reshadefx::tokenid::caret_equal:
+		case reshadefx::tokenid::pipe_equal:
+		case reshadefx::tokenid::pipe_pipe:
+			col = code_editor::color_punctuation;
+			break;
+		case reshadefx::tokenid::identifier:
+			col = code_editor::color_identifier;
+			break;
+		case reshadefx::tokenid::int_literal:
+		case reshadefx::tokenid::uint_literal:
+		case reshadefx::tokenid::float_literal:
+		case reshadefx::tokenid::double_literal:
+			col = code_editor::color_number_literal;
+			break;
+		case reshadefx::tokenid::string_literal:
+			col = code_editor::color_string_literal;
+			break;
+		case reshadefx::tokenid::true_literal:
+		case reshadefx::tokenid::false_literal:
+		case reshadefx::tokenid::namespace_:
+		case reshadefx::tokenid::struct_:
+		case reshadefx::tokenid::technique:
+		case reshadefx::tokenid::pass:
+		case reshadefx::tokenid::for_:
+		case reshadefx::tokenid::while_:
+		case reshadefx::tokenid::do_:
+		case reshadefx::tokenid::if_:
+		case reshadefx::tokenid::else_:
+		case reshadefx::tokenid::switch_:
+		case reshadefx::tokenid::case_:
+		case reshadefx::tokenid::default_:
+		case reshadefx::tokenid::break_:
+		case reshadefx::tokenid::continue_:
+		case reshadefx::tokenid::return_:
+		case reshadefx::tokenid::discard_:
+		case reshadefx::tokenid::extern_:
+		case reshadefx::tokenid::static_:
+		case reshadefx::tokenid::uniform_:
+		case reshadefx::tokenid::volatile_:
+		case reshadefx::tokenid::precise:
+		case reshadefx::tokenid::groupshared:
+		case reshadefx::tokenid::in:
+		case reshadefx::tokenid::out:
+		case reshadefx::tokenid::inout:
+		case reshadefx::tokenid::const_:
+		case reshadefx::tokenid::linear:
+		case reshadefx::tokenid::noperspective:
+		case reshadefx::tokenid::centroid:
+		case reshadefx::tokenid::nointerpolation:
+		case reshadefx::tokenid::void_:
+		case reshadefx::tokenid::bool_:
+		case reshadefx::tokenid::bool2:
+		case reshadefx::tokenid::bool3:
+		case reshadefx::tokenid::bool4:
+		case reshadefx::tokenid::bool2x2:
+		case reshadefx::tokenid::bool2x3:
+		case reshadefx::tokenid::bool2x4:
+		case reshadefx::tokenid::bool3x2:
+		case reshadefx::tokenid::bool3x3:
+		case reshadefx::tokenid::bool3x4:
+		case reshadefx::tokenid::bool4x2:
+		case reshadefx::tokenid::bool4x3:
+		case reshadefx::tokenid::bool4x4:
+		case reshadefx::tokenid::int_:
+		case reshadefx::tokenid::int2:
+		case reshadefx::tokenid::int3:
+		case reshadefx::tokenid::int4:
+		case reshadefx::tokenid::int2x2:
+		case reshadefx::tokenid::int2x3:
+		case reshadefx::tokenid::int2x4:
+		case reshadefx::tokenid::int3x2:
+		case reshadefx::tokenid::int3x3:
+		case reshadefx::tokenid::int3x4:
+		case reshadefx::tokenid::int4x2:
+		case reshadefx::tokenid::int4x3:
+		case reshadefx::tokenid::int4x4:
+		case reshadefx::tokenid::min16int:
+		case reshadefx::tokenid::min16int2:
+		case reshadefx::tokenid::min16int3:
+		case reshadefx::tokenid::min16int4:
+		case reshadefx::tokenid::uint_:
+		case reshadefx::tokenid::uint2:
+		case reshadefx::tokenid::uint3:
+		case reshadefx::tokenid::uint4:
+		case reshadefx::tokenid::uint2x2:
+		case reshadefx::tokenid::uint2x3:
+		case reshadefx::tokenid::uint2x4:
+		case reshadefx::tokenid::uint3x2:
+		case reshadefx::tokenid::uint3x3:
+		case reshadefx::tokenid::uint3x4:
+		case reshadefx::tokenid::uint4x2:
+		case reshadefx::tokenid::uint4x3:
+		case reshadefx::tokenid::uint4x4:
+		case reshadefx::tokenid::min16uint:
+		case reshadefx::tokenid::min16uint2:
+		case reshadefx::tokenid::min16uint3:
+		case reshadefx::tokenid::min16uint4:
+		case reshadefx::tokenid::float_:
+		case reshadefx::tokenid::float2:
+		case reshadefx::tokenid::float3:
+		case reshadefx::tokenid::float4:
+		case reshadefx::tokenid::float2x2:
+		case reshadefx::tokenid::float2x3:
+		case reshadefx::tokenid::float2x4:
+		case reshadefx::tokenid::float3x2:
+		case reshadefx::tokenid::float3x3:
+		case reshadefx::tokenid::float3x4:
+		case reshadefx::tokenid::float4x2:
+		case reshadefx::tokenid::float4x3:
+		case reshadefx::tokenid::float4x4:
+		case reshadefx::tokenid::min16float:
+		case reshadefx::tokenid::min16float2:
+		case reshadefx::tokenid::min16float3:
+		case reshadefx::tokenid::min16float4:
+		case reshadefx::tokenid::vector:
+		case reshadefx::tokenid::matrix:
+		case reshadefx::tokenid::string_:
+		case reshadefx::tokenid::texture:
+		case reshadefx::tokenid::sampler:
+		case reshadefx::tokenid::storage:
+			col = code_editor::color_keyword;
+			break;
+		case reshadefx::tokenid::hash_def:
+		case reshadefx::tokenid::hash_undef:
+		case reshadefx::tokenid::hash_if:
+		case reshadefx::tokenid::hash_ifdef:
+		case reshadefx::tokenid::hash_ifndef:
+		case reshadefx::tokenid::hash_else:
+		case reshadefx::tokenid::hash_elif:
+		case reshadefx::tokenid::hash_endif:
+		case reshadefx::tokenid::hash_error:
+		case reshadefx::tokenid::hash_warning:
+		case reshadefx::tokenid::hash_pragma:
+		case reshadefx::tokenid::hash_include:
+		case reshadefx::tokenid::hash_unknown:
+			col = code_editor::color_preprocessor;
+			tok.offset--; // Add # to token
+			tok.length++;
+			break;
+		case reshadefx::tokenid::single_line_comment:
+			col = code_editor::color_comment;
+			break;
+		case reshadefx::tokenid::multi_line_comment:
+			col = code_editor::color_multiline_comment;
+			break;
+		}
+
+		if (col == code_editor::color_preprocessor)
+			in_directive = true;
+		ends_with_backslash = tok.id == reshadefx::tokenid::backslash;
+
+		// Update character range matching the current the token
+		const size_t column = column_offset + tok.location.column - start_location.column;
+
+		for (size_t k = column; k < column + tok.length && k < length; ++k)
+			colors[k] = col;
+
+		// A multi-line comment that is not terminated on this line continues on the next one
+		// The lexer looks for the closing "*/" right after the opening slash (so "/*/" is a complete comment), which has to be matched here
+		if (tok.id == reshadefx::tokenid::multi_line_comment)
+			state = tok.length < 3 || text[column + tok.length - 2] != '*' || text[column + tok.length - 1] != '/' ?
+				code_editor::line_state::multi_line_comment : code_editor::line_state::normal;
+	}
+
+	// A directive continues on the next line if this one ends with a backslash
+	if (in_directive && ends_with_backslash && state == code_editor::line_state::normal)
+		state = code_editor::line_state::continued_directive;
+
+	return state;
+}
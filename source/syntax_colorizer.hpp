@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "imgui_editor.hpp"
+
+namespace reshade::gui
+{
+	/// <summary>
+	/// Colors a single line of effect code, continuing from the state at the end of the previous line.
+	/// </summary>
+	/// <param name="text">The characters of the line (without the line feed), which have to be followed by a null terminator.</param>
+	/// <param name="length">The number of characters in the line.</param>
+	/// <param name="state">The state at the beginning of the line.</param>
+	/// <param name="colors">Pointer to an array of <paramref name="length"/> colors that receives the color of each character.</param>
+	/// <returns>The state at the beginning of the next line.</returns>
+	code_editor::line_state colorize_line(const char *text, size_t length, code_editor::line_state state, code_editor::color *colors);
+}
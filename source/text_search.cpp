@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "text_search.hpp"
+#include <cstring>
+#include <algorithm>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanForward
+#endif
+#endif
+
+static inline char to_lower(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+static inline bool is_word_character(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+void reshade::find_all_occurrences(const std::string &text, const std::string &pattern, bool case_sensitive, bool whole_word, std::vector<size_t> &offsets)
+{
+	const size_t n = text.size();
+	const size_t m = pattern.size();
+	if (m == 0 || m > n)
+		return;
+
+	const char *const s = text.data();
+	const char *const p = pattern.data();
+
+	const auto is_match = [&](size_t pos) {
+		if (whole_word && ((pos != 0 && is_word_character(s[pos - 1])) || (pos + m < n && is_word_character(s[pos + m]))))
+			return false;
+		if (case_sensitive)
+			return std::memcmp(s + pos, p, m) == 0;
+		for (size_t i = 0; i < m; ++i)
+			if (to_lower(s[pos + i]) != to_lower(p[i]))
+				return false;
+		return true;
+	};
+
+	size_t pos = 0;
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	// Compare the first and last character of the pattern against 16 positions at once and only verify those where both match
+	if (case_sensitive && m > 1)
+	{
+		const __m128i first = _mm_set1_epi8(p[0]);
+		const __m128i last = _mm_set1_epi8(p[m - 1]);
+
+		for (size_t next_pos = 0; pos + m - 1 + 16 <= n; pos += 16)
+		{
+			const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + pos));
+			const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + pos + m - 1));
+
+			for (unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))); mask != 0; mask &= mask - 1)
+			{
+#ifdef _MSC_VER
+				unsigned long bit;
+				_BitScanForward(&bit, mask);
+#else
+				const unsigned int bit = __builtin_ctz(mask);
+#endif
+				// Skip candidates overlapping a previous match
+				if (const size_t candidate = pos + bit; candidate >= next_pos && is_match(candidate))
+				{
+					offsets.push_back(candidate);
+					next_pos = candidate + m;
+				}
+			}
+
+			if (pos + 16 < next_pos)
+				pos = next_pos - 16;
+		}
+
+		if (!offsets.empty())
+			pos = std::max(pos, offsets.back() + m);
+	}
+#endif
+
+	// Search the remainder using the Boyer-Moore-Horspool algorithm, which skips ahead based on the last character of the current window
+	size_t skip_table[256];
+	std::fill_n(skip_table, 256, m);
+	for (size_t i = 0; i + 1 < m; ++i)
+		skip_table[static_cast<uint8_t>(case_sensitive ? p[i] : to_lower(p[i]))] = m - 1 - i;
+
+	while (pos + m <= n)
+	{
+		if (is_match(pos))
+		{
+			offsets.push_back(pos);
+			pos += m;
+			continue;
+		}
+
+		const char last = s[pos + m - 1];
+		pos += skip_table[static_cast<uint8_t>(case_sensitive ? last : to_lower(last))];
+	}
+}
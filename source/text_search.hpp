@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace reshade
+{
+	/// <summary>
+	/// Finds all non-overlapping occurrences of a pattern in a text, from left to right.
+	/// </summary>
+	/// <param name="text">The text to search.</param>
+	/// <param name="pattern">The text to search for.</param>
+	/// <param name="case_sensitive">Set to <c>false</c> to ignore the case of ASCII letters (all other bytes have to match exactly).</param>
+	/// <param name="whole_word">Set to <c>true</c> to only report occurrences that are not directly preceded or followed by a letter, digit or underscore.</param>
+	/// <param name="offsets">Receives the offset of the first character of each occurrence.</param>
+	void find_all_occurrences(const std::string &text, const std::string &pattern, bool case_sensitive, bool whole_word, std::vector<size_t> &offsets);
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <numeric>
+#include <algorithm>
+
+namespace reshade
+{
+	/// <summary>
+	/// Plans which transient render targets can share the same texture, because they have the same description and are never alive at the same time.
+	/// Lifetimes are ranges of positions on a timeline of passes. Resources are assigned in the order they become alive and each one reuses the first texture that is no longer in use by then, which results in the minimal number of textures for every description.
+	/// This only looks at the lifetimes passed in, it is up to the caller to only pass in resources whose contents do not have to be preserved outside their lifetime.
+	/// </summary>
+	class texture_alias_planner
+	{
+	public:
+		struct resource
+		{
+			uint32_t width;
+			uint32_t height;
+			uint32_t levels;
+			reshadefx::texture_format format;
+			uint32_t first_use; // Position of the pass that first writes the resource
+			uint32_t last_use; // Position of the last pass that accesses the resource
+		};
+
+		/// <summary>
+		/// Assigns a texture to each of the specified resources.
+		/// </summary>
+		/// <returns>The index of the resource whose texture should be used for each resource, which is the index of the resource itself for those that keep their own.</returns>
+		static std::vector<size_t> plan(const std::vector<resource> &resources)
+		{
+			std::vector<size_t> order(resources.size());
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(),
+				[&resources](size_t lhs, size_t rhs) { return resources[lhs].first_use < resources[rhs].first_use; });
+
+			struct texture
+			{
+				size_t owner;
+				uint32_t in_use_until;
+			};
+
+			std::vector<texture> textures;
+			std::vector<size_t> assignment(resources.size());
+
+			for (const size_t index : order)
+			{
+				const resource &res = resources[index];
+
+				// A texture cannot be reused in the pass it was last accessed in, since it may still be read there
+				if (const auto it = std::find_if(textures.begin(), textures.end(),
+					[&resources, &res](const texture &tex) { return tex.in_use_until < res.first_use && matches_description(resources[tex.owner], res); });
+					it != textures.end())
+				{
+					it->in_use_until = res.last_use;
+					assignment[index] = it->owner;
+				}
+				else
+				{
+					textures.push_back({ index, res.last_use });
+					assignment[index] = index;
+				}
+			}
+
+			return assignment;
+		}
+
+	private:
+		static bool matches_description(const resource &lhs, const resource &rhs)
+		{
+			return lhs.width == rhs.width && lhs.height == rhs.height && lhs.levels == rhs.levels && lhs.format == rhs.format;
+		}
+	};
+}
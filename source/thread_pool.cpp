@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "thread_pool.hpp"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+reshade::thread_pool::thread_pool(size_t num_threads) :
+	_num_threads(std::max(num_threads, size_t(1)))
+{
+}
+reshade::thread_pool::~thread_pool()
+{
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+
+	_task_added.notify_all();
+
+	for (std::thread &thread : _threads)
+		thread.join();
+}
+
+void reshade::thread_pool::submit(std::function<void()> task)
+{
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(task));
+
+		// Start threads on first use (they wait for the lock held here before looking at the queue)
+		if (_threads.empty())
+			for (size_t i = 0; i < _num_threads; ++i)
+				_threads.emplace_back(&thread_pool::thread_main, this);
+	}
+
+	_task_added.notify_one();
+}
+
+void reshade::thread_pool::parallel_for(size_t count, const std::function<void(size_t index)> &func)
+{
+	if (count == 0)
+		return;
+
+	// Helper tasks may only start after this call returned, so the state they access has to outlive it
+	struct shared_state
+	{
+		std::atomic<size_t> next_index = 0;
+		size_t num_finished = 0;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	const auto state = std::make_shared<shared_state>();
+
+	// Late helpers never call the function, since all indices were taken by then
+	const auto run = [state, &func, count]() {
+		for (size_t index; (index = state->next_index++) < count;)
+		{
+			func(index);
+
+			const std::lock_guard<std::mutex> lock(state->mutex);
+			if (++state->num_finished == count)
+				state->finished.notify_all();
+		}
+	};
+
+	for (size_t i = 0; i < std::min(count - 1, _num_threads); ++i)
+		submit(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state, count]() { return state->num_finished == count; });
+}
+
+void reshade::thread_pool::thread_main()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_task_added.wait(lock, [this]() { return _exit || !_tasks.empty(); });
+		if (_tasks.empty())
+			break; // Only exit once all queued tasks are done
+
+		const std::function<void()> task = std::move(_tasks.front());
+		_tasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
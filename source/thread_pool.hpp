@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// A fixed number of background threads that execute queued tasks in order.
+	/// All background work that may run in parallel (e.g. encoding screenshots) should share the same pool, so that the total number of threads stays bounded no matter how much work is queued.
+	/// </summary>
+	class thread_pool
+	{
+	public:
+		/// <summary>
+		/// Create a pool with the specified number of threads.
+		/// The threads are only started once the first task is submitted, so that a pool which is never used does not cost anything.
+		/// </summary>
+		explicit thread_pool(size_t num_threads);
+		/// <summary>
+		/// Wait for all queued tasks to finish and stop the threads.
+		/// </summary>
+		~thread_pool();
+
+		thread_pool(const thread_pool &) = delete;
+		thread_pool &operator=(const thread_pool &) = delete;
+
+		/// <summary>
+		/// Returns the number of threads in this pool.
+		/// </summary>
+		size_t num_threads() const { return _num_threads; }
+
+		/// <summary>
+		/// Queue a task for execution on one of the threads of this pool.
+		/// </summary>
+		void submit(std::function<void()> task);
+		/// <summary>
+		/// Call a function for every index in the range [0, count) using the threads of this pool and block until all calls have returned.
+		/// The calling thread takes part in the work, so this may also be called from a task running on this pool without deadlocking.
+		/// </summary>
+		void parallel_for(size_t count, const std::function<void(size_t index)> &func);
+
+	private:
+		void thread_main();
+
+		std::mutex _mutex;
+		std::condition_variable _task_added;
+		std::deque<std::function<void()>> _tasks;
+		std::vector<std::thread> _threads;
+		const size_t _num_threads;
+		bool _exit = false;
+	};
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+
+namespace reshade
+{
+	/// <summary>
+	/// Schedules the timestamp queries of a technique over a ring of slots, so that timestamps can be written every frame while results of previous frames are still in flight.
+	/// Each slot holds a fixed number of timestamps (one before the first pass and one after each pass). Results are read back in submission order and only without waiting, so the CPU never stalls on the GPU.
+	/// The actual queries are owned by the render backend, which accesses them through the slot and query indices returned here.
+	/// </summary>
+	class timestamp_query_ring
+	{
+	public:
+		static constexpr uint32_t MAX_TIMESTAMPS = 64;
+		static constexpr uint32_t no_slot = UINT32_MAX;
+
+		enum class status
+		{
+			pending,
+			available,
+			invalid, // Results are available, but not usable (e.g. because the timestamp frequency changed in between)
+		};
+
+		timestamp_query_ring(uint32_t num_slots = 4, uint32_t num_timestamps = 2) :
+			_num_slots(num_slots), _num_timestamps(num_timestamps)
+		{
+			assert(num_slots != 0 && num_timestamps >= 2 && num_timestamps <= MAX_TIMESTAMPS);
+		}
+
+		uint32_t num_slots() const { return _num_slots; }
+		uint32_t num_timestamps() const { return _num_timestamps; }
+		uint32_t num_in_flight() const { return _num_in_flight; }
+
+		/// <summary>
+		/// Gets the index of the query for the specified timestamp in the specified slot, relative to the first query of this ring.
+		/// </summary>
+		uint32_t query_index(uint32_t slot, uint32_t timestamp_index) const
+		{
+			assert(slot < _num_slots && timestamp_index < _num_timestamps);
+			return slot * _num_timestamps + timestamp_index;
+		}
+
+		/// <summary>
+		/// Converts raw timestamps from GPU ticks to nanoseconds relative to the first one.
+		/// Differences are computed modulo the range of the counter and before scaling, so that neither a counter that wrapped around in between nor large absolute tick values cause an overflow.
+		/// </summary>
+		/// <param name="timestamps">The timestamps of a slot in ticks, which are replaced with nanoseconds.</param>
+		/// <param name="nanoseconds_per_tick">The period of the timestamp counter.</param>
+		/// <param name="valid_bits">The number of bits of the timestamp counter that are valid, after which it wraps around.</param>
+		/// <returns><see cref="status::available"/> on success, <see cref="status::invalid"/> if a timestamp lies outside of the range between the first and the last one.</returns>
+		static status convert_ticks_to_nanoseconds(uint64_t *timestamps, uint32_t num_timestamps, double nanoseconds_per_tick, uint32_t valid_bits = 64)
+		{
+			assert(num_timestamps != 0 && valid_bits != 0 && valid_bits <= 64);
+
+			const uint64_t mask = UINT64_MAX >> (64 - valid_bits);
+			const uint64_t first = timestamps[0];
+			const uint64_t total = (timestamps[num_timestamps - 1] - first) & mask;
+
+			// A duration longer than half the range of the counter is far more likely to be a last timestamp that went backwards
+			if (total > mask / 2)
+				return status::invalid;
+
+			for (uint32_t i = 0; i < num_timestamps; ++i)
+			{
+				const uint64_t delta = (timestamps[i] - first) & mask;
+
+				// All timestamps are written between the first and the last one, so one that lies outside means the counter wrapped around further than can be told apart (or went backwards)
+				if (delta > total)
+					return status::invalid;
+
+				timestamps[i] = static_cast<uint64_t>(delta * nanoseconds_per_tick);
+			}
+
+			return status::available;
+		}
+
+		/// <summary>
+		/// Reads back the results of all slots that finished on the GPU, starting with the oldest one and stopping at the first one that has not.
+		/// </summary>
+		/// <param name="read_func">Function with the signature <c>status(uint32_t slot, uint64_t *timestamps)</c>, which fills in the timestamps of a slot in nanoseconds without waiting for them.</param>
+		/// <param name="result_func">Function with the signature <c>void(const uint64_t *timestamps, uint32_t num_timestamps)</c>, which is called for each slot with available results.</param>
+		template <typename R, typename F>
+		void collect(R read_func, F result_func)
+		{
+			uint64_t timestamps[MAX_TIMESTAMPS];
+
+			while (_num_in_flight != 0)
+			{
+				const status result = read_func(_first_in_flight, timestamps);
+				if (result == status::pending)
+					break;
+
+				if (result == status::available)
+					result_func(static_cast<const uint64_t *>(timestamps), _num_timestamps);
+
+				_first_in_flight = (_first_in_flight + 1) % _num_slots;
+				_num_in_flight--;
+			}
+		}
+
+		/// <summary>
+		/// Gets the slot to write the timestamps of the current frame to.
+		/// </summary>
+		/// <returns>The index of a free slot, or <see cref="no_slot"/> if all slots are still in flight, in which case no timestamps should be written this frame.</returns>
+		uint32_t acquire() const
+		{
+			if (_num_in_flight == _num_slots)
+				return no_slot;
+
+			return (_first_in_flight + _num_in_flight) % _num_slots;
+		}
+		/// <summary>
+		/// Marks the slot returned by <see cref="acquire"/> as in flight after all its timestamps were written.
+		/// </summary>
+		void submit(uint32_t slot)
+		{
+			assert(slot == acquire());
+			(void)slot;
+
+			_num_in_flight++;
+		}
+
+		/// <summary>
+		/// Discards all slots that are in flight, e.g. after the queries were recreated.
+		/// </summary>
+		void reset()
+		{
+			_first_in_flight = 0;
+			_num_in_flight = 0;
+		}
+
+	private:
+		uint32_t _num_slots;
+		uint32_t _num_timestamps;
+		uint32_t _first_in_flight = 0;
+		uint32_t _num_in_flight = 0;
+	};
+}
@@ -8,7 +8,9 @@
 #include "dll_resources.hpp"
 #include "runtime_vk.hpp"
 #include "runtime_objects.hpp"
+#include "timestamp_query_ring.hpp"
 #include "format_utils.hpp"
+#include "pixel_kernels.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 
@@ -58,9 +60,18 @@ namespace reshade::vulkan
 	{
 		bool has_compute_passes = false;
 		uint32_t query_base_index = 0;
+		timestamp_query_ring query_ring;
+		std::vector<uint32_t> query_cmd_index; // One per slot in the query ring
+		std::vector<uint64_t> query_framecount;
 		std::vector<pass_data> passes;
 	};
 
+	uint32_t num_timestamps_for_technique(size_t num_passes)
+	{
+		// Write a timestamp before the first and after each pass, unless there are too many passes, in which case only the entire technique is measured
+		return num_passes < timestamp_query_ring::MAX_TIMESTAMPS ? static_cast<uint32_t>(num_passes + 1) : 2;
+	}
+
 	const uint32_t MAX_IMAGE_DESCRIPTOR_SETS = 128; // TODO: Check if these limits are enough
 	const uint32_t MAX_EFFECT_DESCRIPTOR_SETS = 50 * 2 * 4; // 50 resources, 4 passes
 
@@ -138,6 +149,14 @@ reshade::vulkan::runtime_vk::runtime_vk(VkDevice device, VkPhysicalDevice physic
 	instance_table.GetPhysicalDeviceProperties(physical_device, &_device_props);
 	instance_table.GetPhysicalDeviceMemoryProperties(physical_device, &_memory_props);
 
+	// Timestamps written on the queue only have a limited number of valid bits, after which they wrap around
+	uint32_t num_queue_families = 0;
+	instance_table.GetPhysicalDeviceQueueFamilyProperties(physical_device, &num_queue_families, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(num_queue_families);
+	instance_table.GetPhysicalDeviceQueueFamilyProperties(physical_device, &num_queue_families, queue_families.data());
+	if (_queue_family_index < num_queue_families)
+		_timestamp_valid_bits = queue_families[_queue_family_index].timestampValidBits;
+
 	_renderer_id = 0x20000 |
 		VK_VERSION_MAJOR(_device_props.apiVersion) << 12 |
 		VK_VERSION_MINOR(_device_props.apiVersion) <<  8;
@@ -475,6 +494,10 @@ void reshade::vulkan::runtime_vk::on_reset()
 	// Make sure none of the resources below are currently in use
 	wait_for_command_buffers();
 
+	for (uint32_t slot = 0; slot < NUM_READBACK_SLOTS; ++slot)
+		vmaDestroyBuffer(_alloc, _readback_buffers[slot], _readback_buffers_mem[slot]),
+		_readback_buffers[slot] = VK_NULL_HANDLE, _readback_buffers_mem[slot] = VK_NULL_HANDLE;
+
 	for (VkImageView view : _swapchain_views)
 		vk.DestroyImageView(_device, view, nullptr);
 	_swapchain_views.clear();
@@ -662,40 +685,16 @@ bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
 		return false;
 	}
 
-	const size_t data_pitch = _width * 4;
-
 	VkBuffer intermediate = VK_NULL_HANDLE;
 	VmaAllocation intermediate_mem = VK_NULL_HANDLE;
-
-	{   VkBufferCreateInfo create_info { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		create_info.size = data_pitch * _height;
-		create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-		VmaAllocationCreateInfo alloc_info = {};
-		alloc_info.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
-
-		check_result(vmaCreateBuffer(_alloc, &create_info, &alloc_info, &intermediate, &intermediate_mem, nullptr)) false;
-	}
+	if (!create_screenshot_buffer(intermediate, intermediate_mem))
+		return false;
 
 	// Copy image into download buffer
 	uint8_t *mapped_data = nullptr;
 	if (begin_command_buffer())
 	{
-		const VkCommandBuffer cmd_list = _cmd_buffers[_cmd_index].first;
-
-		transition_layout(vk, cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-		{
-			VkBufferImageCopy copy;
-			copy.bufferOffset = 0;
-			copy.bufferRowLength = _width;
-			copy.bufferImageHeight = _height;
-			copy.imageOffset = { 0, 0, 0 };
-			copy.imageExtent = { _width, _height, 1 };
-			copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-
-			vk.CmdCopyImageToBuffer(cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, intermediate, 1, &copy);
-		}
-		transition_layout(vk, cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		record_screenshot_copy(intermediate);
 
 		// Wait for any rendering by the application finish before submitting
 		// It may have submitted that to a different queue, so simply wait for all to idle here
@@ -714,36 +713,7 @@ bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
 
 	if (mapped_data != nullptr)
 	{
-		for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += data_pitch)
-		{
-			if (_color_bit_depth == 10)
-			{
-				for (uint32_t x = 0; x < data_pitch; x += 4)
-				{
-					const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-					// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-					buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-					buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-					buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-					buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-					if (_backbuffer_format >= VK_FORMAT_A2B10G10R10_UNORM_PACK32 &&
-						_backbuffer_format <= VK_FORMAT_A2B10G10R10_SINT_PACK32)
-						std::swap(buffer[x + 0], buffer[x + 2]);
-				}
-			}
-			else
-			{
-				std::memcpy(buffer, mapped_data, data_pitch);
-
-				if (_backbuffer_format >= VK_FORMAT_B8G8R8A8_UNORM &&
-					_backbuffer_format <= VK_FORMAT_B8G8R8A8_SRGB)
-				{
-					// Format is BGRA, but output should be RGBA, so flip channels
-					for (uint32_t x = 0; x < data_pitch; x += 4)
-						std::swap(buffer[x + 0], buffer[x + 2]);
-				}
-			}
-		}
+		copy_screenshot_rows(buffer, mapped_data);
 
 		vmaUnmapMemory(_alloc, intermediate_mem);
 	}
@@ -753,6 +723,97 @@ bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
 	return mapped_data != nullptr;
 }
 
+bool reshade::vulkan::runtime_vk::begin_frame_readback(uint32_t slot)
+{
+	// Unsupported formats are reported by 'capture_screenshot'
+	if (_color_bit_depth != 8 && _color_bit_depth != 10)
+		return false;
+
+	if (_readback_buffers[slot] == VK_NULL_HANDLE && !create_screenshot_buffer(_readback_buffers[slot], _readback_buffers_mem[slot]))
+		return false;
+
+	if (!begin_command_buffer())
+		return false;
+
+	// The copy is submitted with the rest of this frame, which waits for the application to finish rendering it (see 'on_present')
+	record_screenshot_copy(_readback_buffers[slot]);
+
+	_readback_cmd_index[slot] = _cmd_index;
+	_readback_framecount[slot] = _framecount;
+
+	return true;
+}
+reshade::runtime::readback_status reshade::vulkan::runtime_vk::finish_frame_readback(uint32_t slot, uint8_t *buffer)
+{
+	// Do not block if the copy has not finished yet, just try again next frame
+	// Once the command buffer of that frame was reused, its fence was waited on already, so only need to check the fence before that
+	if (_framecount - _readback_framecount[slot] < NUM_COMMAND_FRAMES &&
+		vk.GetFenceStatus(_device, _cmd_fences[_readback_cmd_index[slot]]) != VK_SUCCESS)
+		return readback_status::pending;
+
+	uint8_t *mapped_data = nullptr;
+	if (vmaMapMemory(_alloc, _readback_buffers_mem[slot], reinterpret_cast<void **>(&mapped_data)) != VK_SUCCESS)
+		return readback_status::failed;
+	copy_screenshot_rows(buffer, mapped_data);
+	vmaUnmapMemory(_alloc, _readback_buffers_mem[slot]);
+
+	return readback_status::available;
+}
+
+bool reshade::vulkan::runtime_vk::create_screenshot_buffer(VkBuffer &buffer, VmaAllocation &buffer_mem) const
+{
+	VkBufferCreateInfo create_info { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	create_info.size = VkDeviceSize(_width) * _height * 4;
+	create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	VmaAllocationCreateInfo alloc_info = {};
+	alloc_info.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+
+	check_result(vmaCreateBuffer(_alloc, &create_info, &alloc_info, &buffer, &buffer_mem, nullptr)) false;
+
+	return true;
+}
+void reshade::vulkan::runtime_vk::record_screenshot_copy(VkBuffer buffer) const
+{
+	const VkCommandBuffer cmd_list = _cmd_buffers[_cmd_index].first;
+
+	transition_layout(vk, cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	{
+		VkBufferImageCopy copy;
+		copy.bufferOffset = 0;
+		copy.bufferRowLength = _width;
+		copy.bufferImageHeight = _height;
+		copy.imageOffset = { 0, 0, 0 };
+		copy.imageExtent = { _width, _height, 1 };
+		copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+
+		vk.CmdCopyImageToBuffer(cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &copy);
+	}
+	transition_layout(vk, cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+}
+void reshade::vulkan::runtime_vk::copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data) const
+{
+	const size_t data_pitch = _width * 4;
+
+	for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += data_pitch)
+	{
+		if (_color_bit_depth == 10)
+		{
+			pixel_kernels::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width, _backbuffer_format >= VK_FORMAT_A2B10G10R10_UNORM_PACK32 && _backbuffer_format <= VK_FORMAT_A2B10G10R10_SINT_PACK32);
+		}
+		else if (_backbuffer_format >= VK_FORMAT_B8G8R8A8_UNORM &&
+			_backbuffer_format <= VK_FORMAT_B8G8R8A8_SRGB)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel_kernels::swap_red_blue(buffer, mapped_data, _width);
+		}
+		else
+		{
+			std::memcpy(buffer, mapped_data, data_pitch);
+		}
+	}
+}
+
 bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 {
 	effect &effect = _effects[index];
@@ -878,7 +939,8 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	// Create query pool for time measurements
 	{   VkQueryPoolCreateInfo create_info { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
 		create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
-		create_info.queryCount = static_cast<uint32_t>(effect.module.techniques.size() * 2 * NUM_COMMAND_FRAMES);
+		for (const reshadefx::technique_info &info : effect.module.techniques)
+			create_info.queryCount += num_timestamps_for_technique(info.passes.size()) * NUM_COMMAND_FRAMES;
 
 		check_result(vk.CreateQueryPool(_device, &create_info, nullptr, &effect_data.query_pool)) false;
 	}
@@ -1105,7 +1167,7 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 		spec_data.size(), spec_data.data()
 	};
 
-	uint32_t technique_index = 0;
+	uint32_t query_base_index = 0;
 	uint32_t total_pass_index = 0;
 	for (technique &technique : _techniques)
 	{
@@ -1115,8 +1177,12 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 		auto impl = new technique_data();
 		technique.impl = impl;
 
-		// Offset index so that a query exists for each command frame and two subsequent ones are used for before/after stamps
-		impl->query_base_index = technique_index++ * 2 * NUM_COMMAND_FRAMES;
+		// Offset index so that each technique has a slot of subsequent queries for every command frame (one before the first and one after each pass)
+		impl->query_ring = timestamp_query_ring(NUM_COMMAND_FRAMES, num_timestamps_for_technique(technique.passes.size()));
+		impl->query_base_index = query_base_index;
+		query_base_index += impl->query_ring.num_slots() * impl->query_ring.num_timestamps();
+		impl->query_cmd_index.resize(impl->query_ring.num_slots());
+		impl->query_framecount.resize(impl->query_ring.num_slots());
 
 		impl->passes.resize(technique.passes.size());
 		for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index, ++total_pass_index)
@@ -1838,14 +1904,33 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 	const auto impl = static_cast<technique_data *>(technique.impl);
 	effect_data &effect_data = _effect_data[technique.effect_index];
 
-	// Evaluate queries from oldest frame in queue
-	if (uint64_t timestamps[2];
-		vk.GetQueryPoolResults(_device, effect_data.query_pool,
-			impl->query_base_index + ((_cmd_index + 1) % NUM_COMMAND_FRAMES) * 2, 2,
-		sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
-	{
-		technique.average_gpu_duration.append(timestamps[1] - timestamps[0]);
-	}
+	// Evaluate queries of previous frames that finished
+	impl->query_ring.collect(
+		[this, impl, &effect_data](uint32_t slot, uint64_t *timestamps) {
+			// The queries of a slot are reset in the same command buffer they are written in, so results are only valid once that has finished executing (before that the queries may still hold the results of the last time the slot was used)
+			// Once the command buffer of that frame was reused, its fence was waited on already, so only need to check the fence before that
+			if (_framecount - impl->query_framecount[slot] < NUM_COMMAND_FRAMES &&
+				vk.GetFenceStatus(_device, _cmd_fences[impl->query_cmd_index[slot]]) != VK_SUCCESS)
+				return timestamp_query_ring::status::pending;
+
+			const uint32_t num_timestamps = impl->query_ring.num_timestamps();
+			switch (vk.GetQueryPoolResults(_device, effect_data.query_pool,
+				impl->query_base_index + impl->query_ring.query_index(slot, 0), num_timestamps,
+				num_timestamps * sizeof(uint64_t), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT))
+			{
+			case VK_SUCCESS:
+				if (_timestamp_valid_bits == 0)
+					return timestamp_query_ring::status::invalid;
+				return timestamp_query_ring::convert_ticks_to_nanoseconds(timestamps, num_timestamps, _device_props.limits.timestampPeriod, _timestamp_valid_bits);
+			case VK_NOT_READY:
+				return timestamp_query_ring::status::pending;
+			default:
+				return timestamp_query_ring::status::invalid;
+			}
+		},
+		[&technique](const uint64_t *timestamps, uint32_t num_timestamps) {
+			technique.record_gpu_timestamps(timestamps, num_timestamps);
+		});
 
 	if (!begin_command_buffer())
 		return;
@@ -1866,9 +1951,13 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 	}
 #endif
 
-	// Reset current queries and then write time stamp value
-	vk.CmdResetQueryPool(cmd_list, effect_data.query_pool, impl->query_base_index + _cmd_index * 2, 2);
-	vk.CmdWriteTimestamp(cmd_list, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, effect_data.query_pool, impl->query_base_index + _cmd_index * 2);
+	// Reset queries of the current slot and then write time stamp value (skip measuring this frame if the queries of all previous frames are still in flight)
+	const uint32_t query_slot = impl->query_ring.acquire();
+	if (query_slot != timestamp_query_ring::no_slot)
+	{
+		vk.CmdResetQueryPool(cmd_list, effect_data.query_pool, impl->query_base_index + impl->query_ring.query_index(query_slot, 0), impl->query_ring.num_timestamps());
+		vk.CmdWriteTimestamp(cmd_list, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, effect_data.query_pool, impl->query_base_index + impl->query_ring.query_index(query_slot, 0));
+	}
 
 	vk.CmdBindDescriptorSets(cmd_list, VK_PIPELINE_BIND_POINT_GRAPHICS, effect_data.pipeline_layout, 0, 1, &effect_data.ubo_set, 0, nullptr);
 	if (impl->has_compute_passes)
@@ -1976,6 +2065,10 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 		for (const tex_data *texture : pass_data.modified_resources)
 			generate_mipmaps(texture);
 
+		// The timestamp after the last pass is written below
+		if (query_slot != timestamp_query_ring::no_slot && pass_index + 2 < impl->query_ring.num_timestamps())
+			vk.CmdWriteTimestamp(cmd_list, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, effect_data.query_pool, impl->query_base_index + impl->query_ring.query_index(query_slot, static_cast<uint32_t>(pass_index + 1)));
+
 #ifndef NDEBUG
 		if (insert_debug_markers)
 			vk.CmdDebugMarkerEndEXT(cmd_list);
@@ -1992,7 +2085,14 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 	}
 #endif
 
-	vk.CmdWriteTimestamp(cmd_list, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, effect_data.query_pool, impl->query_base_index + _cmd_index * 2 + 1);
+	if (query_slot != timestamp_query_ring::no_slot)
+	{
+		vk.CmdWriteTimestamp(cmd_list, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, effect_data.query_pool, impl->query_base_index + impl->query_ring.query_index(query_slot, impl->query_ring.num_timestamps() - 1));
+
+		impl->query_cmd_index[query_slot] = _cmd_index;
+		impl->query_framecount[query_slot] = _framecount;
+		impl->query_ring.submit(query_slot);
+	}
 
 #ifndef NDEBUG
 	if (insert_debug_markers)
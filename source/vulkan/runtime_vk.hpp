@@ -34,6 +34,13 @@ namespace reshade::vulkan
 		const VkLayerDispatchTable vk;
 
 	private:
+		bool begin_frame_readback(uint32_t slot) override;
+		readback_status finish_frame_readback(uint32_t slot, uint8_t *buffer) override;
+
+		bool create_screenshot_buffer(VkBuffer &buffer, VmaAllocation &buffer_mem) const;
+		void record_screenshot_copy(VkBuffer buffer) const;
+		void copy_screenshot_rows(uint8_t *buffer, const uint8_t *mapped_data) const;
+
 		bool init_effect(size_t index) override;
 		void unload_effect(size_t index) override;
 		void unload_effects() override;
@@ -67,6 +74,7 @@ namespace reshade::vulkan
 		const uint32_t _queue_family_index;
 		VkPhysicalDeviceProperties _device_props = {};
 		VkPhysicalDeviceMemoryProperties _memory_props = {};
+		uint32_t _timestamp_valid_bits = 0;
 		state_tracking_context &_state_tracking;
 
 		VkFence _cmd_fences[NUM_COMMAND_FRAMES + 1] = {};
@@ -89,6 +97,10 @@ namespace reshade::vulkan
 		VkImageView _backbuffer_image_view[2] = {};
 		VkImage _empty_depth_image = VK_NULL_HANDLE;
 		VkImageView _empty_depth_image_view = VK_NULL_HANDLE;
+		VkBuffer _readback_buffers[NUM_READBACK_SLOTS] = {};
+		VmaAllocation _readback_buffers_mem[NUM_READBACK_SLOTS] = {};
+		uint32_t _readback_cmd_index[NUM_READBACK_SLOTS] = {};
+		uint64_t _readback_framecount[NUM_READBACK_SLOTS] = {};
 
 		std::vector<VmaAllocation> _allocations;
 
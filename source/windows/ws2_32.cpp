@@ -3,19 +3,23 @@
  * License: https://github.com/crosire/reshade#license
  */
 
+#include "ws2_32.hpp"
 #include "hook_manager.hpp"
 #include <Windows.h>
 #include <Winsock2.h>
+#include <MSWSock.h>
 #include <ws2ipdef.h>
+#include <atomic>
 
-// Do not count network traffic for local sockets (localhost), so to avoid blocking occuring in games running local servers in single player too
-static bool is_local_socket(SOCKET s)
+static reshade::network::socket_class classify_socket(uint64_t s)
 {
+	using reshade::network::socket_class;
+
 	// Get the target address information of the socket
 	int address_size = sizeof(SOCKADDR_STORAGE);
 	SOCKADDR_STORAGE peer_address = {};
-	if (getpeername(s, reinterpret_cast<PSOCKADDR>(&peer_address), &address_size) == SOCKET_ERROR)
-		return false;
+	if (getpeername(static_cast<SOCKET>(s), reinterpret_cast<PSOCKADDR>(&peer_address), &address_size) == SOCKET_ERROR)
+		return WSAGetLastError() == WSAENOTCONN ? socket_class::not_connected : socket_class::unknown;
 
 	const int32_t ipv4_loopback = INADDR_LOOPBACK; // 127.0.0.1
 	const uint8_t ipv6_loopback[16] = IN6ADDR_LOOPBACK_INIT; // ::1
@@ -23,37 +27,181 @@ static bool is_local_socket(SOCKET s)
 	static_assert(sizeof(ipv4_loopback) == sizeof(IN_ADDR) && sizeof(ipv6_loopback) == sizeof(IN6_ADDR));
 
 	// Check if the target address matches the loopback address, in which case the connection is local
+	bool is_local = false;
 	switch (peer_address.ss_family)
 	{
-	default:
-		return false;
 	case AF_INET:
-		return std::memcmp(&reinterpret_cast<PSOCKADDR_IN >(&peer_address)->sin_addr, &ipv4_loopback, sizeof(IN_ADDR)) == 0;
+		is_local = std::memcmp(&reinterpret_cast<PSOCKADDR_IN >(&peer_address)->sin_addr, &ipv4_loopback, sizeof(IN_ADDR)) == 0;
+		break;
 	case AF_INET6:
-		return std::memcmp(&reinterpret_cast<PSOCKADDR_IN6>(&peer_address)->sin6_addr, ipv6_loopback, sizeof(IN6_ADDR)) == 0 ||
-		       std::memcmp(&reinterpret_cast<PSOCKADDR_IN6>(&peer_address)->sin6_addr, ipv6_ipv4_loopback, sizeof(IN6_ADDR)) == 0;
+		is_local = std::memcmp(&reinterpret_cast<PSOCKADDR_IN6>(&peer_address)->sin6_addr, ipv6_loopback, sizeof(IN6_ADDR)) == 0 ||
+		           std::memcmp(&reinterpret_cast<PSOCKADDR_IN6>(&peer_address)->sin6_addr, ipv6_ipv4_loopback, sizeof(IN6_ADDR)) == 0;
+		break;
 	}
+
+	return is_local ? socket_class::local : socket_class::remote;
+}
+
+// Classification of each socket is cached, so that games sending many small packets do not pay for an additional 'getpeername' call on every one of them
+// The cache entry is invalidated in every hook through which the peer of a socket can change: 'connect' and 'WSAConnect', the 'ConnectEx', 'AcceptEx', 'DisconnectEx' and 'TransmitFile' extension functions (which can reuse a socket for a new connection without closing it), the 'setsockopt' options that have to be set after those complete and 'closesocket' (after which the handle value is reused)
+// Sockets are only classified after a successful send or receive, at which point a connection-oriented socket is guaranteed to be connected already
+static reshade::network::socket_cache<1024> s_socket_cache;
+
+// Do not count network traffic for local sockets (localhost), so to avoid blocking occuring in games running local servers in single player too
+static bool is_local_socket(SOCKET s)
+{
+	// Keep the last error, since the hooks are called after the original function and should not change what the application sees
+	const int last_error = WSAGetLastError();
+	const bool is_local = s_socket_cache.classify(static_cast<uint64_t>(s), classify_socket) == reshade::network::socket_class::local;
+	WSASetLastError(last_error);
+	return is_local;
+}
+
+reshade::network::traffic_counter g_network_traffic;
+
+HOOK_EXPORT int WSAAPI HookConnect(SOCKET s, const struct sockaddr *name, int namelen)
+{
+	static const auto trampoline = reshade::hooks::call(HookConnect);
+	const auto status = trampoline(s, name, namelen);
+
+	s_socket_cache.invalidate(static_cast<uint64_t>(s));
+
+	return status;
+}
+HOOK_EXPORT int WSAAPI HookWSAConnect(SOCKET s, const struct sockaddr *name, int namelen, LPWSABUF lpCallerData, LPWSABUF lpCalleeData, LPQOS lpSQOS, LPQOS lpGQOS)
+{
+	static const auto trampoline = reshade::hooks::call(HookWSAConnect);
+	const auto status = trampoline(s, name, namelen, lpCallerData, lpCalleeData, lpSQOS, lpGQOS);
+
+	s_socket_cache.invalidate(static_cast<uint64_t>(s));
+
+	return status;
+}
+HOOK_EXPORT int WSAAPI HookCloseSocket(SOCKET s)
+{
+	static const auto trampoline = reshade::hooks::call(HookCloseSocket);
+	const auto status = trampoline(s);
+
+	// Invalidate after the socket was closed, so that a concurrent send cannot add it back to the cache before the handle is released
+	// The same applies to the connect hooks above, which invalidate after the peer has changed
+	s_socket_cache.invalidate(static_cast<uint64_t>(s));
+
+	return status;
 }
 
-volatile long g_network_traffic = 0;
+HOOK_EXPORT int WSAAPI HookSetSockOpt(SOCKET s, int level, int optname, const char *optval, int optlen)
+{
+	static const auto trampoline = reshade::hooks::call(HookSetSockOpt);
+	const auto status = trampoline(s, level, optname, optval, optlen);
+
+	// The peer address of a socket connected through 'ConnectEx' or 'AcceptEx' is only available after these options were set, so a socket may have been classified as not connected before
+	if (level == SOL_SOCKET && (optname == SO_UPDATE_CONNECT_CONTEXT || optname == SO_UPDATE_ACCEPT_CONTEXT))
+		s_socket_cache.invalidate(static_cast<uint64_t>(s));
+
+	return status;
+}
+
+// Original extension functions returned by the service provider, which are called by the replacements below
+static std::atomic<LPFN_CONNECTEX> s_connect_ex = nullptr;
+static std::atomic<LPFN_ACCEPTEX> s_accept_ex = nullptr;
+static std::atomic<LPFN_DISCONNECTEX> s_disconnect_ex = nullptr;
+static std::atomic<LPFN_TRANSMITFILE> s_transmit_file = nullptr;
+
+static BOOL PASCAL HookConnectEx(SOCKET s, const struct sockaddr *name, int namelen, PVOID lpSendBuffer, DWORD dwSendDataLength, LPDWORD lpdwBytesSent, LPOVERLAPPED lpOverlapped)
+{
+	const BOOL result = s_connect_ex.load(std::memory_order_relaxed)(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+
+	s_socket_cache.invalidate(static_cast<uint64_t>(s));
+
+	return result;
+}
+static BOOL PASCAL HookAcceptEx(SOCKET sListenSocket, SOCKET sAcceptSocket, PVOID lpOutputBuffer, DWORD dwReceiveDataLength, DWORD dwLocalAddressLength, DWORD dwRemoteAddressLength, LPDWORD lpdwBytesReceived, LPOVERLAPPED lpOverlapped)
+{
+	const BOOL result = s_accept_ex.load(std::memory_order_relaxed)(sListenSocket, sAcceptSocket, lpOutputBuffer, dwReceiveDataLength, dwLocalAddressLength, dwRemoteAddressLength, lpdwBytesReceived, lpOverlapped);
+
+	s_socket_cache.invalidate(static_cast<uint64_t>(sAcceptSocket));
+
+	return result;
+}
+static BOOL PASCAL HookDisconnectEx(SOCKET s, LPOVERLAPPED lpOverlapped, DWORD dwFlags, DWORD dwReserved)
+{
+	const BOOL result = s_disconnect_ex.load(std::memory_order_relaxed)(s, lpOverlapped, dwFlags, dwReserved);
+
+	if ((dwFlags & TF_REUSE_SOCKET) != 0)
+		s_socket_cache.invalidate(static_cast<uint64_t>(s));
+
+	return result;
+}
+static BOOL PASCAL HookTransmitFile(SOCKET hSocket, HANDLE hFile, DWORD nNumberOfBytesToWrite, DWORD nNumberOfBytesPerSend, LPOVERLAPPED lpOverlapped, LPTRANSMIT_FILE_BUFFERS lpTransmitBuffers, DWORD dwFlags)
+{
+	const BOOL result = s_transmit_file.load(std::memory_order_relaxed)(hSocket, hFile, nNumberOfBytesToWrite, nNumberOfBytesPerSend, lpOverlapped, lpTransmitBuffers, dwFlags);
+
+	if ((dwFlags & TF_REUSE_SOCKET) != 0)
+		s_socket_cache.invalidate(static_cast<uint64_t>(hSocket));
+
+	return result;
+}
+
+template <typename T>
+static void replace_extension_function(void *function_pointer, std::atomic<T> &original, T replacement)
+{
+	const T function = *static_cast<T *>(function_pointer);
+
+	// Only a single original function is kept, so if another service provider returns a different one, leave that alone (the 'setsockopt' hook still invalidates those sockets once they are connected)
+	if (T expected = nullptr; original.compare_exchange_strong(expected, function, std::memory_order_relaxed) || expected == function)
+		*static_cast<T *>(function_pointer) = replacement;
+}
+
+HOOK_EXPORT int WSAAPI HookWSAIoctl(SOCKET s, DWORD dwIoControlCode, LPVOID lpvInBuffer, DWORD cbInBuffer, LPVOID lpvOutBuffer, DWORD cbOutBuffer, LPDWORD lpcbBytesReturned, LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine)
+{
+	static const auto trampoline = reshade::hooks::call(HookWSAIoctl);
+	const auto status = trampoline(s, dwIoControlCode, lpvInBuffer, cbInBuffer, lpvOutBuffer, cbOutBuffer, lpcbBytesReturned, lpOverlapped, lpCompletionRoutine);
+
+	// Extension functions are not exported, but queried from the service provider, so replace them with functions that invalidate the cache entry of a socket whose peer changes
+	if (status == 0 && dwIoControlCode == SIO_GET_EXTENSION_FUNCTION_POINTER &&
+		lpvInBuffer != nullptr && cbInBuffer >= sizeof(GUID) && lpvOutBuffer != nullptr && cbOutBuffer >= sizeof(void *))
+	{
+		const GUID &guid = *static_cast<const GUID *>(lpvInBuffer);
+		const GUID connect_ex_guid = WSAID_CONNECTEX;
+		const GUID accept_ex_guid = WSAID_ACCEPTEX;
+		const GUID disconnect_ex_guid = WSAID_DISCONNECTEX;
+		const GUID transmit_file_guid = WSAID_TRANSMITFILE;
+
+		if (guid == connect_ex_guid)
+			replace_extension_function<LPFN_CONNECTEX>(lpvOutBuffer, s_connect_ex, HookConnectEx);
+		else if (guid == accept_ex_guid)
+			replace_extension_function<LPFN_ACCEPTEX>(lpvOutBuffer, s_accept_ex, HookAcceptEx);
+		else if (guid == disconnect_ex_guid)
+			replace_extension_function<LPFN_DISCONNECTEX>(lpvOutBuffer, s_disconnect_ex, HookDisconnectEx);
+		else if (guid == transmit_file_guid)
+			replace_extension_function<LPFN_TRANSMITFILE>(lpvOutBuffer, s_transmit_file, HookTransmitFile);
+	}
+
+	return status;
+}
 
 HOOK_EXPORT int WSAAPI HookWSASend(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount, LPDWORD lpNumberOfBytesSent, DWORD dwFlags, LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine)
 {
-	if (!is_local_socket(s))
+	static const auto trampoline = reshade::hooks::call(HookWSASend);
+	const auto status = trampoline(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpOverlapped, lpCompletionRoutine);
+
+	// Overlapped operations that did not complete immediately still send all buffers
+	if ((status == 0 || WSAGetLastError() == WSA_IO_PENDING) && !is_local_socket(s))
 		for (DWORD i = 0; i < dwBufferCount; ++i)
-			InterlockedAdd(&g_network_traffic, lpBuffers[i].len);
+			g_network_traffic.add(lpBuffers[i].len);
 
-	static const auto trampoline = reshade::hooks::call(HookWSASend);
-	return trampoline(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpOverlapped, lpCompletionRoutine);
+	return status;
 }
 HOOK_EXPORT int WSAAPI HookWSASendTo(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount, LPDWORD lpNumberOfBytesSent, DWORD dwFlags, const struct sockaddr *lpTo, int iToLen, LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine)
 {
-	if (!is_local_socket(s))
+	static const auto trampoline = reshade::hooks::call(HookWSASendTo);
+	const auto status = trampoline(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpTo, iToLen, lpOverlapped, lpCompletionRoutine);
+
+	if ((status == 0 || WSAGetLastError() == WSA_IO_PENDING) && !is_local_socket(s))
 		for (DWORD i = 0; i < dwBufferCount; ++i)
-			InterlockedAdd(&g_network_traffic, lpBuffers[i].len);
+			g_network_traffic.add(lpBuffers[i].len);
 
-	static const auto trampoline = reshade::hooks::call(HookWSASendTo);
-	return trampoline(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpTo, iToLen, lpOverlapped, lpCompletionRoutine);
+	return status;
 }
 HOOK_EXPORT int WSAAPI HookWSARecv(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount, LPDWORD lpNumberOfBytesRecvd, LPDWORD lpFlags, LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine)
 {
@@ -61,7 +209,7 @@ HOOK_EXPORT int WSAAPI HookWSARecv(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferC
 	const auto status = trampoline(s, lpBuffers, dwBufferCount, lpNumberOfBytesRecvd, lpFlags, lpOverlapped, lpCompletionRoutine);
 
 	if (status == 0 && lpNumberOfBytesRecvd != nullptr && !is_local_socket(s))
-		InterlockedAdd(&g_network_traffic, *lpNumberOfBytesRecvd);
+		g_network_traffic.add(*lpNumberOfBytesRecvd);
 
 	return status;
 }
@@ -71,7 +219,7 @@ HOOK_EXPORT int WSAAPI HookWSARecvFrom(SOCKET s, LPWSABUF lpBuffers, DWORD dwBuf
 	const auto status = trampoline(s, lpBuffers, dwBufferCount, lpNumberOfBytesRecvd, lpFlags, lpFrom, lpFromlen, lpOverlapped, lpCompletionRoutine);
 
 	if (status == 0 && lpNumberOfBytesRecvd != nullptr && !is_local_socket(s))
-		InterlockedAdd(&g_network_traffic, *lpNumberOfBytesRecvd);
+		g_network_traffic.add(*lpNumberOfBytesRecvd);
 
 	return status;
 }
@@ -82,7 +230,7 @@ HOOK_EXPORT int WSAAPI HookSend(SOCKET s, const char *buf, int len, int flags)
 	const auto num_bytes_send = trampoline(s, buf, len, flags);
 
 	if (num_bytes_send != SOCKET_ERROR && !is_local_socket(s))
-		InterlockedAdd(&g_network_traffic, num_bytes_send);
+		g_network_traffic.add(num_bytes_send);
 
 	return num_bytes_send;
 }
@@ -92,7 +240,7 @@ HOOK_EXPORT int WSAAPI HookSendTo(SOCKET s, const char *buf, int len, int flags,
 	const auto num_bytes_send = trampoline(s, buf, len, flags, to, tolen);
 
 	if (num_bytes_send != SOCKET_ERROR && !is_local_socket(s))
-		InterlockedAdd(&g_network_traffic, num_bytes_send);
+		g_network_traffic.add(num_bytes_send);
 
 	return num_bytes_send;
 }
@@ -102,7 +250,7 @@ HOOK_EXPORT int WSAAPI HookRecv(SOCKET s, char *buf, int len, int flags)
 	const auto num_bytes_recieved = trampoline(s, buf, len, flags);
 
 	if (num_bytes_recieved != SOCKET_ERROR && !is_local_socket(s))
-		InterlockedAdd(&g_network_traffic, num_bytes_recieved);
+		g_network_traffic.add(num_bytes_recieved);
 
 	return num_bytes_recieved;
 }
@@ -112,7 +260,7 @@ HOOK_EXPORT int WSAAPI HookRecvFrom(SOCKET s, char *buf, int len, int flags, str
 	const auto num_bytes_recieved = trampoline(s, buf, len, flags, from, fromlen);
 
 	if (num_bytes_recieved != SOCKET_ERROR && !is_local_socket(s))
-		InterlockedAdd(&g_network_traffic, num_bytes_recieved);
+		g_network_traffic.add(num_bytes_recieved);
 
 	return num_bytes_recieved;
 }
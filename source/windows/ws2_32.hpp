@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace reshade::network
+{
+	/// <summary>
+	/// Classification of the peer a socket is connected to.
+	/// </summary>
+	enum class socket_class : uint8_t
+	{
+		unknown, // Used for empty cache entries
+		local,
+		remote,
+		not_connected,
+	};
+
+	/// <summary>
+	/// A fixed-size lock-free cache which remembers how a socket was classified, so that the classification does not have to query the socket layer again on every send or receive.
+	/// Entries have to be invalidated whenever the peer of a socket may change (when it is connected, disconnected for reuse or closed), since socket handles are reused.
+	/// The socket layer is only accessed through the classification function passed to <see cref="classify"/>, so the cache does not depend on Winsock.
+	/// </summary>
+	template <size_t MAX_ENTRIES, size_t MAX_PROBES = 8>
+	class socket_cache
+	{
+		static_assert((MAX_ENTRIES & (MAX_ENTRIES - 1)) == 0 && MAX_PROBES <= MAX_ENTRIES);
+
+	public:
+		/// <summary>
+		/// Gets the classification of the specified <paramref name="socket"/> from the cache, or calls <paramref name="classify_func"/> to determine and add it if it is not in there yet.
+		/// </summary>
+		/// <param name="socket">The socket handle to look up. The two most significant bits are not used.</param>
+		/// <param name="classify_func">Function with the signature <c>socket_class(uint64_t)</c> that queries the socket layer.</param>
+		template <typename F>
+		socket_class classify(uint64_t socket, F classify_func)
+		{
+			const size_t start_index = hash(socket);
+
+			for (size_t i = 0; i < MAX_PROBES; ++i)
+				if (const uint64_t entry = _data[(start_index + i) % MAX_ENTRIES].load(std::memory_order_relaxed);
+					entry != 0 && (entry >> 2) == (socket & key_mask))
+					return static_cast<socket_class>(entry & 0x3);
+
+			// Remember the generation before querying the socket layer, so that a concurrent invalidation is not undone by adding an outdated result afterwards
+			const uint32_t generation = _generation.load(std::memory_order_acquire);
+
+			const socket_class result = classify_func(socket);
+			if (result == socket_class::unknown)
+				return result;
+
+			const uint64_t new_entry = ((socket & key_mask) << 2) | static_cast<uint64_t>(result);
+
+			// Adding the entry and checking the generation afterwards are sequentially consistent, as are incrementing the generation and scanning the entries in 'invalidate'
+			// Otherwise the check could be reordered before the entry becomes visible, so that neither this thread sees the new generation nor the invalidating thread sees the entry
+			size_t index = MAX_ENTRIES;
+			for (size_t i = 0; i < MAX_PROBES && index == MAX_ENTRIES; ++i)
+				if (uint64_t expected = 0; _data[(start_index + i) % MAX_ENTRIES].compare_exchange_strong(expected, new_entry, std::memory_order_seq_cst))
+					index = (start_index + i) % MAX_ENTRIES;
+
+			if (index == MAX_ENTRIES)
+			{
+				// All slots are in use, so evict the first one (this is only a cache, so losing an entry just means it has to be queried again)
+				index = start_index;
+				_data[index].exchange(new_entry, std::memory_order_seq_cst);
+			}
+
+			if (_generation.load(std::memory_order_seq_cst) != generation)
+			{
+				uint64_t expected = new_entry;
+				_data[index].compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+			}
+
+			return result;
+		}
+
+		/// <summary>
+		/// Removes any entries for the specified <paramref name="socket"/> from the cache.
+		/// </summary>
+		void invalidate(uint64_t socket)
+		{
+			_generation.fetch_add(1, std::memory_order_seq_cst);
+
+			const size_t start_index = hash(socket);
+
+			// Scan all probe slots, since multiple threads may have added the same socket at once
+			for (size_t i = 0; i < MAX_PROBES; ++i)
+				if (uint64_t entry = _data[(start_index + i) % MAX_ENTRIES].load(std::memory_order_seq_cst);
+					entry != 0 && (entry >> 2) == (socket & key_mask))
+					_data[(start_index + i) % MAX_ENTRIES].compare_exchange_strong(entry, 0, std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// Removes all entries from the cache.
+		/// </summary>
+		void clear()
+		{
+			_generation.fetch_add(1, std::memory_order_seq_cst);
+
+			for (size_t i = 0; i < MAX_ENTRIES; ++i)
+				_data[i].store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr uint64_t key_mask = UINT64_MAX >> 2;
+
+		static size_t hash(uint64_t socket)
+		{
+			// Socket handles are multiples of four, so drop the bits that are always zero
+			return static_cast<size_t>(socket >> 2) % MAX_ENTRIES;
+		}
+
+		// Each entry stores the socket handle in the upper 62 bits and the classification in the lower 2 bits, so that both are updated atomically
+		std::atomic<uint64_t> _data[MAX_ENTRIES] = {};
+		std::atomic<uint32_t> _generation { 0 };
+	};
+
+	/// <summary>
+	/// A counter which is split into multiple shards, so that threads adding to it at the same time do not contend on the same cache line.
+	/// The shards are only summed up when the value is read, which happens much less frequently than adding to it.
+	/// </summary>
+	class traffic_counter
+	{
+	public:
+		void add(size_t value)
+		{
+			_shards[shard_index()].value.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		size_t total() const
+		{
+			size_t total = 0;
+			for (const shard &shard : _shards)
+				total += shard.value.load(std::memory_order_relaxed);
+			return total;
+		}
+
+		void reset()
+		{
+			for (shard &shard : _shards)
+				shard.value.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr size_t NUM_SHARDS = 16;
+
+		static size_t shard_index()
+		{
+			// Assign shards to threads round-robin the first time they add to a counter
+			static std::atomic<size_t> next_index { 0 };
+			static thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+			return index;
+		}
+
+		struct alignas(64) shard
+		{
+			std::atomic<size_t> value { 0 };
+		};
+
+		shard _shards[NUM_SHARDS];
+	};
+}
+
+/// <summary>
+/// Number of bytes sent or received through non-local sockets since the last frame.
+/// </summary>
+extern reshade::network::traffic_counter g_network_traffic;
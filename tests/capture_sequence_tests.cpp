@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "capture_sequence.hpp"
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	/// <summary>
+	/// Produces frames that mostly stay the same between frames, with a moving block and some noise, like a game would while capturing.
+	/// </summary>
+	struct synthetic_frame_source
+	{
+		synthetic_frame_source(uint32_t width, uint32_t height) : width(width), height(height) {}
+
+		void render(uint32_t frame_index, uint8_t *pixels) const
+		{
+			uint32_t seed = frame_index * 7919 + 1;
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					uint8_t *const pixel = pixels + (size_t(y) * width + x) * 4;
+					pixel[0] = static_cast<uint8_t>(x * 255 / width);
+					pixel[1] = static_cast<uint8_t>(y * 255 / height);
+					pixel[2] = x / 8 == frame_index % (width / 8) && y / 8 == 1 ? 0xFF : 0x20;
+					pixel[3] = 0xFF;
+				}
+			}
+
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				seed = seed * 1103515245 + 12345;
+				pixels[(seed >> 8) % (size_t(width) * height) * 4] ^= 0x55;
+			}
+		}
+
+		const uint32_t width, height;
+	};
+
+	/// <summary>
+	/// Drives a capture sequence the same way the runtime does every presented frame, without any graphics API involved.
+	/// </summary>
+	void run_sequence(reshade::capture_sequence &sequence, const synthetic_frame_source &source, uint32_t num_frames)
+	{
+		for (uint32_t frame_index = 0; frame_index < num_frames; ++frame_index)
+		{
+			if (!sequence.next_frame())
+				continue;
+
+			std::vector<uint8_t> pixels = sequence.acquire_frame_buffer();
+			source.render(sequence.frame_index(), pixels.data());
+			sequence.submit_frame(sequence.frame_index(), std::move(pixels));
+		}
+	}
+}
+
+TEST_CASE(capture_sequence_delta_stream)
+{
+	const reshade::tests::temp_directory dir;
+	const synthetic_frame_source source(64, 48);
+
+	reshade::thread_pool pool(2);
+	reshade::capture_sequence sequence(pool);
+
+	reshade::capture_sequence::settings settings;
+	settings.frame_count = 100; // More than the key frame interval, so that the stream contains both key and delta frames
+	settings.delta_encoding = true;
+	settings.clear_alpha = false;
+	settings.max_buffered_frames = 1000; // Make sure no frames are dropped
+
+	CHECK(sequence.start(dir.path / "sequence", source.width, source.height, settings));
+	CHECK(sequence.is_capturing());
+
+	run_sequence(sequence, source, 150);
+	CHECK(!sequence.is_capturing());
+
+	sequence.finish();
+	CHECK(!sequence.is_writing());
+
+	const reshade::capture_sequence::statistics stats = sequence.get_statistics();
+	CHECK(stats.frames_captured == 100);
+	CHECK(stats.frames_written == 100);
+	CHECK(stats.frames_dropped == 0);
+	CHECK(stats.frames_failed == 0);
+
+	// Every frame has to decode to exactly what was captured
+	uint32_t num_frames = 0;
+	std::vector<uint8_t> expected(size_t(source.width) * source.height * 4);
+	CHECK(reshade::capture_sequence::read_delta_stream(sequence.path(), [&](uint32_t width, uint32_t height, uint32_t frame_index, const uint8_t *pixels) {
+		CHECK(width == source.width && height == source.height);
+		CHECK(frame_index == num_frames);
+		source.render(frame_index, expected.data());
+		CHECK(std::memcmp(pixels, expected.data(), expected.size()) == 0);
+		num_frames++;
+		return true;
+	}));
+	CHECK(num_frames == 100);
+
+	// Delta frames of mostly static content should compress well
+	CHECK(std::filesystem::file_size(sequence.path()) < 100 * expected.size() / 4);
+}
+
+TEST_CASE(capture_sequence_frame_interval)
+{
+	const reshade::tests::temp_directory dir;
+	const synthetic_frame_source source(16, 16);
+
+	reshade::thread_pool pool(1);
+	reshade::capture_sequence sequence(pool);
+
+	reshade::capture_sequence::settings settings;
+	settings.frame_count = 5;
+	settings.frame_interval = 3;
+	settings.delta_encoding = true;
+	settings.max_buffered_frames = 100;
+
+	CHECK(sequence.start(dir.path / "sequence", source.width, source.height, settings));
+
+	// Five frames at an interval of three are done after thirteen frames
+	run_sequence(sequence, source, 13);
+	CHECK(!sequence.is_capturing());
+	sequence.finish();
+
+	std::vector<uint32_t> frame_indices;
+	CHECK(reshade::capture_sequence::read_delta_stream(sequence.path(), [&](uint32_t, uint32_t, uint32_t frame_index, const uint8_t *) {
+		frame_indices.push_back(frame_index);
+		return true;
+	}));
+	CHECK(frame_indices == std::vector<uint32_t>({ 0, 3, 6, 9, 12 }));
+}
+
+TEST_CASE(capture_sequence_images)
+{
+	const reshade::tests::temp_directory dir;
+	const synthetic_frame_source source(32, 32);
+
+	reshade::thread_pool pool(2);
+	reshade::capture_sequence sequence(pool);
+
+	reshade::capture_sequence::settings settings;
+	settings.frame_count = 10;
+	settings.image_format = 1; // PNG
+	settings.max_buffered_frames = 100;
+
+	CHECK(sequence.start(dir.path / "sequence", source.width, source.height, settings));
+	run_sequence(sequence, source, 10);
+	sequence.finish();
+
+	const reshade::capture_sequence::statistics stats = sequence.get_statistics();
+	CHECK(stats.frames_captured == 10);
+	CHECK(stats.frames_written == 10);
+	CHECK(stats.frames_failed == 0);
+
+	for (const char *name : { "00000.png", "00005.png", "00009.png" })
+		CHECK(std::filesystem::file_size(sequence.path() / name) > 0);
+	CHECK(!std::filesystem::exists(sequence.path() / "00010.png"));
+}
+
+TEST_CASE(capture_sequence_dropped_frames)
+{
+	const reshade::tests::temp_directory dir;
+	const synthetic_frame_source source(256, 256);
+
+	reshade::thread_pool pool(1);
+	reshade::capture_sequence sequence(pool);
+
+	reshade::capture_sequence::settings settings;
+	settings.frame_count = 50;
+	settings.delta_encoding = true;
+	settings.max_buffered_frames = 2;
+
+	CHECK(sequence.start(dir.path / "sequence", source.width, source.height, settings));
+
+	// Keep the only thread of the pool busy, so that nothing is written while frames are submitted and the queue fills up
+	std::mutex mutex;
+	mutex.lock();
+	pool.submit([&mutex]() { const std::lock_guard<std::mutex> lock(mutex); });
+
+	run_sequence(sequence, source, 50);
+
+	// Frames that could not be captured (e.g. because a readback failed) are counted as dropped too
+	sequence.drop_frame();
+
+	mutex.unlock();
+	sequence.finish();
+
+	const reshade::capture_sequence::statistics stats = sequence.get_statistics();
+	CHECK(stats.frames_captured == 2);
+	CHECK(stats.frames_dropped == 49);
+	CHECK(stats.frames_written == 2);
+
+	// The frames that were written are still valid and keep their original index
+	std::vector<uint32_t> frame_indices;
+	CHECK(reshade::capture_sequence::read_delta_stream(sequence.path(), [&](uint32_t, uint32_t, uint32_t frame_index, const uint8_t *) {
+		frame_indices.push_back(frame_index);
+		return true;
+	}));
+	CHECK(frame_indices == std::vector<uint32_t>({ 0, 1 }));
+}
+
+TEST_CASE(capture_sequence_out_of_order_submission)
+{
+	const reshade::tests::temp_directory dir;
+	const synthetic_frame_source source(16, 16);
+
+	reshade::thread_pool pool(1);
+	reshade::capture_sequence sequence(pool);
+
+	reshade::capture_sequence::settings settings;
+	settings.frame_count = 8;
+	settings.delta_encoding = true;
+	settings.max_buffered_frames = 100;
+
+	CHECK(sequence.start(dir.path / "sequence", source.width, source.height, settings));
+
+	// Simulate asynchronous readback, where frames are only submitted a few frames after they were advanced to
+	std::vector<std::pair<uint32_t, std::vector<uint8_t>>> in_flight;
+	for (uint32_t i = 0; i < 12; ++i)
+	{
+		if (in_flight.size() == 3 || (!sequence.is_capturing() && !in_flight.empty()))
+		{
+			sequence.submit_frame(in_flight.front().first, std::move(in_flight.front().second));
+			in_flight.erase(in_flight.begin());
+		}
+
+		if (!sequence.next_frame())
+			continue;
+
+		std::vector<uint8_t> pixels = sequence.acquire_frame_buffer();
+		source.render(sequence.frame_index(), pixels.data());
+		in_flight.emplace_back(sequence.frame_index(), std::move(pixels));
+	}
+
+	for (auto &frame : in_flight)
+		sequence.submit_frame(frame.first, std::move(frame.second));
+
+	sequence.finish();
+
+	uint32_t num_frames = 0;
+	std::vector<uint8_t> expected(size_t(source.width) * source.height * 4);
+	CHECK(reshade::capture_sequence::read_delta_stream(sequence.path(), [&](uint32_t, uint32_t, uint32_t frame_index, const uint8_t *pixels) {
+		CHECK(frame_index == num_frames);
+		source.render(frame_index, expected.data());
+		for (size_t i = 3; i < expected.size(); i += 4)
+			expected[i] = 0xFF; // Alpha is cleared by default
+		CHECK(std::memcmp(pixels, expected.data(), expected.size()) == 0);
+		num_frames++;
+		return true;
+	}));
+	CHECK(num_frames == 8);
+}
+
+TEST_CASE(capture_sequence_corrupt_delta_stream)
+{
+	const reshade::tests::temp_directory dir;
+
+	const auto write_stream = [&dir](uint32_t width, uint32_t height, uint32_t payload_size, size_t actual_payload_size) {
+		std::vector<uint8_t> data = { 'R', 'S', 'E', 'Q' };
+		const auto append_uint32 = [&data](uint32_t value) {
+			for (unsigned int i = 0; i < 4; ++i)
+				data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		};
+		append_uint32(1); // Version
+		append_uint32(width);
+		append_uint32(height);
+		append_uint32(0); // Frame index
+		data.push_back(0); // Key frame
+		append_uint32(payload_size);
+		data.resize(data.size() + actual_payload_size);
+
+		const std::filesystem::path path = dir.path / "corrupt.rseq";
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char *>(data.data()), data.size());
+		return path;
+	};
+
+	const auto callback = [](uint32_t, uint32_t, uint32_t, const uint8_t *) { return true; };
+
+	// A payload size larger than the rest of the file must be rejected before allocating memory for it
+	CHECK(!reshade::capture_sequence::read_delta_stream(write_stream(16, 16, 0xFFFFFFFF, 16), callback));
+	CHECK(!reshade::capture_sequence::read_delta_stream(write_stream(16, 16, 17, 16), callback));
+
+	// Frame dimensions that no graphics API supports must be rejected before allocating memory for the decoded frame
+	CHECK(!reshade::capture_sequence::read_delta_stream(write_stream(0xFFFFFFFF, 0xFFFFFFFF, 0, 0), callback));
+	CHECK(!reshade::capture_sequence::read_delta_stream(write_stream(0, 16, 0, 0), callback));
+
+	CHECK(!reshade::capture_sequence::read_delta_stream(dir.path / "missing.rseq", callback));
+}
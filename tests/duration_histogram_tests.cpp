@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "duration_histogram.hpp"
+
+using reshade::duration_histogram;
+
+TEST_CASE(duration_histogram_bucket_boundaries)
+{
+	CHECK(duration_histogram::index_of(0) == 0);
+	CHECK(duration_histogram::index_of(UINT64_MAX) == duration_histogram::NUM_BUCKETS - 1);
+	CHECK(duration_histogram::upper_bound_of(duration_histogram::NUM_BUCKETS - 1) == UINT64_MAX);
+
+	// Every bucket starts right after the previous one ends, so that no duration is lost between them
+	for (size_t i = 0; i + 1 < duration_histogram::NUM_BUCKETS; ++i)
+	{
+		const uint64_t upper_bound = duration_histogram::upper_bound_of(i);
+		CHECK(duration_histogram::index_of(upper_bound) == i);
+		CHECK(duration_histogram::index_of(upper_bound + 1) == i + 1);
+		if (i != 0)
+			CHECK(upper_bound > duration_histogram::upper_bound_of(i - 1));
+	}
+
+	// The transition from the linear to the logarithmic buckets and between two magnitudes
+	const uint64_t unit = 1ull << duration_histogram::UNIT_SHIFT;
+	const size_t num_linear_buckets = 2 * duration_histogram::SUB_BUCKETS;
+	CHECK(duration_histogram::index_of(num_linear_buckets * unit - 1) == num_linear_buckets - 1);
+	CHECK(duration_histogram::index_of(num_linear_buckets * unit) == num_linear_buckets);
+	CHECK(duration_histogram::index_of(num_linear_buckets * unit + 2 * unit - 1) == num_linear_buckets);
+	CHECK(duration_histogram::index_of(num_linear_buckets * unit + 2 * unit) == num_linear_buckets + 1);
+	CHECK(duration_histogram::index_of(2 * num_linear_buckets * unit - 1) == num_linear_buckets + duration_histogram::SUB_BUCKETS - 1);
+	CHECK(duration_histogram::index_of(2 * num_linear_buckets * unit) == num_linear_buckets + duration_histogram::SUB_BUCKETS);
+}
+
+TEST_CASE(duration_histogram_relative_error)
+{
+	// Durations from one microsecond to just below 34 seconds are recorded with a relative error of at most 1/16
+	for (uint64_t value = 1000; value < 34000000000ull; value += value / 7 + 1)
+	{
+		const size_t index = duration_histogram::index_of(value);
+		CHECK(index < duration_histogram::NUM_BUCKETS - 1);
+
+		const uint64_t upper_bound = duration_histogram::upper_bound_of(index);
+		CHECK(upper_bound >= value);
+		CHECK((upper_bound - value) * 16 <= value);
+	}
+}
+
+TEST_CASE(duration_histogram_percentile)
+{
+	duration_histogram histogram;
+	CHECK(histogram.percentile(0.5) == 0);
+
+	// A single duration is reported exactly, since the result is clamped to the maximum
+	histogram.record(1234567);
+	CHECK(histogram.count() == 1);
+	CHECK(histogram.percentile(0.0) == 1234567);
+	CHECK(histogram.percentile(0.5) == 1234567);
+	CHECK(histogram.percentile(1.0) == 1234567);
+
+	// Durations of 1 to 100 microseconds
+	histogram.clear();
+	CHECK(histogram.count() == 0 && histogram.max() == 0);
+	for (uint64_t i = 1; i <= 100; ++i)
+		histogram.record(i * 1000);
+	CHECK(histogram.count() == 100);
+	CHECK(histogram.mean() == 50500);
+	CHECK(histogram.max() == 100000);
+
+	for (const uint64_t p : { 1, 10, 50, 90, 99 })
+	{
+		const uint64_t expected = p * 1000;
+		const uint64_t value = histogram.percentile(p / 100.0);
+		CHECK(value >= expected && (value - expected) * 16 <= expected);
+	}
+
+	CHECK(histogram.percentile(0.0) == histogram.percentile(0.01)); // Always at least one duration is counted
+	CHECK(histogram.percentile(1.0) == 100000);
+
+	// A single outlier only shows up in the highest percentiles
+	histogram.record(20000000000ull);
+	CHECK(histogram.percentile(0.99) < 100000 + 100000 / 16);
+	CHECK(histogram.percentile(1.0) == 20000000000ull);
+
+	// Durations past the last bucket are still counted and reported as the maximum
+	histogram.clear();
+	histogram.record(1000);
+	histogram.record(UINT64_MAX / 2);
+	CHECK(histogram.percentile(0.5) == duration_histogram::upper_bound_of(duration_histogram::index_of(1000)));
+	CHECK(histogram.percentile(1.0) == UINT64_MAX / 2);
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_budget_controller.hpp"
+#include "runtime_objects.hpp"
+#include <vector>
+
+using reshade::effect_budget_controller;
+
+namespace
+{
+	struct simulated_technique
+	{
+		uint64_t duration; // Duration in nanoseconds while the scene has its full load
+		int priority;
+		bool suspended;
+		uint64_t last_duration = 0; // Duration of the last frame the technique was rendered in
+	};
+
+	/// <summary>
+	/// Runs the controller over a number of frames, in which every technique that is rendered takes its duration scaled by the load of the scene, plus a little deterministic noise.
+	/// </summary>
+	struct simulation
+	{
+		template <typename L>
+		void run(unsigned int num_frames, uint64_t budget, L load_func)
+		{
+			for (unsigned int i = 0; i < num_frames; ++i, ++frame)
+			{
+				const double load = load_func(frame);
+
+				std::vector<effect_budget_controller::candidate> candidates;
+				for (size_t k = 0; k < techniques.size(); ++k)
+				{
+					simulated_technique &technique = techniques[k];
+					if (!technique.suspended)
+						technique.last_duration = static_cast<uint64_t>(technique.duration * load) + (frame * 7 + k * 13) % 5 * 10'000;
+
+					candidates.push_back({ technique.last_duration, technique.priority, technique.suspended });
+				}
+
+				const effect_budget_controller::decision decision = controller.update(budget, candidates.data(), candidates.size());
+				if (decision.type == effect_budget_controller::action::none)
+					continue;
+
+				CHECK(decision.index < techniques.size());
+				CHECK(techniques[decision.index].suspended == (decision.type == effect_budget_controller::action::resume));
+				techniques[decision.index].suspended = decision.type == effect_budget_controller::action::suspend;
+
+				changes.push_back({ frame, decision.type, decision.index });
+			}
+		}
+
+		uint64_t total_duration() const
+		{
+			uint64_t total = 0;
+			for (const simulated_technique &technique : techniques)
+				if (!technique.suspended)
+					total += technique.last_duration;
+			return total;
+		}
+
+		struct change
+		{
+			unsigned int frame;
+			effect_budget_controller::action type;
+			size_t index;
+		};
+
+		unsigned int frame = 0;
+		effect_budget_controller controller;
+		std::vector<simulated_technique> techniques;
+		std::vector<change> changes;
+	};
+
+	/// <summary>
+	/// Per-frame GPU durations of a set of techniques with the effect budget disabled, so that there is a duration for every technique in every frame.
+	/// </summary>
+	struct timing_trace
+	{
+		explicit timing_trace(const std::filesystem::path &path)
+		{
+			std::ifstream file(path);
+
+			// Lines starting with '#' are comments, all other lines consist of values separated by tabs
+			for (std::string line; std::getline(file, line);)
+			{
+				if (line.empty() || line[0] == '#')
+					continue;
+
+				std::vector<std::string> values;
+				std::istringstream stream(line);
+				for (std::string value; std::getline(stream, value, '\t');)
+					values.push_back(std::move(value));
+
+				if (values[0] == "budget" && values.size() == 2)
+					budget = std::stoull(values[1]) * 1000;
+				else if (values[0] == "technique" && values.size() == 3)
+					techniques.push_back({ values[1], std::stoi(values[2]) });
+				else
+				{
+					std::vector<uint64_t> &durations = frames.emplace_back();
+					for (const std::string &value : values)
+						durations.push_back(std::stoull(value) * 1000);
+				}
+			}
+		}
+
+		struct technique
+		{
+			std::string name;
+			int priority;
+		};
+
+		uint64_t budget = 0; // In nanoseconds
+		std::vector<technique> techniques;
+		std::vector<std::vector<uint64_t>> frames; // Duration of every technique in nanoseconds for each frame
+	};
+}
+
+TEST_CASE(effect_budget_controller_suspend_and_resume)
+{
+	simulation sim;
+	sim.techniques = {
+		{ 2'000'000, 0, false },
+		{ 3'000'000, 1, false },
+		{ 1'500'000, 0, false },
+		{ 1'000'000, 5, false },
+	};
+
+	// Heavy scene: 7.5 ms of techniques with a budget of 5 ms, so the two cheapest ones with the lowest priority have to go, starting with the later one
+	sim.run(1000, 5'000'000, [](unsigned int) { return 1.0; });
+
+	CHECK(sim.changes.size() == 2);
+	CHECK(sim.changes.size() == 2 && sim.changes[0].type == effect_budget_controller::action::suspend && sim.changes[0].index == 2);
+	CHECK(sim.changes.size() == 2 && sim.changes[1].type == effect_budget_controller::action::suspend && sim.changes[1].index == 0);
+	// Each suspension waits for the budget to be exceeded for a number of consecutive frames
+	CHECK(sim.changes.size() == 2 && sim.changes[0].frame == effect_budget_controller::SUSPEND_DELAY - 1 && sim.changes[1].frame == 2 * effect_budget_controller::SUSPEND_DELAY - 1);
+	CHECK(sim.total_duration() <= 5'000'000);
+
+	// Light scene: everything fits again with headroom to spare, so the techniques are resumed in the reverse order
+	sim.changes.clear();
+	sim.run(1000, 5'000'000, [](unsigned int) { return 0.4; });
+
+	CHECK(sim.changes.size() == 2);
+	CHECK(sim.changes.size() == 2 && sim.changes[0].type == effect_budget_controller::action::resume && sim.changes[0].index == 0);
+	CHECK(sim.changes.size() == 2 && sim.changes[1].type == effect_budget_controller::action::resume && sim.changes[1].index == 2);
+	CHECK(sim.changes.size() == 2 && sim.changes[1].frame - sim.changes[0].frame == effect_budget_controller::RESUME_DELAY);
+	CHECK(sim.total_duration() <= 5'000'000);
+}
+
+TEST_CASE(effect_budget_controller_hysteresis)
+{
+	simulation sim;
+	sim.techniques = {
+		{ 2'000'000, 0, false },
+		{ 2'000'000, 0, false },
+	};
+
+	// Spikes above the budget that are shorter than the delay do not suspend anything
+	sim.run(2000, 4'500'000, [](unsigned int frame) { return frame % 20 < 5 ? 1.5 : 1.0; });
+	CHECK(sim.changes.empty());
+
+	// A technique that only barely fits is not resumed, so that it does not flicker on and off
+	sim.run(1000, 4'500'000, [](unsigned int) { return 1.2; });
+	CHECK(sim.changes.size() == 1 && sim.changes[0].type == effect_budget_controller::action::suspend && sim.changes[0].index == 1);
+	sim.run(2000, 4'500'000, [](unsigned int) { return 1.05; });
+	CHECK(sim.changes.size() == 1);
+
+	// A load that alternates around the point where the technique fits with headroom does not resume it either, since the headroom has to last for a number of consecutive frames
+	sim.run(2000, 4'500'000, [](unsigned int frame) { return frame % 100 < 90 ? 0.75 : 1.2; });
+	CHECK(sim.changes.size() == 1);
+
+	sim.run(1000, 4'500'000, [](unsigned int) { return 0.75; });
+	CHECK(sim.changes.size() == 2 && sim.changes[1].type == effect_budget_controller::action::resume && sim.changes[1].index == 1);
+}
+
+TEST_CASE(effect_budget_controller_limits)
+{
+	// A single technique over the budget is suspended too, and once everything is suspended there is nothing left to do
+	simulation sim;
+	sim.techniques = {
+		{ 10'000'000, 0, false },
+	};
+
+	sim.run(1000, 5'000'000, [](unsigned int) { return 1.0; });
+	CHECK(sim.changes.size() == 1 && sim.changes[0].type == effect_budget_controller::action::suspend && sim.techniques[0].suspended);
+
+	// Resetting the controller restarts the delay
+	simulation reset_sim;
+	reset_sim.techniques = {
+		{ 10'000'000, 0, false },
+	};
+
+	for (unsigned int i = 0; i < 10; ++i)
+	{
+		reset_sim.run(effect_budget_controller::SUSPEND_DELAY - 1, 5'000'000, [](unsigned int) { return 1.0; });
+		reset_sim.controller.reset();
+	}
+	CHECK(reset_sim.changes.empty());
+
+	// No candidates at all is fine as well
+	effect_budget_controller controller;
+	CHECK(controller.update(5'000'000, nullptr, 0).type == effect_budget_controller::action::none);
+}
+
+TEST_CASE(effect_budget_controller_recorded_trace)
+{
+	const timing_trace trace(std::filesystem::path(__FILE__).parent_path() / "effect_budget_trace.txt");
+	CHECK(trace.budget == 5'000'000 && trace.techniques.size() == 4 && trace.frames.size() == 1500);
+
+	struct change
+	{
+		size_t frame;
+		effect_budget_controller::action type;
+		std::string name;
+	};
+
+	std::vector<change> changes;
+	std::vector<bool> suspended(trace.techniques.size(), false);
+	std::vector<reshade::moving_average<uint64_t, 60>> average_gpu_durations(trace.techniques.size());
+
+	// Replay the trace the same way as 'runtime::update_effect_budget', where suspended techniques are not rendered and therefore keep the average from before they were suspended
+	effect_budget_controller controller;
+	for (size_t frame = 0; frame < trace.frames.size(); ++frame)
+	{
+		CHECK(trace.frames[frame].size() == trace.techniques.size());
+
+		std::vector<effect_budget_controller::candidate> candidates;
+		for (size_t k = 0; k < trace.techniques.size(); ++k)
+		{
+			if (!suspended[k])
+				average_gpu_durations[k].append(trace.frames[frame][k]);
+
+			candidates.push_back({ average_gpu_durations[k], trace.techniques[k].priority, suspended[k] });
+		}
+
+		const effect_budget_controller::decision decision = controller.update(trace.budget, candidates.data(), candidates.size());
+		if (decision.type == effect_budget_controller::action::none)
+			continue;
+
+		suspended[decision.index] = decision.type == effect_budget_controller::action::suspend;
+		changes.push_back({ frame, decision.type, trace.techniques[decision.index].name });
+	}
+
+	// The hitch in the light scene is too short to suspend anything, the heavy scene sheds the two techniques with the lowest priority (the later one first) and they are resumed in the reverse order once the scene is light again
+	CHECK(changes.size() == 4);
+	if (changes.size() != 4)
+		return;
+
+	CHECK(changes[0].type == effect_budget_controller::action::suspend && changes[0].name == "Bloom@Bloom.fx");
+	CHECK(changes[1].type == effect_budget_controller::action::suspend && changes[1].name == "MXAO@qUINT_mxao.fx");
+	CHECK(changes[2].type == effect_budget_controller::action::resume && changes[2].name == "MXAO@qUINT_mxao.fx");
+	CHECK(changes[3].type == effect_budget_controller::action::resume && changes[3].name == "Bloom@Bloom.fx");
+
+	CHECK(changes[0].frame >= 400 + effect_budget_controller::SUSPEND_DELAY && changes[1].frame - changes[0].frame >= effect_budget_controller::SUSPEND_DELAY && changes[1].frame < 900);
+	CHECK(changes[2].frame >= 900 + effect_budget_controller::RESUME_DELAY && changes[3].frame - changes[2].frame >= effect_budget_controller::RESUME_DELAY);
+}
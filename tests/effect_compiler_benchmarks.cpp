@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_lexer.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include <new>
+#include <atomic>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+// Every allocation is prefixed with its size, so that the amount of memory in use is known when it is freed again
+static constexpr size_t s_allocation_header_size = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+static std::atomic<size_t> s_allocated_bytes = 0;
+static std::atomic<size_t> s_peak_allocated_bytes = 0;
+
+void *operator new(size_t size)
+{
+	void *const ptr = std::malloc(size + s_allocation_header_size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+
+	*static_cast<size_t *>(ptr) = size;
+
+	const size_t allocated_bytes = s_allocated_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	for (size_t peak = s_peak_allocated_bytes.load(std::memory_order_relaxed); allocated_bytes > peak && !s_peak_allocated_bytes.compare_exchange_weak(peak, allocated_bytes, std::memory_order_relaxed);)
+		continue;
+
+	return static_cast<char *>(ptr) + s_allocation_header_size;
+}
+void operator delete(void *ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	ptr = static_cast<char *>(ptr) - s_allocation_header_size;
+	s_allocated_bytes.fetch_sub(*static_cast<size_t *>(ptr), std::memory_order_relaxed);
+	std::free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+namespace
+{
+	struct backend_info
+	{
+		const char *name;
+		reshadefx::codegen *(*create)();
+	};
+
+	const backend_info backends[] = {
+		{ "spirv", []() { return reshadefx::create_codegen_spirv(true, false, false); } },
+		{ "glsl", []() { return reshadefx::create_codegen_glsl(false, false); } },
+		{ "hlsl", []() { return reshadefx::create_codegen_hlsl(50, false, false); } },
+	};
+
+	/// <summary>
+	/// Results of the previous run a benchmark is compared against, together with how much worse a result may become before it counts as a regression.
+	/// </summary>
+	struct baseline
+	{
+		explicit baseline(const std::filesystem::path &path)
+		{
+			std::ifstream file(path);
+
+			// Every line consists of a metric name and its value, separated by a tab, lines starting with '#' are comments
+			for (std::string line; std::getline(file, line);)
+			{
+				if (line.empty() || line[0] == '#')
+					continue;
+
+				if (const size_t separator = line.rfind('\t'); separator != std::string::npos)
+				{
+					if (const double value = std::strtod(line.c_str() + separator + 1, nullptr); line.compare(0, separator, "throughput_threshold") == 0)
+						throughput_threshold = value;
+					else if (line.compare(0, separator, "memory_threshold") == 0)
+						memory_threshold = value;
+					else
+						metrics.emplace_back(line.substr(0, separator), value);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Compares a measured value against the baseline and prints it if it regressed or is not part of the baseline yet.
+		/// </summary>
+		/// <param name="higher_is_better">Set to <c>true</c> for throughput, which regresses when it becomes lower, or <c>false</c> for memory usage, which regresses when it becomes higher.</param>
+		/// <returns><c>true</c> if the value did not regress, <c>false</c> otherwise.</returns>
+		bool compare(const std::string &name, double value, bool higher_is_better) const
+		{
+			const auto it = std::find_if(metrics.begin(), metrics.end(), [&name](const std::pair<std::string, double> &metric) { return metric.first == name; });
+			if (it == metrics.end() || it->second <= 0.0)
+			{
+				std::printf("  missing from baseline: %s\t%.0f\n", name.c_str(), value);
+				return true;
+			}
+
+			const double change = (value - it->second) / it->second * 100.0;
+			if (higher_is_better ? change >= -throughput_threshold : change <= memory_threshold)
+				return true;
+
+			std::printf("  regression: %s\t%.0f (%+.1f%% compared to %.0f)\n", name.c_str(), value, change, it->second);
+			return false;
+		}
+
+		double throughput_threshold = 10.0; // In percent
+		double memory_threshold = 10.0;
+		std::vector<std::pair<std::string, double>> metrics;
+	};
+}
+
+BENCHMARK(effect_compiler)
+{
+	const std::filesystem::path corpus_path = std::filesystem::path(__FILE__).parent_path() / "effect_corpus";
+	const baseline baseline(corpus_path.parent_path() / "effect_compiler_baseline.txt");
+
+	std::vector<std::filesystem::path> inputs;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(corpus_path))
+		if (entry.path().extension() == ".fx")
+			inputs.push_back(entry.path());
+	std::sort(inputs.begin(), inputs.end());
+	CHECK(!inputs.empty());
+
+	// Include files are read from disk only once, so that the benchmark measures the compiler and not the file system
+	reshadefx::file_cache include_cache;
+
+	const auto preprocess = [&include_cache, &corpus_path](const std::filesystem::path &input, std::string &output) {
+		reshadefx::preprocessor pp;
+		pp.set_include_cache(&include_cache);
+		pp.add_include_path(corpus_path);
+		pp.add_macro_definition("BUFFER_WIDTH", "1920");
+		pp.add_macro_definition("BUFFER_HEIGHT", "1080");
+		pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+		pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+		const bool success = pp.append_file(input);
+		output = std::move(pp.output());
+		return success;
+	};
+	const auto compile = [](const std::string &source, const backend_info &info) {
+		const std::unique_ptr<reshadefx::codegen> backend(info.create());
+		reshadefx::parser parser;
+		if (!parser.parse(source, backend.get()))
+			return false;
+		reshadefx::module module;
+		backend->write_result(module);
+		return true;
+	};
+
+	bool regressed = false;
+
+	std::printf("  %-28s %12s %14s %10s %10s %10s %12s\n", "Input", "Preprocess", "Lex", "SPIR-V", "GLSL", "HLSL", "Peak memory");
+
+	for (const std::filesystem::path &input : inputs)
+	{
+		const std::string name = input.filename().u8string();
+
+		// Measure the memory that is allocated at most at any time while compiling the input with every backend once
+		std::string source;
+		const size_t allocated_bytes_before = s_allocated_bytes.load();
+		s_peak_allocated_bytes.store(allocated_bytes_before);
+
+		bool success = preprocess(input, source);
+		for (const backend_info &info : backends)
+			success = success && compile(source, info);
+
+		const size_t peak_bytes = s_peak_allocated_bytes.load() - allocated_bytes_before;
+
+		CHECK(success);
+		if (!success)
+			continue;
+
+		const double megabytes = source.size() / (1024.0 * 1024.0);
+
+		const double preprocess_time = reshade::tests::measure(50, [&]() { std::string output; preprocess(input, output); });
+		size_t num_tokens = 0;
+		const double lex_time = reshade::tests::measure(50, [&]() {
+			reshadefx::lexer lexer(source);
+			for (num_tokens = 0; lexer.lex().id != reshadefx::tokenid::end_of_file;)
+				num_tokens++;
+		});
+		double parse_time[std::size(backends)];
+		for (size_t i = 0; i < std::size(backends); ++i)
+			parse_time[i] = reshade::tests::measure(50, [&]() { compile(source, backends[i]); });
+
+		std::printf("  %-28s %7.2f MB/s %7.0f ktok/s", name.c_str(), megabytes / preprocess_time, num_tokens / lex_time / 1000.0);
+		for (size_t i = 0; i < std::size(backends); ++i)
+			std::printf(" %7.1f fx/s", 1.0 / parse_time[i]);
+		std::printf(" %8.0f KiB\n", peak_bytes / 1024.0);
+
+		regressed |= !baseline.compare(name + ".preprocess_kb_per_s", source.size() / 1024.0 / preprocess_time, true);
+		regressed |= !baseline.compare(name + ".lex_tokens_per_s", num_tokens / lex_time, true);
+		for (size_t i = 0; i < std::size(backends); ++i)
+			regressed |= !baseline.compare(name + '.' + backends[i].name + "_effects_per_s", 1.0 / parse_time[i], true);
+		regressed |= !baseline.compare(name + ".peak_memory_bytes", static_cast<double>(peak_bytes), false);
+	}
+
+	CHECK(!regressed);
+}
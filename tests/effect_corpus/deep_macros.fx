@@ -0,0 +1,58 @@
+// Macros that expand into each other, so that every level doubles the amount of expanded code
+
+#include "common.fxh"
+
+#define EXPAND0(x) (x)
+#define EXPAND1(x) EXPAND0(EXPAND0(x) * 0.5 + 0.25)
+#define EXPAND2(x) EXPAND1(EXPAND1(x) * 0.5 + 0.25)
+#define EXPAND3(x) EXPAND2(EXPAND2(x) * 0.5 + 0.25)
+#define EXPAND4(x) EXPAND3(EXPAND3(x) * 0.5 + 0.25)
+#define EXPAND5(x) EXPAND4(EXPAND4(x) * 0.5 + 0.25)
+#define EXPAND6(x) EXPAND5(EXPAND5(x) * 0.5 + 0.25)
+
+float4 DeepMacrosPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+{
+	float x = texcoord.x;
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	x = EXPAND6(x);
+	return x;
+}
+
+technique DeepMacros
+{
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = DeepMacrosPS;
+	}
+}
@@ -0,0 +1,72 @@
+// A typical two pass post-processing effect with user interface annotations, render targets and loops
+
+#include "common.fxh"
+
+uniform int BlurRadius <
+	ui_type = "slider";
+	ui_min = 1; ui_max = 8;
+	ui_label = "Blur Radius";
+	ui_tooltip = "Number of pixels sampled on each side of the center pixel.";
+> = 4;
+uniform float BlurStrength <
+	ui_type = "drag";
+	ui_min = 0.0; ui_max = 1.0; ui_step = 0.01;
+	ui_label = "Blur Strength";
+> = 0.5;
+uniform bool DepthAware <
+	ui_label = "Only blur the background";
+> = false;
+
+texture BlurTex { Width = BUFFER_WIDTH / 2; Height = BUFFER_HEIGHT / 2; Format = RGBA16F; };
+sampler BlurSampler { Texture = BlurTex; AddressU = CLAMP; AddressV = CLAMP; MinFilter = LINEAR; MagFilter = LINEAR; };
+
+static const float Weights[9] = { 0.2270270270, 0.1945945946, 0.1216216216, 0.0540540541, 0.0162162162, 0.0075, 0.0032, 0.0011, 0.0003 };
+
+float3 Blur(sampler s, float2 texcoord, float2 direction)
+{
+	float3 color = tex2D(s, texcoord).rgb * Weights[0];
+	float total_weight = Weights[0];
+
+	[loop]
+	for (int i = 1; i <= BlurRadius; ++i)
+	{
+		const float2 offset = direction * BUFFER_PIXEL_SIZE * i;
+		color += tex2D(s, texcoord + offset).rgb * Weights[i];
+		color += tex2D(s, texcoord - offset).rgb * Weights[i];
+		total_weight += Weights[i] * 2.0;
+	}
+
+	return color / total_weight;
+}
+
+float4 BlurHorizontalPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+{
+	return float4(Blur(Common::BackBuffer, texcoord, float2(1.0, 0.0)), 1.0);
+}
+
+float4 BlurVerticalPS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+{
+	const float3 original = tex2D(Common::BackBuffer, texcoord).rgb;
+	float3 blurred = Blur(BlurSampler, texcoord, float2(0.0, 1.0));
+
+	float strength = BlurStrength;
+	if (DepthAware)
+		strength *= saturate(Common::GetLinearizedDepth(texcoord) * 4.0);
+
+	return float4(lerp(original, blurred, strength), 1.0);
+}
+
+technique GaussianBlur < ui_tooltip = "Blurs the image in two separable passes."; >
+{
+	pass Horizontal
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = BlurHorizontalPS;
+		RenderTarget = BlurTex;
+	}
+	pass Vertical
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = BlurVerticalPS;
+	}
+}
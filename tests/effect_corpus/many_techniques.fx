@@ -0,0 +1,137 @@
+// Many small techniques, each with its own uniform and pixel shader, declared through a macro
+
+#include "common.fxh"
+
+#define DECLARE_TECHNIQUE(index) \
+	uniform float Strength##index < ui_type = "slider"; ui_min = 0.0; ui_max = 1.0; ui_label = "Strength " #index; > = 0.5; \
+	float4 PS##index(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return float4(tex2D(Common::BackBuffer, texcoord).rgb * Strength##index, 1.0); } \
+	technique Technique##index { pass { VertexShader = PostProcessVS; PixelShader = PS##index; } }
+
+DECLARE_TECHNIQUE(0)
+DECLARE_TECHNIQUE(1)
+DECLARE_TECHNIQUE(2)
+DECLARE_TECHNIQUE(3)
+DECLARE_TECHNIQUE(4)
+DECLARE_TECHNIQUE(5)
+DECLARE_TECHNIQUE(6)
+DECLARE_TECHNIQUE(7)
+DECLARE_TECHNIQUE(8)
+DECLARE_TECHNIQUE(9)
+DECLARE_TECHNIQUE(10)
+DECLARE_TECHNIQUE(11)
+DECLARE_TECHNIQUE(12)
+DECLARE_TECHNIQUE(13)
+DECLARE_TECHNIQUE(14)
+DECLARE_TECHNIQUE(15)
+DECLARE_TECHNIQUE(16)
+DECLARE_TECHNIQUE(17)
+DECLARE_TECHNIQUE(18)
+DECLARE_TECHNIQUE(19)
+DECLARE_TECHNIQUE(20)
+DECLARE_TECHNIQUE(21)
+DECLARE_TECHNIQUE(22)
+DECLARE_TECHNIQUE(23)
+DECLARE_TECHNIQUE(24)
+DECLARE_TECHNIQUE(25)
+DECLARE_TECHNIQUE(26)
+DECLARE_TECHNIQUE(27)
+DECLARE_TECHNIQUE(28)
+DECLARE_TECHNIQUE(29)
+DECLARE_TECHNIQUE(30)
+DECLARE_TECHNIQUE(31)
+DECLARE_TECHNIQUE(32)
+DECLARE_TECHNIQUE(33)
+DECLARE_TECHNIQUE(34)
+DECLARE_TECHNIQUE(35)
+DECLARE_TECHNIQUE(36)
+DECLARE_TECHNIQUE(37)
+DECLARE_TECHNIQUE(38)
+DECLARE_TECHNIQUE(39)
+DECLARE_TECHNIQUE(40)
+DECLARE_TECHNIQUE(41)
+DECLARE_TECHNIQUE(42)
+DECLARE_TECHNIQUE(43)
+DECLARE_TECHNIQUE(44)
+DECLARE_TECHNIQUE(45)
+DECLARE_TECHNIQUE(46)
+DECLARE_TECHNIQUE(47)
+DECLARE_TECHNIQUE(48)
+DECLARE_TECHNIQUE(49)
+DECLARE_TECHNIQUE(50)
+DECLARE_TECHNIQUE(51)
+DECLARE_TECHNIQUE(52)
+DECLARE_TECHNIQUE(53)
+DECLARE_TECHNIQUE(54)
+DECLARE_TECHNIQUE(55)
+DECLARE_TECHNIQUE(56)
+DECLARE_TECHNIQUE(57)
+DECLARE_TECHNIQUE(58)
+DECLARE_TECHNIQUE(59)
+DECLARE_TECHNIQUE(60)
+DECLARE_TECHNIQUE(61)
+DECLARE_TECHNIQUE(62)
+DECLARE_TECHNIQUE(63)
+DECLARE_TECHNIQUE(64)
+DECLARE_TECHNIQUE(65)
+DECLARE_TECHNIQUE(66)
+DECLARE_TECHNIQUE(67)
+DECLARE_TECHNIQUE(68)
+DECLARE_TECHNIQUE(69)
+DECLARE_TECHNIQUE(70)
+DECLARE_TECHNIQUE(71)
+DECLARE_TECHNIQUE(72)
+DECLARE_TECHNIQUE(73)
+DECLARE_TECHNIQUE(74)
+DECLARE_TECHNIQUE(75)
+DECLARE_TECHNIQUE(76)
+DECLARE_TECHNIQUE(77)
+DECLARE_TECHNIQUE(78)
+DECLARE_TECHNIQUE(79)
+DECLARE_TECHNIQUE(80)
+DECLARE_TECHNIQUE(81)
+DECLARE_TECHNIQUE(82)
+DECLARE_TECHNIQUE(83)
+DECLARE_TECHNIQUE(84)
+DECLARE_TECHNIQUE(85)
+DECLARE_TECHNIQUE(86)
+DECLARE_TECHNIQUE(87)
+DECLARE_TECHNIQUE(88)
+DECLARE_TECHNIQUE(89)
+DECLARE_TECHNIQUE(90)
+DECLARE_TECHNIQUE(91)
+DECLARE_TECHNIQUE(92)
+DECLARE_TECHNIQUE(93)
+DECLARE_TECHNIQUE(94)
+DECLARE_TECHNIQUE(95)
+DECLARE_TECHNIQUE(96)
+DECLARE_TECHNIQUE(97)
+DECLARE_TECHNIQUE(98)
+DECLARE_TECHNIQUE(99)
+DECLARE_TECHNIQUE(100)
+DECLARE_TECHNIQUE(101)
+DECLARE_TECHNIQUE(102)
+DECLARE_TECHNIQUE(103)
+DECLARE_TECHNIQUE(104)
+DECLARE_TECHNIQUE(105)
+DECLARE_TECHNIQUE(106)
+DECLARE_TECHNIQUE(107)
+DECLARE_TECHNIQUE(108)
+DECLARE_TECHNIQUE(109)
+DECLARE_TECHNIQUE(110)
+DECLARE_TECHNIQUE(111)
+DECLARE_TECHNIQUE(112)
+DECLARE_TECHNIQUE(113)
+DECLARE_TECHNIQUE(114)
+DECLARE_TECHNIQUE(115)
+DECLARE_TECHNIQUE(116)
+DECLARE_TECHNIQUE(117)
+DECLARE_TECHNIQUE(118)
+DECLARE_TECHNIQUE(119)
+DECLARE_TECHNIQUE(120)
+DECLARE_TECHNIQUE(121)
+DECLARE_TECHNIQUE(122)
+DECLARE_TECHNIQUE(123)
+DECLARE_TECHNIQUE(124)
+DECLARE_TECHNIQUE(125)
+DECLARE_TECHNIQUE(126)
+DECLARE_TECHNIQUE(127)
@@ -0,0 +1,99 @@
+// Structures, function overloads, casts and intrinsics, which make the parser backtrack and resolve overloads
+
+#include "common.fxh"
+
+struct Material
+{
+	float3 albedo;
+	float roughness;
+	float metallic;
+};
+
+struct Light
+{
+	float3 direction;
+	float3 color;
+	float intensity;
+};
+
+static const float PI = 3.14159265;
+
+float Square(float x) { return x * x; }
+float2 Square(float2 x) { return x * x; }
+float3 Square(float3 x) { return x * x; }
+float4 Square(float4 x) { return x * x; }
+
+float DistributionGGX(float3 n, float3 h, float roughness)
+{
+	const float a2 = Square(Square(roughness));
+	const float n_dot_h = max(dot(n, h), 0.0);
+	return a2 / (PI * Square(Square(n_dot_h) * (a2 - 1.0) + 1.0));
+}
+
+float GeometrySchlick(float n_dot_v, float roughness)
+{
+	const float k = Square(roughness + 1.0) / 8.0;
+	return n_dot_v / (n_dot_v * (1.0 - k) + k);
+}
+
+float3 FresnelSchlick(float cos_theta, float3 f0)
+{
+	return f0 + (1.0 - f0) * pow(saturate(1.0 - cos_theta), 5.0);
+}
+
+float3 Shade(Material material, Light light, float3 n, float3 v)
+{
+	const float3 l = normalize(-light.direction);
+	const float3 h = normalize(v + l);
+	const float3 f0 = lerp((float3)0.04, material.albedo, material.metallic);
+
+	const float n_dot_v = max(dot(n, v), 0.0);
+	const float n_dot_l = max(dot(n, l), 0.0);
+	const float3 f = FresnelSchlick(max(dot(h, v), 0.0), f0);
+	const float3 specular = DistributionGGX(n, h, material.roughness) * GeometrySchlick(n_dot_v, material.roughness) * GeometrySchlick(n_dot_l, material.roughness) * f / max(4.0 * n_dot_v * n_dot_l, 0.001);
+	const float3 diffuse = (1.0 - f) * (1.0 - material.metallic) * material.albedo / PI;
+
+	return (diffuse + specular) * light.color * light.intensity * n_dot_l;
+}
+
+float3 NormalFromDepth(float2 texcoord)
+{
+	const float2 offset = BUFFER_PIXEL_SIZE;
+	const float center = Common::GetLinearizedDepth(texcoord);
+	const float3 dx = float3(offset.x, 0.0, Common::GetLinearizedDepth(texcoord + float2(offset.x, 0.0)) - center);
+	const float3 dy = float3(0.0, offset.y, Common::GetLinearizedDepth(texcoord + float2(0.0, offset.y)) - center);
+	return normalize(cross(dx, dy));
+}
+
+float4 ShadePS(float4 position : SV_Position, float2 texcoord : TEXCOORD) : SV_Target
+{
+	Material material;
+	material.albedo = tex2D(Common::BackBuffer, texcoord).rgb;
+	material.roughness = 0.5;
+	material.metallic = (float)(Common::FrameCount % 2);
+
+	Light lights[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		lights[i].direction = normalize(float3(sin((float)i), -1.0, cos((float)(i))));
+		lights[i].color = float3(1.0, 0.9 - i * 0.1, 0.8);
+		lights[i].intensity = (i == 0) ? 2.0 : (float)(1) / (i + 1);
+	}
+
+	const float3 n = NormalFromDepth(texcoord);
+	float3 color = 0.0;
+	[unroll]
+	for (int j = 0; j < 3; ++j)
+		color += Shade(material, lights[j], n, float3(0.0, 0.0, -1.0));
+
+	return float4(color / (color + 1.0), 1.0);
+}
+
+technique Shading
+{
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = ShadePS;
+	}
+}
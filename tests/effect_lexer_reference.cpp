@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+// Compile the lexer a second time with the scalar code paths, in its own namespace so that it does not conflict with the optimized one it is compared against
+#define LEXER_SSE2 0
+#define LEXER_KEYWORD_TABLE 0
+#define reshadefx reshadefx_reference
+#include "effect_lexer.cpp"
+#undef reshadefx
+
+#include "effect_lexer_reference.hpp"
+#include <cstring>
+
+std::vector<reshade::tests::reference_token> reshade::tests::lex_reference(const std::string &input, bool ignore_comments, bool ignore_whitespace, bool ignore_pp_directives, bool ignore_line_directives, bool ignore_keywords, bool escape_string_literals)
+{
+	reshadefx_reference::lexer lexer(input, ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals);
+
+	// Every token consumes at least one character (except for a '#' at the very end of the input), so there cannot be many more tokens than characters
+	std::vector<reference_token> tokens;
+	while (tokens.size() <= input.size() + 1)
+	{
+		const reshadefx_reference::token tok = lexer.lex();
+
+		reference_token &reference = tokens.emplace_back();
+		reference.id = static_cast<int>(tok.id);
+		reference.source = tok.location.source;
+		reference.line = tok.location.line;
+		reference.column = tok.location.column;
+		reference.offset = tok.offset;
+		reference.length = tok.length;
+		std::memcpy(&reference.literal_as_double, &tok.literal_as_double, sizeof(double)); // Copy all bytes of the literal value, no matter which member of the union is set
+		reference.literal_as_string = tok.literal_as_string;
+
+		if (tok.id == reshadefx_reference::tokenid::end_of_file)
+			break;
+	}
+
+	return tokens;
+}
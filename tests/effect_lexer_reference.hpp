@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace reshade::tests
+{
+	/// <summary>
+	/// A token of the reference lexer, with the same fields as 'reshadefx::token', but not depending on its declaration.
+	/// </summary>
+	struct reference_token
+	{
+		int id;
+		std::string source;
+		unsigned int line, column;
+		size_t offset, length;
+		union
+		{
+			int literal_as_int;
+			unsigned int literal_as_uint;
+			float literal_as_float;
+			double literal_as_double;
+		};
+		std::string literal_as_string;
+	};
+
+	/// <summary>
+	/// Splits the input into tokens with a second copy of the lexer that was compiled without vectorized scanning and with a plain map for keywords.
+	/// The arguments are the same as those of the 'reshadefx::lexer' constructor.
+	/// </summary>
+	std::vector<reference_token> lex_reference(const std::string &input, bool ignore_comments, bool ignore_whitespace, bool ignore_pp_directives, bool ignore_line_directives, bool ignore_keywords, bool escape_string_literals);
+}
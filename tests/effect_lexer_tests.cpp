@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_lexer.hpp"
+#include "effect_lexer_reference.hpp"
+#include <cstdio>
+#include <cstring>
+
+using reshadefx::tokenid;
+
+static std::vector<reshadefx::token> lex_all(const std::string &input, bool ignore_whitespace = true, bool ignore_comments = true)
+{
+	reshadefx::lexer lexer(input, ignore_comments, ignore_whitespace, false);
+
+	// Every token consumes at least one character (except for a '#' at the very end of the input), so there cannot be many more tokens than characters
+	std::vector<reshadefx::token> tokens;
+	while (tokens.size() <= input.size() + 1)
+	{
+		tokens.push_back(lexer.lex());
+		if (tokens.back().id == tokenid::end_of_file)
+			break;
+	}
+
+	return tokens;
+}
+
+/// <summary>
+/// Checks that the token stream ends and that all tokens are in order and lie within the input.
+/// </summary>
+static bool is_well_formed(const std::string &input, const std::vector<reshadefx::token> &tokens)
+{
+	if (tokens.empty() || tokens.back().id != tokenid::end_of_file || tokens.back().offset != input.size())
+		return false;
+
+	for (size_t i = 0; i < tokens.size(); ++i)
+	{
+		if (tokens[i].offset + tokens[i].length > input.size() + (tokens[i].id == tokenid::end_of_file ? 1 : 0))
+			return false;
+		if (i != 0 && tokens[i].offset < tokens[i - 1].offset + tokens[i - 1].length)
+			return false;
+	}
+
+	return true;
+}
+
+// Builds a string of the specified length by repeating a pattern
+static std::string repeat(const char *pattern, size_t length)
+{
+	std::string result;
+	for (size_t i = 0; i < length; ++i)
+		result += pattern[i % std::strlen(pattern)];
+	return result;
+}
+
+/// <summary>
+/// Checks that the optimized lexer produces exactly the same tokens as the reference lexer for the specified input and flags.
+/// </summary>
+static bool matches_reference(const std::string &input, unsigned int flags)
+{
+	const bool ignore_comments = (flags & 0x1) != 0, ignore_whitespace = (flags & 0x2) != 0, ignore_pp_directives = (flags & 0x4) != 0,
+		ignore_line_directives = (flags & 0x8) != 0, ignore_keywords = (flags & 0x10) != 0, escape_string_literals = (flags & 0x20) != 0;
+
+	const std::vector<reshade::tests::reference_token> expected = reshade::tests::lex_reference(input, ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals);
+
+	reshadefx::lexer lexer(input, ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals);
+
+	for (const reshade::tests::reference_token &reference : expected)
+	{
+		const reshadefx::token tok = lexer.lex();
+
+		if (static_cast<int>(tok.id) != reference.id ||
+			tok.location.source != reference.source || tok.location.line != reference.line || tok.location.column != reference.column ||
+			tok.offset != reference.offset || tok.length != reference.length ||
+			std::memcmp(&tok.literal_as_double, &reference.literal_as_double, sizeof(double)) != 0 || tok.literal_as_string != reference.literal_as_string)
+		{
+			std::fprintf(stderr, "token at offset %zu differs from reference for flags 0x%x\n", reference.offset, flags);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TEST_CASE(effect_lexer_end_of_input)
+{
+	// A '#' at the very end of the input has no directive name after it
+	{
+		const std::vector<reshadefx::token> tokens = lex_all("#");
+		CHECK(is_well_formed("#", tokens));
+		CHECK(tokens.size() == 2 && tokens[0].id == tokenid::hash_unknown);
+	}
+	{
+		const std::vector<reshadefx::token> tokens = lex_all("a #");
+		CHECK(is_well_formed("a #", tokens));
+		CHECK(tokens.size() == 3 && tokens[1].id == tokenid::hash);
+	}
+	{
+		const std::vector<reshadefx::token> tokens = lex_all("\n# \t");
+		CHECK(is_well_formed("\n# \t", tokens));
+		CHECK(tokens.size() == 2 && tokens[0].id == tokenid::hash_unknown);
+	}
+
+	// An escape character at the very end of an unterminated string literal has nothing to escape
+	{
+		const std::vector<reshadefx::token> tokens = lex_all("\"abc\\");
+		CHECK(is_well_formed("\"abc\\", tokens));
+		CHECK(tokens.size() == 2 && tokens[0].id == tokenid::string_literal && tokens[0].literal_as_string == "abc\\" && tokens[0].length == 5);
+	}
+	{
+		const std::vector<reshadefx::token> tokens = lex_all("\"\\");
+		CHECK(is_well_formed("\"\\", tokens));
+		CHECK(tokens.size() == 2 && tokens[0].id == tokenid::string_literal && tokens[0].length == 2);
+	}
+	{
+		const std::vector<reshadefx::token> tokens = lex_all("\"abc");
+		CHECK(is_well_formed("\"abc", tokens));
+		CHECK(tokens.size() == 2 && tokens[0].id == tokenid::string_literal && tokens[0].literal_as_string == "abc");
+	}
+
+	// Unterminated comments extend to the end of the input
+	for (const char *const input : { "/*", "/* abc", "/* abc *", "/* abc \n", "//", "// abc" })
+	{
+		const std::vector<reshadefx::token> tokens = lex_all(input, true, false);
+		CHECK(is_well_formed(input, tokens));
+		CHECK(tokens.size() == 2 && (tokens[0].id == tokenid::multi_line_comment || tokens[0].id == tokenid::single_line_comment) && tokens[0].length == std::strlen(input));
+	}
+}
+
+TEST_CASE(effect_lexer_block_boundaries)
+{
+	// Runs of every length around the size of the blocks that are scanned at once, to cover full blocks, the remainder and both combined
+	for (size_t n = 0; n <= 40; ++n)
+	{
+		const std::string space = repeat(" \t\v\f\r", n);
+		{
+			const std::vector<reshadefx::token> tokens = lex_all(space + "x");
+			CHECK(tokens.size() == 2 && tokens[0].id == tokenid::identifier && tokens[0].offset == n);
+		}
+		if (n != 0)
+		{
+			const std::vector<reshadefx::token> tokens = lex_all("x" + space + "y", false);
+			CHECK(tokens.size() == 4 && tokens[1].id == tokenid::space && tokens[1].length == n && tokens[2].literal_as_string == "y");
+		}
+
+		// Identifiers starting with an underscore cannot be keywords
+		const std::string identifier = "_" + repeat("azAZ09_m", n);
+		{
+			const std::vector<reshadefx::token> tokens = lex_all(identifier + "+");
+			CHECK(tokens.size() == 3 && tokens[0].id == tokenid::identifier && tokens[0].literal_as_string == identifier && tokens[1].id == tokenid::plus);
+		}
+		{
+			// Characters outside of the ASCII range are not part of identifiers
+			const std::vector<reshadefx::token> tokens = lex_all(identifier + "\xC3\xA4");
+			CHECK(tokens.size() == 4 && tokens[0].literal_as_string == identifier && tokens[1].id == tokenid::unknown);
+		}
+
+		const std::string text = repeat("ab #/*'\xC3\xA4", n);
+		{
+			const std::string input = "\"" + text + "\\n" + text + "\\\"\"";
+			const std::vector<reshadefx::token> tokens = lex_all(input);
+			CHECK(tokens.size() == 2 && tokens[0].id == tokenid::string_literal && tokens[0].literal_as_string == text + "\n" + text + "\"" && tokens[0].length == input.size());
+		}
+		{
+			// Line feeds and stars that do not end the comment have to be handled in between runs of comment text
+			const std::string comment = "/*" + repeat("ab*\n/", n) + "*/";
+			const std::vector<reshadefx::token> tokens = lex_all(comment + "x", true, false);
+			CHECK(tokens.size() == 3 && tokens[0].id == tokenid::multi_line_comment && tokens[0].length == comment.size());
+			CHECK(tokens.size() == 3 && tokens[1].id == tokenid::identifier && tokens[1].location.line == 1 + (n + 1) / 5);
+		}
+		{
+			const std::vector<reshadefx::token> tokens = lex_all("//" + text + "\nx", true, false);
+			CHECK(tokens.size() == 3 && tokens[0].id == tokenid::single_line_comment && tokens[0].length == n + 2 && tokens[1].location.line == 2);
+		}
+	}
+}
+
+TEST_CASE(effect_lexer_keywords)
+{
+	for (int i = static_cast<int>(tokenid::namespace_); i <= static_cast<int>(tokenid::storage); ++i)
+	{
+		const tokenid id = static_cast<tokenid>(i);
+		const std::string name = reshadefx::token::id_to_name(id);
+
+		// Some keywords are only reserved and not supported (like 'centroid')
+		const tokenid lexed_id = lex_all(name)[0].id;
+		CHECK(lexed_id == id || lexed_id == tokenid::reserved);
+
+		// Identifiers that only contain a keyword are not keywords
+		CHECK(lex_all(name + "_")[0].id == tokenid::identifier);
+		CHECK(lex_all("_" + name)[0].id == tokenid::identifier);
+
+		reshadefx::lexer lexer(name, true, true, true, false, true);
+		CHECK(lexer.lex().id == tokenid::identifier);
+	}
+
+	CHECK(lex_all("float4x1")[0].id == tokenid::float4);
+	CHECK(lex_all("Float4")[0].id == tokenid::identifier);
+	CHECK(lex_all("technique")[0].id == tokenid::technique);
+}
+
+TEST_CASE(effect_lexer_fuzz)
+{
+	// Characters that start or end the different kinds of tokens, so that random inputs contain many partial and unterminated ones
+	const char alphabet[] = "aZ_09 \t\r\n#/*\"\\.,'+-<>=!&|x\xC3";
+
+	uint32_t seed = 1;
+	for (int i = 0; i < 5000; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+
+		std::string input((seed >> 16) % 100, ' ');
+		for (char &c : input)
+		{
+			seed = seed * 1103515245 + 12345;
+			c = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+		}
+
+		CHECK(is_well_formed(input, lex_all(input)));
+		CHECK(is_well_formed(input, lex_all(input, false, false)));
+	}
+}
+
+TEST_CASE(effect_lexer_matches_reference)
+{
+	// Inputs covering every kind of token, with runs long enough to be scanned in blocks
+	const std::string inputs[] = {
+		"float4 main(float2 texcoord : TEXCOORD) : SV_Target { return tex2D(s, texcoord) * 0.5f + 1e-3 - 0x1F + 017u + 2.0lf; }",
+		"#define MACRO(x) (x * 2) \\\n\t+ 1\n#line 42 \"file.fx\"\nint a = MACRO(3);\n#pragma once\n#  include \"a.fxh\"\n#unknown\n",
+		"/* multi\nline *** comment */ // single line comment\n" + repeat("/* abcdefghijklmnopqrstuvwxyz */", 3200),
+		"\"string with \\\"escapes\\\" \\n \\t \\x41 \\101 and a line\\\ncontinuation\" \"unterminated\nstring",
+		repeat("technique namespace struct uniform static const sampler2D float4x4 true false _identifier012 ", 20000),
+		repeat(" \t\v\f\r", 5000) + repeat("\n", 100) + "x",
+	};
+
+	for (const std::string &input : inputs)
+		for (unsigned int flags = 0; flags < 64; ++flags)
+			CHECK(matches_reference(input, flags));
+}
+
+TEST_CASE(effect_lexer_matches_reference_fuzz)
+{
+	// Characters that start or end the different kinds of tokens, plus keywords and directives that are inserted as a whole
+	const char alphabet[] = "aZ_09 \t\r\n#/*\"\\.,'+-<>=!&|xefu\xC3";
+	const char *const words[] = { "float", "int", "if", "return", "technique", "true", "define", "line", "include", "0x", "1.5e+", "//", "/*", "*/", "\\\n" };
+
+	uint32_t seed = 1;
+	const auto next = [&seed]() { seed = seed * 1103515245 + 12345; return seed >> 16; };
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		std::string input;
+		for (size_t length = next() % 200; input.size() < length;)
+		{
+			if (next() % 8 == 0)
+				input += words[next() % std::size(words)];
+			else
+				input += alphabet[next() % (sizeof(alphabet) - 1)];
+		}
+
+		CHECK(matches_reference(input, next() % 64));
+	}
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_lexer.hpp"
+#include <memory>
+
+using reshadefx::tokenid;
+
+static size_t count_tokens(const std::string &source)
+{
+	reshadefx::lexer lexer(source);
+
+	size_t num_tokens = 1; // The parser counts the end of file token too
+	while (lexer.lex().id != tokenid::end_of_file)
+		num_tokens++;
+	return num_tokens;
+}
+
+static size_t parse_and_count_tokens(const std::string &source)
+{
+	const std::unique_ptr<reshadefx::codegen> backend(reshadefx::create_codegen_hlsl(50, false, false));
+
+	reshadefx::parser parser;
+	CHECK(parser.parse(source, backend.get()));
+	return parser.num_tokens();
+}
+
+TEST_CASE(effect_parser_num_tokens)
+{
+	// Every token is consumed exactly once without backtracking
+	const std::string source =
+		"uniform float value = 1.0;\n"
+		"float4 main(float4 pos : SV_Position) : SV_Target { return pos * value; }\n";
+	CHECK(parse_and_count_tokens(source) == count_tokens(source));
+}
+
+TEST_CASE(effect_parser_num_tokens_backtracking)
+{
+	// The parser backtracks when a parenthesis could start a cast and when an identifier could name a structure, which must not count the tokens consumed again
+	const std::string source =
+		"struct S { float x; };\n"
+		"float f(float a) { S s; s.x = a; float b = (float)(a) + (a) * 2; return (b) + s.x; }\n"
+		"float4 main() : SV_Target { return (float4)f((1.0)); }\n";
+	CHECK(parse_and_count_tokens(source) == count_tokens(source));
+}
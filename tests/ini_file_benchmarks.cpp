@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "dll_config.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	/// <summary>
+	/// The previous implementation of loading and saving INI files, which kept every value in nested maps of strings, for comparison.
+	/// </summary>
+	struct previous_ini_file
+	{
+		explicit previous_ini_file(const std::filesystem::path &path) : path(path)
+		{
+			std::ifstream file(path);
+			if (!file)
+				return;
+
+			// Remove BOM (0xefbbbf means 0xfeff)
+			if (file.get() != 0xef || file.get() != 0xbb || file.get() != 0xbf)
+				file.seekg(0, std::ios::beg);
+
+			std::string line, section;
+			while (std::getline(file, line))
+			{
+				trim(line);
+
+				if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
+					continue;
+
+				if (line[0] == '[')
+				{
+					section = trim(line.substr(0, line.find(']')), " \t[]");
+					continue;
+				}
+
+				const auto assign_index = line.find('=');
+				if (assign_index != std::string::npos)
+				{
+					const std::string key = trim(line.substr(0, assign_index));
+					const std::string value = trim(line.substr(assign_index + 1));
+
+					std::vector<std::string> &elements = sections[section][key];
+					for (size_t offset = 0, base = 0, len = value.size(); offset <= len;)
+					{
+						const size_t found = std::min(value.find_first_of(',', offset), len);
+						if (found + 1 < len && value[found + 1] == ',')
+						{
+							offset = found + 2;
+						}
+						else
+						{
+							std::string &element = elements.emplace_back();
+							element.reserve(found - base);
+
+							while (base < found)
+							{
+								const char c = value[base++];
+								element += c;
+
+								if (c == ',' && base < found && value[base] == ',')
+									base++;
+							}
+
+							base = offset = found + 1;
+						}
+					}
+				}
+				else
+				{
+					sections[section].insert({ line, {} });
+				}
+			}
+		}
+
+		void save() const
+		{
+			std::stringstream data;
+			std::vector<std::string> section_names, key_names;
+
+			section_names.reserve(sections.size());
+			for (const auto &section : sections)
+				section_names.push_back(section.first);
+
+			std::sort(section_names.begin(), section_names.end(),
+				[](std::string a, std::string b) {
+					std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
+					std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
+					return a < b;
+				});
+
+			for (const std::string &section_name : section_names)
+			{
+				const auto &keys = sections.at(section_name);
+
+				key_names.clear();
+				key_names.reserve(keys.size());
+				for (const auto &key : keys)
+					key_names.push_back(key.first);
+
+				std::sort(key_names.begin(), key_names.end(),
+					[](std::string a, std::string b) {
+						std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
+						std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
+						return a < b;
+					});
+
+				if (!section_name.empty())
+					data << '[' << section_name << ']' << '\n';
+
+				for (const std::string &key_name : key_names)
+				{
+					data << key_name << '=';
+
+					if (const std::vector<std::string> &elements = keys.at(key_name); !elements.empty())
+					{
+						std::string value;
+						for (const std::string &element : elements)
+						{
+							value.reserve(value.size() + element.size() + 1);
+							for (const char c : element)
+								value.append(c == ',' ? 2 : 1, c);
+							value += ',';
+						}
+
+						value.pop_back();
+
+						data << value;
+					}
+
+					data << '\n';
+				}
+
+				data << '\n';
+			}
+
+			std::ofstream file(path);
+			const std::string str = data.str();
+			file.write(str.data(), str.size());
+		}
+
+		std::filesystem::path path;
+		std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::string>>> sections;
+	};
+}
+
+BENCHMARK(ini_file)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reshade_ini_file_benchmark.ini";
+
+	// Generate a large preset, with many effects that each have a lot of settings
+	const unsigned int num_sections = 200, num_keys_per_section = 25;
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << "Techniques=";
+		for (unsigned int s = 0; s < num_sections; ++s)
+			file << (s != 0 ? "," : "") << "Technique" << s << "@Effect" << s << ".fx";
+		file << "\n\n";
+
+		for (unsigned int s = 0; s < num_sections; ++s)
+		{
+			file << "[Effect" << s << ".fx]\n";
+			for (unsigned int k = 0; k < num_keys_per_section; ++k)
+				file << "Setting" << k << '=' << k * 0.25f << ',' << s * 0.5f << ',' << 1.0f << ',' << 0.0f << '\n';
+			file << '\n';
+		}
+	}
+
+	const unsigned int num_keys = num_sections * num_keys_per_section;
+
+	reshade::tests::report_benchmark("Load (previous implementation)", reshade::tests::measure(10, [&path]() {
+		const previous_ini_file ini(path);
+	}), num_keys, "keys");
+	reshade::tests::report_benchmark("Load", reshade::tests::measure(10, [&path]() {
+		const reshade::ini_file ini(path);
+	}), num_keys, "keys");
+
+	// Modify a single value, so that the entire file has to be written again
+	reshade::tests::report_benchmark("Load and save (previous implementation)", reshade::tests::measure(10, [&path]() {
+		previous_ini_file ini(path);
+		ini.sections["Effect0.fx"]["Setting0"] = { "1.000000" };
+		ini.save();
+	}), num_keys, "keys");
+	reshade::tests::report_benchmark("Load and save", reshade::tests::measure(10, [&path]() {
+		reshade::ini_file ini(path);
+		ini.set("Effect0.fx", "Setting0", 1.0f);
+	}), num_keys, "keys");
+
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "dll_config.hpp"
+
+// These are defined in 'dll_main.cpp', which is not part of the tests
+std::filesystem::path g_reshade_dll_path;
+std::filesystem::path g_reshade_base_path;
+std::filesystem::path g_target_executable_path;
+
+TEST_CASE(ini_file_load)
+{
+	// Long enough value to go through the vectorized search for separators and not just the remainder
+	std::string long_value;
+	for (int i = 0; i < 40; ++i)
+		long_value += std::to_string(i) + ".500000,";
+	long_value.pop_back();
+
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path path = dir.write("load.ini",
+		"\xEF\xBB\xBF" "Techniques=A@a.fx,B@b.fx\r\n"
+		"; Comment\r\n"
+		"[GENERAL]\r\n"
+		"  PresetPath = C:\\Presets\\Default.ini  \r\n"
+		"Numbers=1,2,,3,-4\n"
+		"Flag=true\n"
+		"EmptyValue=\n"
+		"NoValue\n"
+		"# Another comment\n"
+		"[ Effect.fx ]\n"
+		"LongValue=" + long_value + "\n"
+		"Numbers=5\n"
+		"[GENERAL]\n"
+		"Numbers=6"); // No line break at the end of the file
+
+	const reshade::ini_file ini(path);
+
+	std::vector<std::string> techniques;
+	CHECK(ini.get({}, "Techniques", techniques));
+	CHECK(techniques == std::vector<std::string>({ "A@a.fx", "B@b.fx" }));
+
+	// Leading and trailing whitespace is removed from keys and values
+	std::filesystem::path preset_path;
+	CHECK(ini.get("GENERAL", "PresetPath", preset_path));
+	CHECK(preset_path == "C:\\Presets\\Default.ini");
+
+	// Values of keys that appear multiple times in the same section are appended and ",," is an escaped comma
+	std::vector<std::string> numbers;
+	CHECK(ini.get("GENERAL", "Numbers", numbers));
+	CHECK(numbers == std::vector<std::string>({ "1", "2,3", "-4", "6" }));
+	int int_values[5] = {};
+	CHECK(ini.get("GENERAL", "Numbers", int_values));
+	CHECK(int_values[0] == 1 && int_values[1] == 2 && int_values[2] == -4 && int_values[3] == 6 && int_values[4] == 0);
+
+	CHECK(ini.get("GENERAL", "Flag"));
+	CHECK(!ini.get("GENERAL", "EmptyValue"));
+
+	// A key with an empty value has a single empty element, while a key without an assignment has none
+	std::vector<std::string> elements;
+	CHECK(ini.get("GENERAL", "EmptyValue", elements) && elements.size() == 1 && elements[0].empty());
+	CHECK(ini.get("GENERAL", "NoValue", elements) && elements.empty());
+
+	// Section names are trimmed too
+	unsigned int uint_value = 0;
+	CHECK(ini.get("Effect.fx", "Numbers", uint_value) && uint_value == 5);
+	CHECK(!ini.has(" Effect.fx ", "Numbers"));
+
+	float float_values[40] = {};
+	CHECK(ini.get("Effect.fx", "LongValue", float_values));
+	bool float_values_match = true;
+	for (int i = 0; i < 40; ++i)
+		float_values_match &= float_values[i] == i + 0.5f;
+	CHECK(float_values_match);
+
+	// Comments are not parsed as keys and missing keys leave the value untouched
+	CHECK(!ini.has({}, "; Comment"));
+	CHECK(!ini.has("GENERAL", "# Another comment"));
+	int missing_value = 42;
+	CHECK(!ini.get("GENERAL", "Missing", missing_value) && missing_value == 42);
+	CHECK(!ini.get("Missing", "Numbers", missing_value) && missing_value == 42);
+}
+
+TEST_CASE(ini_file_save)
+{
+	const reshade::tests::temp_directory dir;
+
+	{
+		reshade::ini_file ini(dir.path / "save.ini");
+		ini.set("b", "Key", std::string("x,y"));
+		ini.set("A", "key2", std::vector<std::string> { "1", "2" });
+		ini.set({}, "Techniques", std::vector<std::string> { "A@a.fx" });
+		ini.set("a", "Z", 1);
+		ini.set("A", "Key1", true);
+		ini.set("b", "Removed", 1);
+		ini.remove_key("b", "Removed");
+	} // Modified files are saved when they are destroyed
+
+	// Sections and keys are sorted without regard to case, but names that only differ in case still stay separate
+	CHECK(dir.read("save.ini") ==
+		"Techniques=A@a.fx\n"
+		"\n"
+		"[A]\n"
+		"Key1=1\n"
+		"key2=1,2\n"
+		"\n"
+		"[a]\n"
+		"Z=1\n"
+		"\n"
+		"[b]\n"
+		"Key=x,,y\n"
+		"\n");
+
+	const reshade::ini_file ini(dir.path / "save.ini");
+	std::string value;
+	CHECK(ini.get("b", "Key", value) && value == "x,y");
+	CHECK(ini.get("A", "Key1"));
+	CHECK(!ini.has("b", "Removed"));
+}
+
+TEST_CASE(ini_file_modify)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path path = dir.write("modify.ini",
+		"[Section]\n"
+		"Loaded=1,2,3\n"
+		"Replaced=4\n"
+		"Removed=5\n");
+
+	reshade::ini_file ini(path);
+	ini.set("Section", "Replaced", std::vector<std::string> { "6", "7" });
+	ini.set("Section", "Added", 8);
+	ini.remove_key("Section", "Removed");
+
+	// Replace a value often enough for the unused storage to be compacted, which has to keep all other values intact
+	const std::string long_value(100, 'x');
+	for (int i = 0; i < 2000; ++i)
+		ini.set("Other", "Often", long_value + std::to_string(i));
+
+	std::vector<int> values;
+	CHECK(ini.get("Section", "Loaded", values) && values == std::vector<int>({ 1, 2, 3 }));
+	CHECK(ini.get("Section", "Replaced", values) && values == std::vector<int>({ 6, 7 }));
+	CHECK(ini.get("Section", "Added", values) && values == std::vector<int>({ 8 }));
+	CHECK(!ini.has("Section", "Removed"));
+	std::string often_value;
+	CHECK(ini.get("Other", "Often", often_value) && often_value == long_value + "1999");
+
+	// A removed key can be added again
+	ini.set("Section", "Removed", 9);
+	CHECK(ini.get("Section", "Removed", values) && values == std::vector<int>({ 9 }));
+
+	// Copies own their data, so are independent of the original
+	const reshade::ini_file copy(ini);
+	ini.set("Section", "Loaded", 10);
+	CHECK(copy.get("Section", "Loaded", values) && values == std::vector<int>({ 1, 2, 3 }));
+	CHECK(copy.get("Other", "Often", often_value) && often_value == long_value + "1999");
+	CHECK(copy.revision() != ini.revision());
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "dll_log.hpp"
+#include <thread>
+
+static void log_messages(unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i)
+		LOG(INFO) << "Redirecting vkCreateDevice" << '(' << "physicalDevice = " << reinterpret_cast<void *>(0x1234) << ", index = " << i << ')' << " ...";
+}
+
+BENCHMARK(log_throughput)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reshade_log_benchmark.log";
+	reshade::log::open_log_file(path);
+
+	const unsigned int num_messages = 100000;
+
+	reshade::tests::report_benchmark("Synchronous writes", reshade::tests::measure(3, [num_messages]() {
+		log_messages(num_messages);
+	}), num_messages, "messages");
+
+	reshade::log::start_log_writer();
+
+	reshade::tests::report_benchmark("Background writer (1 thread)", reshade::tests::measure(3, [num_messages]() {
+		log_messages(num_messages);
+		reshade::log::flush();
+	}), num_messages, "messages");
+
+	reshade::tests::report_benchmark("Background writer (4 threads)", reshade::tests::measure(3, [num_messages]() {
+		std::thread threads[4];
+		for (std::thread &thread : threads)
+			thread = std::thread(&log_messages, num_messages / 4);
+		for (std::thread &thread : threads)
+			thread.join();
+		reshade::log::flush();
+	}), num_messages, "messages");
+
+	reshade::log::stop_log_writer();
+
+	reshade::log::close_log_file();
+	std::filesystem::remove(path);
+}
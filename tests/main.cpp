@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include <cstdio>
+#include <cstring>
+
+static unsigned int s_failed_checks = 0;
+
+std::vector<reshade::tests::test_case> &reshade::tests::registry()
+{
+	// Use a function-local static, so that it is constructed before the first test case registers itself
+	static std::vector<test_case> list;
+	return list;
+}
+
+void reshade::tests::report_failure(const char *file, int line, const char *expression)
+{
+	s_failed_checks++;
+	std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+}
+
+void reshade::tests::report_benchmark(const char *name, double best_time, double amount, const char *unit)
+{
+	if (amount != 0 && unit != nullptr)
+		std::printf("  %-40s %10.3f ms %12.1f %s/s\n", name, best_time * 1000.0, amount / best_time, unit);
+	else
+		std::printf("  %-40s %10.3f ms\n", name, best_time * 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	bool run_benchmarks = false;
+	const char *filter = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--benchmark") == 0)
+			run_benchmarks = true;
+		else if (argv[i][0] != '-')
+			filter = argv[i];
+		else
+		{
+			std::fputs("usage: tests [--benchmark] [filter]\n"
+				"  Runs all test cases (or benchmarks with --benchmark) whose name contains the filter.\n", stderr);
+			return 1;
+		}
+	}
+
+	unsigned int num_run = 0, num_failed = 0;
+
+	for (const reshade::tests::test_case &test : reshade::tests::registry())
+	{
+		if (test.is_benchmark != run_benchmarks || (filter != nullptr && std::strstr(test.name, filter) == nullptr))
+			continue;
+
+		std::printf("%s\n", test.name);
+
+		const unsigned int failed_checks_before = s_failed_checks;
+		test.func();
+
+		num_run++;
+		if (s_failed_checks != failed_checks_before)
+			num_failed++;
+	}
+
+	std::printf("%u %s run, %u failed\n", num_run, run_benchmarks ? "benchmarks" : "test cases", num_failed);
+
+	return num_failed != 0 ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "pixel_kernels.hpp"
+#include <cmath>
+#include <cstring>
+
+// Pixel counts that cover empty input, only the scalar remainder, exact multiples of the SSE2 and AVX2 widths and both combined with a remainder
+static const size_t s_counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33, 1000 };
+
+static std::vector<uint8_t> random_bytes(size_t size, uint32_t seed = 1)
+{
+	std::vector<uint8_t> data(size);
+	for (uint8_t &value : data)
+	{
+		seed = seed * 1103515245 + 12345;
+		value = static_cast<uint8_t>(seed >> 16);
+	}
+	return data;
+}
+
+TEST_CASE(pixel_kernels_fill_alpha)
+{
+	for (const size_t count : s_counts)
+	{
+		// Offset by one byte, so that the data is not aligned
+		std::vector<uint8_t> data = random_bytes(count * 4 + 1);
+		std::vector<uint8_t> expected = data;
+		for (size_t i = 0; i < count; ++i)
+			expected[1 + i * 4 + 3] = 0x42;
+
+		reshade::pixel_kernels::fill_alpha(data.data() + 1, count, 0x42);
+		CHECK(data == expected);
+	}
+}
+
+TEST_CASE(pixel_kernels_swap_red_blue)
+{
+	for (const size_t count : s_counts)
+	{
+		const std::vector<uint8_t> src = random_bytes(count * 4);
+		std::vector<uint8_t> expected(count * 4);
+		for (size_t i = 0; i < count; ++i)
+		{
+			expected[i * 4 + 0] = src[i * 4 + 2];
+			expected[i * 4 + 1] = src[i * 4 + 1];
+			expected[i * 4 + 2] = src[i * 4 + 0];
+			expected[i * 4 + 3] = src[i * 4 + 3];
+		}
+
+		std::vector<uint8_t> dst(count * 4);
+		reshade::pixel_kernels::swap_red_blue(dst.data(), src.data(), count);
+		CHECK(dst == expected);
+
+		// Converting in place has to work too
+		std::vector<uint8_t> data = src;
+		reshade::pixel_kernels::swap_red_blue(data.data(), data.data(), count);
+		CHECK(data == expected);
+	}
+}
+
+TEST_CASE(pixel_kernels_convert_rgb10a2_to_rgba8)
+{
+	for (const bool swap : { false, true })
+	{
+		for (const size_t count : s_counts)
+		{
+			const std::vector<uint8_t> src = random_bytes(count * 4, static_cast<uint32_t>(count));
+			std::vector<uint8_t> expected(count * 4);
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint32_t value; std::memcpy(&value, src.data() + i * 4, 4);
+				const uint32_t r = value & 0x3FF, g = (value >> 10) & 0x3FF, b = (value >> 20) & 0x3FF, a = value >> 30;
+				expected[i * 4 + 0] = static_cast<uint8_t>((swap ? b : r) >> 2);
+				expected[i * 4 + 1] = static_cast<uint8_t>(g >> 2);
+				expected[i * 4 + 2] = static_cast<uint8_t>((swap ? r : b) >> 2);
+				expected[i * 4 + 3] = static_cast<uint8_t>(a * 255 / 3);
+			}
+
+			std::vector<uint8_t> dst(count * 4);
+			reshade::pixel_kernels::convert_rgb10a2_to_rgba8(dst.data(), src.data(), count, swap);
+			CHECK(dst == expected);
+
+			std::vector<uint8_t> data = src;
+			reshade::pixel_kernels::convert_rgb10a2_to_rgba8(data.data(), data.data(), count, swap);
+			CHECK(data == expected);
+		}
+	}
+}
+
+TEST_CASE(pixel_kernels_convert_rgba16f_to_rgba8)
+{
+	// Convert every possible half value, which covers zero, denormals, normals, infinity and NaN of both signs
+	std::vector<uint16_t> src(65536);
+	for (size_t i = 0; i < src.size(); ++i)
+		src[i] = static_cast<uint16_t>(i);
+
+	std::vector<uint8_t> expected(src.size());
+	for (size_t i = 0; i < src.size(); ++i)
+	{
+		const uint16_t h = src[i];
+		const int exponent = (h >> 10) & 0x1F;
+		const int mantissa = h & 0x3FF;
+
+		float value;
+		if (exponent == 0x1F)
+			value = mantissa != 0 ? NAN : INFINITY;
+		else if (exponent == 0)
+			value = std::ldexp(static_cast<float>(mantissa), -24);
+		else
+			value = std::ldexp(static_cast<float>(mantissa | 0x400), exponent - 25);
+		if (h & 0x8000)
+			value = -value;
+
+		// NaN and negative values become zero, values larger than one saturate
+		expected[i] = std::isnan(value) || value <= 0.0f ? 0 : value >= 1.0f ? 255 : static_cast<uint8_t>(value * 255.0f + 0.5f);
+	}
+
+	std::vector<uint8_t> dst(src.size());
+	reshade::pixel_kernels::convert_rgba16f_to_rgba8(dst.data(), src.data(), src.size() / 4);
+	CHECK(dst == expected);
+
+	// Check that the remainder that is not a multiple of the SIMD width is converted as well
+	for (const size_t count : s_counts)
+	{
+		std::vector<uint8_t> dst_partial(count * 4 + 4, 0xCC);
+		reshade::pixel_kernels::convert_rgba16f_to_rgba8(dst_partial.data(), src.data() + 0x3000, count);
+		CHECK(std::equal(dst_partial.begin(), dst_partial.begin() + count * 4, expected.begin() + 0x3000));
+		CHECK(dst_partial[count * 4] == 0xCC);
+	}
+}
+
+TEST_CASE(pixel_kernels_premultiply_alpha)
+{
+	// Check every combination of color and alpha value
+	std::vector<uint8_t> data(256 * 256 * 4);
+	for (size_t color = 0; color < 256; ++color)
+	{
+		for (size_t alpha = 0; alpha < 256; ++alpha)
+		{
+			uint8_t *const pixel = data.data() + (color * 256 + alpha) * 4;
+			pixel[0] = static_cast<uint8_t>(color);
+			pixel[1] = static_cast<uint8_t>(255 - color);
+			pixel[2] = static_cast<uint8_t>(color / 2);
+			pixel[3] = static_cast<uint8_t>(alpha);
+		}
+	}
+
+	std::vector<uint8_t> expected = data;
+	for (size_t i = 0; i < expected.size(); i += 4)
+		for (size_t c = 0; c < 3; ++c)
+			expected[i + c] = static_cast<uint8_t>((expected[i + c] * expected[i + 3] + 127) / 255); // Rounded to nearest
+
+	reshade::pixel_kernels::premultiply_alpha(data.data(), data.size() / 4);
+	CHECK(data == expected);
+
+	for (const size_t count : s_counts)
+	{
+		std::vector<uint8_t> partial = random_bytes(count * 4);
+		std::vector<uint8_t> expected_partial = partial;
+		for (size_t i = 0; i < expected_partial.size(); i += 4)
+			for (size_t c = 0; c < 3; ++c)
+				expected_partial[i + c] = static_cast<uint8_t>((expected_partial[i + c] * expected_partial[i + 3] + 127) / 255);
+
+		reshade::pixel_kernels::premultiply_alpha(partial.data(), count);
+		CHECK(partial == expected_partial);
+	}
+}
+
+TEST_CASE(pixel_kernels_flip_vertically)
+{
+	for (const size_t rows : { 0, 1, 2, 5 })
+	{
+		const size_t row_size = 7;
+		std::vector<uint8_t> data = random_bytes(rows * row_size);
+		std::vector<uint8_t> expected(data.size());
+		for (size_t y = 0; y < rows; ++y)
+			std::memcpy(expected.data() + y * row_size, data.data() + (rows - 1 - y) * row_size, row_size);
+
+		reshade::pixel_kernels::flip_vertically(data.data(), row_size, rows);
+		CHECK(data == expected);
+	}
+}
+
+BENCHMARK(pixel_kernels)
+{
+	const size_t count = 3840 * 2160;
+	std::vector<uint8_t> data = random_bytes(count * 4), dst(count * 4);
+	const std::vector<uint16_t> half_data(count * 4, 0x3800); // 0.5
+
+	const double size_in_mb = count * 4.0 / (1024 * 1024);
+
+	reshade::tests::report_benchmark("fill_alpha 3840x2160", reshade::tests::measure(10, [&]() {
+		reshade::pixel_kernels::fill_alpha(data.data(), count);
+	}), size_in_mb, "MB");
+	reshade::tests::report_benchmark("swap_red_blue 3840x2160", reshade::tests::measure(10, [&]() {
+		reshade::pixel_kernels::swap_red_blue(dst.data(), data.data(), count);
+	}), size_in_mb, "MB");
+	reshade::tests::report_benchmark("convert_rgb10a2_to_rgba8 3840x2160", reshade::tests::measure(10, [&]() {
+		reshade::pixel_kernels::convert_rgb10a2_to_rgba8(dst.data(), data.data(), count);
+	}), size_in_mb, "MB");
+	reshade::tests::report_benchmark("convert_rgba16f_to_rgba8 3840x2160", reshade::tests::measure(10, [&]() {
+		reshade::pixel_kernels::convert_rgba16f_to_rgba8(dst.data(), half_data.data(), count);
+	}), size_in_mb * 2, "MB");
+	reshade::tests::report_benchmark("premultiply_alpha 3840x2160", reshade::tests::measure(10, [&]() {
+		reshade::pixel_kernels::premultiply_alpha(data.data(), count);
+	}), size_in_mb, "MB");
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "preset_index.hpp"
+
+namespace
+{
+	const char *const preset_content = "Techniques=A@a.fx\n\n[a.fx]\nValue=1\n";
+
+	std::filesystem::path find_next(const reshade::preset_index &index, const std::filesystem::path &current_path, bool reversed = false, const std::wstring &filter = {})
+	{
+		std::filesystem::path result;
+		index.find_next(current_path, filter, reversed, result);
+		return result;
+	}
+}
+
+TEST_CASE(preset_index_sort_order)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path b = dir.write("b.ini", preset_content);
+	const std::filesystem::path a_upper = dir.write("A.ini", preset_content);
+	const std::filesystem::path c = dir.write("c.txt", preset_content);
+	const std::filesystem::path a10 = dir.write("a10.ini", preset_content);
+	const std::filesystem::path a2 = dir.write("a2.ini", preset_content);
+	dir.write("config.ini", "[GENERAL]\nTechniques=A@a.fx\n"); // Only keys before the first section count
+	dir.write("empty.ini", "");
+	dir.write("preset.json", preset_content);
+
+	reshade::preset_index index;
+	index.update(dir.path);
+	CHECK(index.size() == 5);
+
+	// Presets are sorted by their file name without extension, ignoring case
+	const std::filesystem::path expected_order[] = { a_upper, a10, a2, b, c };
+	std::filesystem::path current = find_next(index, dir.path / "missing.ini");
+	for (const std::filesystem::path &expected : expected_order)
+	{
+		CHECK(current == expected);
+		current = find_next(index, current);
+	}
+}
+
+TEST_CASE(preset_index_find_next_wrap_around)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path a = dir.write("a.ini", preset_content);
+	const std::filesystem::path b = dir.write("b.ini", preset_content);
+	const std::filesystem::path c = dir.write("c.ini", preset_content);
+	dir.write("d.ini", "[a.fx]\nValue=1\n");
+
+	reshade::preset_index index;
+	index.update(dir.path);
+	CHECK(index.size() == 3);
+
+	CHECK(find_next(index, a) == b);
+	CHECK(find_next(index, c) == a); // Wraps around at the end, skipping files that are not presets
+	CHECK(find_next(index, a, true) == c); // And at the beginning when going backwards
+	CHECK(find_next(index, b, true) == a);
+
+	// Without a current preset in the directory the first or last one is used
+	CHECK(find_next(index, dir.path / "missing.ini") == a);
+	CHECK(find_next(index, dir.path / "missing.ini", true) == c);
+
+	// With a filter only matching presets are considered, staying with the current one if it is the only match
+	CHECK(find_next(index, a, false, L"C") == c);
+	CHECK(find_next(index, c, false, L"c") == c);
+	CHECK(find_next(index, a, false, L"x") == a);
+	std::filesystem::path result;
+	CHECK(!index.find_next(dir.path / "missing.ini", L"x", false, result));
+}
+
+TEST_CASE(preset_index_invalidation)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path a = dir.write("a.ini", preset_content);
+	const std::filesystem::path c = dir.write("c.ini", preset_content);
+
+	reshade::preset_index index;
+	index.update(dir.path);
+	CHECK(index.size() == 2);
+	CHECK(find_next(index, a) == c);
+
+	// Adding a preset is picked up by the next update
+	const std::filesystem::path b = dir.write("b.ini", preset_content);
+	index.update(dir.path);
+	CHECK(index.size() == 3);
+	CHECK(find_next(index, a) == b);
+
+	// As is removing one
+	std::filesystem::remove(b);
+	index.update(dir.path);
+	CHECK(index.size() == 2);
+	CHECK(find_next(index, a) == c);
+
+	// Switching to another directory starts over
+	const reshade::tests::temp_directory other_dir;
+	const std::filesystem::path d = other_dir.write("d.ini", preset_content);
+	index.update(other_dir.path);
+	CHECK(index.size() == 1);
+	CHECK(find_next(index, a) == d);
+}
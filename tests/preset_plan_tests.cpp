@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "dll_config.hpp"
+#include "runtime_objects.hpp"
+
+namespace
+{
+	/// <summary>
+	/// Fills in the values a plan depends on the same way as 'runtime::build_preset_plan'.
+	/// </summary>
+	reshade::preset_plan build_plan(const std::filesystem::path &config_path, const std::filesystem::path &preset_path)
+	{
+		reshade::preset_plan plan;
+		plan.path = preset_path;
+		reshade::ini_file::load_cache(config_path).get("GENERAL", "TechniqueSorting", plan.config_technique_sorting);
+		plan.preset_revision = reshade::ini_file::load_cache(preset_path).revision();
+		return plan;
+	}
+
+	/// <summary>
+	/// Checks a plan the same way as 'runtime::load_current_preset'.
+	/// </summary>
+	bool is_up_to_date(const reshade::preset_plan &plan, const std::filesystem::path &config_path)
+	{
+		std::vector<std::string> config_technique_sorting;
+		reshade::ini_file::load_cache(config_path).get("GENERAL", "TechniqueSorting", config_technique_sorting);
+		return plan.is_up_to_date(reshade::ini_file::load_cache(plan.path).revision(), config_technique_sorting);
+	}
+
+	/// <summary>
+	/// Writes the config the same way as 'runtime::save_config', which happens right before switching to another preset.
+	/// </summary>
+	void save_config(const std::filesystem::path &config_path, const std::filesystem::path &preset_path)
+	{
+		reshade::ini_file &config = reshade::ini_file::load_cache(config_path);
+		config.set("GENERAL", "PresetPath", preset_path);
+		config.set("GENERAL", "PerformanceMode", false);
+		config.set("GENERAL", "EffectSearchPaths", std::vector<std::filesystem::path> { ".\\reshade-shaders\\Shaders" });
+		config.set("GENERAL", "TechniqueSorting", std::vector<std::string> { "B@b.fx", "A@a.fx" });
+	}
+}
+
+TEST_CASE(preset_plan_switch_back_and_forth)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path config_path = dir.write("ReShade.ini",
+		"[GENERAL]\n"
+		"PresetPath=.\\a.ini\n"
+		"TechniqueSorting=B@b.fx,A@a.fx\n");
+	const std::filesystem::path preset_a_path = dir.write("a.ini", "Techniques=A@a.fx\n");
+	const std::filesystem::path preset_b_path = dir.write("b.ini", "Techniques=B@b.fx\n");
+
+	// Switch from A to B and back to A again, saving the config before each switch
+	save_config(config_path, preset_a_path);
+	const reshade::preset_plan plan_a = build_plan(config_path, preset_a_path);
+	save_config(config_path, preset_b_path);
+	const reshade::preset_plan plan_b = build_plan(config_path, preset_b_path);
+	const size_t config_revision = reshade::ini_file::load_cache(config_path).revision();
+	save_config(config_path, preset_a_path);
+
+	// Saving the config changed its revision (the preset path is different), but not the value the plans depend on
+	CHECK(reshade::ini_file::load_cache(config_path).revision() != config_revision);
+	CHECK(is_up_to_date(plan_a, config_path));
+	CHECK(is_up_to_date(plan_b, config_path));
+
+	// Changing the technique sorting has to invalidate all plans
+	reshade::ini_file::load_cache(config_path).set("GENERAL", "TechniqueSorting", std::vector<std::string> { "A@a.fx", "B@b.fx" });
+	CHECK(!is_up_to_date(plan_a, config_path));
+	CHECK(!is_up_to_date(plan_b, config_path));
+
+	// Changing a preset only invalidates the plan for that preset
+	const reshade::preset_plan plan_a_sorted = build_plan(config_path, preset_a_path);
+	const reshade::preset_plan plan_b_sorted = build_plan(config_path, preset_b_path);
+	reshade::ini_file::load_cache(preset_b_path).set({}, "Techniques", std::vector<std::string> { "A@a.fx", "B@b.fx" });
+	CHECK(is_up_to_date(plan_a_sorted, config_path));
+	CHECK(!is_up_to_date(plan_b_sorted, config_path));
+
+	// Write back modified files before the temporary directory is deleted
+	reshade::ini_file::flush_cache();
+}
+
+TEST_CASE(preset_plan_unchanged_set)
+{
+	const reshade::tests::temp_directory dir;
+	reshade::ini_file ini(dir.write("unchanged.ini",
+		"[Section]\n"
+		"Number=1\n"
+		"Text=abc\n"
+		"List=a,b,c\n"));
+
+	// Setting the values a key already has must not change the revision
+	const size_t revision = ini.revision();
+	ini.set("Section", "Number", 1);
+	ini.set("Section", "Text", std::string("abc"));
+	ini.set("Section", "List", std::vector<std::string> { "a", "b", "c" });
+	CHECK(ini.revision() == revision);
+
+	// But setting different values, adding a key or adding back a removed one does
+	ini.set("Section", "List", std::vector<std::string> { "a", "b" });
+	CHECK(ini.revision() != revision);
+	const size_t revision_after_list = ini.revision();
+	ini.set("Section", "Added", 2);
+	CHECK(ini.revision() != revision_after_list);
+	ini.remove_key("Section", "Number");
+	const size_t revision_after_remove = ini.revision();
+	ini.set("Section", "Number", 1);
+	CHECK(ini.revision() != revision_after_remove);
+}
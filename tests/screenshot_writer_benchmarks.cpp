@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "screenshot_writer.hpp"
+#include <cmath>
+
+static void generate_frame(uint32_t width, uint32_t height, std::vector<uint8_t> &pixels)
+{
+	pixels.resize(size_t(width) * height * 4);
+
+	// Mix smooth gradients with some noise, so that the image neither compresses trivially nor not at all, like a typical game frame
+	uint32_t seed = 12345;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			seed = seed * 1103515245 + 12345;
+			const uint8_t noise = (seed >> 16) & 0x7;
+
+			uint8_t *const pixel = pixels.data() + (size_t(y) * width + x) * 4;
+			pixel[0] = static_cast<uint8_t>(x * 255 / width + noise);
+			pixel[1] = static_cast<uint8_t>(y * 255 / height + noise);
+			pixel[2] = static_cast<uint8_t>(127 + 127 * std::sin(x * 0.01f + y * 0.02f));
+			pixel[3] = 0xFF;
+		}
+	}
+}
+
+BENCHMARK(screenshot_encode_png)
+{
+	const struct { const char *name; uint32_t width, height; } sizes[] = {
+		{ "Encode PNG 3840x2160", 3840, 2160 },
+		{ "Encode PNG 7680x4320", 7680, 4320 },
+	};
+
+	std::vector<uint8_t> pixels, data;
+
+	reshade::thread_pool pool(std::max(std::thread::hardware_concurrency() / 2, 1u));
+	const std::string pool_suffix = " (" + std::to_string(pool.num_threads()) + " threads)";
+
+	for (const auto &size : sizes)
+	{
+		generate_frame(size.width, size.height, pixels);
+
+		reshade::tests::report_benchmark(size.name, reshade::tests::measure(5, [&]() {
+			reshade::screenshot_writer::encode_png(pixels.data(), size.width, size.height, data);
+		}), static_cast<double>(pixels.size()) / (1024 * 1024), "MB");
+		reshade::tests::report_benchmark((size.name + pool_suffix).c_str(), reshade::tests::measure(5, [&]() {
+			reshade::screenshot_writer::encode_png(pixels.data(), size.width, size.height, data, &pool);
+		}), static_cast<double>(pixels.size()) / (1024 * 1024), "MB");
+	}
+}
+
+BENCHMARK(screenshot_writer_submit)
+{
+	const uint32_t width = 3840, height = 2160;
+	const unsigned int num_screenshots = 4;
+
+	std::vector<uint8_t> pixels;
+	generate_frame(width, height, pixels);
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reshade_screenshot_benchmark.png";
+
+	reshade::thread_pool pool(std::max(std::thread::hardware_concurrency() / 2, 1u));
+	reshade::screenshot_writer writer(pool, 1, num_screenshots);
+
+	// Time spent on the calling thread (which would be the render thread) to hand off screenshots
+	double submit_time = 0;
+	const double total_time = reshade::tests::measure(3, [&]() {
+		submit_time += reshade::tests::measure(1, [&]() {
+			for (unsigned int i = 0; i < num_screenshots; ++i)
+			{
+				reshade::screenshot_writer::job job;
+				job.path = path;
+				job.pixels = writer.acquire_buffer(pixels.size());
+				std::copy(pixels.begin(), pixels.end(), job.pixels.begin());
+				job.width = width;
+				job.height = height;
+				writer.submit(std::move(job));
+			}
+		});
+
+		writer.wait_idle();
+		for (reshade::screenshot_writer::job job; writer.poll_finished(job);)
+			continue;
+	});
+
+	reshade::tests::report_benchmark("Submit 4 screenshots 3840x2160", submit_time / 3);
+	reshade::tests::report_benchmark("Save 4 screenshots 3840x2160", total_time, num_screenshots, "screenshots");
+
+	std::filesystem::remove(path);
+}
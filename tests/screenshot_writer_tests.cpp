@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "screenshot_writer.hpp"
+#include <cstring>
+#include <stb_image.h>
+
+static std::vector<uint8_t> generate_pixels(uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+
+	// Mix flat areas, gradients and noise, so that every filter type and both literals and matches are used by the encoder
+	uint32_t seed = width * 31 + height;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			seed = seed * 1103515245 + 12345;
+
+			uint8_t *const pixel = pixels.data() + (size_t(y) * width + x) * 4;
+			if (y % 7 == 3)
+				std::memset(pixel, 0x80, 4);
+			else if (x < width / 2)
+				pixel[0] = static_cast<uint8_t>(x), pixel[1] = static_cast<uint8_t>(y), pixel[2] = static_cast<uint8_t>(x + y), pixel[3] = 0xFF;
+			else
+				std::memcpy(pixel, &seed, 4);
+		}
+	}
+
+	return pixels;
+}
+
+static uint32_t read_uint32_be(const uint8_t *data)
+{
+	return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
+
+static uint32_t reference_crc32(const uint8_t *data, size_t size)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (int k = 0; k < 8; ++k)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+static uint32_t reference_adler32(const uint8_t *data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	return (b << 16) | a;
+}
+
+/// <summary>
+/// Checks the signature and the checksum of every chunk and concatenates the data of all IDAT chunks.
+/// </summary>
+static bool read_png_chunks(const std::vector<uint8_t> &data, std::vector<uint8_t> &zlib_stream)
+{
+	if (data.size() < 8 || std::memcmp(data.data(), "\x89PNG\r\n\x1A\n", 8) != 0)
+		return false;
+
+	bool has_end = false;
+	for (size_t offset = 8; offset < data.size() && !has_end;)
+	{
+		if (data.size() - offset < 12)
+			return false;
+		const uint32_t size = read_uint32_be(data.data() + offset);
+		if (data.size() - offset - 12 < size)
+			return false;
+
+		const uint8_t *const type = data.data() + offset + 4;
+		if (read_uint32_be(type + 4 + size) != reference_crc32(type, 4 + size))
+			return false;
+
+		if (std::memcmp(type, "IDAT", 4) == 0)
+			zlib_stream.insert(zlib_stream.end(), type + 4, type + 4 + size);
+		has_end = std::memcmp(type, "IEND", 4) == 0;
+
+		offset += 12 + size;
+	}
+
+	return has_end && zlib_stream.size() > 6;
+}
+
+TEST_CASE(screenshot_writer_encode_png)
+{
+	// Sizes that cover a single pixel, a single band, heights that do not divide evenly into bands and the maximum number of bands
+	const struct { uint32_t width, height; } sizes[] = {
+		{ 1, 1 }, { 3, 2 }, { 17, 5 }, { 64, 64 }, { 100, 129 }, { 33, 513 }, { 257, 1000 },
+	};
+
+	reshade::thread_pool pool(4);
+
+	for (const auto &size : sizes)
+	{
+		const std::vector<uint8_t> pixels = generate_pixels(size.width, size.height);
+
+		std::vector<uint8_t> data;
+		reshade::screenshot_writer::encode_png(pixels.data(), size.width, size.height, data);
+
+		std::vector<uint8_t> zlib_stream;
+		CHECK(read_png_chunks(data, zlib_stream));
+
+		// The bands are compressed separately, so check that the combined checksum at the end of the stream matches the decompressed data
+		int filtered_size = 0;
+		if (char *const filtered = stbi_zlib_decode_malloc(reinterpret_cast<const char *>(zlib_stream.data()), static_cast<int>(zlib_stream.size()), &filtered_size))
+		{
+			CHECK(static_cast<size_t>(filtered_size) == size_t(size.height) * (1 + size.width * 4));
+			CHECK(zlib_stream.size() >= 4 && reference_adler32(reinterpret_cast<const uint8_t *>(filtered), filtered_size) == read_uint32_be(zlib_stream.data() + zlib_stream.size() - 4));
+			stbi_image_free(filtered);
+		}
+		else
+		{
+			CHECK(!"Failed to decompress image data");
+		}
+
+		int width = 0, height = 0, channels = 0;
+		if (stbi_uc *const decoded = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels, 4))
+		{
+			CHECK(static_cast<uint32_t>(width) == size.width && static_cast<uint32_t>(height) == size.height && channels == 4);
+			CHECK(std::memcmp(decoded, pixels.data(), pixels.size()) == 0);
+			stbi_image_free(decoded);
+		}
+		else
+		{
+			CHECK(!"Failed to decode image");
+		}
+
+		// Output has to be the same no matter whether the bands are encoded on a thread pool or not
+		std::vector<uint8_t> pool_data;
+		reshade::screenshot_writer::encode_png(pixels.data(), size.width, size.height, pool_data, &pool);
+		CHECK(pool_data == data);
+	}
+}
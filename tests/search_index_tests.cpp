@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "search_index.hpp"
+
+TEST_CASE(search_index_find_text)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path a = dir.write("a.fx", "float4 Foo(float4 pos : SV_Position) : SV_Target\n{\n\treturn FooBar;\n}\n");
+	const std::filesystem::path b = dir.write("b.fxh", "// Nothing to see here\n#define FOO_VALUE 1\n");
+
+	reshade::search_index index;
+	index.update({ a, b });
+	index.wait_for_update();
+	CHECK(!index.is_updating());
+
+	const std::vector<reshade::search_index::match> results = index.find_text("foo");
+	CHECK(results.size() == 3);
+
+	const std::vector<reshade::search_index::match> exact_results = index.find_text("Foo", true);
+	CHECK(exact_results.size() == 2);
+	for (const reshade::search_index::match &result : exact_results)
+		CHECK(result.file_path == a);
+
+	// Lines and columns are zero-based and the line text does not include the line break
+	const std::vector<reshade::search_index::match> bar_results = index.find_text("Bar", true);
+	CHECK(bar_results.size() == 1);
+	CHECK(bar_results.size() == 1 && bar_results[0].line == 2 && bar_results[0].column == 11);
+	CHECK(bar_results.size() == 1 && bar_results[0].line_text == "\treturn FooBar;");
+
+	// Short queries cannot use trigrams, but still have to work
+	CHECK(index.find_text("1", true).size() == 1);
+
+	CHECK(index.find_text("foo", false, 2).size() == 2);
+	CHECK(index.find_text("not in any file").empty());
+	CHECK(index.find_text("").empty());
+}
+
+TEST_CASE(search_index_find_definition)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path a = dir.write("a.fx",
+		"#define MY_MACRO 1\n"
+		"struct MyStruct { float x; };\n"
+		"float4 MyFunc(float4 v) { return v * MY_MACRO; }\n"
+		"void main() { MyStruct s; float4 c = MyFunc(0); }\n");
+
+	reshade::search_index index;
+	index.update({ a });
+	index.wait_for_update();
+
+	const std::vector<reshade::search_index::match> macro_results = index.find_definition("MY_MACRO");
+	CHECK(macro_results.size() == 1 && macro_results[0].line == 0);
+	const std::vector<reshade::search_index::match> struct_results = index.find_definition("MyStruct");
+	CHECK(struct_results.size() == 1 && struct_results[0].line == 1);
+	const std::vector<reshade::search_index::match> func_results = index.find_definition("MyFunc");
+	CHECK(func_results.size() == 1 && func_results[0].line == 2);
+
+	// Identifiers that only appear as part of another one are not definitions
+	CHECK(index.find_definition("My").empty());
+}
+
+TEST_CASE(search_index_update)
+{
+	const reshade::tests::temp_directory dir;
+	const std::filesystem::path a = dir.write("a.fx", "uniform float Alpha;\n");
+	const std::filesystem::path b = dir.write("b.fx", "uniform float Beta;\n");
+
+	reshade::search_index index;
+	index.update({ a, b });
+	index.wait_for_update();
+	CHECK(index.find_text("Alpha").size() == 1);
+	CHECK(index.find_text("Beta").size() == 1);
+
+	// Modified files are indexed again (move the modification time forward, since the file system may not have a high enough resolution to notice otherwise)
+	dir.write("a.fx", "uniform float Gamma;\n");
+	std::filesystem::last_write_time(a, std::filesystem::last_write_time(a) + std::chrono::seconds(10));
+
+	// Files no longer in the list are removed and the list can be built on the background thread
+	index.update([a]() { return std::vector<std::filesystem::path> { a }; });
+	index.wait_for_update();
+	CHECK(index.find_text("Alpha").empty());
+	CHECK(index.find_text("Gamma").size() == 1);
+	CHECK(index.find_text("Beta").empty());
+
+	// Files that do not exist are ignored
+	index.update({ a, dir.path / "missing.fx" });
+	index.wait_for_update();
+	CHECK(index.find_text("Gamma").size() == 1);
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "syntax_colorizer.hpp"
+#include <string>
+
+using reshade::gui::code_editor;
+
+namespace
+{
+	/// <summary>
+	/// Lines of code together with the state at the beginning of each line and the colors of each character, like the code editor keeps them.
+	/// </summary>
+	struct document
+	{
+		explicit document(std::vector<std::string> text) : lines(std::move(text)), states(lines.size(), code_editor::line_state::normal), colors(lines.size())
+		{
+			recolor(0, lines.size());
+		}
+
+		/// <summary>
+		/// Colors the specified range of lines the same way as the code editor, which keeps going past the range until the state at the beginning of the next line matches the recorded one.
+		/// </summary>
+		/// <returns>The number of lines that were colored.</returns>
+		size_t recolor(size_t first, size_t last)
+		{
+			size_t num_colored_lines = 0;
+
+			for (size_t line_no = first; line_no < last; ++line_no, ++num_colored_lines)
+			{
+				colors[line_no].assign(lines[line_no].size(), code_editor::color_background);
+
+				const code_editor::line_state next_line_state = reshade::gui::colorize_line(lines[line_no].c_str(), lines[line_no].size(), states[line_no], colors[line_no].data());
+
+				if (line_no + 1 < lines.size() && states[line_no + 1] != next_line_state)
+				{
+					states[line_no + 1] = next_line_state;
+					last = std::max(last, line_no + 2);
+				}
+			}
+
+			return num_colored_lines;
+		}
+
+		std::vector<std::string> lines;
+		std::vector<code_editor::line_state> states;
+		std::vector<std::vector<code_editor::color>> colors;
+	};
+
+	std::vector<std::string> make_lines(size_t count)
+	{
+		std::vector<std::string> lines;
+		for (size_t i = 0; i < count; ++i)
+			lines.push_back("float4 value" + std::to_string(i) + " = float4(1.0, 0.5, 0.25, 0.0);");
+		return lines;
+	}
+}
+
+TEST_CASE(syntax_colorizer_tokens)
+{
+	const document doc({ "float4 x = 1.0; // comment" });
+	const std::vector<code_editor::color> &colors = doc.colors[0];
+
+	CHECK(colors[0] == code_editor::color_keyword && colors[5] == code_editor::color_keyword);
+	CHECK(colors[6] == code_editor::color_default); // Whitespace
+	CHECK(colors[7] == code_editor::color_identifier);
+	CHECK(colors[9] == code_editor::color_punctuation);
+	CHECK(colors[11] == code_editor::color_number_literal && colors[13] == code_editor::color_number_literal);
+	CHECK(colors[16] == code_editor::color_comment && colors[25] == code_editor::color_comment);
+}
+
+TEST_CASE(syntax_colorizer_multi_line_comment)
+{
+	const document doc({
+		"int a; /* begin",
+		"inside",
+		"end */ int b;",
+		"/*/ int c;",
+		"int d; /**/ int e;" });
+
+	CHECK(doc.states[1] == code_editor::line_state::multi_line_comment);
+	CHECK(doc.states[2] == code_editor::line_state::multi_line_comment);
+	CHECK(doc.states[3] == code_editor::line_state::normal);
+	CHECK(doc.states[4] == code_editor::line_state::normal); // The lexer treats "/*/" as a complete comment
+
+	CHECK(doc.colors[0][0] == code_editor::color_keyword);
+	CHECK(doc.colors[0][7] == code_editor::color_multiline_comment);
+	CHECK(doc.colors[1][0] == code_editor::color_multiline_comment);
+	CHECK(doc.colors[2][5] == code_editor::color_multiline_comment);
+	CHECK(doc.colors[2][7] == code_editor::color_keyword);
+	CHECK(doc.colors[3][4] == code_editor::color_keyword);
+	CHECK(doc.colors[4][12] == code_editor::color_keyword);
+}
+
+TEST_CASE(syntax_colorizer_continued_directive)
+{
+	const document doc({
+		"#define STR(x) \\",
+		"\t#x",
+		"#x",
+		"#define SUM \\",
+		"\t1 + \\",
+		"\t2",
+		"int a; \\",
+		"#define B" });
+
+	CHECK(doc.states[1] == code_editor::line_state::continued_directive);
+	CHECK(doc.states[2] == code_editor::line_state::normal);
+	CHECK(doc.states[4] == code_editor::line_state::continued_directive);
+	CHECK(doc.states[5] == code_editor::line_state::continued_directive);
+	CHECK(doc.states[6] == code_editor::line_state::normal);
+	CHECK(doc.states[7] == code_editor::line_state::normal); // A backslash outside a directive does not continue anything
+
+	CHECK(doc.colors[0][0] == code_editor::color_preprocessor);
+	// The '#' on a continued line is the stringize operator and not the start of another directive
+	CHECK(doc.colors[1][1] != code_editor::color_preprocessor);
+	CHECK(doc.colors[1][2] == code_editor::color_identifier);
+	CHECK(doc.colors[2][0] == code_editor::color_preprocessor);
+	CHECK(doc.colors[5][1] == code_editor::color_number_literal);
+	CHECK(doc.colors[7][0] == code_editor::color_preprocessor);
+}
+
+TEST_CASE(syntax_colorizer_state_convergence)
+{
+	std::vector<std::string> lines = make_lines(100);
+	lines[40] = "int a; */";
+	document doc(lines);
+
+	// Changing a line without changing the state at its end only colors that line
+	doc.lines[10] = "int changed;";
+	CHECK(doc.recolor(10, 11) == 1);
+
+	// Opening a comment colors all lines up to the one that closes it, since their state changes
+	doc.lines[20] += " /*";
+	CHECK(doc.recolor(20, 21) == 21);
+	CHECK(doc.states[40] == code_editor::line_state::multi_line_comment);
+	CHECK(doc.states[41] == code_editor::line_state::normal);
+
+	// Continuing a directive only affects the next line
+	doc.lines[60] = "#define A \\";
+	CHECK(doc.recolor(60, 61) == 2);
+	CHECK(doc.states[61] == code_editor::line_state::continued_directive);
+	CHECK(doc.states[62] == code_editor::line_state::normal);
+
+	// Removing the comment again colors the same lines back
+	doc.lines[20] = lines[20];
+	CHECK(doc.recolor(20, 21) == 21);
+
+	// The result has to match coloring the whole text from scratch
+	const document reference(doc.lines);
+	CHECK(doc.states == reference.states);
+	CHECK(doc.colors == reference.colors);
+}
+
+TEST_CASE(syntax_colorizer_empty_line)
+{
+	const document doc({ "", "/*", "", "*/" });
+
+	CHECK(doc.states[1] == code_editor::line_state::normal);
+	CHECK(doc.states[2] == code_editor::line_state::multi_line_comment);
+	CHECK(doc.states[3] == code_editor::line_state::multi_line_comment);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+
+namespace reshade::tests
+{
+	struct test_case
+	{
+		const char *name;
+		void(*func)();
+		bool is_benchmark;
+	};
+
+	/// <summary>
+	/// Returns the list of all test cases and benchmarks, which register themselves through the <see cref="TEST_CASE"/> and <see cref="BENCHMARK"/> macros.
+	/// </summary>
+	std::vector<test_case> &registry();
+
+	struct registrar
+	{
+		registrar(const char *name, void(*func)(), bool is_benchmark) { registry().push_back({ name, func, is_benchmark }); }
+	};
+
+	/// <summary>
+	/// Records a failed check of the currently running test case.
+	/// </summary>
+	void report_failure(const char *file, int line, const char *expression);
+
+	/// <summary>
+	/// Prints the result of a benchmark in a common format.
+	/// </summary>
+	/// <param name="name">Name of the measured operation.</param>
+	/// <param name="best_time">Fastest time of all iterations in seconds.</param>
+	/// <param name="amount">The amount of work done in each iteration (e.g. bytes or items), or zero to only print the time.</param>
+	/// <param name="unit">The unit of <paramref name="amount"/> (e.g. "MB" with the amount in bytes).</param>
+	void report_benchmark(const char *name, double best_time, double amount = 0, const char *unit = nullptr);
+
+	/// <summary>
+	/// An empty directory for the files a test case creates, which is removed again with everything in it when this goes out of scope.
+	/// </summary>
+	struct temp_directory
+	{
+		temp_directory() : path(std::filesystem::temp_directory_path() / ("reshade_tests_" + std::to_string(next_index++)))
+		{
+			std::filesystem::remove_all(path);
+			std::filesystem::create_directories(path);
+		}
+		~temp_directory()
+		{
+			std::error_code ec;
+			std::filesystem::remove_all(path, ec);
+		}
+
+		temp_directory(const temp_directory &) = delete;
+		temp_directory &operator=(const temp_directory &) = delete;
+
+		/// <summary>
+		/// Writes a file with the specified <paramref name="content"/> into this directory and returns its path.
+		/// </summary>
+		std::filesystem::path write(const char *name, const std::string &content) const
+		{
+			const std::filesystem::path file_path = path / name;
+			std::ofstream(file_path, std::ios::binary | std::ios::trunc).write(content.data(), content.size());
+			return file_path;
+		}
+		/// <summary>
+		/// Reads the entire content of a file in this directory.
+		/// </summary>
+		std::string read(const char *name) const
+		{
+			std::stringstream content;
+			content << std::ifstream(path / name, std::ios::binary).rdbuf();
+			return content.str();
+		}
+
+		const std::filesystem::path path;
+
+	private:
+		static inline unsigned int next_index = 0;
+	};
+
+	/// <summary>
+	/// Calls the specified function a number of times and returns the fastest time in seconds.
+	/// </summary>
+	template <typename F>
+	double measure(unsigned int iterations, F func)
+	{
+		double best_time = 1e30;
+		for (unsigned int i = 0; i < iterations; ++i)
+		{
+			const auto start_time = std::chrono::high_resolution_clock::now();
+			func();
+			const auto end_time = std::chrono::high_resolution_clock::now();
+			best_time = std::min(best_time, std::chrono::duration<double>(end_time - start_time).count());
+		}
+		return best_time;
+	}
+}
+
+#define TEST_CASE(name) \
+	static void test_##name(); \
+	static const reshade::tests::registrar test_registrar_##name(#name, &test_##name, false); \
+	static void test_##name()
+#define BENCHMARK(name) \
+	static void benchmark_##name(); \
+	static const reshade::tests::registrar benchmark_registrar_##name(#name, &benchmark_##name, true); \
+	static void benchmark_##name()
+
+#define CHECK(expression) \
+	((expression) ? (void)0 : reshade::tests::report_failure(__FILE__, __LINE__, #expression))
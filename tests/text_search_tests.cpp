@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "text_search.hpp"
+#include <random>
+
+namespace
+{
+	std::vector<size_t> find(const std::string &text, const std::string &pattern, bool case_sensitive = true, bool whole_word = false)
+	{
+		std::vector<size_t> offsets;
+		reshade::find_all_occurrences(text, pattern, case_sensitive, whole_word, offsets);
+		return offsets;
+	}
+
+	// Straightforward implementation to compare the optimized search against
+	std::vector<size_t> find_reference(const std::string &text, const std::string &pattern, bool case_sensitive, bool whole_word)
+	{
+		const auto to_lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+		const auto is_word_character = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'; };
+
+		std::vector<size_t> offsets;
+		if (pattern.empty())
+			return offsets;
+
+		for (size_t pos = 0; pos + pattern.size() <= text.size();)
+		{
+			bool match = true;
+			for (size_t i = 0; i < pattern.size() && match; ++i)
+				match = case_sensitive ? text[pos + i] == pattern[i] : to_lower(text[pos + i]) == to_lower(pattern[i]);
+			if (match && whole_word)
+				match = (pos == 0 || !is_word_character(text[pos - 1])) && (pos + pattern.size() == text.size() || !is_word_character(text[pos + pattern.size()]));
+
+			if (match)
+			{
+				offsets.push_back(pos);
+				pos += pattern.size();
+			}
+			else
+			{
+				pos += 1;
+			}
+		}
+
+		return offsets;
+	}
+}
+
+TEST_CASE(text_search_buffer_boundaries)
+{
+	// Long enough for the vectorized search to process full blocks, with matches at the very start and the very end
+	const std::string text = "needle" + std::string(100, '.') + "needle";
+
+	for (const bool case_sensitive : { true, false })
+	{
+		const std::vector<size_t> offsets = find(text, "needle", case_sensitive);
+		CHECK(offsets.size() == 2);
+		CHECK(offsets.size() == 2 && offsets[0] == 0 && offsets[1] == text.size() - 6);
+	}
+
+	CHECK(find("abc", "abc") == std::vector<size_t> { 0 });
+	CHECK(find("abc", "abcd").empty());
+	CHECK(find("abc", "").empty());
+	CHECK(find("", "a").empty());
+}
+
+TEST_CASE(text_search_single_character)
+{
+	const std::string text = "a.b.c.d.e.f.g.h.i.j.k.l.m.n.o.p.q.r.s.t.u.v.w.x.y.z.";
+
+	CHECK(find(text, ".").size() == 26);
+	CHECK(find(text, "z") == std::vector<size_t> { 50 });
+	CHECK(find(text, "Z", false) == std::vector<size_t> { 50 });
+	CHECK(find(text, "Z", true).empty());
+	CHECK(find(text, "a", true, true) == std::vector<size_t> { 0 });
+}
+
+TEST_CASE(text_search_across_lines)
+{
+	// The editor joins lines with a line feed, so a pattern containing one matches across line boundaries
+	const std::string text = "float4 a;\nfloat4 b;\n" + std::string(40, ' ') + "float4 c;\n";
+
+	CHECK(find(text, ";\nfloat4") == std::vector<size_t> { 8 });
+	CHECK(find(text, "\n") == (std::vector<size_t> { 9, 19, text.size() - 1 }));
+	CHECK(find(text, "A;\nFLOAT", false) == std::vector<size_t> { 7 });
+}
+
+TEST_CASE(text_search_overlapping)
+{
+	// Occurrences never overlap, so the search continues after the end of each match
+	CHECK(find("aaaaa", "aa") == (std::vector<size_t> { 0, 2 }));
+	CHECK(find(std::string(40, 'a'), "aaa").size() == 13);
+	CHECK(find(std::string(40, 'a'), "AAA", false).size() == 13);
+}
+
+TEST_CASE(text_search_case_folding)
+{
+	// Only ASCII letters are folded, all other bytes have to match exactly (e.g. UTF-8 encoded umlauts)
+	const std::string text = std::string(32, ' ') + "Gr\xC3\x96\xC3\x9F" "e gr\xC3\xB6\xC3\x9F" "e GR\xC3\x96\xC3\x9F" "E";
+
+	CHECK(find(text, "gr\xC3\x96\xC3\x9F" "e", false).size() == 2);
+	CHECK(find(text, "gr\xC3\xB6\xC3\x9F" "e", false).size() == 1);
+	CHECK(find(text, "\xC3\x96", true).size() == 2);
+	CHECK(find(text, "\xC3\x96", false).size() == 2);
+
+	// Bytes with the highest bit set must not break the skip table of the case-insensitive search
+	CHECK(find(text, "\xC3\x9F" "E", false).size() == 3);
+}
+
+TEST_CASE(text_search_whole_word)
+{
+	const std::string text = "color colors _color color_ (color) Color\ncolor";
+
+	CHECK(find(text, "color", true, true) == (std::vector<size_t> { 0, 28, text.size() - 5 }));
+	CHECK(find(text, "color", false, true) == (std::vector<size_t> { 0, 28, 35, text.size() - 5 }));
+	CHECK(find(text, "color", true, false).size() == 6);
+}
+
+TEST_CASE(text_search_fuzz)
+{
+	std::mt19937 rng(42);
+	const char alphabet[] = { 'a', 'b', 'A', 'B', '_', ' ', '\n', '\xE4' };
+
+	for (unsigned int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::string text(rng() % 200, '\0');
+		for (char &c : text)
+			c = alphabet[rng() % std::size(alphabet)];
+		std::string pattern(1 + rng() % 4, '\0');
+		for (char &c : pattern)
+			c = alphabet[rng() % std::size(alphabet)];
+
+		for (unsigned int mode = 0; mode < 4; ++mode)
+		{
+			const bool case_sensitive = (mode & 1) != 0;
+			const bool whole_word = (mode & 2) != 0;
+			CHECK(find(text, pattern, case_sensitive, whole_word) == find_reference(text, pattern, case_sensitive, whole_word));
+		}
+	}
+}
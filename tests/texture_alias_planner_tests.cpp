@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "texture_alias_planner.hpp"
+
+using reshade::texture_alias_planner;
+using reshadefx::texture_format;
+
+TEST_CASE(texture_alias_planner_single_slot)
+{
+	// Lifetimes that follow one after another all fit into the same texture
+	const std::vector<texture_alias_planner::resource> resources = {
+		{ 1920, 1080, 1, texture_format::rgba8, 0, 1 },
+		{ 1920, 1080, 1, texture_format::rgba8, 2, 2 },
+		{ 1920, 1080, 1, texture_format::rgba8, 3, 7 },
+		{ 1920, 1080, 1, texture_format::rgba8, 8, 9 },
+	};
+
+	CHECK(texture_alias_planner::plan(resources) == std::vector<size_t>({ 0, 0, 0, 0 }));
+
+	// The order of the resources does not matter, only their lifetimes do
+	const std::vector<texture_alias_planner::resource> reversed_resources(resources.rbegin(), resources.rend());
+	CHECK(texture_alias_planner::plan(reversed_resources) == std::vector<size_t>({ 3, 3, 3, 3 }));
+
+	CHECK(texture_alias_planner::plan({}).empty());
+}
+
+TEST_CASE(texture_alias_planner_overlapping_lifetimes)
+{
+	const std::vector<texture_alias_planner::resource> resources = {
+		{ 1920, 1080, 1, texture_format::rgba8, 0, 2 },
+		{ 1920, 1080, 1, texture_format::rgba8, 1, 3 }, // Alive at the same time as the first one
+		{ 1920, 1080, 1, texture_format::rgba8, 2, 4 }, // Written in the pass the first one is last read in, so cannot reuse it there
+		{ 1920, 1080, 1, texture_format::rgba8, 3, 5 }, // Can reuse the first one
+		{ 1920, 1080, 1, texture_format::rgba8, 4, 4 }, // Can reuse the second one
+		{ 1920, 1080, 1, texture_format::rgba8, 0, 9 }, // Alive the entire time
+	};
+
+	CHECK(texture_alias_planner::plan(resources) == std::vector<size_t>({ 0, 1, 2, 0, 1, 5 }));
+}
+
+TEST_CASE(texture_alias_planner_description_mismatch)
+{
+	// Only resources with the same size, number of mipmap levels and format share a texture
+	const std::vector<texture_alias_planner::resource> resources = {
+		{ 1920, 1080, 1, texture_format::rgba8, 0, 0 },
+		{ 1920, 1080, 1, texture_format::rgba16f, 1, 1 },
+		{ 960, 1080, 1, texture_format::rgba8, 2, 2 },
+		{ 1920, 540, 1, texture_format::rgba8, 3, 3 },
+		{ 1920, 1080, 2, texture_format::rgba8, 4, 4 },
+		{ 1920, 1080, 1, texture_format::rgba16f, 5, 5 },
+		{ 1920, 1080, 1, texture_format::rgba8, 6, 6 },
+	};
+
+	CHECK(texture_alias_planner::plan(resources) == std::vector<size_t>({ 0, 1, 2, 3, 4, 1, 0 }));
+}
+
+TEST_CASE(texture_alias_planner_random)
+{
+	uint32_t seed = 1;
+	const auto next = [&seed](uint32_t range) {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % range;
+	};
+
+	bool all_valid = true, any_aliased = false;
+
+	for (int i = 0; i < 2000; ++i)
+	{
+		std::vector<texture_alias_planner::resource> resources(next(20));
+		for (texture_alias_planner::resource &res : resources)
+		{
+			res.width = 1 + next(2);
+			res.height = 1;
+			res.levels = 1;
+			res.format = next(2) ? texture_format::rgba8 : texture_format::r8;
+			res.first_use = next(30);
+			res.last_use = res.first_use + next(5);
+		}
+
+		const std::vector<size_t> assignment = texture_alias_planner::plan(resources);
+		all_valid &= assignment.size() == resources.size();
+
+		for (size_t k = 0; k < resources.size() && all_valid; ++k)
+		{
+			// Every resource either keeps its own texture or uses one of another resource that keeps its own
+			all_valid &= assignment[k] < resources.size() && assignment[assignment[k]] == assignment[k];
+
+			for (size_t j = k + 1; j < resources.size(); ++j)
+			{
+				if (assignment[k] != assignment[j])
+					continue;
+
+				any_aliased = true;
+
+				// Resources that share a texture have the same description and are never alive in the same pass
+				all_valid &= resources[k].width == resources[j].width && resources[k].format == resources[j].format;
+				all_valid &= resources[k].last_use < resources[j].first_use || resources[j].last_use < resources[k].first_use;
+			}
+		}
+	}
+
+	CHECK(all_valid);
+	CHECK(any_aliased);
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "timestamp_query_ring.hpp"
+#include <set>
+#include <vector>
+
+using reshade::timestamp_query_ring;
+
+namespace
+{
+	/// <summary>
+	/// Stand-in for the timestamp queries of a render backend, which finish a fixed number of frames after they were written.
+	/// </summary>
+	struct fake_timestamp_source
+	{
+		fake_timestamp_source(const timestamp_query_ring &ring, uint64_t latency) :
+			ring(ring), latency(latency), written_frame(ring.num_slots()), ticks(size_t(ring.num_slots()) * ring.num_timestamps())
+		{
+		}
+
+		// Writes the timestamps of a slot, with each pass taking one tick longer than the one before it
+		void write(uint32_t slot, uint64_t start_tick)
+		{
+			written_frame[slot] = frame;
+			for (uint32_t i = 0; i < ring.num_timestamps(); ++i)
+				ticks[ring.query_index(slot, i)] = (start_tick + i * (i + 1) / 2) & mask;
+		}
+
+		timestamp_query_ring::status operator()(uint32_t slot, uint64_t *timestamps) const
+		{
+			if (frame - written_frame[slot] < latency || pending_slots.count(slot))
+				return timestamp_query_ring::status::pending;
+
+			for (uint32_t i = 0; i < ring.num_timestamps(); ++i)
+				timestamps[i] = ticks[ring.query_index(slot, i)];
+			return timestamp_query_ring::convert_ticks_to_nanoseconds(timestamps, ring.num_timestamps(), 2.0, valid_bits);
+		}
+
+		const timestamp_query_ring &ring;
+		uint64_t frame = 0;
+		uint64_t latency;
+		uint64_t mask = UINT64_MAX;
+		uint32_t valid_bits = 64;
+		std::set<uint32_t> pending_slots;
+		std::vector<uint64_t> written_frame;
+		std::vector<uint64_t> ticks;
+	};
+}
+
+TEST_CASE(timestamp_query_ring_in_flight)
+{
+	timestamp_query_ring ring(4, 3);
+	fake_timestamp_source source(ring, 2);
+
+	std::vector<uint64_t> durations;
+	const auto record_duration = [&durations](const uint64_t *timestamps, uint32_t num_timestamps) {
+		durations.push_back(timestamps[num_timestamps - 1] - timestamps[0]);
+	};
+
+	// Results are only read back after the latency of the source, but every frame is measured
+	for (source.frame = 0; source.frame < 20; ++source.frame)
+	{
+		ring.collect(std::cref(source), record_duration);
+
+		const uint32_t slot = ring.acquire();
+		CHECK(slot != timestamp_query_ring::no_slot);
+		source.write(slot, source.frame * 1000);
+		ring.submit(slot);
+	}
+
+	CHECK(durations.size() == 18 && ring.num_in_flight() == 2);
+	CHECK(durations.front() == 3 * 2 && durations.back() == 3 * 2);
+
+	// With a latency longer than the ring, frames are skipped instead of waiting
+	timestamp_query_ring slow_ring(4, 2);
+	fake_timestamp_source slow_source(slow_ring, 6);
+	unsigned int num_measured_frames = 0, num_results = 0;
+	for (slow_source.frame = 0; slow_source.frame < 60; ++slow_source.frame)
+	{
+		slow_ring.collect(std::cref(slow_source), [&num_results](const uint64_t *, uint32_t) { ++num_results; });
+
+		if (const uint32_t slot = slow_ring.acquire(); slot != timestamp_query_ring::no_slot)
+		{
+			slow_source.write(slot, slow_source.frame);
+			slow_ring.submit(slot);
+			++num_measured_frames;
+		}
+	}
+
+	CHECK(num_measured_frames < 60 && num_measured_frames == num_results + slow_ring.num_in_flight());
+	CHECK(slow_ring.num_in_flight() <= slow_ring.num_slots());
+
+	slow_ring.reset();
+	CHECK(slow_ring.num_in_flight() == 0 && slow_ring.acquire() == 0);
+}
+
+TEST_CASE(timestamp_query_ring_not_ready)
+{
+	timestamp_query_ring ring(4, 2);
+	fake_timestamp_source source(ring, 0);
+
+	std::vector<uint64_t> starts;
+	const auto record_start = [&starts](const uint64_t *timestamps, uint32_t) {
+		starts.push_back(timestamps[0]);
+	};
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const uint32_t slot = ring.acquire();
+		source.write(slot, i);
+		ring.submit(slot);
+	}
+
+	// Slots are read back in submission order, so a later slot that finished has to wait for an earlier one that has not
+	source.pending_slots = { 0 };
+	ring.collect(std::cref(source), record_start);
+	CHECK(starts.empty() && ring.num_in_flight() == 3);
+
+	source.pending_slots = { 1 };
+	ring.collect(std::cref(source), record_start);
+	CHECK(starts.size() == 1 && ring.num_in_flight() == 2);
+
+	source.pending_slots.clear();
+	ring.collect(std::cref(source), record_start);
+	CHECK(starts.size() == 3 && ring.num_in_flight() == 0);
+
+	// A slot is only reused after its results were read back
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		const uint32_t slot = ring.acquire();
+		CHECK(slot == (3 + i) % 4);
+		source.write(slot, i);
+		ring.submit(slot);
+	}
+
+	CHECK(ring.acquire() == timestamp_query_ring::no_slot);
+	source.pending_slots = { 3 };
+	ring.collect(std::cref(source), record_start);
+	CHECK(ring.acquire() == timestamp_query_ring::no_slot);
+	source.pending_slots.clear();
+	ring.collect(std::cref(source), record_start);
+	CHECK(ring.acquire() == 3 && starts.size() == 7);
+}
+
+TEST_CASE(timestamp_query_ring_wrap_around)
+{
+	timestamp_query_ring ring(2, 4);
+	fake_timestamp_source source(ring, 0);
+
+	std::vector<uint64_t> timestamps;
+	const auto record_timestamps = [&timestamps](const uint64_t *results, uint32_t num_timestamps) {
+		timestamps.assign(results, results + num_timestamps);
+	};
+
+	// A counter with only 36 valid bits that wraps around between the passes still gives the correct durations
+	source.valid_bits = 36;
+	source.mask = UINT64_MAX >> (64 - 36);
+	uint32_t slot = ring.acquire();
+	source.write(slot, source.mask - 1);
+	ring.submit(slot);
+	ring.collect(std::cref(source), record_timestamps);
+	CHECK(timestamps == std::vector<uint64_t>({ 0, 1 * 2, 3 * 2, 6 * 2 }));
+
+	// Large absolute values do not overflow when converting to nanoseconds
+	source.valid_bits = 64;
+	source.mask = UINT64_MAX;
+	timestamps.clear();
+	slot = ring.acquire();
+	source.write(slot, UINT64_MAX - 3);
+	ring.submit(slot);
+	ring.collect(std::cref(source), record_timestamps);
+	CHECK(timestamps == std::vector<uint64_t>({ 0, 1 * 2, 3 * 2, 6 * 2 }));
+
+	// Timestamps that do not lie between the first and the last one are discarded, but the slot is still freed
+	timestamps.clear();
+	slot = ring.acquire();
+	source.write(slot, 1000);
+	source.ticks[ring.query_index(slot, 1)] = 999;
+	ring.submit(slot);
+	ring.collect(std::cref(source), record_timestamps);
+	CHECK(timestamps.empty() && ring.num_in_flight() == 0);
+
+	// A last timestamp that went backwards cannot be told apart from one that wrapped around, but durations longer than half the range of the counter are discarded
+	uint64_t backwards[2] = { 1000, 10 };
+	CHECK(timestamp_query_ring::convert_ticks_to_nanoseconds(backwards, 2, 1.0) == timestamp_query_ring::status::invalid);
+	uint64_t backwards_with_wrap[2] = { 1000, 10 };
+	CHECK(timestamp_query_ring::convert_ticks_to_nanoseconds(backwards_with_wrap, 2, 1.0, 10) == timestamp_query_ring::status::available && backwards_with_wrap[1] == 34);
+	uint64_t outside_with_wrap[3] = { 1000, 900, 1100 };
+	CHECK(timestamp_query_ring::convert_ticks_to_nanoseconds(outside_with_wrap, 3, 1.0, 12) == timestamp_query_ring::status::invalid);
+}
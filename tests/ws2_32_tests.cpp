@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "windows/ws2_32.hpp"
+#include <thread>
+#include <functional>
+#include <unordered_map>
+
+// This is defined in 'ws2_32.cpp', which is not part of the tests
+reshade::network::traffic_counter g_network_traffic;
+
+using reshade::network::socket_class;
+
+namespace
+{
+	/// <summary>
+	/// Stand-in for the socket layer, which keeps the peer of every socket and counts how often it was queried.
+	/// </summary>
+	struct fake_socket_layer
+	{
+		socket_class operator()(uint64_t s)
+		{
+			++num_queries;
+			const auto it = peers.find(s);
+			return it != peers.end() ? it->second : socket_class::unknown;
+		}
+
+		unsigned int num_queries = 0;
+		std::unordered_map<uint64_t, socket_class> peers;
+	};
+}
+
+TEST_CASE(socket_cache_classify)
+{
+	reshade::network::socket_cache<16, 4> cache;
+	fake_socket_layer sockets;
+	sockets.peers[8] = socket_class::local;
+	sockets.peers[12] = socket_class::not_connected;
+
+	// Only the first lookup queries the socket layer
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::local && sockets.num_queries == 1);
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::local && sockets.num_queries == 1);
+	CHECK(cache.classify(12, std::ref(sockets)) == socket_class::not_connected && sockets.num_queries == 2);
+	CHECK(cache.classify(12, std::ref(sockets)) == socket_class::not_connected && sockets.num_queries == 2);
+
+	// Sockets the socket layer does not know are not added to the cache
+	CHECK(cache.classify(16, std::ref(sockets)) == socket_class::unknown);
+	CHECK(cache.classify(16, std::ref(sockets)) == socket_class::unknown && sockets.num_queries == 4);
+
+	// Handles that only differ in the two most significant bits are the same socket
+	sockets.num_queries = 0;
+	CHECK(cache.classify(8 | (uint64_t(3) << 62), std::ref(sockets)) == socket_class::local && sockets.num_queries == 0);
+}
+
+TEST_CASE(socket_cache_peer_change)
+{
+	reshade::network::socket_cache<16, 4> cache;
+	fake_socket_layer sockets;
+
+	// A socket that is reused for a new connection (through 'DisconnectEx' and 'ConnectEx' or after 'closesocket') keeps its handle, but changes its peer
+	sockets.peers[8] = socket_class::not_connected;
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::not_connected);
+	sockets.peers[8] = socket_class::local;
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::not_connected);
+	cache.invalidate(8);
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::local);
+	sockets.peers[8] = socket_class::remote;
+	cache.invalidate(8);
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::remote);
+
+	// Invalidating a socket leaves all others in the cache, even if they share the same slots
+	sockets.num_queries = 0;
+	for (uint64_t s = 4; s < 4 * 64; s += 4)
+		sockets.peers.emplace(s, socket_class::remote);
+	for (uint64_t s = 4; s < 4 * 64; s += 4 * 16)
+		cache.classify(s, std::ref(sockets));
+	cache.invalidate(4);
+	sockets.num_queries = 0;
+	for (uint64_t s = 4 + 4 * 16; s < 4 * 64; s += 4 * 16)
+		cache.classify(s, std::ref(sockets));
+	CHECK(sockets.num_queries == 0);
+
+	// More sockets than there are probe slots evict older entries, which are then queried again
+	for (uint64_t s = 4; s < 4 * 64; s += 4)
+		cache.classify(s, std::ref(sockets));
+	sockets.peers[8] = socket_class::local;
+	cache.clear();
+	sockets.num_queries = 0;
+	CHECK(cache.classify(8, std::ref(sockets)) == socket_class::local && sockets.num_queries == 1);
+}
+
+TEST_CASE(socket_cache_concurrent_invalidate)
+{
+	reshade::network::socket_cache<16, 4> cache;
+	std::atomic<int> peer_version { 0 };
+
+	// The peer changes while other threads are classifying the socket, which must not leave an outdated classification in the cache after an invalidation that followed the change
+	std::atomic<bool> stop { false };
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i)
+		threads.emplace_back([&]() {
+			while (!stop.load())
+				cache.classify(8, [&](uint64_t) { return peer_version.load() % 2 == 0 ? socket_class::local : socket_class::remote; });
+		});
+
+	for (int i = 1; i <= 2001; ++i)
+	{
+		peer_version.store(i);
+		cache.invalidate(8);
+		std::this_thread::yield();
+	}
+
+	stop.store(true);
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// The last change made the peer remote, so any entry still in the cache has to say so too
+	CHECK(cache.classify(8, [](uint64_t) { return socket_class::remote; }) == socket_class::remote);
+}
+
+TEST_CASE(traffic_counter)
+{
+	g_network_traffic.reset();
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 8; ++i)
+		threads.emplace_back([]() {
+			for (int k = 0; k < 100000; ++k)
+				g_network_traffic.add(2);
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+
+	CHECK(g_network_traffic.total() == 8 * 100000 * 2);
+	g_network_traffic.reset();
+	CHECK(g_network_traffic.total() == 0);
+}
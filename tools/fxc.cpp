@@ -6,15 +6,32 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_statistics.hpp"
 #include "version.h"
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <list>
+#include <algorithm>
+#include <unordered_map>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#endif
 
 static void print_usage(const char *path)
 {
 	printf(R"(usage: %s [options] <filename>
+       %s [options] <filename|directory|pattern>...
 
 Options:
   -h, --help                Print this help.
@@ -37,7 +54,908 @@ Options:
   --spec-constants          Convert uniform variables to specialization constants.
 
   -Zi                       Enable debug information.
-	)", path);
+  --stats                   Print timings of the compilation steps and counts of tokens, macro expansions, includes, symbols, instructions and allocations.
+
+Batch mode (used when more than one input, a directory or a wildcard pattern like "shaders/*.fx" is specified):
+  -j <count>                Number of files to compile in parallel. Defaults to the number of processor cores.
+  -r, --recursive           Search directories recursively for effect files.
+  --json                    Print results as JSON lines (one object per file, followed by a summary object).
+  -Fo <directory>           Write the output of every file to the given directory.
+
+  Exit code is 0 if all files compiled, 1 if any file failed and 2 if no input files were found.
+
+Server mode (keeps read files and compile results in memory, so that repeated compiles only redo the work for effects whose files changed):
+  --server                  Run as a compile server until it is shut down.
+  --connect                 Forward the compile to a running server. Falls back to compiling locally if no server is running.
+  --shutdown                Shut down a running server.
+  --pipe <name>             Name of the pipe (or socket on non-Windows platforms) the server listens on. Defaults to "ReShadeFXC".
+	)", path, path);
+}
+
+struct compile_options
+{
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::filesystem::path> include_paths;
+	bool print_glsl = false;
+	bool print_hlsl = false;
+	bool debug_info = false;
+	bool invert_y_axis = false;
+	bool spec_constants = false;
+	bool statistics = false;
+	bool keep_output = false; // Keep the generated code (or SPIR-V binary) in 'compile_result::output'
+	unsigned int shader_model = 50;
+};
+
+struct compile_result
+{
+	std::filesystem::path path;
+	bool success = false;
+	bool cached = false;
+	std::string errors;
+	std::string output;
+	std::vector<std::filesystem::path> included_files;
+	reshadefx::compile_statistics stats;
+};
+
+// Allocations are only counted on threads that currently compile with statistics enabled, so this costs a single branch per allocation otherwise
+static thread_local reshadefx::compile_statistics *t_allocation_stats = nullptr;
+
+void *operator new(size_t size)
+{
+	if (t_allocation_stats != nullptr)
+	{
+		t_allocation_stats->num_allocations++;
+		t_allocation_stats->allocated_bytes += size;
+	}
+
+	if (void *const ptr = std::malloc(size != 0 ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+static uint64_t elapsed_microseconds(std::chrono::high_resolution_clock::time_point since)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - since).count();
+}
+
+static void print_statistics(std::ostream &stream, const reshadefx::compile_statistics &stats)
+{
+	char line[512];
+	snprintf(line, sizeof(line),
+		"  preprocess %.3f ms, parse %.3f ms, write_result %.3f ms\n"
+		"  %zu tokens, %zu macro expansions, %zu includes, %zu symbols, %zu instructions, %zu allocations (%zu bytes)\n",
+		stats.preprocess_time / 1000.0, stats.parse_time / 1000.0, stats.write_result_time / 1000.0,
+		stats.num_tokens, stats.num_macro_expansions, stats.num_includes, stats.num_symbols, stats.num_instructions, stats.num_allocations, stats.allocated_bytes);
+	stream << line;
+}
+
+static bool matches_wildcard(const char *pattern, const char *name)
+{
+	// Simple matching of '*' and '?' wildcards, which backtracks to the last '*' on a mismatch
+	const char *star = nullptr, *star_name = nullptr;
+	while (*name != '\0')
+	{
+		if (*pattern == '?' || *pattern == *name)
+			++pattern, ++name;
+		else if (*pattern == '*')
+			star = pattern++, star_name = name;
+		else if (star != nullptr)
+			pattern = star + 1, name = ++star_name;
+		else
+			return false;
+	}
+	while (*pattern == '*')
+		++pattern;
+	return *pattern == '\0';
+}
+
+static void find_input_files(const char *input, bool recursive, std::vector<std::filesystem::path> &files)
+{
+	std::error_code ec;
+	const std::filesystem::path input_path = std::filesystem::u8path(input);
+
+	if (std::strpbrk(input, "*?") != nullptr)
+	{
+		// Wildcards are only supported in the file name part of the path
+		std::filesystem::path directory = input_path.parent_path();
+		if (directory.empty())
+			directory = ".";
+		const std::string pattern = input_path.filename().u8string();
+
+		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, ec))
+			if (!entry.is_directory(ec) && matches_wildcard(pattern.c_str(), entry.path().filename().u8string().c_str()))
+				files.push_back(entry.path());
+	}
+	else if (std::filesystem::is_directory(input_path, ec))
+	{
+		const auto add_file = [&files, &ec](const std::filesystem::directory_entry &entry) {
+			if (!entry.is_directory(ec) && entry.path().extension() == ".fx")
+				files.push_back(entry.path());
+		};
+
+		if (recursive)
+			for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(input_path, std::filesystem::directory_options::skip_permission_denied, ec))
+				add_file(entry);
+		else
+			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(input_path, std::filesystem::directory_options::skip_permission_denied, ec))
+				add_file(entry);
+	}
+	else
+	{
+		files.push_back(input_path);
+	}
+}
+
+static std::string escape_json(const std::string &str)
+{
+	std::string result;
+	result.reserve(str.size() + 2);
+	result += '\"';
+	for (const char c : str)
+	{
+		switch (c)
+		{
+		case '\"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char code[8];
+				snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(c));
+				result += code;
+			}
+			else
+			{
+				result += c;
+			}
+			break;
+		}
+	}
+	result += '\"';
+	return result;
+}
+
+static void compile_file(const compile_options &options, reshadefx::file_cache &include_cache, compile_result &result)
+{
+	if (options.statistics)
+		t_allocation_stats = &result.stats;
+
+	reshadefx::preprocessor pp;
+	pp.set_include_cache(&include_cache);
+	for (const std::pair<std::string, std::string> &macro : options.macros)
+		pp.add_macro_definition(macro.first, macro.second);
+	for (const std::filesystem::path &include_path : options.include_paths)
+		pp.add_include_path(include_path);
+
+	const auto time_preprocess_started = std::chrono::high_resolution_clock::now();
+	const bool preprocessed = pp.append_file(result.path);
+	result.stats.preprocess_time = elapsed_microseconds(time_preprocess_started);
+	result.stats.num_macro_expansions = pp.num_macro_expansions();
+	result.stats.num_includes = pp.num_includes();
+	result.included_files = pp.included_files();
+
+	if (!preprocessed)
+	{
+		result.errors = pp.errors();
+		if (result.errors.empty())
+			result.errors = "error: Failed to open file";
+		t_allocation_stats = nullptr;
+		return;
+	}
+
+	std::unique_ptr<reshadefx::codegen> backend;
+	if (options.print_glsl)
+		backend.reset(reshadefx::create_codegen_glsl(options.debug_info, options.spec_constants));
+	else if (options.print_hlsl)
+		backend.reset(reshadefx::create_codegen_hlsl(options.shader_model, options.debug_info, options.spec_constants));
+	else
+		backend.reset(reshadefx::create_codegen_spirv(true, options.debug_info, options.spec_constants, false, options.invert_y_axis));
+
+	reshadefx::parser parser;
+	const auto time_parse_started = std::chrono::high_resolution_clock::now();
+	result.success = parser.parse(pp.output(), backend.get());
+	result.stats.parse_time = elapsed_microseconds(time_parse_started);
+	result.stats.num_tokens = parser.num_tokens();
+	result.stats.num_symbols = parser.num_symbols();
+	result.errors = pp.errors() + parser.errors();
+
+	// Only need the result when it is kept, or to count the generated instructions
+	if (result.success && (options.keep_output || options.statistics))
+	{
+		reshadefx::module module;
+		const auto time_write_result_started = std::chrono::high_resolution_clock::now();
+		backend->write_result(module);
+		result.stats.write_result_time = elapsed_microseconds(time_write_result_started);
+		result.stats.num_instructions = reshadefx::count_instructions(module);
+
+		// Allocations made for keeping the output are not part of the compilation
+		t_allocation_stats = nullptr;
+
+		if (options.keep_output)
+		{
+			if (options.print_glsl || options.print_hlsl)
+				result.output = std::move(module.hlsl);
+			else
+				result.output.assign(reinterpret_cast<const char *>(module.spirv.data()), module.spirv.size() * sizeof(uint32_t));
+		}
+	}
+
+	t_allocation_stats = nullptr;
+}
+
+static void write_output_file(const compile_options &options, const std::filesystem::path &output_directory, const compile_result &result)
+{
+	std::filesystem::path output_path = output_directory / result.path.filename();
+	if (options.print_glsl || options.print_hlsl)
+		std::ofstream(output_path.replace_extension(options.print_glsl ? ".glsl" : ".hlsl")) << result.output;
+	else
+		std::ofstream(output_path.replace_extension(".spv"), std::ios::binary).write(result.output.data(), result.output.size());
+}
+
+static void print_result(const compile_options &options, const compile_result &result, bool json_output)
+{
+	const reshadefx::compile_statistics &stats = result.stats;
+
+	if (json_output)
+	{
+		char timings[128];
+		snprintf(timings, sizeof(timings), ",\"preprocess_ms\":%.3f,\"compile_ms\":%.3f,\"total_ms\":%.3f", stats.preprocess_time / 1000.0, (stats.parse_time + stats.write_result_time) / 1000.0, stats.total_time() / 1000.0);
+
+		std::cout << "{\"file\":" << escape_json(result.path.u8string()) << ",\"success\":" << (result.success ? "true" : "false") << ",\"cached\":" << (result.cached ? "true" : "false") << timings;
+
+		if (options.statistics)
+		{
+			char details[512];
+			snprintf(details, sizeof(details), ",\"parse_ms\":%.3f,\"write_result_ms\":%.3f,\"tokens\":%zu,\"macro_expansions\":%zu,\"includes\":%zu,\"symbols\":%zu,\"instructions\":%zu,\"allocations\":%zu,\"allocated_bytes\":%zu",
+				stats.parse_time / 1000.0, stats.write_result_time / 1000.0, stats.num_tokens, stats.num_macro_expansions, stats.num_includes, stats.num_symbols, stats.num_instructions, stats.num_allocations, stats.allocated_bytes);
+			std::cout << details;
+		}
+
+		std::cout << ",\"errors\":" << escape_json(result.errors) << '}' << std::endl;
+	}
+	else
+	{
+		char timings[64];
+		snprintf(timings, sizeof(timings), result.cached ? " (cached)" : " (%.1f ms)", stats.total_time() / 1000.0);
+
+		std::cout << result.path.u8string() << ": " << (result.success ? "succeeded" : "failed") << timings << std::endl;
+		if (options.statistics)
+			print_statistics(std::cout, stats);
+		if (!result.errors.empty())
+			std::cout << result.errors;
+	}
+}
+
+static void print_summary(size_t num_files, size_t num_failed, double total_ms, bool json_output)
+{
+	if (json_output)
+	{
+		char summary[256];
+		snprintf(summary, sizeof(summary), "{\"summary\":true,\"files\":%zu,\"succeeded\":%zu,\"failed\":%zu,\"total_ms\":%.3f}", num_files, num_files - num_failed, num_failed, total_ms);
+		std::cout << summary << std::endl;
+	}
+	else
+	{
+		char summary[128];
+		snprintf(summary, sizeof(summary), "%zu succeeded, %zu failed (%.1f ms)", num_files - num_failed, num_failed, total_ms);
+		std::cout << summary << std::endl;
+	}
+}
+
+static int compile_batch(compile_options options, const std::vector<const char *> &inputs, bool recursive, unsigned int num_threads, bool json_output, const char *output_directory)
+{
+	const auto time_started = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::filesystem::path> files;
+	for (const char *input : inputs)
+		find_input_files(input, recursive, files);
+
+	std::sort(files.begin(), files.end());
+	files.erase(std::unique(files.begin(), files.end()), files.end());
+
+	if (files.empty())
+	{
+		if (json_output)
+			std::cout << "{\"summary\":true,\"files\":0,\"succeeded\":0,\"failed\":0,\"total_ms\":0}" << std::endl;
+		else
+			std::cout << "error: No input files found" << std::endl;
+		return 2;
+	}
+
+	if (output_directory != nullptr)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(std::filesystem::u8path(output_directory), ec);
+		options.keep_output = true;
+	}
+
+	if (num_threads == 0)
+		num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	num_threads = std::min<unsigned int>(num_threads, static_cast<unsigned int>(files.size()));
+
+	// Include files are shared between all files and threads, so that common headers are only read once
+	reshadefx::file_cache include_cache;
+
+	std::mutex output_mutex;
+	std::atomic<size_t> next_file = 0;
+	size_t num_failed = 0;
+
+	const auto worker = [&]() {
+		for (size_t index; (index = next_file++) < files.size();)
+		{
+			compile_result result;
+			result.path = files[index];
+			compile_file(options, include_cache, result);
+
+			if (output_directory != nullptr && result.success)
+				write_output_file(options, std::filesystem::u8path(output_directory), result);
+
+			// Print results as soon as they are available, so that progress is visible for large directories
+			const std::lock_guard<std::mutex> lock(output_mutex);
+
+			if (!result.success)
+				num_failed++;
+
+			print_result(options, result, json_output);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < num_threads; ++i)
+		threads.emplace_back(worker);
+	worker(); // Use the main thread as one of the workers
+	for (std::thread &thread : threads)
+		thread.join();
+
+	const double total_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - time_started).count();
+
+	print_summary(files.size(), num_failed, total_ms, json_output);
+
+	return num_failed != 0 ? 1 : 0;
+}
+
+// Compile server, which keeps include files and compile results of previous requests in memory, so that repeated compiles of the same effects only need to do work for what changed
+// Messages are exchanged over a named pipe on Windows and a Unix domain socket elsewhere, each prefixed with its size
+
+#ifdef _WIN32
+typedef HANDLE connection_handle;
+static const connection_handle invalid_connection = INVALID_HANDLE_VALUE;
+#else
+typedef int connection_handle;
+static const connection_handle invalid_connection = -1;
+#endif
+
+enum class request_type : uint8_t
+{
+	compile,
+	shutdown,
+};
+
+static std::string get_server_address(const char *name)
+{
+#ifdef _WIN32
+	return std::string("\\\\.\\pipe\\") + name;
+#else
+	return (std::filesystem::temp_directory_path() / (std::string(name) + ".sock")).u8string();
+#endif
+}
+
+static void close_connection(connection_handle connection)
+{
+#ifdef _WIN32
+	CloseHandle(connection);
+#else
+	close(connection);
+#endif
+}
+
+static bool write_bytes(connection_handle connection, const char *data, size_t size)
+{
+	while (size != 0)
+	{
+#ifdef _WIN32
+		DWORD written = 0;
+		if (!WriteFile(connection, data, static_cast<DWORD>(std::min<size_t>(size, 1 << 20)), &written, nullptr))
+			return false;
+#else
+		const ssize_t written = send(connection, data, size, MSG_NOSIGNAL);
+		if (written <= 0)
+			return false;
+#endif
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+static bool read_bytes(connection_handle connection, char *data, size_t size)
+{
+	while (size != 0)
+	{
+#ifdef _WIN32
+		DWORD read = 0;
+		if (!ReadFile(connection, data, static_cast<DWORD>(std::min<size_t>(size, 1 << 20)), &read, nullptr) || read == 0)
+			return false;
+#else
+		const ssize_t read = recv(connection, data, size, 0);
+		if (read <= 0)
+			return false;
+#endif
+		data += read;
+		size -= read;
+	}
+	return true;
+}
+
+// Limits for requests the server accepts, so that a malformed request cannot make it allocate arbitrary amounts of memory
+static const uint32_t max_request_size = 64 * 1024 * 1024;
+static const size_t max_request_macros = 4096;
+static const size_t max_request_include_paths = 1024;
+static const size_t max_request_files = 65536;
+
+static bool send_message(connection_handle connection, const std::string &message)
+{
+	const uint32_t size = static_cast<uint32_t>(message.size());
+	return write_bytes(connection, reinterpret_cast<const char *>(&size), sizeof(size)) && write_bytes(connection, message.data(), message.size());
+}
+static bool receive_message_size(connection_handle connection, uint32_t &size)
+{
+	return read_bytes(connection, reinterpret_cast<char *>(&size), sizeof(size));
+}
+static bool receive_message_data(connection_handle connection, uint32_t size, std::string &message)
+{
+	message.resize(size);
+	return read_bytes(connection, message.data(), size);
+}
+static bool receive_message(connection_handle connection, std::string &message)
+{
+	uint32_t size = 0;
+	return receive_message_size(connection, size) && receive_message_data(connection, size, message);
+}
+
+class message_writer
+{
+public:
+	explicit message_writer(std::string &message) : _message(message) {}
+
+	void write(uint64_t value)
+	{
+		_message.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+	void write(const std::string &value)
+	{
+		write(static_cast<uint64_t>(value.size()));
+		_message += value;
+	}
+
+private:
+	std::string &_message;
+};
+
+class message_reader
+{
+public:
+	explicit message_reader(const std::string &message) : _it(message.data()), _end(message.data() + message.size()) {}
+
+	bool read(uint64_t &value)
+	{
+		if (static_cast<size_t>(_end - _it) < sizeof(value))
+			return false;
+		std::memcpy(&value, _it, sizeof(value));
+		_it += sizeof(value);
+		return true;
+	}
+	bool read(std::string &value)
+	{
+		uint64_t size = 0;
+		if (!read(size) || static_cast<uint64_t>(_end - _it) < size)
+			return false;
+		value.assign(_it, static_cast<size_t>(size));
+		_it += size;
+		return true;
+	}
+	template <typename T>
+	bool read_as(T &value)
+	{
+		uint64_t data = 0;
+		if (!read(data))
+			return false;
+		value = static_cast<T>(data);
+		return true;
+	}
+
+private:
+	const char *_it, *_end;
+};
+
+static void write_options(message_writer &writer, const compile_options &options)
+{
+	writer.write(options.macros.size());
+	for (const std::pair<std::string, std::string> &macro : options.macros)
+		writer.write(macro.first), writer.write(macro.second);
+	writer.write(options.include_paths.size());
+	for (const std::filesystem::path &include_path : options.include_paths)
+		writer.write(include_path.u8string());
+	writer.write(
+		(options.print_glsl ? 0x1 : 0) | (options.print_hlsl ? 0x2 : 0) | (options.debug_info ? 0x4 : 0) | (options.invert_y_axis ? 0x8 : 0) |
+		(options.spec_constants ? 0x10 : 0) | (options.statistics ? 0x20 : 0) | (options.keep_output ? 0x40 : 0));
+	writer.write(options.shader_model);
+}
+static bool read_options(message_reader &reader, compile_options &options)
+{
+	size_t num_macros = 0;
+	if (!reader.read_as(num_macros) || num_macros > max_request_macros)
+		return false;
+	options.macros.resize(num_macros);
+	for (std::pair<std::string, std::string> &macro : options.macros)
+		if (!reader.read(macro.first) || !reader.read(macro.second))
+			return false;
+
+	size_t num_include_paths = 0;
+	if (!reader.read_as(num_include_paths) || num_include_paths > max_request_include_paths)
+		return false;
+	options.include_paths.resize(num_include_paths);
+	for (std::filesystem::path &include_path : options.include_paths)
+	{
+		std::string path;
+		if (!reader.read(path))
+			return false;
+		include_path = std::filesystem::u8path(path);
+	}
+
+	uint64_t flags = 0;
+	if (!reader.read(flags) || !reader.read_as(options.shader_model))
+		return false;
+	options.print_glsl = (flags & 0x1) != 0;
+	options.print_hlsl = (flags & 0x2) != 0;
+	options.debug_info = (flags & 0x4) != 0;
+	options.invert_y_axis = (flags & 0x8) != 0;
+	options.spec_constants = (flags & 0x10) != 0;
+	options.statistics = (flags & 0x20) != 0;
+	options.keep_output = (flags & 0x40) != 0;
+	return true;
+}
+
+static void write_compile_result(message_writer &writer, const compile_result &result)
+{
+	writer.write(result.success);
+	writer.write(result.cached);
+	writer.write(result.errors);
+	writer.write(result.output);
+	const reshadefx::compile_statistics &stats = result.stats;
+	for (const uint64_t value : { stats.preprocess_time, stats.parse_time, stats.write_result_time })
+		writer.write(value);
+	for (const size_t value : { stats.num_tokens, stats.num_macro_expansions, stats.num_includes, stats.num_symbols, stats.num_instructions, stats.num_allocations, stats.allocated_bytes })
+		writer.write(value);
+}
+static bool read_compile_result(message_reader &reader, compile_result &result)
+{
+	reshadefx::compile_statistics &stats = result.stats;
+	return reader.read_as(result.success) && reader.read_as(result.cached) && reader.read(result.errors) && reader.read(result.output) &&
+		reader.read(stats.preprocess_time) && reader.read(stats.parse_time) && reader.read(stats.write_result_time) &&
+		reader.read_as(stats.num_tokens) && reader.read_as(stats.num_macro_expansions) && reader.read_as(stats.num_includes) && reader.read_as(stats.num_symbols) && reader.read_as(stats.num_instructions) &&
+		reader.read_as(stats.num_allocations) && reader.read_as(stats.allocated_bytes);
+}
+
+static connection_handle connect_to_server(const char *name)
+{
+	const std::string address = get_server_address(name);
+
+#ifdef _WIN32
+	for (int attempt = 0; attempt < 10; ++attempt)
+	{
+		const HANDLE pipe = CreateFileA(address.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		if (pipe != INVALID_HANDLE_VALUE)
+			return pipe;
+
+		// Wait for the server to finish with another client if all pipe instances are busy
+		if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(address.c_str(), 2000))
+			break;
+	}
+	return invalid_connection;
+#else
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (address.size() >= sizeof(addr.sun_path))
+		return invalid_connection;
+	std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+
+	const int socket_handle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (socket_handle < 0)
+		return invalid_connection;
+	if (connect(socket_handle, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+		return close(socket_handle), invalid_connection;
+	return socket_handle;
+#endif
+}
+
+static bool send_request(const char *name, const std::string &request, std::string &response)
+{
+	const connection_handle connection = connect_to_server(name);
+	if (connection == invalid_connection)
+		return false;
+
+	const bool success = send_message(connection, request) && receive_message(connection, response);
+	close_connection(connection);
+	return success;
+}
+
+// Maximum number of compile results the server keeps in memory
+static const size_t max_cached_compiles = 1024;
+
+static int run_server(const char *name)
+{
+	const std::string address = get_server_address(name);
+
+#ifdef _WIN32
+	// Use a single pipe instance, so that clients wait in 'WaitNamedPipe' while another request is processed
+	const auto create_pipe = [&address]() {
+		return CreateNamedPipeA(address.c_str(), PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 1 << 16, 1 << 16, 0, nullptr);
+	};
+	HANDLE pipe = create_pipe();
+	if (pipe == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "error: Failed to create pipe " << address << std::endl;
+		return 1;
+	}
+#else
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (address.size() >= sizeof(addr.sun_path))
+		return 1;
+	std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+
+	const int server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	// Remove a socket file left behind by a previous server that was killed
+	unlink(address.c_str());
+	if (server_socket < 0 || bind(server_socket, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 || listen(server_socket, 16) != 0)
+	{
+		std::cout << "error: Failed to listen on " << address << std::endl;
+		return 1;
+	}
+#endif
+
+	std::cout << "Listening on " << address << std::endl;
+
+	// Contents of all read files, which are only read again from disk after they were modified
+	reshadefx::file_cache include_cache;
+
+	// Results of successful compiles, keyed by options and file path, together with the modification times of all files they depend on
+	struct cached_compile
+	{
+		compile_result result;
+		std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> dependencies;
+		std::list<std::string>::iterator lru_position;
+	};
+	std::unordered_map<std::string, cached_compile> compile_cache;
+	// Keys of the cached results from least to most recently used, so that the oldest one can be evicted once the cache is full
+	std::list<std::string> compile_cache_order;
+
+	// Wait a little longer after every failed attempt to accept a connection, so that an error that persists does not make the server spin
+	unsigned int num_failed_connects = 0;
+	const auto back_off = [&num_failed_connects]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(1u << std::min(num_failed_connects, 10u), 1000u)));
+		num_failed_connects++;
+	};
+
+	for (bool running = true; running;)
+	{
+#ifdef _WIN32
+		const HANDLE connection = pipe;
+		if (!ConnectNamedPipe(connection, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED)
+		{
+			// A client may have connected and closed its end again already, in which case the pipe has to be disconnected before it can accept the next one
+			DisconnectNamedPipe(connection);
+
+			// Start over with a new pipe if that keeps failing, in case this one is broken
+			if (num_failed_connects != 0 && num_failed_connects % 8 == 0)
+			{
+				CloseHandle(pipe);
+				pipe = create_pipe();
+				if (pipe == INVALID_HANDLE_VALUE)
+				{
+					std::cout << "error: Failed to recreate pipe " << address << std::endl;
+					return 1;
+				}
+			}
+
+			back_off();
+			continue;
+		}
+#else
+		const int connection = accept(server_socket, nullptr, nullptr);
+		if (connection < 0)
+		{
+			back_off();
+			continue;
+		}
+#endif
+
+		num_failed_connects = 0;
+
+		const auto disconnect = [connection]() {
+#ifdef _WIN32
+			FlushFileBuffers(connection);
+			DisconnectNamedPipe(connection);
+#else
+			close(connection);
+#endif
+		};
+
+		const auto reject = [connection, &disconnect](const char *message) {
+			std::string response;
+			message_writer writer(response);
+			writer.write(false);
+			writer.write(message);
+			send_message(connection, response);
+			disconnect();
+		};
+
+		std::string request, response;
+		uint32_t request_size = 0;
+		if (!receive_message_size(connection, request_size))
+		{
+			disconnect();
+			continue;
+		}
+		if (request_size > max_request_size)
+		{
+			reject("request is too large");
+			continue;
+		}
+		if (!receive_message_data(connection, request_size, request))
+		{
+			disconnect();
+			continue;
+		}
+
+		message_reader reader(request);
+		message_writer writer(response);
+
+		request_type type = request_type::compile;
+		compile_options options;
+		size_t num_files = 0;
+		if (!reader.read_as(type) || (type == request_type::compile && (!read_options(reader, options) || !reader.read_as(num_files) || num_files > max_request_files)))
+		{
+			reject("request is malformed or exceeds the limits of the server");
+			continue;
+		}
+
+		writer.write(true);
+
+		if (type == request_type::shutdown)
+		{
+			running = false;
+		}
+		else
+		{
+			// Only check for modified files once per request, instead of for every file of every compile
+			include_cache.remove_modified();
+
+			std::string options_key;
+			message_writer options_writer(options_key);
+			write_options(options_writer, options);
+
+			std::error_code ec;
+			writer.write(num_files);
+
+			for (size_t i = 0; i < num_files; ++i)
+			{
+				std::string path;
+				if (!reader.read(path))
+					break;
+
+				std::string key = options_key + path;
+				auto it = compile_cache.find(key);
+				if (it == compile_cache.end())
+				{
+					// Keep memory usage bounded no matter how many different files and option combinations are compiled over the lifetime of the server
+					if (compile_cache.size() >= max_cached_compiles)
+					{
+						compile_cache.erase(compile_cache_order.front());
+						compile_cache_order.pop_front();
+					}
+
+					it = compile_cache.try_emplace(key).first;
+					it->second.lru_position = compile_cache_order.insert(compile_cache_order.end(), std::move(key));
+				}
+				else
+				{
+					compile_cache_order.splice(compile_cache_order.end(), compile_cache_order, it->second.lru_position);
+				}
+
+				cached_compile &entry = it->second;
+
+				// Reuse the previous result if the effect file and none of its included files changed since
+				if (!entry.dependencies.empty() && std::all_of(entry.dependencies.begin(), entry.dependencies.end(),
+						[&ec](const auto &dependency) { return std::filesystem::last_write_time(dependency.first, ec) == dependency.second && !ec; }))
+				{
+					entry.result.cached = true;
+					write_compile_result(writer, entry.result);
+					continue;
+				}
+
+				// Get modification times before compiling, so that changes during the compile cause another compile on the next request
+				const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(std::filesystem::u8path(path), ec);
+
+				compile_result &result = entry.result;
+				result = {};
+				result.path = std::filesystem::u8path(path);
+				compile_file(options, include_cache, result);
+
+				write_compile_result(writer, result);
+
+				// Failed compiles are not cached, since they may depend on files that do not exist (yet)
+				entry.dependencies.clear();
+				if (result.success)
+				{
+					entry.dependencies.emplace_back(result.path, modified_at);
+					for (const std::filesystem::path &included_file : result.included_files)
+						entry.dependencies.emplace_back(included_file, std::filesystem::last_write_time(included_file, ec));
+				}
+			}
+		}
+
+		send_message(connection, response);
+		disconnect();
+	}
+
+#ifdef _WIN32
+	CloseHandle(pipe);
+#else
+	close(server_socket);
+	unlink(address.c_str());
+#endif
+	return 0;
+}
+
+static bool compile_on_server(const char *name, const compile_options &options, const std::vector<std::filesystem::path> &files, std::vector<compile_result> &results)
+{
+	std::string request, response;
+	message_writer writer(request);
+	writer.write(static_cast<uint64_t>(request_type::compile));
+	write_options(writer, options);
+	writer.write(files.size());
+	for (const std::filesystem::path &path : files)
+		writer.write(path.u8string());
+
+	if (!send_request(name, request, response))
+		return false;
+
+	message_reader reader(response);
+	bool accepted = false;
+	if (!reader.read_as(accepted))
+		return false;
+	if (!accepted)
+	{
+		std::string message;
+		if (reader.read(message))
+			std::cout << "warning: Compile server rejected the request: " << message << std::endl;
+		return false;
+	}
+
+	size_t num_results = 0;
+	if (!reader.read_as(num_results) || num_results != files.size())
+		return false;
+
+	results.resize(num_results);
+	for (size_t i = 0; i < num_results; ++i)
+	{
+		results[i].path = files[i];
+		if (!read_compile_result(reader, results[i]))
+			return false;
+	}
+	return true;
 }
 
 int main(int argc, char *argv[])
@@ -53,12 +971,25 @@ int main(int argc, char *argv[])
 	bool debug_info = false;
 	bool invert_y_axis = false;
 	bool spec_constants = false;
+	bool statistics = false;
 	unsigned int shader_model = 50;
+	bool batch_mode = false;
+	bool json_output = false;
+	bool recursive = false;
+	unsigned int num_threads = 0;
+	const char *server_name = "ReShadeFXC";
+	bool server_mode = false;
+	bool connect = false;
+	bool shutdown_server = false;
+	std::vector<const char *> inputs;
+	compile_options batch_options;
 
 	reshadefx::parser parser;
 	reshadefx::preprocessor pp;
 	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
 	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+	batch_options.macros.emplace_back("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+	batch_options.macros.emplace_back("__RESHADE_PERFORMANCE_MODE__", "0");
 
 	// Parse command-line arguments
 	for (int i = 1; i < argc; ++i)
@@ -82,12 +1013,14 @@ int main(int argc, char *argv[])
 				char *value = std::strchr(macro, '=');
 				if (value) *value++ = '\0';
 				pp.add_macro_definition(macro, value ? value : "1");
+				batch_options.macros.emplace_back(macro, value ? value : "1");
 				continue;
 			}
 
 			if (0 == std::strcmp(arg, "-I"))
 			{
 				pp.add_include_path(argv[++i]);
+				batch_options.include_paths.push_back(std::filesystem::u8path(argv[i]));
 				continue;
 			}
 
@@ -101,6 +1034,18 @@ int main(int argc, char *argv[])
 				invert_y_axis = true;
 			else if (0 == std::strcmp(arg, "--spec-constants"))
 				spec_constants = true;
+			else if (0 == std::strcmp(arg, "--stats"))
+				statistics = true;
+			else if (0 == std::strcmp(arg, "--json"))
+				json_output = batch_mode = true;
+			else if (0 == std::strcmp(arg, "-r") || 0 == std::strcmp(arg, "--recursive"))
+				recursive = true;
+			else if (0 == std::strcmp(arg, "--server"))
+				server_mode = true;
+			else if (0 == std::strcmp(arg, "--connect"))
+				connect = true;
+			else if (0 == std::strcmp(arg, "--shutdown"))
+				shutdown_server = true;
 
 			if (i + 1 >= argc)
 				continue;
@@ -116,19 +1061,32 @@ int main(int argc, char *argv[])
 				buffer_width = argv[++i];
 			else if (0 == std::strcmp(arg, "--height"))
 				buffer_height = argv[++i];
+			else if (0 == std::strcmp(arg, "-j"))
+				num_threads = std::strtoul(argv[++i], nullptr, 10);
+			else if (0 == std::strcmp(arg, "--pipe"))
+				server_name = argv[++i];
 		}
 		else
 		{
-			if (filename != nullptr)
-			{
-				std::cout << "error: More than one input file specified" << std::endl;
-				return 1;
-			}
+			// Compile all files in batch mode if there is more than one or the input has to be searched for files
+			if (std::error_code ec; !inputs.empty() || std::strpbrk(arg, "*?") != nullptr || std::filesystem::is_directory(std::filesystem::u8path(arg), ec))
+				batch_mode = true;
 
+			inputs.push_back(arg);
 			filename = arg;
 		}
 	}
 
+	if (server_mode)
+		return run_server(server_name);
+
+	if (shutdown_server)
+	{
+		std::string request, response;
+		message_writer(request).write(static_cast<uint64_t>(request_type::shutdown));
+		return send_request(server_name, request, response) ? 0 : 1;
+	}
+
 	if (filename == nullptr)
 	{
 		print_usage(argv[0]);
@@ -140,8 +1098,102 @@ int main(int argc, char *argv[])
 	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
 	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
 
-	if (!pp.append_file(filename))
+	batch_options.macros.emplace_back("BUFFER_WIDTH", buffer_width);
+	batch_options.macros.emplace_back("BUFFER_HEIGHT", buffer_height);
+	batch_options.macros.emplace_back("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	batch_options.macros.emplace_back("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	batch_options.print_glsl = print_glsl;
+	batch_options.print_hlsl = print_hlsl;
+	batch_options.debug_info = debug_info;
+	batch_options.invert_y_axis = invert_y_axis;
+	batch_options.spec_constants = spec_constants;
+	batch_options.statistics = statistics;
+	batch_options.shader_model = shader_model;
+
+	// Forward the compile to a running server (pre-processing to a file is always done locally)
+	if (connect && preprocess == nullptr)
+	{
+		const auto time_started = std::chrono::high_resolution_clock::now();
+
+		// Server may run in a different working directory, so only send absolute paths
+		std::error_code ec;
+		std::vector<std::filesystem::path> files;
+		for (const char *input : inputs)
+			find_input_files(input, recursive, files);
+		for (std::filesystem::path &path : files)
+			path = std::filesystem::absolute(path, ec).lexically_normal();
+		std::sort(files.begin(), files.end());
+		files.erase(std::unique(files.begin(), files.end()), files.end());
+
+		compile_options remote_options = batch_options;
+		for (std::filesystem::path &include_path : remote_options.include_paths)
+			include_path = std::filesystem::absolute(include_path, ec);
+		remote_options.keep_output = batch_mode ? objectfile != nullptr : print_glsl || print_hlsl || objectfile != nullptr;
+
+		if (std::vector<compile_result> results;
+			!files.empty() && compile_on_server(server_name, remote_options, files, results))
+		{
+			if (!batch_mode)
+			{
+				const compile_result &result = results[0];
+
+				if (!result.success)
+				{
+					if (errorfile == nullptr)
+						std::cout << result.errors << std::endl;
+					else
+						std::ofstream(errorfile) << result.errors;
+				}
+				else if (print_glsl || print_hlsl)
+					std::cout << result.output << std::endl;
+				else if (objectfile != nullptr)
+					std::ofstream(objectfile, std::ios::binary).write(result.output.data(), result.output.size());
+
+				if (statistics)
+					print_statistics(std::cerr, result.stats);
+
+				return result.success ? 0 : 1;
+			}
+
+			if (objectfile != nullptr)
+				std::filesystem::create_directories(std::filesystem::u8path(objectfile), ec);
+
+			size_t num_failed = 0;
+			for (const compile_result &result : results)
+			{
+				if (!result.success)
+					num_failed++;
+				else if (objectfile != nullptr)
+					write_output_file(remote_options, std::filesystem::u8path(objectfile), result);
+
+				print_result(remote_options, result, json_output);
+			}
+
+			print_summary(results.size(), num_failed, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - time_started).count(), json_output);
+
+			return num_failed != 0 ? 1 : 0;
+		}
+
+		// Fall back to compiling locally if no server is running
+	}
+
+	if (batch_mode)
+		return compile_batch(batch_options, inputs, recursive, num_threads, json_output, objectfile);
+
+	reshadefx::compile_statistics stats;
+	if (statistics)
+		t_allocation_stats = &stats;
+
+	const auto time_preprocess_started = std::chrono::high_resolution_clock::now();
+	const bool preprocessed = pp.append_file(filename);
+	stats.preprocess_time = elapsed_microseconds(time_preprocess_started);
+	stats.num_macro_expansions = pp.num_macro_expansions();
+	stats.num_includes = pp.num_includes();
+
+	if (!preprocessed)
 	{
+		t_allocation_stats = nullptr;
+
 		if (errorfile == nullptr)
 			std::cout << pp.errors() << std::endl;
 		else
@@ -151,6 +1203,8 @@ int main(int argc, char *argv[])
 
 	if (preprocess != nullptr)
 	{
+		t_allocation_stats = nullptr;
+
 		if (std::strcmp(preprocess, "-") == 0)
 			std::cout << pp.output() << std::endl;
 		else
@@ -164,19 +1218,38 @@ int main(int argc, char *argv[])
 	else if (print_hlsl)
 		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
 	else
-		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, false, invert_y_axis));
+
+	const auto time_parse_started = std::chrono::high_resolution_clock::now();
+	const bool parsed = parser.parse(pp.output(), backend.get());
+	stats.parse_time = elapsed_microseconds(time_parse_started);
+	stats.num_tokens = parser.num_tokens();
+	stats.num_symbols = parser.num_symbols();
 
-	if (!parser.parse(pp.output(), backend.get()))
+	if (!parsed)
 	{
+		t_allocation_stats = nullptr;
+
 		if (errorfile == nullptr)
 			std::cout << pp.errors() << parser.errors() << std::endl;
 		else
 			std::ofstream(errorfile) << pp.errors() << parser.errors();
+		if (statistics)
+			print_statistics(std::cerr, stats);
 		return 1;
 	}
 
 	reshadefx::module module;
+	const auto time_write_result_started = std::chrono::high_resolution_clock::now();
 	backend->write_result(module);
+	stats.write_result_time = elapsed_microseconds(time_write_result_started);
+	stats.num_instructions = reshadefx::count_instructions(module);
+
+	t_allocation_stats = nullptr;
+
+	// Statistics go to the error stream, so that they do not mix with code printed to the standard output
+	if (statistics)
+		print_statistics(std::cerr, stats);
 
 	if (print_glsl || print_hlsl)
 	{